@@ -772,6 +772,8 @@ ReplayOptions::ReplayOptions(const QVariant &var)
     forceGPUDriverName = map[lit("forceGPUDriverName")].toString();
   if(map.contains(lit("optimisation")))
     optimisation = (ReplayOptimisationLevel)map[lit("optimisation")].toUInt();
+  if(map.contains(lit("analysisOnly")))
+    analysisOnly = map[lit("analysisOnly")].toBool();
 }
 
 ReplayOptions::operator QVariant() const
@@ -783,6 +785,7 @@ ReplayOptions::operator QVariant() const
   map[lit("forceGPUDeviceID")] = forceGPUDeviceID;
   map[lit("forceGPUDriverName")] = forceGPUDriverName;
   map[lit("optimisation")] = (uint32_t)optimisation;
+  map[lit("analysisOnly")] = analysisOnly;
 
   return map;
 }
@@ -181,6 +181,7 @@ DEFINE_SAFE_EQUALITY(EnvironmentModification)
 DEFINE_SAFE_EQUALITY(EventUsage)
 DEFINE_SAFE_EQUALITY(PathEntry)
 DEFINE_SAFE_EQUALITY(PixelModification)
+DEFINE_SAFE_EQUALITY(PixelHistoryResult)
 DEFINE_SAFE_EQUALITY(ResourceDescription)
 DEFINE_SAFE_EQUALITY(ResourceId)
 DEFINE_SAFE_EQUALITY(LineColumnInfo)
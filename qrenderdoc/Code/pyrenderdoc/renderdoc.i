@@ -370,6 +370,7 @@ TEMPLATE_ARRAY_INSTANTIATE(rdcarray, EnvironmentModification)
 TEMPLATE_ARRAY_INSTANTIATE(rdcarray, EventUsage)
 TEMPLATE_ARRAY_INSTANTIATE(rdcarray, PathEntry)
 TEMPLATE_ARRAY_INSTANTIATE(rdcarray, PixelModification)
+TEMPLATE_ARRAY_INSTANTIATE(rdcarray, PixelHistoryResult)
 TEMPLATE_ARRAY_INSTANTIATE(rdcarray, ResourceDescription)
 TEMPLATE_ARRAY_INSTANTIATE(rdcarray, ResourceId)
 TEMPLATE_ARRAY_INSTANTIATE(rdcarray, LineColumnInfo)
@@ -565,6 +566,137 @@ extern "C" PyObject *RENDERDOC_DumpObject(PyObject *obj)
 
 %}
 
+///////////////////////////////////////////////////////////////////////////////////////////
+// Pure python helpers
+
+%pythoncode %{
+class _ColumnarStrings(object):
+    """A dictionary encoded string column, see :func:`ReadColumnarExport`."""
+
+    def __init__(self):
+        import array
+        self.dictionary = []
+        self.indices = array.array('I')
+        self._lookup = {}
+
+    def _append(self, strings, indices):
+        import array
+
+        # the file's dictionaries are per row group, merge them into one for the whole column
+        remap = array.array('I')
+        for s in strings:
+            idx = self._lookup.get(s)
+            if idx is None:
+                idx = len(self.dictionary)
+                self._lookup[s] = idx
+                self.dictionary.append(s)
+            remap.append(idx)
+
+        if len(self.indices) == 0:
+            # the first row group's dictionary is always the identity mapping
+            self.indices = indices
+        else:
+            self.indices.extend(map(remap.__getitem__, indices))
+
+    def __len__(self):
+        return len(self.indices)
+
+    def __getitem__(self, i):
+        if isinstance(i, slice):
+            return [self.dictionary[idx] for idx in self.indices[i]]
+        return self.dictionary[self.indices[i]]
+
+    def __iter__(self):
+        return (self.dictionary[idx] for idx in self.indices)
+
+def ReadColumnarExport(filename):
+    """Reads a file written by the ``rdcols`` columnar capture exporter.
+
+Numeric columns are returned as :class:`array.array` so they can be passed directly to e.g.
+``numpy.frombuffer`` without conversion.
+
+String columns stay dictionary encoded: they have a ``dictionary`` list of the unique str values and
+an ``indices`` :class:`array.array` of ``'I'`` with the dictionary index for each row. Indexing or
+iterating the column decodes values on demand, so ``col[i]`` is ``col.dictionary[col.indices[i]]``.
+
+:param str filename: The path to the exported file.
+:return: A dict with ``version`` for the structured data version, ``driver`` for the driver name,
+  and ``tables`` which maps each table name to a dict of column name to column values.
+:rtype: dict
+"""
+    import array
+    import struct
+    import sys
+
+    with open(filename, 'rb') as f:
+        data = memoryview(f.read())
+
+    if bytes(data[0:8]) != b'RDCCOLS\0':
+        raise ValueError("'{}' is not a columnar export".format(filename))
+
+    # ColumnType -> (array typecode, byte size)
+    fixed = {0: ('I', 4), 1: ('Q', 8), 2: ('q', 8), 3: ('d', 8)}
+    string_type = 4
+
+    offs = 8
+
+    def read(fmt):
+        nonlocal offs
+        vals = struct.unpack_from('<' + fmt, data, offs)
+        offs += struct.calcsize('<' + fmt)
+        return vals[0] if len(vals) == 1 else vals
+
+    def read_string():
+        nonlocal offs
+        length = read('I')
+        ret = str(data[offs:offs + length], 'utf-8')
+        offs += length
+        return ret
+
+    format_version = read('I')
+    if format_version != 1:
+        raise ValueError("Unsupported columnar export version {}".format(format_version))
+
+    ret = {'version': read('Q'), 'driver': read_string(), 'tables': {}}
+
+    for t in range(read('I')):
+        name = read_string()
+        columns = [(read_string(), read('I')) for c in range(read('I'))]
+
+        table = {}
+        for col, coltype in columns:
+            if coltype == string_type:
+                table[col] = _ColumnarStrings()
+            else:
+                table[col] = array.array(fixed[coltype][0])
+
+        rows = read('Q')
+        while rows > 0:
+            for col, coltype in columns:
+                if coltype == string_type:
+                    strings = [read_string() for s in range(read('I'))]
+                    indices = array.array('I')
+                    indices.frombytes(data[offs:offs + rows * 4])
+                    if sys.byteorder == 'big':
+                        indices.byteswap()
+                    offs += rows * 4
+                    table[col]._append(strings, indices)
+                else:
+                    size = rows * fixed[coltype][1]
+                    vals = array.array(fixed[coltype][0])
+                    vals.frombytes(data[offs:offs + size])
+                    if sys.byteorder == 'big':
+                        vals.byteswap()
+                    table[col].extend(vals)
+                    offs += size
+
+            rows = read('Q')
+
+        ret['tables'][name] = table
+
+    return ret
+%}
+
 ///////////////////////////////////////////////////////////////////////////////////////////
 // Check documentation for types is set up correctly
 
@@ -845,6 +845,18 @@ The default is :data:`ReplayOptimisationLevel.Balanced`.
 )");
   ReplayOptimisationLevel optimisation = ReplayOptimisationLevel::Balanced;
 
+  DOCUMENT(R"(Open the capture for analysis only, without replaying it on any graphics API.
+
+In this mode no GPU is needed. The action list, resource usage, pass events and frame statistics are
+derived from the capture's structured data alone, so they may be less precise than a real replay. No
+rendering, pipeline state, texture or buffer contents are available.
+
+This is intended for bulk-processing large numbers of captures, for example on headless machines.
+
+The default is to replay normally.
+)");
+  bool analysisOnly = false;
+
 // helpers for Qt, define constructor and cast. These will be defined in Qt code
 #if defined(RENDERDOC_QT_COMPAT)
   ReplayOptions(const QVariant &var);
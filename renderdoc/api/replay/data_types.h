@@ -2217,6 +2217,43 @@ pixel.
 
 DECLARE_REFLECTION_STRUCT(PixelModification);
 
+DOCUMENT("The history of modifications to one pixel within a region.");
+struct PixelHistoryResult
+{
+  DOCUMENT("");
+  PixelHistoryResult() = default;
+  PixelHistoryResult(const PixelHistoryResult &) = default;
+  PixelHistoryResult &operator=(const PixelHistoryResult &) = default;
+
+  bool operator==(const PixelHistoryResult &o) const
+  {
+    return x == o.x && y == o.y && modifications == o.modifications;
+  }
+  bool operator<(const PixelHistoryResult &o) const
+  {
+    if(!(y == o.y))
+      return y < o.y;
+    if(!(x == o.x))
+      return x < o.x;
+    if(!(modifications == o.modifications))
+      return modifications < o.modifications;
+    return false;
+  }
+  DOCUMENT("The x co-ordinate of the pixel.");
+  uint32_t x = 0;
+  DOCUMENT("The y co-ordinate of the pixel.");
+  uint32_t y = 0;
+
+  DOCUMENT(R"(The pixel history events for this pixel, as returned by
+:meth:`ReplayController.PixelHistory`.
+
+:type: List[PixelModification]
+)");
+  rdcarray<PixelModification> modifications;
+};
+
+DECLARE_REFLECTION_STRUCT(PixelHistoryResult);
+
 DOCUMENT("Contains the bytes and metadata describing a thumbnail.");
 struct Thumbnail
 {
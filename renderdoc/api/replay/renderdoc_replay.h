@@ -906,6 +906,35 @@ bucket when the pixel values are divided between ``minval`` and ``maxval``.
   virtual rdcarray<PixelModification> PixelHistory(ResourceId texture, uint32_t x, uint32_t y,
                                                    const Subresource &sub, CompType typeCast) = 0;
 
+  DOCUMENT(R"(Retrieve the history of modifications to every pixel in a rectangle on the selected
+texture.
+
+This returns the same results as calling :meth:`PixelHistory` on each pixel, but where possible the
+work is shared between pixels, and results for events already tested at a pixel are re-used by
+later queries on the same pixel. It is intended for small regions, such as a pixel and its
+neighbours.
+
+.. note::
+  X and Y co-ordinates are always considered to be top-left, as with :meth:`PixelHistory`.
+
+:param ResourceId texture: The texture to search for modifications.
+:param int x: The x co-ordinate of the top-left of the rectangle.
+:param int y: The y co-ordinate of the top-left of the rectangle.
+:param int width: The width of the rectangle. It will be clamped to the texture's bounds.
+:param int height: The height of the rectangle. It will be clamped to the texture's bounds.
+:param Subresource sub: The subresource within this texture to use.
+:param CompType typeCast: If possible interpret the texture with this type instead of its normal
+  type. If set to :data:`CompType.Typeless` then no cast is applied, otherwise where allowed the
+  texture data will be reinterpreted - e.g. from unsigned integers to floats, or to unsigned
+  normalised values.
+:return: The pixel history for each pixel in the rectangle, in rows from top to bottom.
+:rtype: List[PixelHistoryResult]
+)");
+  virtual rdcarray<PixelHistoryResult> PixelHistoryRegion(ResourceId texture, uint32_t x,
+                                                          uint32_t y, uint32_t width,
+                                                          uint32_t height, const Subresource &sub,
+                                                          CompType typeCast) = 0;
+
   DOCUMENT(R"(Retrieve a debugging trace from running a vertex shader.
 
 :param int vertid: The vertex ID as a 0-based index up to the number of vertices in the draw.
@@ -30,6 +30,11 @@
 #include "os/os_specific.h"
 #include "strings/string_utils.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define RDOC_SSE2_ZERO_CHECK 1
+#include <emmintrin.h>
+#endif
+
 int utf8printv(char *buf, size_t bufsize, const char *fmt, va_list args);
 int utf8printf(char *str, size_t bufSize, const char *fmt, ...);
 
@@ -79,6 +84,48 @@ bool Vec16NotEqual(void *a, void *b)
 #endif
 }
 
+// returns whether every byte in the buffer is zero. Checks a 64-byte cache line at a time with a
+// single compare, so it's cheap enough to run over whole memory allocations.
+bool IsZeroBuffer(const void *data, size_t bufSize)
+{
+  const byte *bytes = (const byte *)data;
+  size_t offs = 0;
+
+#if defined(RDOC_SSE2_ZERO_CHECK)
+  const __m128i zero = _mm_setzero_si128();
+
+  for(; offs + 64 <= bufSize; offs += 64)
+  {
+    __m128i a = _mm_loadu_si128((const __m128i *)(bytes + offs));
+    __m128i b = _mm_loadu_si128((const __m128i *)(bytes + offs + 16));
+    __m128i c = _mm_loadu_si128((const __m128i *)(bytes + offs + 32));
+    __m128i d = _mm_loadu_si128((const __m128i *)(bytes + offs + 48));
+
+    __m128i ored = _mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d));
+
+    if(_mm_movemask_epi8(_mm_cmpeq_epi8(ored, zero)) != 0xffff)
+      return false;
+  }
+#else
+  for(; offs + 64 <= bufSize; offs += 64)
+  {
+    uint64_t words[8];
+    memcpy(words, bytes + offs, sizeof(words));
+
+    if((words[0] | words[1] | words[2] | words[3] | words[4] | words[5] | words[6] | words[7]) != 0)
+      return false;
+  }
+#endif
+
+  for(; offs < bufSize; offs++)
+  {
+    if(bytes[offs] != 0)
+      return false;
+  }
+
+  return true;
+}
+
 bool FindDiffRange(void *a, void *b, size_t bufSize, size_t &diffStart, size_t &diffEnd)
 {
   RDCASSERT(uintptr_t(a) % 16 == 0);
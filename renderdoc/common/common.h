@@ -298,6 +298,7 @@ inline T AlignUpPtr(T x, A a)
   (((uint32_t)(d) << 24) | ((uint32_t)(c) << 16) | ((uint32_t)(b) << 8) | (uint32_t)(a))
 
 bool FindDiffRange(void *a, void *b, size_t bufSize, size_t &diffStart, size_t &diffEnd);
+bool IsZeroBuffer(const void *data, size_t bufSize);
 uint32_t CalcNumMips(int Width, int Height, int Depth);
 
 typedef uint8_t byte;
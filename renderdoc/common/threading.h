@@ -110,6 +110,45 @@ public:
 private:
   SpinLock *m_Spin = NULL;
 };
+
+// splits [0, count) into contiguous ranges of at least minRange items and calls func(begin, end)
+// for each range, spread across up to GetNumCores() threads. The calling thread processes the
+// first range itself, and this doesn't return until all ranges are complete.
+inline void ParallelFor(uint32_t count, uint32_t minRange,
+                        const std::function<void(uint32_t begin, uint32_t end)> &func)
+{
+  if(count == 0)
+    return;
+
+  minRange = RDCMAX(minRange, 1U);
+
+  uint32_t numThreads = RDCMIN(GetNumCores(), (count + minRange - 1) / minRange);
+
+  if(numThreads <= 1)
+  {
+    func(0, count);
+    return;
+  }
+
+  uint32_t rangeSize = (count + numThreads - 1) / numThreads;
+
+  rdcarray<ThreadHandle> threads;
+  threads.reserve(numThreads - 1);
+
+  for(uint32_t begin = rangeSize; begin < count; begin += rangeSize)
+  {
+    uint32_t end = RDCMIN(begin + rangeSize, count);
+    threads.push_back(CreateThread([&func, begin, end]() { func(begin, end); }));
+  }
+
+  func(0, RDCMIN(rangeSize, count));
+
+  for(ThreadHandle t : threads)
+  {
+    JoinThread(t);
+    CloseThread(t);
+  }
+}
 };
 
 #define SCOPED_LOCK(cs) Threading::ScopedLock CONCAT(scopedlock, __LINE__)(&cs);
@@ -71,4 +71,30 @@ TEST_CASE("Test spin lock", "[threading]")
   CHECK(finalValue == value);
 }
 
+TEST_CASE("Test ParallelFor", "[threading]")
+{
+  SECTION("Every index is visited exactly once")
+  {
+    for(uint32_t count : {0U, 1U, 7U, 100U, 12345U})
+    {
+      for(uint32_t minRange : {0U, 1U, 16U, 100000U})
+      {
+        rdcarray<int32_t> visits;
+        visits.resize(count);
+
+        Threading::ParallelFor(count, minRange, [&visits](uint32_t begin, uint32_t end) {
+          for(uint32_t i = begin; i < end; i++)
+            Atomic::Inc32(&visits[i]);
+        });
+
+        for(uint32_t i = 0; i < count; i++)
+        {
+          INFO("count: " << count << " index: " << i);
+          CHECK(visits[i] == 1);
+        }
+      }
+    }
+  }
+}
+
 #endif    // ENABLED(ENABLE_UNIT_TESTS)
@@ -49,6 +49,18 @@
 RDOC_DEBUG_CONFIG(bool, Capture_Debug_SnapshotDiagnosticLog, false,
                   "Snapshot the diagnostic log at capture time and embed in the capture.");
 
+RDOC_CONFIG(bool, Capture_AsyncWriting, false,
+            "Write captures to disk on a background thread. The frame is serialised into memory "
+            "before the application continues and compressed and written out afterwards.");
+RDOC_CONFIG(uint32_t, Capture_AsyncWritingMaxQueued, 2,
+            "The maximum number of captures that can be held in memory waiting to be written when "
+            "writing asynchronously. Further captures wait until a write has completed.");
+
+RDOC_CONFIG(bool, Capture_RecompressZstd, false,
+            "Recompress each capture with zstd on a low priority background thread once it has "
+            "been written, replacing the faster but larger LZ4 compression. The capture file is "
+            "replaced when recompression finishes.");
+
 // this is declared centrally so it can be shared with any backend - the name is a misnomer but kept
 // for backwards compatibility reasons.
 RDOC_CONFIG(rdcarray<rdcstr>, DXBC_Debug_SearchDirPaths, {},
@@ -71,6 +83,9 @@ void LogReplayOptions(const ReplayOptions &opts)
   }
 
   RDCLOG("Replay optimisation level: %s", ToStr(opts.optimisation).c_str());
+
+  if(opts.analysisOnly)
+    RDCLOG("Opening for analysis only, without replay");
 }
 
 // these one is done by hand as we format it
@@ -545,6 +560,24 @@ RenderDoc::~RenderDoc()
     UnloadCrashHandler();
   }
 
+  // make sure any captures being written in the background make it to disk
+  if(m_CaptureWriteThread)
+  {
+    StopCaptureWriting();
+    Threading::CloseThread(m_CaptureWriteThread);
+    m_CaptureWriteThread = 0;
+  }
+
+  // recompression is optional, so don't wait for it. If it's interrupted the original capture is
+  // still intact, only a temporary file is left behind.
+  if(m_RecompressThread)
+  {
+    Atomic::CmpExch32(&m_RecompressThreadShutdown, 0, 1);
+    Threading::Sleep(50);
+    Threading::CloseThread(m_RecompressThread);
+    m_RecompressThread = 0;
+  }
+
   for(auto it = m_ShutdownFunctions.begin(); it != m_ShutdownFunctions.end(); ++it)
     (*it)();
   m_ShutdownFunctions.clear();
@@ -603,6 +636,22 @@ void RenderDoc::RemoveHooks()
     Threading::CloseThread(m_RemoteThread);
     m_RemoteThread = 0;
   }
+
+  if(m_CaptureWriteThread)
+  {
+    StopCaptureWriting();
+    Threading::JoinThread(m_CaptureWriteThread);
+    Threading::CloseThread(m_CaptureWriteThread);
+    m_CaptureWriteThread = 0;
+  }
+
+  if(m_RecompressThread)
+  {
+    Atomic::CmpExch32(&m_RecompressThreadShutdown, 0, 1);
+    Threading::JoinThread(m_RecompressThread);
+    Threading::CloseThread(m_RecompressThread);
+    m_RecompressThread = 0;
+  }
 }
 
 void RenderDoc::InitialiseReplay(GlobalEnvironment env, const rdcarray<rdcstr> &args)
@@ -1337,13 +1386,19 @@ RDCFile *RenderDoc::CreateRDC(RDCDriver driver, uint32_t frameNum, const FramePi
 
   m_CurrentLogFile = StringFormat::Fmt("%s%s.rdc", m_CaptureFileTemplate.c_str(), suffix.c_str());
 
-  // make sure we don't stomp another capture if we make multiple captures in the same frame.
+  // make sure we don't stomp another capture if we make multiple captures in the same frame,
+  // including any that are still being written in the background.
   {
     SCOPED_LOCK(m_CaptureLock);
+    SCOPED_LOCK(m_CaptureWriteLock);
     int altnum = 2;
-    while(std::find_if(m_Captures.begin(), m_Captures.end(), [this](const CaptureData &o) {
-            return o.path == m_CurrentLogFile;
-          }) != m_Captures.end())
+    auto isCurrent = [this](const rdcstr &path) { return path == m_CurrentLogFile; };
+    while(std::find_if(m_Captures.begin(), m_Captures.end(),
+                       [&](const CaptureData &o) { return isCurrent(o.path); }) !=
+              m_Captures.end() ||
+          std::find_if(m_PendingCaptureWrites.begin(), m_PendingCaptureWrites.end(),
+                       [&](const PendingCaptureWrite &o) { return isCurrent(o.path); }) !=
+              m_PendingCaptureWrites.end())
     {
       m_CurrentLogFile =
           StringFormat::Fmt("%s%s_%d.rdc", m_CaptureFileTemplate.c_str(), suffix.c_str(), altnum);
@@ -1786,10 +1841,322 @@ void RenderDoc::SetCaptureFileTemplate(const rdcstr &pathtemplate)
   FileIO::CreateParentDirectory(m_CaptureFileTemplate);
 }
 
+StreamWriter *RenderDoc::WriteCaptureSection(RDCFile *rdc, const SectionProperties &props)
+{
+  if(!rdc)
+    return new StreamWriter(StreamWriter::InvalidStream);
+
+  if(!Capture_AsyncWriting())
+    return rdc->WriteSection(props);
+
+  const int32_t maxQueued = (int32_t)RDCMAX(1U, Capture_AsyncWritingMaxQueued());
+
+  PendingCaptureWrite write;
+  write.path = rdc->GetFilename();
+  write.rdc = rdc;
+  write.props = props;
+  // the section is serialised uncompressed into memory, and compressed when it's written to disk.
+  write.section = new StreamWriter(1024 * 1024);
+
+  // bound how much memory is used by waiting for earlier captures to be written out before
+  // serialising another one.
+  bool waited = false;
+  for(;;)
+  {
+    {
+      SCOPED_LOCK(m_CaptureWriteLock);
+      if(m_PendingCaptureWrites.count() < maxQueued)
+      {
+        m_PendingCaptureWrites.push_back(write);
+
+        if(m_CaptureWriteThread == 0)
+        {
+          m_CaptureWriteThread = Threading::CreateThread([this]() {
+            PendingCaptureWrite next;
+            while(Atomic::CmpExch32(&m_CaptureWriteThreadShutdown, 0, 0) == 0)
+            {
+              if(ClaimPendingCaptureWrite(next))
+                WritePendingCapture(next);
+              else
+                Threading::Sleep(5);
+            }
+          });
+        }
+
+        break;
+      }
+    }
+
+    if(!waited)
+      RDCLOG("Waiting for %d queued captures to finish writing", maxQueued);
+    waited = true;
+
+    Threading::Sleep(5);
+  }
+
+  return write.section;
+}
+
+bool RenderDoc::ClaimPendingCaptureWrite(PendingCaptureWrite &write)
+{
+  SCOPED_LOCK(m_CaptureWriteLock);
+  for(PendingCaptureWrite &p : m_PendingCaptureWrites)
+  {
+    if(p.ready && !p.writing)
+    {
+      p.writing = true;
+      write = p;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void RenderDoc::WritePendingCapture(PendingCaptureWrite &write)
+{
+  RenderDoc::Inst().SetProgress(CaptureProgress::FileWriting, 0.0f);
+
+  const byte *data = write.section->GetData();
+  const uint64_t size = write.section->GetOffset();
+
+  StreamWriter *w = write.rdc->WriteSection(write.props);
+
+  // write in blocks so we can report progress while compressing
+  const uint64_t blockSize = 16 * 1024 * 1024;
+  for(uint64_t offs = 0; offs < size && !w->IsErrored(); offs += blockSize)
+  {
+    RenderDoc::Inst().SetProgress(CaptureProgress::FileWriting, float(offs) / float(size));
+    w->Write(data + offs, RDCMIN(blockSize, size - offs));
+  }
+
+  w->Finish();
+  delete w;
+
+  WriteCaptureFileSections(write.rdc, write.frameNumber);
+
+  {
+    SCOPED_LOCK(m_CaptureWriteLock);
+    m_PendingCaptureWrites.removeOneIf(
+        [&write](const PendingCaptureWrite &p) { return p.section == write.section; });
+  }
+
+  delete write.section;
+
+  RenderDoc::Inst().SetProgress(CaptureProgress::FileWriting, 1.0f);
+}
+
+void RenderDoc::FlushCaptureWriting()
+{
+  // wait for every capture that's been completely serialised to be written
+  while(m_CaptureWriteThread)
+  {
+    {
+      SCOPED_LOCK(m_CaptureWriteLock);
+      if(std::find_if(m_PendingCaptureWrites.begin(), m_PendingCaptureWrites.end(),
+                      [](const PendingCaptureWrite &p) { return p.ready; }) ==
+         m_PendingCaptureWrites.end())
+        break;
+    }
+
+    Threading::Sleep(5);
+  }
+
+  // then for any recompression, which may have been queued by those writes
+  while(m_RecompressThread)
+  {
+    {
+      SCOPED_LOCK(m_RecompressLock);
+      if(m_PendingRecompress.empty())
+        break;
+    }
+
+    Threading::Sleep(5);
+  }
+}
+
+void RenderDoc::StopCaptureWriting()
+{
+  // stop the writer thread from picking up more captures and give it time to finish any write it's
+  // in the middle of. If the thread has been terminated already, as can happen during process
+  // shutdown on windows, it will never finish so we can't wait indefinitely.
+  Atomic::CmpExch32(&m_CaptureWriteThreadShutdown, 0, 1);
+
+  for(int i = 0; i < 6000; i++)
+  {
+    {
+      SCOPED_LOCK(m_CaptureWriteLock);
+      if(std::find_if(m_PendingCaptureWrites.begin(), m_PendingCaptureWrites.end(),
+                      [](const PendingCaptureWrite &p) { return p.writing; }) ==
+         m_PendingCaptureWrites.end())
+        break;
+    }
+
+    Threading::Sleep(5);
+  }
+
+  // write any remaining captures on this thread
+  PendingCaptureWrite write;
+  while(ClaimPendingCaptureWrite(write))
+    WritePendingCapture(write);
+}
+
+// recompresses the frame capture section of a capture from LZ4 to zstd into a temporary file next
+// to it, then replaces the original. If anything fails the original capture is left untouched.
+static void RecompressCapture(const rdcstr &path)
+{
+  rdcstr tmpPath = path + ".tmp";
+  RDResult result;
+
+  {
+    RDCFile input;
+    input.Open(path);
+
+    if(input.Error() != ResultCode::Succeeded)
+    {
+      RDCWARN("Couldn't open %s to recompress: %s", path.c_str(),
+              ResultDetails(input.Error()).Message().c_str());
+      return;
+    }
+
+    int frameIdx = input.SectionIndex(SectionType::FrameCapture);
+    if(frameIdx < 0 || !(input.GetSectionProperties(frameIdx).flags & SectionFlags::LZ4Compressed))
+      return;
+
+    RDCFile output;
+    output.SetData(input.GetDriver(), input.GetDriverName(), input.GetMachineIdent(),
+                   &input.GetThumbnail(), input.GetTimestampBase(),
+                   input.GetTimestampFrequency());
+    output.Create(tmpPath);
+
+    result = output.Error();
+
+    // the frame capture section must be written first, then all others follow as-is
+    rdcarray<int> sections = {frameIdx};
+    for(int i = 0; i < input.NumSections(); i++)
+      if(i != frameIdx)
+        sections.push_back(i);
+
+    for(int i : sections)
+    {
+      if(result != ResultCode::Succeeded)
+        break;
+
+      SectionProperties props = input.GetSectionProperties(i);
+      if(i == frameIdx)
+        props.flags = SectionFlags::ZstdCompressed;
+
+      StreamWriter *writer = output.WriteSection(props);
+      StreamReader *reader = input.ReadSection(i);
+
+      StreamTransfer(writer, reader, NULL);
+
+      writer->Finish();
+
+      result = writer->GetError();
+      if(result == ResultCode::Succeeded)
+        result = reader->GetError();
+
+      delete reader;
+      delete writer;
+    }
+  }
+
+  if(result != ResultCode::Succeeded)
+  {
+    RDCWARN("Couldn't recompress %s: %s", path.c_str(),
+            ResultDetails(result).Message().c_str());
+    FileIO::Delete(tmpPath);
+    return;
+  }
+
+  uint64_t prevSize = FileIO::GetFileSize(path);
+  uint64_t newSize = FileIO::GetFileSize(tmpPath);
+
+  // the capture may be open elsewhere, in which case it can't be replaced and is left as LZ4
+  if(!FileIO::Move(tmpPath, path, true))
+  {
+    RDCWARN("Couldn't replace %s with recompressed capture", path.c_str());
+    FileIO::Delete(tmpPath);
+    return;
+  }
+
+  RDCLOG("Recompressed %s from %llu to %llu bytes", path.c_str(), prevSize, newSize);
+}
+
+void RenderDoc::QueueCaptureRecompress(const rdcstr &path)
+{
+  SCOPED_LOCK(m_RecompressLock);
+
+  m_PendingRecompress.push_back(path);
+
+  if(m_RecompressThread == 0)
+  {
+    m_RecompressThread = Threading::CreateThread([this]() {
+      Threading::SetCurrentThreadLowPriority();
+
+      while(Atomic::CmpExch32(&m_RecompressThreadShutdown, 0, 0) == 0)
+      {
+        rdcstr next;
+        {
+          SCOPED_LOCK(m_RecompressLock);
+          if(!m_PendingRecompress.empty())
+            next = m_PendingRecompress[0];
+        }
+
+        if(next.empty())
+        {
+          Threading::Sleep(20);
+          continue;
+        }
+
+        RecompressCapture(next);
+
+        {
+          SCOPED_LOCK(m_RecompressLock);
+          m_PendingRecompress.erase(0);
+        }
+      }
+    });
+  }
+}
+
+void RenderDoc::FinishCaptureWriting(RDCFile *rdc, uint32_t frameNumber,
+                                     StreamWriter *captureSection)
+{
+  {
+    SCOPED_LOCK(m_CaptureWriteLock);
+    for(PendingCaptureWrite &p : m_PendingCaptureWrites)
+    {
+      if(p.section == captureSection)
+      {
+        RDCLOG("Queued %s to be written in the background", p.path.c_str());
+        p.frameNumber = frameNumber;
+        p.ready = true;
+        return;
+      }
+    }
+  }
+
+  // otherwise the section was written directly and needs to be finished before the rest of the
+  // capture is written
+  captureSection->Finish();
+  delete captureSection;
+
+  FinishCaptureWriting(rdc, frameNumber);
+}
+
 void RenderDoc::FinishCaptureWriting(RDCFile *rdc, uint32_t frameNumber)
 {
   RenderDoc::Inst().SetProgress(CaptureProgress::FileWriting, 0.0f);
 
+  WriteCaptureFileSections(rdc, frameNumber);
+
+  RenderDoc::Inst().SetProgress(CaptureProgress::FileWriting, 1.0f);
+}
+
+void RenderDoc::WriteCaptureFileSections(RDCFile *rdc, uint32_t frameNumber)
+{
   if(rdc)
   {
     // add the resolve database if we were capturing callstacks.
@@ -1854,22 +2221,23 @@ void RenderDoc::FinishCaptureWriting(RDCFile *rdc, uint32_t frameNumber)
       delete w;
     }
 
-    RDCLOG("Written to disk: %s", m_CurrentLogFile.c_str());
+    RDCLOG("Written to disk: %s", rdc->GetFilename().c_str());
 
-    CaptureData cap(m_CurrentLogFile, Timing::GetUnixTimestamp(), rdc->GetDriver(), frameNumber);
+    CaptureData cap(rdc->GetFilename(), Timing::GetUnixTimestamp(), rdc->GetDriver(), frameNumber);
     {
       SCOPED_LOCK(m_CaptureLock);
       m_Captures.push_back(cap);
     }
 
     delete rdc;
+
+    if(Capture_RecompressZstd())
+      QueueCaptureRecompress(cap.path);
   }
   else
   {
     RDCLOG("Discarded capture, Frame %u", frameNumber);
   }
-
-  RenderDoc::Inst().SetProgress(CaptureProgress::FileWriting, 1.0f);
 }
 
 void RenderDoc::AddChildProcess(uint32_t pid, uint32_t ident)
@@ -2100,4 +2468,137 @@ TEST_CASE("Check ResourceId tostr", "[tostr]")
   CHECK(ToStr(*u.id) == "ResourceId::1311768465173141112");
 }
 
+TEST_CASE("Test asynchronous capture writing", "[core]")
+{
+  RenderDoc &rd = RenderDoc::Inst();
+
+  rdcstr prevTemplate = rd.GetCaptureFileTemplate();
+  rd.SetCaptureFileTemplate(FileIO::GetTempFolderFilename() + "renderdoc_async_write_test");
+
+  SDObject *async = rd.SetConfigSetting("Capture.AsyncWriting");
+  SDObject *maxQueued = rd.SetConfigSetting("Capture.AsyncWritingMaxQueued");
+  REQUIRE(async);
+  REQUIRE(maxQueued);
+
+  bool prevAsync = async->data.basic.b;
+  uint64_t prevMaxQueued = maxQueued->data.basic.u;
+  async->data.basic.b = true;
+  maxQueued->data.basic.u = 1;
+
+  // write more captures than can be queued so that later ones have to wait
+  const uint32_t numCaptures = 3;
+  const uint32_t numValues = 1024 * 1024;
+  rdcarray<rdcstr> paths;
+  for(uint32_t i = 0; i < numCaptures; i++)
+  {
+    RDCFile *rdc = rd.CreateRDC(RDCDriver::Vulkan, 1000 + i, RenderDoc::FramePixels());
+    REQUIRE(rdc);
+    paths.push_back(rdc->GetFilename());
+
+    SectionProperties props;
+    props.flags = SectionFlags::LZ4Compressed;
+    props.version = 1;
+    props.type = SectionType::FrameCapture;
+
+    StreamWriter *w = rd.WriteCaptureSection(rdc, props);
+    for(uint32_t v = 0; v < numValues; v++)
+      w->Write(v ^ i);
+    rd.FinishCaptureWriting(rdc, 1000 + i, w);
+  }
+
+  rd.FlushCaptureWriting();
+
+  for(uint32_t i = 0; i < numCaptures; i++)
+  {
+    RDCFile rdc;
+    rdc.Open(paths[i]);
+    REQUIRE(rdc.Error().code == ResultCode::Succeeded);
+
+    int idx = rdc.SectionIndex(SectionType::FrameCapture);
+    REQUIRE(idx >= 0);
+    CHECK(rdc.GetSectionProperties(idx).uncompressedSize == numValues * sizeof(uint32_t));
+
+    StreamReader *reader = rdc.ReadSection(idx);
+    bool match = true;
+    for(uint32_t v = 0; v < numValues; v++)
+    {
+      uint32_t val = 0;
+      reader->Read(val);
+      match &= (val == (v ^ i));
+    }
+    delete reader;
+
+    CHECK(match);
+  }
+
+  for(const rdcstr &p : paths)
+    FileIO::Delete(p);
+
+  async->data.basic.b = prevAsync;
+  maxQueued->data.basic.u = prevMaxQueued;
+  rd.SetCaptureFileTemplate(prevTemplate);
+}
+
+TEST_CASE("Test background capture recompression", "[core]")
+{
+  RenderDoc &rd = RenderDoc::Inst();
+
+  rdcstr prevTemplate = rd.GetCaptureFileTemplate();
+  rd.SetCaptureFileTemplate(FileIO::GetTempFolderFilename() + "renderdoc_recompress_test");
+
+  SDObject *recompress = rd.SetConfigSetting("Capture.RecompressZstd");
+  REQUIRE(recompress);
+
+  bool prevRecompress = recompress->data.basic.b;
+  recompress->data.basic.b = true;
+
+  const uint32_t numValues = 1024 * 1024;
+
+  RDCFile *rdc = rd.CreateRDC(RDCDriver::Vulkan, 2000, RenderDoc::FramePixels());
+  REQUIRE(rdc);
+  rdcstr path = rdc->GetFilename();
+
+  SectionProperties props;
+  props.flags = SectionFlags::LZ4Compressed;
+  props.version = 1;
+  props.type = SectionType::FrameCapture;
+
+  StreamWriter *w = rd.WriteCaptureSection(rdc, props);
+  for(uint32_t v = 0; v < numValues; v++)
+    w->Write(v / 7);
+  rd.FinishCaptureWriting(rdc, 2000, w);
+
+  rd.FlushCaptureWriting();
+
+  CHECK_FALSE(FileIO::exists(path + ".tmp"));
+
+  {
+    RDCFile file;
+    file.Open(path);
+    REQUIRE(file.Error().code == ResultCode::Succeeded);
+
+    int idx = file.SectionIndex(SectionType::FrameCapture);
+    REQUIRE(idx >= 0);
+    CHECK(file.GetSectionProperties(idx).flags == SectionFlags::ZstdCompressed);
+    CHECK(file.GetSectionProperties(idx).uncompressedSize == numValues * sizeof(uint32_t));
+
+    StreamReader *reader = file.ReadSection(idx);
+    bool match = true;
+    for(uint32_t v = 0; v < numValues; v++)
+    {
+      uint32_t val = 0;
+      reader->Read(val);
+      match &= (val == v / 7);
+    }
+    delete reader;
+
+    CHECK(match);
+  }
+
+  FileIO::Delete(path);
+
+  recompress->data.basic.b = prevRecompress;
+  rd.SetCaptureFileTemplate(prevTemplate);
+}
+
 #endif
@@ -51,6 +51,7 @@ class IRemoteDriver;
 class IReplayDriver;
 
 class StreamReader;
+class StreamWriter;
 class RDCFile;
 struct SDFile;
 enum class VulkanLayerFlags : uint32_t;
@@ -406,13 +407,19 @@ public:
   template <typename ProgressType>
   void SetProgressCallback(RENDERDOC_ProgressCallback progress)
   {
+    m_ProgressLock.Lock();
     m_ProgressCallbacks[TypeName<ProgressType>()] = progress;
+    m_ProgressLock.Unlock();
   }
 
   template <typename ProgressType>
   void SetProgress(ProgressType section, float delta)
   {
+    // captures may be loaded on several threads at once, so the map must be locked
+    m_ProgressLock.Lock();
     RENDERDOC_ProgressCallback cb = m_ProgressCallbacks[TypeName<ProgressType>()];
+    m_ProgressLock.Unlock();
+
     if(!cb || section < ProgressType::First || section >= ProgressType::Count)
       return;
 
@@ -474,7 +481,13 @@ public:
   void ResamplePixels(const FramePixels &in, RDCThumb &out);
   void EncodePixelsPNG(const RDCThumb &in, RDCThumb &out);
   RDCFile *CreateRDC(RDCDriver driver, uint32_t frameNum, const FramePixels &fp);
+  // returns a writer for the frame capture section of a new capture. If captures are written
+  // asynchronously this is an in-memory stream that is written to disk on a background thread
+  // after the writer is passed back to FinishCaptureWriting below. The caller must not delete it.
+  StreamWriter *WriteCaptureSection(RDCFile *rdc, const SectionProperties &props);
+  void FinishCaptureWriting(RDCFile *rdc, uint32_t frameNumber, StreamWriter *captureSection);
   void FinishCaptureWriting(RDCFile *rdc, uint32_t frameNumber);
+  void FlushCaptureWriting();
 
   void AddChildProcess(uint32_t pid, uint32_t ident);
   rdcarray<rdcpair<uint32_t, uint32_t>> GetChildProcesses();
@@ -611,6 +624,8 @@ private:
 
   void SyncAvailableGPUThread();
 
+  void WriteCaptureFileSections(RDCFile *rdc, uint32_t frameNumber);
+
   bool m_Replay;
 
   uint32_t m_Cap;
@@ -647,11 +662,43 @@ private:
   Threading::ThreadHandle m_AvailableGPUThread = 0;
   rdcarray<GPUDevice> m_AvailableGPUs;
 
+  Threading::CriticalSection m_ProgressLock;
   std::map<rdcstr, RENDERDOC_ProgressCallback> m_ProgressCallbacks;
 
   Threading::CriticalSection m_CaptureLock;
   rdcarray<CaptureData> m_Captures;
 
+  struct PendingCaptureWrite
+  {
+    rdcstr path;
+    RDCFile *rdc = NULL;
+    StreamWriter *section = NULL;
+    SectionProperties props;
+    uint32_t frameNumber = 0;
+    // set once the frame capture section has been completely serialised
+    bool ready = false;
+    // set once a thread has started writing this capture to disk
+    bool writing = false;
+  };
+
+  Threading::CriticalSection m_CaptureWriteLock;
+  // captures being serialised or waiting to be written, in the order they were started
+  rdcarray<PendingCaptureWrite> m_PendingCaptureWrites;
+  Threading::ThreadHandle m_CaptureWriteThread = 0;
+  int32_t m_CaptureWriteThreadShutdown = 0;
+
+  bool ClaimPendingCaptureWrite(PendingCaptureWrite &write);
+  void WritePendingCapture(PendingCaptureWrite &write);
+  void StopCaptureWriting();
+
+  Threading::CriticalSection m_RecompressLock;
+  // captures waiting to be recompressed, the first is removed once it has been processed
+  rdcarray<rdcstr> m_PendingRecompress;
+  Threading::ThreadHandle m_RecompressThread = 0;
+  int32_t m_RecompressThreadShutdown = 0;
+
+  void QueueCaptureRecompress(const rdcstr &path);
+
   Threading::CriticalSection m_ChildLock;
   rdcarray<rdcpair<uint32_t, uint32_t>> m_Children;
   rdcarray<rdcpair<uint32_t, Threading::ThreadHandle>> m_ChildThreads;
@@ -24,6 +24,7 @@
 
 #include "common/dds_readwrite.h"
 #include "common/formatting.h"
+#include "common/threading.h"
 #include "core/core.h"
 #include "maths/formatpacking.h"
 #include "replay/dummy_driver.h"
@@ -70,10 +71,18 @@ public:
     m_Resources[0].resourceId = m_TextureID;
     m_Resources[0].autogeneratedName = false;
     m_Resources[0].name = get_basename(m_Filename);
+
+    m_Watch = FileIO::WatchFile(m_Filename, [this](FileIO::FileWatchEvent ev) {
+      if(ev == FileIO::FileModified)
+        Atomic::CmpExch32(&m_WriteInProgress, 0, 1);
+      else
+        Atomic::CmpExch32(&m_WriteInProgress, 1, 0);
+    });
   }
 
   virtual ~ImageViewer()
   {
+    FileIO::UnwatchFile(m_Watch);
     SAFE_DELETE(m_File);
     if(m_Proxy)
     {
@@ -313,6 +322,13 @@ public:
   {
     return rdcarray<PixelModification>();
   }
+  rdcarray<PixelHistoryResult> PixelHistoryRegion(rdcarray<EventUsage> events, ResourceId target,
+                                                  uint32_t x, uint32_t y, uint32_t width,
+                                                  uint32_t height, const Subresource &sub,
+                                                  CompType typeCast)
+  {
+    return rdcarray<PixelHistoryResult>();
+  }
   ShaderDebugTrace *DebugVertex(uint32_t eventId, uint32_t vertid, uint32_t instid, uint32_t idx,
                                 uint32_t view)
   {
@@ -363,10 +379,20 @@ public:
     RDCERR("Calling proxy-render functions on an image viewer");
   }
 
-  void FileChanged() { RefreshFile(); }
+  void FileChanged();
+
 private:
   void RefreshFile();
   void CreateProxyTexture(TextureDescription &texDetails, read_dds_data &read_data);
+  void RemapProxyData(TextureDescription &texDetails, read_dds_data &read_data);
+
+  // how the image data is remapped to fit in the proxy texture, if it's not natively supported
+  enum class ProxyRemap
+  {
+    NoRemap,
+    Texture3DAsArray,
+    ConvertToFloat,
+  };
 
   APIProperties m_Props;
   FrameRecord m_FrameRecord;
@@ -383,8 +409,81 @@ private:
   // if we remapped the texture for display, this contains the real data to return from
   // GetTextureData()
   rdcarray<bytebuf> m_RealTexData;
+  ProxyRemap m_ProxyRemap = ProxyRemap::NoRemap;
+
+  // watch on the file so we know when writes have completed. NULL if watching isn't supported
+  FileIO::FileWatch *m_Watch = NULL;
+  int32_t m_WriteInProgress = 0;
 };
 
+// parses the EXR version and header, reading only as much of the file as is needed to parse the
+// header instead of the whole file. buffer is left containing the prefix of the file that was read
+static RDResult ParseEXRHeaderFromFile(FILE *f, uint64_t fileSize, bytebuf &buffer,
+                                       EXRHeader &exrHeader)
+{
+  // headers are almost always much smaller than this, if not we'll grow the read below
+  buffer.resize((size_t)RDCMIN(fileSize, uint64_t(256 * 1024)));
+
+  FileIO::fseek64(f, 0, SEEK_SET);
+  FileIO::fread(buffer.data(), 1, buffer.size(), f);
+
+  EXRVersion exrVersion;
+  int ret = ParseEXRVersionFromMemory(&exrVersion, buffer.data(), buffer.size());
+
+  if(ret != 0)
+  {
+    RETURN_ERROR_RESULT(ResultCode::ImageUnsupported,
+                        "EXR file detected, but couldn't load with ParseEXRVersionFromMemory: %d",
+                        ret);
+  }
+
+  if(exrVersion.multipart)
+  {
+    RETURN_ERROR_RESULT(ResultCode::ImageUnsupported,
+                        "Unsupported EXR file detected - multipart EXR.");
+  }
+
+  if(exrVersion.non_image)
+  {
+    RETURN_ERROR_RESULT(ResultCode::ImageUnsupported,
+                        "Unsupported EXR file detected - deep image EXR.");
+  }
+
+  rdcstr errString;
+
+  for(;;)
+  {
+    InitEXRHeader(&exrHeader);
+
+    const char *err = NULL;
+
+    ret = ParseEXRHeaderFromMemory(&exrHeader, &exrVersion, buffer.data(), buffer.size(), &err);
+
+    if(err)
+    {
+      errString = err;
+      free((void *)err);
+    }
+
+    if(ret == 0)
+      return ResultCode::Succeeded;
+
+    FreeEXRHeader(&exrHeader);
+
+    if(buffer.size() >= fileSize)
+      break;
+
+    // the header may have been truncated, read more of the file and try again
+    const size_t oldSize = buffer.size();
+    buffer.resize((size_t)RDCMIN(fileSize, uint64_t(oldSize) * 4));
+    FileIO::fread(buffer.data() + oldSize, 1, buffer.size() - oldSize, f);
+  }
+
+  RETURN_ERROR_RESULT(ResultCode::ImageUnsupported,
+                      "EXR file detected, but couldn't load with ParseEXRHeaderFromMemory %d: '%s'",
+                      ret, errString.c_str());
+}
+
 RDResult IMG_CreateReplayDevice(RDCFile *rdc, IReplayDriver **driver)
 {
   if(!rdc)
@@ -411,83 +510,31 @@ RDResult IMG_CreateReplayDevice(RDCFile *rdc, IReplayDriver **driver)
     FileIO::fseek64(f, 0, SEEK_SET);
 
     bytebuf buffer;
-    buffer.resize((size_t)size);
-
-    FileIO::fread(&buffer[0], 1, buffer.size(), f);
-
-    EXRVersion exrVersion;
-    int ret = ParseEXRVersionFromMemory(&exrVersion, buffer.data(), buffer.size());
-
-    if(ret != 0)
-    {
-      FileIO::fclose(f);
-      RETURN_ERROR_RESULT(ResultCode::ImageUnsupported,
-                          "EXR file detected, but couldn't load with ParseEXRVersionFromMemory: %d",
-                          ret);
-    }
-
-    if(exrVersion.multipart)
-    {
-      FileIO::fclose(f);
-      RETURN_ERROR_RESULT(ResultCode::ImageUnsupported,
-                          "Unsupported EXR file detected - multipart EXR.");
-    }
-
-    if(exrVersion.non_image)
-    {
-      FileIO::fclose(f);
-      RETURN_ERROR_RESULT(ResultCode::ImageUnsupported,
-                          "Unsupported EXR file detected - deep image EXR.");
-    }
-
-    if(exrVersion.tiled)
-    {
-      FileIO::fclose(f);
-      RETURN_ERROR_RESULT(ResultCode::ImageUnsupported,
-                          "Unsupported EXR file detected - tiled EXR.");
-    }
-
     EXRHeader exrHeader;
-    InitEXRHeader(&exrHeader);
-
-    rdcstr errString;
-
-    {
-      const char *err = NULL;
-
-      ret = ParseEXRHeaderFromMemory(&exrHeader, &exrVersion, buffer.data(), buffer.size(), &err);
-
-      if(err)
-      {
-        errString = err;
-        free((void *)err);
-      }
-    }
+    RDResult res = ParseEXRHeaderFromFile(f, size, buffer, exrHeader);
 
-    if(ret != 0)
+    if(res != ResultCode::Succeeded)
     {
       FileIO::fclose(f);
-      RETURN_ERROR_RESULT(
-          ResultCode::ImageUnsupported,
-          "EXR file detected, but couldn't load with ParseEXRHeaderFromMemory %d: '%s'", ret,
-          errString.c_str());
+      return res;
     }
+
+    FreeEXRHeader(&exrHeader);
   }
   else if(stbi_is_hdr_from_file(f))
   {
     FileIO::fseek64(f, 0, SEEK_SET);
 
+    // only check that the header is valid, the image will be fully decoded when it's loaded
     int ignore = 0;
-    float *data = stbi_loadf_from_file(f, &ignore, &ignore, &ignore, 4);
+    int ret = stbi_info_from_file(f, &ignore, &ignore, &ignore);
 
-    if(!data)
+    if(ret == 0)
     {
       FileIO::fclose(f);
       RETURN_ERROR_RESULT(ResultCode::ImageUnsupported,
-                          "HDR file recognised, but couldn't load with stbi_loadf_from_file");
+                          "HDR file recognised, but couldn't load with stbi_info_from_file");
     }
-
-    free(data);
   }
   else if(is_dds_file(headerBuffer, headerSize))
   {
@@ -522,16 +569,6 @@ RDResult IMG_CreateReplayDevice(RDCFile *rdc, IReplayDriver **driver)
       RETURN_ERROR_RESULT(ResultCode::ImageUnsupported, "Image dimensions %ux%u are not supported",
                           width, height);
     }
-
-    byte *data = stbi_load_from_file(f, &ignore, &ignore, &ignore, 4);
-
-    if(!data)
-    {
-      FileIO::fclose(f);
-      RETURN_ERROR_RESULT(ResultCode::ImageUnsupported, "File recognised, but couldn't load image");
-    }
-
-    free(data);
   }
 
   if(f != NULL)
@@ -562,6 +599,21 @@ RDResult IMG_CreateReplayDevice(RDCFile *rdc, IReplayDriver **driver)
   return ResultCode::Succeeded;
 }
 
+void ImageViewer::FileChanged()
+{
+  // we're typically told about changes as soon as the file is modified, so if we can see that the
+  // write is still in progress wait for it to complete instead of loading a partial file. This is
+  // bounded in case the completion is missed, and without a watch we rely on RefreshFile retrying
+  if(m_Watch)
+  {
+    PerformanceTimer timer;
+    while(Atomic::CmpExch32(&m_WriteInProgress, 1, 1) == 1 && timer.GetMilliseconds() < 2000.0)
+      Threading::Sleep(1);
+  }
+
+  RefreshFile();
+}
+
 void ImageViewer::RefreshFile()
 {
   FILE *f = NULL;
@@ -624,84 +676,59 @@ void ImageViewer::RefreshFile()
 
   if(is_exr_file(f))
   {
-    texDetails.format = rgba32_float;
-
-    FileIO::fseek64(f, 0, SEEK_SET);
-
     bytebuf buffer;
-    buffer.resize((size_t)fileSize);
-
-    FileIO::fread(buffer.data(), 1, buffer.size(), f);
-
-    EXRVersion exrVersion;
-    int ret = ParseEXRVersionFromMemory(&exrVersion, buffer.data(), buffer.size());
-
-    if(ret != 0)
-    {
-      SET_ERROR_RESULT(m_Error, ResultCode::ImageUnsupported,
-                       "EXR file detected, but couldn't load with ParseEXRVersionFromMemory: %d",
-                       ret);
-      FileIO::fclose(f);
-      return;
-    }
-
-    if(exrVersion.multipart)
-    {
-      SET_ERROR_RESULT(m_Error, ResultCode::ImageUnsupported,
-                       "Unsupported EXR file detected - multipart EXR.");
-      FileIO::fclose(f);
-      return;
-    }
+    EXRHeader exrHeader;
+    RDResult res = ParseEXRHeaderFromFile(f, fileSize, buffer, exrHeader);
 
-    if(exrVersion.non_image)
+    if(res != ResultCode::Succeeded)
     {
-      SET_ERROR_RESULT(m_Error, ResultCode::ImageUnsupported,
-                       "Unsupported EXR file detected - deep image EXR.");
+      m_Error = res;
       FileIO::fclose(f);
       return;
     }
 
-    if(exrVersion.tiled)
+    // now read the rest of the file. tinyexr can only decode a whole image (every tile of the first
+    // level) from a complete in-memory file, so there's no way to decode just a region or a single
+    // mip on demand here. The file contents are released as soon as the decode is done
     {
-      SET_ERROR_RESULT(m_Error, ResultCode::ImageUnsupported,
-                       "Unsupported EXR file detected - tiled EXR.");
-      FileIO::fclose(f);
-      return;
+      const size_t headerSize = buffer.size();
+      buffer.resize((size_t)fileSize);
+      FileIO::fread(buffer.data() + headerSize, 1, buffer.size() - headerSize, f);
     }
 
-    EXRHeader exrHeader;
-    InitEXRHeader(&exrHeader);
-
-    rdcstr errString;
-
+    int channels[4] = {-1, -1, -1, -1};
+    for(int i = 0; i < exrHeader.num_channels; i++)
     {
-      const char *err = NULL;
-
-      ret = ParseEXRHeaderFromMemory(&exrHeader, &exrVersion, buffer.data(), buffer.size(), &err);
-
-      if(err)
+      switch(exrHeader.channels[i].name[0])
       {
-        errString = err;
-        free((void *)err);
+        case 'R': channels[0] = i; break;
+        case 'G': channels[1] = i; break;
+        case 'B': channels[2] = i; break;
+        case 'A': channels[3] = i; break;
       }
     }
 
-    if(ret != 0)
-    {
-      SET_ERROR_RESULT(
-          m_Error, ResultCode::ImageUnsupported,
-          "EXR file detected, but couldn't load with ParseEXRHeaderFromMemory %d: '%s'", ret,
-          errString.c_str());
-      FileIO::fclose(f);
-      return;
-    }
+    // if all the channels we use are half precision, keep them as halfs. This halves the memory
+    // needed both here and for the proxy texture compared to always expanding to float
+    bool halfData = true;
+    for(int c = 0; c < 4; c++)
+      if(channels[c] >= 0 && exrHeader.pixel_types[channels[c]] != TINYEXR_PIXELTYPE_HALF)
+        halfData = false;
 
     for(int i = 0; i < exrHeader.num_channels; i++)
-      exrHeader.requested_pixel_types[i] = TINYEXR_PIXELTYPE_FLOAT;
+      exrHeader.requested_pixel_types[i] =
+          halfData ? TINYEXR_PIXELTYPE_HALF : TINYEXR_PIXELTYPE_FLOAT;
+
+    texDetails.format = rgba32_float;
+    if(halfData)
+      texDetails.format.compByteWidth = 2;
 
     EXRImage exrImage;
     InitEXRImage(&exrImage);
 
+    rdcstr errString;
+    int ret = 0;
+
     {
       const char *err = NULL;
 
@@ -714,6 +741,14 @@ void ImageViewer::RefreshFile()
       }
     }
 
+    const int tileWidth = exrHeader.tile_size_x;
+    const int tileHeight = exrHeader.tile_size_y;
+
+    FreeEXRHeader(&exrHeader);
+
+    // the file contents are no longer needed, release them before allocating the decoded data
+    bytebuf().swap(buffer);
+
     if(ret != 0)
     {
       SET_ERROR_RESULT(m_Error, ResultCode::ImageUnsupported,
@@ -726,42 +761,70 @@ void ImageViewer::RefreshFile()
     texDetails.width = exrImage.width;
     texDetails.height = exrImage.height;
 
-    datasize = texDetails.width * texDetails.height * 4 * sizeof(float);
+    const size_t compSize = halfData ? sizeof(uint16_t) : sizeof(float);
+
+    datasize = texDetails.width * texDetails.height * 4 * compSize;
     data = (byte *)malloc(datasize);
 
     if(!data)
     {
+      FreeEXRImage(&exrImage);
       SET_ERROR_RESULT(m_Error, ResultCode::ReplayOutOfMemory,
                        "Allocation for %zu bytes failed for EXR data", datasize);
+      FileIO::fclose(f);
       return;
     }
 
-    int channels[4] = {-1, -1, -1, -1};
-    for(int i = 0; i < exrImage.num_channels; i++)
-    {
-      switch(exrHeader.channels[i].name[0])
-      {
-        case 'R': channels[0] = i; break;
-        case 'G': channels[1] = i; break;
-        case 'B': channels[2] = i; break;
-        case 'A': channels[3] = i; break;
-      }
-    }
-
-    float *rgba = (float *)data;
-    float **src = (float **)exrImage.images;
+    // RGB channels default to 0, alpha defaults to 1
+    const uint32_t defaultValues[4] = {
+        0, 0, 0, halfData ? uint32_t(ConvertToHalf(1.0f)) : 0x3f800000U,
+    };
 
-    for(uint32_t i = 0; i < texDetails.width * texDetails.height; i++)
-    {
+    // interleave a run of pixels from the planar source channels into RGBA
+    auto interleave = [&](byte **src, size_t srcOffset, size_t dstOffset, size_t count) {
       for(int c = 0; c < 4; c++)
       {
+        byte *dst = data + dstOffset * 4 * compSize + c * compSize;
+
         if(channels[c] >= 0)
-          rgba[i * 4 + c] = src[channels[c]][i];
-        else if(c < 3)    // RGB channels default to 0
-          rgba[i * 4 + c] = 0.0f;
-        else    // alpha defaults to 1
-          rgba[i * 4 + c] = 1.0f;
+        {
+          const byte *chan = src[channels[c]] + srcOffset * compSize;
+          for(size_t i = 0; i < count; i++)
+            memcpy(dst + i * 4 * compSize, chan + i * compSize, compSize);
+        }
+        else
+        {
+          for(size_t i = 0; i < count; i++)
+            memcpy(dst + i * 4 * compSize, &defaultValues[c], compSize);
+        }
       }
+    };
+
+    const uint32_t width = texDetails.width;
+
+    if(exrImage.tiles)
+    {
+      // tiled images are reassembled a row of each tile at a time. Tiles at the right and bottom
+      // edges may be partial, but rows in each tile are always strided by the full tile width
+      Threading::ParallelFor(exrImage.num_tiles, 1, [&](uint32_t begin, uint32_t end) {
+        for(uint32_t t = begin; t < end; t++)
+        {
+          const EXRTile &tile = exrImage.tiles[t];
+          const size_t x = size_t(tile.offset_x) * tileWidth;
+          const size_t y = size_t(tile.offset_y) * tileHeight;
+
+          for(int row = 0; row < tile.height; row++)
+            interleave(tile.images, size_t(row) * tileWidth, (y + row) * width + x, tile.width);
+        }
+      });
+    }
+    else
+    {
+      byte **src = exrImage.images;
+
+      Threading::ParallelFor(texDetails.height, 64, [&](uint32_t begin, uint32_t end) {
+        interleave(src, size_t(begin) * width, size_t(begin) * width, size_t(end - begin) * width);
+      });
     }
 
     ret = FreeEXRImage(&exrImage);
@@ -905,8 +968,12 @@ void ImageViewer::RefreshFile()
 
   m_TexDetails = texDetails;
 
+  // if we're reusing the existing proxy texture, the data still needs the same remapping that was
+  // applied when it was created
   if(m_TextureID == ResourceId())
     CreateProxyTexture(texDetails, read_data);
+  else
+    RemapProxyData(texDetails, read_data);
 
   if(m_TextureID == ResourceId())
   {
@@ -938,6 +1005,8 @@ void ImageViewer::RefreshFile()
 
 void ImageViewer::CreateProxyTexture(TextureDescription &texDetails, read_dds_data &read_data)
 {
+  m_ProxyRemap = ProxyRemap::NoRemap;
+
   if(m_Proxy->IsTextureSupported(texDetails))
   {
     m_TextureID = m_Proxy->CreateProxyTexture(texDetails);
@@ -956,27 +1025,9 @@ void ImageViewer::CreateProxyTexture(TextureDescription &texDetails, read_dds_da
 
       if(m_Proxy->IsTextureSupported(arrayDetails))
       {
-        texDetails = arrayDetails;
-        m_TextureID = m_Proxy->CreateProxyTexture(arrayDetails);
-
-        rdcarray<rdcpair<size_t, size_t>> oldSubs;
-        oldSubs.swap(read_data.subresources);
-
-        // reformat the subresources. The data doesn't change we just add new offsets/sizes
-        for(uint32_t i = 0; i < texDetails.arraysize * texDetails.mips; i++)
-        {
-          const uint32_t mip = i % texDetails.mips;
-          const uint32_t slice = i / texDetails.mips;
-
-          // size of each subresource is 1/Nth for an N-sized array
-          size_t size = oldSubs[mip].second / texDetails.arraysize;
-
-          // and the offset is slice steps further on
-          size_t offset = oldSubs[mip].first + size * slice;
-
-          read_data.subresources.push_back({offset, size});
-        }
-
+        m_ProxyRemap = ProxyRemap::Texture3DAsArray;
+        RemapProxyData(texDetails, read_data);
+        m_TextureID = m_Proxy->CreateProxyTexture(texDetails);
         return;
       }
     }
@@ -989,59 +1040,8 @@ void ImageViewer::CreateProxyTexture(TextureDescription &texDetails, read_dds_da
 
       if(convertSupported)
       {
-        uint32_t srcStride = texDetails.format.ElementSize();
-
-        if(texDetails.format.type == ResourceFormatType::D16S8)
-          srcStride = 4;
-        else if(texDetails.format.type == ResourceFormatType::D32S8)
-          srcStride = 8;
-
-        m_RealTexData.resize(texDetails.arraysize * texDetails.mips);
-
-        bytebuf convertedData;
-
-        for(uint32_t i = 0; i < texDetails.arraysize * texDetails.mips; i++)
-        {
-          const uint32_t mip = i % texDetails.mips;
-
-          const uint32_t mipwidth = RDCMAX(1U, texDetails.width >> mip);
-          const uint32_t mipheight = RDCMAX(1U, texDetails.height >> mip);
-          const uint32_t mipdepth = RDCMAX(1U, texDetails.depth >> mip);
-
-          byte *old = read_data.buffer.data() + read_data.subresources[i].first;
-          m_RealTexData[i].assign(old, read_data.subresources[i].second);
-
-          read_data.subresources[i].first = convertedData.size();
-          read_data.subresources[i].second = sizeof(FloatVector) * mipwidth * mipheight * mipdepth;
-          convertedData.resize(convertedData.size() + read_data.subresources[i].second);
-          byte *converted = convertedData.data() + read_data.subresources[i].first;
-
-          byte *src = old;
-          FloatVector *dst = (FloatVector *)converted;
-
-          for(uint32_t z = 0; z < mipdepth; z++)
-          {
-            for(uint32_t y = 0; y < mipheight; y++)
-            {
-              for(uint32_t x = 0; x < mipwidth; x++)
-              {
-                *dst = DecodeFormattedComponents(texDetails.format, src);
-                dst++;
-                src += srcStride;
-              }
-            }
-          }
-        }
-
-        read_data.buffer.swap(convertedData);
-
-        ResourceFormat rgba32_float;
-        rgba32_float.type = ResourceFormatType::Regular;
-        rgba32_float.compByteWidth = 4;
-        rgba32_float.compCount = 4;
-        rgba32_float.compType = CompType::Float;
-
-        texDetails.format = rgba32_float;
+        m_ProxyRemap = ProxyRemap::ConvertToFloat;
+        RemapProxyData(texDetails, read_data);
         m_TextureID = m_Proxy->CreateProxyTexture(texDetails);
       }
       else
@@ -1057,3 +1057,81 @@ void ImageViewer::CreateProxyTexture(TextureDescription &texDetails, read_dds_da
     }
   }
 }
+
+void ImageViewer::RemapProxyData(TextureDescription &texDetails, read_dds_data &read_data)
+{
+  m_RealTexData.clear();
+
+  if(m_ProxyRemap == ProxyRemap::Texture3DAsArray)
+  {
+    texDetails.arraysize = texDetails.depth;
+    texDetails.depth = 1;
+    texDetails.type = TextureType::Texture2DArray;
+    texDetails.dimension = 2;
+
+    rdcarray<rdcpair<size_t, size_t>> oldSubs;
+    oldSubs.swap(read_data.subresources);
+
+    // reformat the subresources. The data doesn't change we just add new offsets/sizes
+    for(uint32_t i = 0; i < texDetails.arraysize * texDetails.mips; i++)
+    {
+      const uint32_t mip = i % texDetails.mips;
+      const uint32_t slice = i / texDetails.mips;
+
+      // size of each subresource is 1/Nth for an N-sized array
+      size_t size = oldSubs[mip].second / texDetails.arraysize;
+
+      // and the offset is slice steps further on
+      size_t offset = oldSubs[mip].first + size * slice;
+
+      read_data.subresources.push_back({offset, size});
+    }
+  }
+  else if(m_ProxyRemap == ProxyRemap::ConvertToFloat)
+  {
+    uint32_t srcStride = texDetails.format.ElementSize();
+
+    if(texDetails.format.type == ResourceFormatType::D16S8)
+      srcStride = 4;
+    else if(texDetails.format.type == ResourceFormatType::D32S8)
+      srcStride = 8;
+
+    m_RealTexData.resize(texDetails.arraysize * texDetails.mips);
+
+    bytebuf convertedData;
+
+    for(uint32_t i = 0; i < texDetails.arraysize * texDetails.mips; i++)
+    {
+      const uint32_t mip = i % texDetails.mips;
+
+      const uint32_t mipwidth = RDCMAX(1U, texDetails.width >> mip);
+      const uint32_t mipheight = RDCMAX(1U, texDetails.height >> mip);
+      const uint32_t mipdepth = RDCMAX(1U, texDetails.depth >> mip);
+
+      byte *old = read_data.buffer.data() + read_data.subresources[i].first;
+      m_RealTexData[i].assign(old, read_data.subresources[i].second);
+
+      read_data.subresources[i].first = convertedData.size();
+      read_data.subresources[i].second = sizeof(FloatVector) * mipwidth * mipheight * mipdepth;
+      convertedData.resize(convertedData.size() + read_data.subresources[i].second);
+      byte *converted = convertedData.data() + read_data.subresources[i].first;
+
+      for(uint32_t row = 0; row < mipdepth * mipheight; row++)
+      {
+        DecodeFormattedComponentsRow(texDetails.format, old + row * mipwidth * srcStride,
+                                     srcStride, mipwidth,
+                                     (FloatVector *)converted + row * mipwidth);
+      }
+    }
+
+    read_data.buffer.swap(convertedData);
+
+    ResourceFormat rgba32_float;
+    rgba32_float.type = ResourceFormatType::Regular;
+    rgba32_float.compByteWidth = 4;
+    rgba32_float.compCount = 4;
+    rgba32_float.compType = CompType::Float;
+
+    texDetails.format = rgba32_float;
+  }
+}
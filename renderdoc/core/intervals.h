@@ -24,12 +24,252 @@
 
 #pragma once
 
+#include <algorithm>
 #include <map>
 #include "api/replay/rdcflatmap.h"
 #include "api/replay/renderdoc_replay.h"
 #include "common/common.h"
 
-template <typename T>
+// A two-level B+-tree map. Elements are stored sorted in leaf arrays of at most LeafSize elements,
+// with a separate sorted array of each leaf's first key used to find the right leaf. Inserting or
+// erasing only shifts elements within one leaf (and occasionally the leaf index) so unlike
+// rdcflatmap this stays fast with hundreds of thousands of elements, while lookups and iteration
+// stay cache friendly.
+//
+// It only implements what Intervals needs. Inserting invalidates all iterators apart from the one
+// returned. Erasing invalidates iterators at or after the erased element, the same as rdcflatmap.
+template <typename Key, typename Value, size_t LeafSize = 256>
+class BTreeMap
+{
+public:
+  using value_type = rdcpair<Key, Value>;
+  using size_type = size_t;
+
+private:
+  typedef rdcarray<value_type> Leaf;
+
+  template <typename Owner, typename Elem>
+  class iter_type
+  {
+    friend class BTreeMap;
+
+    Owner *map = NULL;
+    size_t leaf = 0, idx = 0;
+
+    iter_type(Owner *m, size_t l, size_t i) : map(m), leaf(l), idx(i) {}
+  public:
+    iter_type() = default;
+
+    Elem &operator*() const { return (*map->leaves[leaf])[idx]; }
+    Elem *operator->() const { return &(*map->leaves[leaf])[idx]; }
+    iter_type &operator++()
+    {
+      if(++idx >= map->leaves[leaf]->size())
+      {
+        leaf++;
+        idx = 0;
+      }
+      return *this;
+    }
+    iter_type operator++(int)
+    {
+      iter_type tmp(*this);
+      operator++();
+      return tmp;
+    }
+    iter_type &operator--()
+    {
+      if(idx == 0)
+      {
+        leaf--;
+        idx = map->leaves[leaf]->size() - 1;
+      }
+      else
+      {
+        idx--;
+      }
+      return *this;
+    }
+    iter_type operator--(int)
+    {
+      iter_type tmp(*this);
+      operator--();
+      return tmp;
+    }
+    bool operator==(const iter_type &o) const { return leaf == o.leaf && idx == o.idx; }
+    bool operator!=(const iter_type &o) const { return !(*this == o); }
+  };
+
+public:
+  using iterator = iter_type<BTreeMap, value_type>;
+  using const_iterator = iter_type<const BTreeMap, const value_type>;
+
+  BTreeMap() = default;
+  BTreeMap(const BTreeMap &o) { *this = o; }
+  BTreeMap(BTreeMap &&o) { *this = std::move(o); }
+  ~BTreeMap() { clear(); }
+  BTreeMap &operator=(const BTreeMap &o)
+  {
+    if(this == &o)
+      return *this;
+    clear();
+    firstKeys = o.firstKeys;
+    leaves.reserve(o.leaves.size());
+    for(Leaf *l : o.leaves)
+      leaves.push_back(new Leaf(*l));
+    count = o.count;
+    return *this;
+  }
+  BTreeMap &operator=(BTreeMap &&o)
+  {
+    if(this == &o)
+      return *this;
+    clear();
+    firstKeys.swap(o.firstKeys);
+    leaves.swap(o.leaves);
+    std::swap(count, o.count);
+    return *this;
+  }
+
+  void clear()
+  {
+    for(Leaf *l : leaves)
+      delete l;
+    leaves.clear();
+    firstKeys.clear();
+    count = 0;
+  }
+
+  size_t size() const { return count; }
+  bool empty() const { return count == 0; }
+  iterator begin() { return iterator(this, 0, 0); }
+  iterator end() { return iterator(this, leaves.size(), 0); }
+  const_iterator begin() const { return const_iterator(this, 0, 0); }
+  const_iterator end() const { return const_iterator(this, leaves.size(), 0); }
+  iterator upper_bound(const Key &key)
+  {
+    size_t l, i;
+    find_upper(key, l, i);
+    return iterator(this, l, i);
+  }
+  const_iterator upper_bound(const Key &key) const
+  {
+    size_t l, i;
+    find_upper(key, l, i);
+    return const_iterator(this, l, i);
+  }
+
+  rdcpair<iterator, bool> insert(const value_type &val)
+  {
+    if(leaves.empty())
+    {
+      leaves.push_back(new Leaf);
+      leaves[0]->push_back(val);
+      firstKeys.push_back(val.first);
+      count++;
+      return {iterator(this, 0, 0), true};
+    }
+
+    size_t l = find_leaf(val.first);
+    Leaf &leaf = *leaves[l];
+    size_t i = std::lower_bound(leaf.begin(), leaf.end(), val.first, KeyLess) - leaf.begin();
+
+    if(i < leaf.size() && leaf[i].first == val.first)
+      return {iterator(this, l, i), false};
+
+    leaf.insert(i, val);
+    count++;
+
+    // only possible in the first leaf, any other leaf's first key is <= val.first
+    if(i == 0)
+      firstKeys[l] = val.first;
+
+    if(leaf.size() > LeafSize)
+    {
+      // split off the upper half into a new leaf
+      const size_t half = leaf.size() / 2;
+
+      Leaf *right = new Leaf;
+      right->assign(leaf.data() + half, leaf.size() - half);
+      leaf.erase(half, leaf.size() - half);
+
+      leaves.insert(l + 1, right);
+      firstKeys.insert(l + 1, right->at(0).first);
+
+      if(i >= half)
+      {
+        l++;
+        i -= half;
+      }
+    }
+
+    return {iterator(this, l, i), true};
+  }
+
+  void erase(iterator it)
+  {
+    const size_t l = it.leaf;
+    Leaf &leaf = *leaves[l];
+    leaf.erase(it.idx);
+    count--;
+
+    if(leaf.empty())
+    {
+      delete leaves[l];
+      leaves.erase(l);
+      firstKeys.erase(l);
+      return;
+    }
+
+    if(it.idx == 0)
+      firstKeys[l] = leaf[0].first;
+
+    // merge the following leaf into this one if they're both sparse. We never merge into the
+    // previous leaf so that iterators before the erased element stay valid.
+    if(l + 1 < leaves.size() && leaf.size() + leaves[l + 1]->size() <= LeafSize / 2)
+    {
+      leaf.append(*leaves[l + 1]);
+      delete leaves[l + 1];
+      leaves.erase(l + 1);
+      firstKeys.erase(l + 1);
+    }
+  }
+
+private:
+  static bool KeyLess(const value_type &v, const Key &k) { return v.first < k; }
+  static bool KeyGreater(const Key &k, const value_type &v) { return k < v.first; }
+  // the last leaf whose first key is <= key, or the first leaf if there is none
+  size_t find_leaf(const Key &key) const
+  {
+    size_t l = std::upper_bound(firstKeys.begin(), firstKeys.end(), key) - firstKeys.begin();
+    return l == 0 ? 0 : l - 1;
+  }
+
+  void find_upper(const Key &key, size_t &l, size_t &i) const
+  {
+    if(leaves.empty())
+    {
+      l = i = 0;
+      return;
+    }
+
+    l = find_leaf(key);
+    const Leaf &leaf = *leaves[l];
+    i = std::upper_bound(leaf.begin(), leaf.end(), key, KeyGreater) - leaf.begin();
+
+    if(i >= leaf.size())
+    {
+      l++;
+      i = 0;
+    }
+  }
+
+  rdcarray<Key> firstKeys;
+  rdcarray<Leaf *> leaves;
+  size_t count = 0;
+};
+
+template <typename T, typename Map = rdcflatmap<uint64_t, T, 0>>
 struct Intervals;
 
 template <typename T, typename Map, typename Iter, typename Interval>
@@ -109,7 +349,8 @@ public:
 template <typename T, typename Map, typename Iter, typename Interval>
 class IntervalsIter
 {
-  friend struct Intervals<T>;
+  template <typename, typename>
+  friend struct Intervals;
 
 protected:
   Interval ref;
@@ -158,11 +399,13 @@ public:
 };
 
 // Data structure to efficiently store values for disjoint intervals.
-template <typename T>
+// By default the interval start points are kept in a flat sorted array which is fastest for the
+// common case of a handful of intervals. Use BTreeIntervals where there can be many thousands.
+template <typename T, typename Map>
 struct Intervals
 {
 public:
-  using MapType = rdcflatmap<uint64_t, T, 0>;
+  using MapType = Map;
 
   typedef IntervalRef<T, MapType, typename MapType::iterator> interval;
   typedef IntervalsIter<T, MapType, typename MapType::iterator, interval> iterator;
@@ -286,3 +529,6 @@ public:
     }
   }
 };
+
+template <typename T>
+using BTreeIntervals = Intervals<T, BTreeMap<uint64_t, T>>;
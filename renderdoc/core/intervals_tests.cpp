@@ -27,6 +27,7 @@
 #if ENABLED(ENABLE_UNIT_TESTS)
 
 #include "api/replay/rdcarray.h"
+#include "common/timing.h"
 #include "intervals.h"
 
 #include "catch/catch.hpp"
@@ -439,4 +440,159 @@ TEST_CASE("Test Intervals type", "[intervals]")
   };
 };
 
+// simple deterministic LCG so tests and benchmarks are repeatable
+static uint64_t NextRandom(uint64_t &seed)
+{
+  seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+  return seed >> 33;
+}
+
+template <typename MapA, typename MapB>
+static void check_same(const Intervals<uint64_t, MapA> &a, const Intervals<uint64_t, MapB> &b)
+{
+  REQUIRE(a.size() == b.size());
+
+  auto i = a.begin();
+  auto j = b.begin();
+  for(; i != a.end() && j != b.end(); i++, j++)
+  {
+    CHECK(i->start() == j->start());
+    CHECK(i->value() == j->value());
+    CHECK(i->finish() == j->finish());
+  }
+  CHECK((i == a.end()));
+  CHECK((j == b.end()));
+}
+
+TEST_CASE("Test BTree backed Intervals", "[intervals]")
+{
+  // use a tiny leaf size so that leaf splits and merges are exercised heavily
+  typedef Intervals<uint64_t, BTreeMap<uint64_t, uint64_t, 4>> SmallBTreeIntervals;
+
+  uint64_t seed = 0x1234;
+
+  auto randomUpdates = [&seed](Intervals<uint64_t> &flat, SmallBTreeIntervals &btree, int count) {
+    for(int i = 0; i < count; i++)
+    {
+      uint64_t start = NextRandom(seed) % 4096;
+      uint64_t finish = start + NextRandom(seed) % 256;
+      uint64_t val = NextRandom(seed) % 4;
+
+      // alternate between overwriting and max, so that some updates leave values unchanged
+      if(i % 2)
+      {
+        auto comp = [](uint64_t a, uint64_t b) { return b; };
+        flat.update(start, finish, val, comp);
+        btree.update(start, finish, val, comp);
+      }
+      else
+      {
+        auto comp = [](uint64_t a, uint64_t b) { return RDCMAX(a, b); };
+        flat.update(start, finish, val, comp);
+        btree.update(start, finish, val, comp);
+      }
+    }
+  };
+
+  SECTION("random updates")
+  {
+    Intervals<uint64_t> flat;
+    SmallBTreeIntervals btree;
+
+    randomUpdates(flat, btree, 2000);
+    check_same(flat, btree);
+
+    // clear everything back to a single interval, which removes every leaf but one
+    auto comp = [](uint64_t a, uint64_t b) { return b; };
+    flat.update(0, UINT64_MAX, 0, comp);
+    btree.update(0, UINT64_MAX, 0, comp);
+    check_same(flat, btree);
+    CHECK(btree.size() == 1);
+  };
+
+  SECTION("random merges")
+  {
+    Intervals<uint64_t> flatA, flatB;
+    SmallBTreeIntervals btreeA, btreeB;
+
+    randomUpdates(flatA, btreeA, 500);
+    randomUpdates(flatB, btreeB, 500);
+
+    auto comp = [](uint64_t a, uint64_t b) { return a ^ b; };
+    flatA.merge(flatB, comp);
+    btreeA.merge(btreeB, comp);
+    check_same(flatA, btreeA);
+  };
+
+  SECTION("copy and find")
+  {
+    Intervals<uint64_t> flat;
+    SmallBTreeIntervals btree;
+
+    randomUpdates(flat, btree, 500);
+
+    SmallBTreeIntervals copy = btree;
+    check_same(flat, copy);
+
+    for(uint64_t x = 0; x < 4500; x += 7)
+    {
+      CHECK(flat.find(x)->start() == copy.find(x)->start());
+      CHECK(flat.find(x)->value() == copy.find(x)->value());
+    }
+  };
+};
+
+// simulates tracking many sub-allocations bound in random order within one large memory object
+template <typename IntervalsType>
+static double BenchmarkSubAllocations(uint32_t count)
+{
+  rdcarray<uint32_t> order;
+  order.resize(count);
+  for(uint32_t i = 0; i < count; i++)
+    order[i] = i;
+
+  uint64_t seed = 0x5678;
+  for(uint32_t i = count - 1; i > 0; i--)
+    std::swap(order[i], order[NextRandom(seed) % (i + 1)]);
+
+  IntervalsType intervals;
+
+  PerformanceTimer timer;
+
+  for(uint32_t i : order)
+    intervals.update(uint64_t(i) * 256, uint64_t(i) * 256 + 192, uint64_t(i % 3) + 1,
+                     [](uint64_t, uint64_t val) { return val; });
+
+  uint64_t sum = 0;
+  for(uint32_t i : order)
+    sum += intervals.find(uint64_t(i) * 256 + 64)->value();
+
+  double ms = timer.GetMilliseconds();
+
+  // each sub-allocation plus the unbound gap after it
+  CHECK(intervals.size() == size_t(count) * 2);
+  CHECK(sum > 0);
+
+  return ms;
+}
+
+TEST_CASE("Benchmark Intervals with many sub-allocations", "[intervals][.benchmark]")
+{
+  for(uint32_t count : {100000U, 300000U, 1000000U})
+  {
+    double btree = BenchmarkSubAllocations<BTreeIntervals<uint64_t>>(count);
+
+    // the flat map is quadratic, so past this point it takes minutes
+    if(count <= 100000)
+    {
+      double flat = BenchmarkSubAllocations<Intervals<uint64_t>>(count);
+      RDCLOG("%u sub-allocations: flat map %.2f ms, b-tree %.2f ms", count, flat, btree);
+    }
+    else
+    {
+      RDCLOG("%u sub-allocations: b-tree %.2f ms", count, btree);
+    }
+  }
+}
+
 #endif    // ENABLED(ENABLE_UNIT_TESTS)
@@ -88,6 +88,7 @@ rdcstr DoStringise(const ReplayProxyPacket &el)
     STRINGISE_ENUM_NAMED(eReplayProxy_RenderOverlay, "RenderOverlay");
 
     STRINGISE_ENUM_NAMED(eReplayProxy_PixelHistory, "PixelHistory");
+    STRINGISE_ENUM_NAMED(eReplayProxy_PixelHistoryRegion, "PixelHistoryRegion");
 
     STRINGISE_ENUM_NAMED(eReplayProxy_DisassembleShader, "DisassembleShader");
     STRINGISE_ENUM_NAMED(eReplayProxy_GetDisassemblyTargets, "GetDisassemblyTargets");
@@ -1532,6 +1533,49 @@ rdcarray<PixelModification> ReplayProxy::PixelHistory(rdcarray<EventUsage> event
   PROXY_FUNCTION(PixelHistory, events, target, x, y, sub, typeCast);
 }
 
+template <typename ParamSerialiser, typename ReturnSerialiser>
+rdcarray<PixelHistoryResult> ReplayProxy::Proxied_PixelHistoryRegion(
+    ParamSerialiser &paramser, ReturnSerialiser &retser, rdcarray<EventUsage> events,
+    ResourceId target, uint32_t x, uint32_t y, uint32_t width, uint32_t height,
+    const Subresource &sub, CompType typeCast)
+{
+  const ReplayProxyPacket expectedPacket = eReplayProxy_PixelHistoryRegion;
+  ReplayProxyPacket packet = eReplayProxy_PixelHistoryRegion;
+  rdcarray<PixelHistoryResult> ret;
+
+  {
+    BEGIN_PARAMS();
+    SERIALISE_ELEMENT(events);
+    SERIALISE_ELEMENT(target);
+    SERIALISE_ELEMENT(x);
+    SERIALISE_ELEMENT(y);
+    SERIALISE_ELEMENT(width);
+    SERIALISE_ELEMENT(height);
+    SERIALISE_ELEMENT(sub);
+    SERIALISE_ELEMENT(typeCast);
+    END_PARAMS();
+  }
+
+  {
+    REMOTE_EXECUTION();
+    if(paramser.IsReading() && !paramser.IsErrored() && !m_IsErrored)
+      ret = m_Remote->PixelHistoryRegion(events, target, x, y, width, height, sub, typeCast);
+  }
+
+  SERIALISE_RETURN(ret);
+
+  return ret;
+}
+
+rdcarray<PixelHistoryResult> ReplayProxy::PixelHistoryRegion(rdcarray<EventUsage> events,
+                                                            ResourceId target, uint32_t x,
+                                                            uint32_t y, uint32_t width,
+                                                            uint32_t height, const Subresource &sub,
+                                                            CompType typeCast)
+{
+  PROXY_FUNCTION(PixelHistoryRegion, events, target, x, y, width, height, sub, typeCast);
+}
+
 template <typename ParamSerialiser, typename ReturnSerialiser>
 ShaderDebugTrace *ReplayProxy::Proxied_DebugVertex(ParamSerialiser &paramser,
                                                    ReturnSerialiser &retser, uint32_t eventId,
@@ -2948,6 +2992,10 @@ bool ReplayProxy::Tick(int type)
     case eReplayProxy_PixelHistory:
       PixelHistory(rdcarray<EventUsage>(), ResourceId(), 0, 0, Subresource(), CompType::Typeless);
       break;
+    case eReplayProxy_PixelHistoryRegion:
+      PixelHistoryRegion(rdcarray<EventUsage>(), ResourceId(), 0, 0, 0, 0, Subresource(),
+                         CompType::Typeless);
+      break;
     case eReplayProxy_DisassembleShader: DisassembleShader(ResourceId(), NULL, ""); break;
     case eReplayProxy_GetDisassemblyTargets: GetDisassemblyTargets(false); break;
     case eReplayProxy_GetTargetShaderEncodings: GetTargetShaderEncodings(); break;
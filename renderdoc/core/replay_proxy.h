@@ -93,6 +93,7 @@ enum ReplayProxyPacket
   eReplayProxy_RenderOverlay,
 
   eReplayProxy_PixelHistory,
+  eReplayProxy_PixelHistoryRegion,
 
   eReplayProxy_DisassembleShader,
   eReplayProxy_GetDisassemblyTargets,
@@ -524,6 +525,10 @@ public:
   IMPLEMENT_FUNCTION_PROXIED(rdcarray<PixelModification>, PixelHistory, rdcarray<EventUsage> events,
                              ResourceId target, uint32_t x, uint32_t y, const Subresource &sub,
                              CompType typeCast);
+  IMPLEMENT_FUNCTION_PROXIED(rdcarray<PixelHistoryResult>, PixelHistoryRegion,
+                             rdcarray<EventUsage> events, ResourceId target, uint32_t x, uint32_t y,
+                             uint32_t width, uint32_t height, const Subresource &sub,
+                             CompType typeCast);
   IMPLEMENT_FUNCTION_PROXIED(ShaderDebugTrace *, DebugVertex, uint32_t eventId, uint32_t vertid,
                              uint32_t instid, uint32_t idx, uint32_t view);
   IMPLEMENT_FUNCTION_PROXIED(ShaderDebugTrace *, DebugPixel, uint32_t eventId, uint32_t x,
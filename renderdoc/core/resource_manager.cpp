@@ -26,6 +26,12 @@
 #include "resource_manager.h"
 
 #include <algorithm>
+#include "core/settings.h"
+#include "zstd/xxhash.h"
+
+RDOC_CONFIG(bool, Capture_DeduplicateInitialContents, true,
+            "Store identical initial contents payloads only once in a capture, with other "
+            "resources referring to the first copy.");
 
 namespace ResourceIDGen
 {
@@ -228,3 +234,360 @@ void ResourceRecord::Delete(ResourceRecordHandler *mgr)
     mgr->DestroyResourceRecord(this);
   }
 }
+
+void ResourceRecord::InsertRuns(rdcarray<ChunkRun> &runs)
+{
+  bool dataWritten = DataWritten;
+
+  DataWritten = true;
+
+  for(auto it = Parents.begin(); it != Parents.end(); ++it)
+  {
+    if(!(*it)->DataWritten)
+    {
+      (*it)->InsertRuns(runs);
+    }
+  }
+
+  if(!dataWritten && !m_Chunks.empty())
+  {
+    // IDs are allocated before the chunk lock is taken, so chunks added from different threads can
+    // be slightly out of order.
+    auto idLess = [](const StoredChunk &a, const StoredChunk &b) { return a.id < b.id; };
+    if(!std::is_sorted(m_Chunks.begin(), m_Chunks.end(), idLess))
+    {
+      LockChunks();
+      std::stable_sort(m_Chunks.begin(), m_Chunks.end(), idLess);
+      UnlockChunks();
+    }
+
+    runs.push_back({m_Chunks.data(), m_Chunks.size()});
+  }
+}
+
+void ResourceRecord::WriteChunkRuns(WriteSerialiser &ser, const rdcarray<ChunkRun> &runs,
+                                    CaptureProgress progress)
+{
+  size_t total = 0;
+  for(const ChunkRun &run : runs)
+    total += run.second;
+
+  const float num = float(total);
+  size_t idx = 0;
+
+  // each chunk is held back until the next one is seen, so that a chunk with the same ID from a
+  // later run can replace it.
+  const StoredChunk *pending = NULL;
+
+  ProcessSortedRuns(runs, [](const StoredChunk &c) { return int64_t(c.id); },
+                    [&](const StoredChunk &c) {
+                      if(pending && pending->id != c.id)
+                        pending->chunk->Write(ser);
+                      pending = &c;
+
+                      // don't update progress for every chunk, there can be millions of them
+                      if((idx % 1024) == 0)
+                        RenderDoc::Inst().SetProgress(progress, float(idx) / num);
+                      idx++;
+                    });
+
+  if(pending)
+    pending->chunk->Write(ser);
+}
+
+bool InitialContentsDedupTable::Enabled()
+{
+  return Capture_DeduplicateInitialContents();
+}
+
+ResourceId InitialContentsDedupTable::FindOrAdd(ResourceId id, uint32_t kind, const byte *data,
+                                                uint64_t size)
+{
+  ContentsKey key;
+  key.kind = kind;
+  key.size = size;
+  key.hash[0] = XXH64(data, (size_t)size, 0);
+  key.hash[1] = XXH64(data, (size_t)size, 0x9E3779B97F4A7C15ULL);
+
+  auto it = m_Contents.find(key);
+  if(it != m_Contents.end())
+  {
+    m_DedupCount++;
+    m_DedupBytes += size;
+    return it->second;
+  }
+
+  m_Contents[key] = id;
+  return ResourceId();
+}
+
+void InitialContentsDedupTable::Clear()
+{
+  m_Contents.clear();
+  m_DedupCount = 0;
+  m_DedupBytes = 0;
+}
+
+#if ENABLED(ENABLE_UNIT_TESTS)
+
+#include "common/timing.h"
+#include "catch/catch.hpp"
+
+TEST_CASE("Test merging sorted runs", "[resourcemanager]")
+{
+  typedef rdcpair<uint32_t, uint32_t> KeyVal;
+
+  auto key = [](const KeyVal &kv) { return kv.first; };
+  auto sum = [](KeyVal &kv, const KeyVal &other) { kv.second += other.second; };
+
+  rdcarray<KeyVal> merged;
+
+  SECTION("empty")
+  {
+    rdcarray<rdcarray<KeyVal>> runs;
+    MergeSortedRuns(runs, merged, key, sum);
+    CHECK(merged.empty());
+
+    runs.resize(3);
+    MergeSortedRuns(runs, merged, key, sum);
+    CHECK(merged.empty());
+  };
+
+  SECTION("single run is unchanged")
+  {
+    rdcarray<rdcarray<KeyVal>> runs = {{{1, 1}, {4, 2}, {9, 3}}};
+    MergeSortedRuns(runs, merged, key, sum);
+    CHECK((merged == runs[0]));
+  };
+
+  SECTION("overlapping runs are combined")
+  {
+    rdcarray<rdcarray<KeyVal>> runs = {
+        {{1, 1}, {4, 1}, {9, 1}}, {}, {{2, 10}, {4, 10}}, {{0, 100}, {9, 100}, {12, 100}},
+    };
+    MergeSortedRuns(runs, merged, key, sum);
+
+    rdcarray<KeyVal> expected = {{0, 100}, {1, 1}, {2, 10}, {4, 11}, {9, 101}, {12, 100}};
+    CHECK((merged == expected));
+  };
+
+  SECTION("random runs match a sorted union")
+  {
+    uint32_t seed = 0x1234;
+    auto rand = [&seed]() {
+      seed = seed * 1103515245U + 12345U;
+      return seed >> 16;
+    };
+
+    std::map<uint32_t, uint32_t> ref;
+    rdcarray<rdcarray<KeyVal>> runs;
+    runs.resize(16);
+    for(rdcarray<KeyVal> &run : runs)
+    {
+      std::map<uint32_t, uint32_t> vals;
+      for(uint32_t i = rand() % 200; i > 0; i--)
+        vals[rand() % 1000] = 1;
+
+      for(auto it = vals.begin(); it != vals.end(); ++it)
+      {
+        run.push_back({it->first, it->second});
+        ref[it->first] += it->second;
+      }
+    }
+
+    MergeSortedRuns(runs, merged, key, sum);
+
+    REQUIRE(merged.size() == ref.size());
+    size_t i = 0;
+    for(auto it = ref.begin(); it != ref.end(); ++it, ++i)
+    {
+      CHECK(merged[i].first == it->first);
+      CHECK(merged[i].second == it->second);
+    }
+  };
+};
+
+// writes the chunks from a set of records in ID order, either by inserting them into a map or with
+// a k-way merge of the records' chunk lists.
+static void WriteRecordChunks(WriteSerialiser &ser, const rdcarray<ResourceRecord *> &records,
+                              bool merge)
+{
+  for(ResourceRecord *record : records)
+    record->MarkDataUnwritten();
+
+  if(merge)
+  {
+    rdcarray<ResourceRecord::ChunkRun> runs;
+    for(ResourceRecord *record : records)
+      record->InsertRuns(runs);
+    ResourceRecord::WriteChunkRuns(ser, runs, CaptureProgress::SerialiseFrameContents);
+  }
+  else
+  {
+    std::map<int64_t, Chunk *> recordlist;
+    for(ResourceRecord *record : records)
+      record->Insert(recordlist);
+    for(auto it = recordlist.begin(); it != recordlist.end(); ++it)
+      it->second->Write(ser);
+  }
+}
+
+TEST_CASE("Test deduplicating initial contents", "[resourcemanager]")
+{
+  InitialContentsDedupTable table;
+
+  ResourceId a = ResourceIDGen::GetNewUniqueID();
+  ResourceId b = ResourceIDGen::GetNewUniqueID();
+  ResourceId c = ResourceIDGen::GetNewUniqueID();
+  ResourceId d = ResourceIDGen::GetNewUniqueID();
+
+  bytebuf zeroes;
+  zeroes.resize(4096);
+  bytebuf pattern;
+  pattern.resize(4096);
+  for(size_t i = 0; i < pattern.size(); i++)
+    pattern[i] = byte(i * 7);
+
+  CHECK(table.FindOrAdd(a, 0, zeroes.data(), zeroes.size()) == ResourceId());
+  CHECK(table.FindOrAdd(b, 0, pattern.data(), pattern.size()) == ResourceId());
+
+  // identical payloads refer to the first resource that wrote them
+  CHECK(table.FindOrAdd(c, 0, zeroes.data(), zeroes.size()) == a);
+  CHECK(table.FindOrAdd(d, 0, pattern.data(), pattern.size()) == b);
+  CHECK(table.FindOrAdd(d, 0, pattern.data(), pattern.size()) == b);
+
+  // a prefix of the same data is a different payload
+  CHECK(table.FindOrAdd(c, 0, zeroes.data(), 1024) == ResourceId());
+  CHECK(table.FindOrAdd(d, 0, zeroes.data(), 1024) == c);
+
+  // a single byte difference is a different payload
+  pattern[2000]++;
+  CHECK(table.FindOrAdd(c, 0, pattern.data(), pattern.size()) == ResourceId());
+
+  // as is the same data of a different kind
+  CHECK(table.FindOrAdd(d, 1, zeroes.data(), zeroes.size()) == ResourceId());
+  CHECK(table.FindOrAdd(a, 1, zeroes.data(), zeroes.size()) == d);
+
+  CHECK(table.GetDeduplicatedCount() == 5);
+  CHECK(table.GetDeduplicatedBytes() == 4096 * 4 + 1024);
+
+  table.Clear();
+
+  CHECK(table.GetDeduplicatedCount() == 0);
+  CHECK(table.FindOrAdd(c, 0, zeroes.data(), zeroes.size()) == ResourceId());
+};
+
+TEST_CASE("Test writing record chunks in order", "[resourcemanager]")
+{
+  WriteSerialiser scratch(new StreamWriter(StreamWriter::DefaultScratchSize), Ownership::Stream);
+
+  rdcarray<Chunk *> chunks;
+  for(uint32_t i = 0; i < 300; i++)
+  {
+    scratch.WriteChunk(1);
+    scratch.Serialise("value"_lit, i);
+    scratch.EndChunk();
+
+    chunks.push_back(Chunk::Create(scratch, 1));
+  }
+
+  rdcarray<ResourceRecord *> records;
+  for(uint32_t i = 0; i < 8; i++)
+    records.push_back(new ResourceRecord(ResourceId(), false));
+
+  // the first record's chunks come from its parent as well
+  records[0]->AddParent(records[1]);
+
+  uint32_t seed = 0x4321;
+  for(uint32_t i = 0; i < 250; i++)
+  {
+    seed = seed * 1103515245U + 12345U;
+    records[(seed >> 16) % records.size()]->AddChunk(chunks[i], i + 1);
+  }
+
+  // chunks added out of order, and an ID that's in two records
+  records[5]->AddChunk(chunks[250], 1000);
+  records[5]->AddChunk(chunks[251], 999);
+  records[6]->AddChunk(chunks[252], 2000);
+  records[7]->AddChunk(chunks[253], 2000);
+
+  StreamWriter *mapWriter = new StreamWriter(StreamWriter::DefaultScratchSize);
+  StreamWriter *mergeWriter = new StreamWriter(StreamWriter::DefaultScratchSize);
+  {
+    WriteSerialiser mapSer(mapWriter, Ownership::Nothing);
+    WriteRecordChunks(mapSer, records, false);
+
+    WriteSerialiser mergeSer(mergeWriter, Ownership::Nothing);
+    WriteRecordChunks(mergeSer, records, true);
+  }
+
+  CHECK(mergeWriter->GetOffset() > 0);
+  CHECK((bytebuf(mapWriter->GetData(), (size_t)mapWriter->GetOffset()) ==
+         bytebuf(mergeWriter->GetData(), (size_t)mergeWriter->GetOffset())));
+
+  delete mapWriter;
+  delete mergeWriter;
+
+  for(ResourceRecord *record : records)
+    delete record;
+
+  for(Chunk *c : chunks)
+    c->Delete();
+};
+
+TEST_CASE("Benchmark writing record chunks in order", "[resourcemanager][.benchmark]")
+{
+  const uint32_t numRecords = 10000;
+  const uint32_t numChunks = 5000000;
+
+  WriteSerialiser scratch(new StreamWriter(StreamWriter::DefaultScratchSize), Ownership::Stream);
+  uint32_t value = 0;
+  scratch.WriteChunk(1);
+  scratch.Serialise("value"_lit, value);
+  scratch.EndChunk();
+
+  // the chunk contents don't matter here, only the ordering, so every record refers to one chunk
+  Chunk *chunk = Chunk::Create(scratch, 1);
+
+  // like command buffers recorded in parallel, each record's chunk IDs are interleaved with others
+  rdcarray<ResourceRecord *> records;
+  for(uint32_t i = 0; i < numRecords; i++)
+    records.push_back(new ResourceRecord(ResourceId(), false));
+  for(uint32_t i = 0; i < numChunks; i++)
+    records[i % numRecords]->AddChunk(chunk, i + 1);
+
+  // size the output up-front so that neither timing includes growing it
+  uint64_t chunkSize = 0;
+  {
+    StreamWriter *chunkWriter = new StreamWriter(StreamWriter::DefaultScratchSize);
+    WriteSerialiser chunkSer(chunkWriter, Ownership::Stream);
+    chunk->Write(chunkSer);
+    chunkSize = chunkWriter->GetOffset();
+  }
+
+  StreamWriter *writer = new StreamWriter(chunkSize * numChunks);
+  WriteSerialiser ser(writer, Ownership::Stream);
+
+  PerformanceTimer timer;
+  WriteRecordChunks(ser, records, false);
+  double mapTime = timer.GetMilliseconds();
+
+  uint64_t mapSize = writer->GetOffset();
+  writer->Rewind();
+
+  timer.Restart();
+  WriteRecordChunks(ser, records, true);
+  double mergeTime = timer.GetMilliseconds();
+
+  CHECK(writer->GetOffset() == mapSize);
+
+  RDCLOG("%u records with %u chunks: map %.2f ms, k-way merge %.2f ms", numRecords, numChunks,
+         mapTime, mergeTime);
+
+  for(ResourceRecord *record : records)
+    delete record;
+
+  chunk->Delete();
+};
+
+#endif    // ENABLED(ENABLE_UNIT_TESTS)
@@ -34,6 +34,7 @@
 #include "api/replay/resourceid.h"
 #include "common/threading.h"
 #include "core/core.h"
+#include "core/resourceid_map.h"
 #include "os/os_specific.h"
 #include "serialise/serialiser.h"
 
@@ -289,6 +290,96 @@ inline bool MarkReferenced(std::map<ResourceId, FrameRefType> &refs, ResourceId
   return MarkReferenced(refs, id, refType, ComposeFrameRefs);
 }
 
+template <typename Compose>
+bool MarkReferenced(ShardedResourceIdMap<FrameRefType> &refs, ResourceId id, FrameRefType refType,
+                    Compose comp)
+{
+  bool ret = false;
+  refs.update(id, [&](FrameRefType &ref, bool isNew) {
+    ref = isNew ? refType : comp(ref, refType);
+    ret = isNew;
+  });
+  return ret;
+}
+
+// k-way merge of several runs, each sorted by key, calling process(const T &) on every element in
+// key order. Elements with the same key are processed in the order of the runs they come from.
+template <typename T, typename Key, typename Process>
+void ProcessSortedRuns(const rdcarray<rdcpair<const T *, size_t>> &runs, Key key, Process process)
+{
+  struct Head
+  {
+    const T *cur;
+    const T *end;
+    size_t run;
+  };
+
+  // min-heap of the next unprocessed element in each run
+  rdcarray<Head> heads;
+  for(size_t i = 0; i < runs.size(); i++)
+  {
+    if(runs[i].second > 0)
+      heads.push_back({runs[i].first, runs[i].first + runs[i].second, i});
+  }
+
+  auto greater = [&key](const Head &a, const Head &b) {
+    auto keyA = key(*a.cur);
+    auto keyB = key(*b.cur);
+    if(keyB < keyA)
+      return true;
+    if(keyA < keyB)
+      return false;
+    return b.run < a.run;
+  };
+
+  std::make_heap(heads.begin(), heads.end(), greater);
+
+  while(!heads.empty())
+  {
+    std::pop_heap(heads.begin(), heads.end(), greater);
+    Head &head = heads.back();
+
+    // keep taking from this run while it's still ahead of every other run, so runs that don't
+    // interleave much don't need a heap operation per element
+    do
+    {
+      process(*head.cur);
+      head.cur++;
+    } while(head.cur != head.end && (heads.size() == 1 || !greater(head, heads[0])));
+
+    if(head.cur != head.end)
+      std::push_heap(heads.begin(), heads.end(), greater);
+    else
+      heads.pop_back();
+  }
+}
+
+// k-way merge of several runs, each sorted by key with no duplicate keys, into one sorted run. When
+// a key is in more than one run, combine(T &merged, const T &other) is called to fold it in.
+template <typename T, typename Key, typename Combine>
+void MergeSortedRuns(const rdcarray<rdcarray<T>> &runs, rdcarray<T> &merged, Key key,
+                     Combine combine)
+{
+  merged.clear();
+
+  rdcarray<rdcpair<const T *, size_t>> spans;
+  size_t total = 0;
+  for(size_t i = 0; i < runs.size(); i++)
+  {
+    total += runs[i].size();
+    spans.push_back({runs[i].data(), runs[i].size()});
+  }
+
+  merged.reserve(total);
+
+  ProcessSortedRuns(spans, key, [&merged, &key, &combine](const T &val) {
+    if(!merged.empty() && key(merged.back()) == key(val))
+      combine(merged.back(), val);
+    else
+      merged.push_back(val);
+  });
+}
+
 // verbose prints with IDs of each dirty resource and whether it was prepared,
 // and whether it was serialised.
 #define VERBOSE_DIRTY_RESOURCES OPTION_OFF
@@ -370,6 +461,24 @@ struct ResourceRecord
     Parents.clear();
   }
 
+  struct StoredChunk
+  {
+    StoredChunk(int64_t i, Chunk *c)
+    {
+      id = i;
+      // we store this here because by the time it comes to delete the chunks the allocator may have
+      // already been reset and the contents trashed.
+      fromAllocator = c->IsFromAllocator() ? 1 : 0;
+      chunk = c;
+    }
+    int64_t id : 63;
+    int64_t fromAllocator : 1;
+    Chunk *chunk;
+  };
+
+  // a record's chunk list, sorted by ID
+  typedef rdcpair<const StoredChunk *, size_t> ChunkRun;
+
   void MarkDataUnwritten() { DataWritten = false; }
   void Insert(std::map<int64_t, Chunk *> &recordlist)
   {
@@ -392,6 +501,14 @@ struct ResourceRecord
     }
   }
 
+  // the same as Insert, but rather than inserting each chunk into a map it gathers the chunk lists
+  // of this record and its unwritten parents, to be merged and written in order by WriteChunkRuns.
+  void InsertRuns(rdcarray<ChunkRun> &runs);
+  // writes the chunks from several runs to ser in ID order. If an ID appears in more than one run
+  // the chunk from the last run is written, matching inserting them into a map in order.
+  static void WriteChunkRuns(WriteSerialiser &ser, const rdcarray<ChunkRun> &runs,
+                             CaptureProgress progress);
+
   void AddRef() { Atomic::Inc32(&RefCount); }
   int GetRefCount() const { return RefCount; }
   void Delete(ResourceRecordHandler *mgr);
@@ -516,21 +633,6 @@ protected:
     return Atomic::Inc64(&globalIDCounter);
   }
 
-  struct StoredChunk
-  {
-    StoredChunk(int64_t i, Chunk *c)
-    {
-      id = i;
-      // we store this here because by the time it comes to delete the chunks the allocator may have
-      // already been reset and the contents trashed.
-      fromAllocator = c->IsFromAllocator() ? 1 : 0;
-      chunk = c;
-    }
-    int64_t id : 63;
-    int64_t fromAllocator : 1;
-    Chunk *chunk;
-  };
-
   rdcarray<StoredChunk> m_Chunks;
   Threading::CriticalSection *m_ChunkLock;
 
@@ -545,6 +647,49 @@ bool ResourceRecord::MarkResourceFrameReferenced(ResourceId id, FrameRefType ref
   return MarkReferenced(m_FrameRefs, id, refType, comp);
 }
 
+// tracks the initial contents payloads written so far in a capture by their contents, so that a
+// payload identical to an earlier one can be stored as a reference to that resource instead of
+// being written again.
+class InitialContentsDedupTable
+{
+public:
+  // returns the resource that first wrote an identical payload of the same kind, or ResourceId() if
+  // this is the first time it has been seen - in which case id becomes its owner. Drivers can use
+  // the kind to keep apart payloads that are encoded or replayed differently.
+  ResourceId FindOrAdd(ResourceId id, uint32_t kind, const byte *data, uint64_t size);
+  void Clear();
+
+  // whether deduplication is enabled for captures, see Capture.DeduplicateInitialContents
+  static bool Enabled();
+
+  uint64_t GetDeduplicatedCount() const { return m_DedupCount; }
+  uint64_t GetDeduplicatedBytes() const { return m_DedupBytes; }
+private:
+  struct ContentsKey
+  {
+    uint32_t kind;
+    uint64_t size;
+    // two independently seeded hashes, to make an accidental collision vanishingly unlikely since
+    // the earlier payload is no longer available to compare against.
+    uint64_t hash[2];
+
+    bool operator<(const ContentsKey &o) const
+    {
+      if(kind != o.kind)
+        return kind < o.kind;
+      if(size != o.size)
+        return size < o.size;
+      if(hash[0] != o.hash[0])
+        return hash[0] < o.hash[0];
+      return hash[1] < o.hash[1];
+    }
+  };
+
+  std::map<ContentsKey, ResourceId> m_Contents;
+  uint64_t m_DedupCount = 0;
+  uint64_t m_DedupBytes = 0;
+};
+
 // the resource manager is a utility class that's not required but is likely wanted by any API
 // implementation.
 // It keeps track of resource records, which resources are alive and allows you to query for them by
@@ -614,6 +759,12 @@ public:
   // generate chunks for initial contents and insert.
   void InsertInitialContentsChunks(WriteSerialiser &ser);
 
+  // while initial contents chunks are being inserted, checks whether a resource's payload is
+  // identical to one of the same kind already written. If so returns the ID of the resource that
+  // wrote it and the payload can be serialised as a reference, otherwise returns ResourceId().
+  ResourceId DeduplicateInitialContents(ResourceId id, uint32_t kind, const byte *data,
+                                        uint64_t size);
+
   // for initial contents that don't need a chunk - apply them here. This allows any patching to
   // creation-time chunks to happen before they're written to disk.
   void ApplyInitialContentsNonChunks(WriteSerialiser &ser);
@@ -632,6 +783,10 @@ public:
   void MarkBackgroundFrameReferenced(const rdcflatmap<ResourceId, FrameRefType> &refs);
   void CleanBackgroundFrameReferences();
 
+  // merge any writes and dirty resources buffered by threads during background capture. This
+  // happens automatically at frame end and whenever the merged state is needed.
+  void FlushPendingReferences();
+
   ///////////////////////////////////////////
   // Replay-side methods
 
@@ -721,12 +876,36 @@ protected:
   // Unwrap)
   std::map<RealResourceType, WrappedResourceType> m_WrapperMap;
 
-  // used during capture - holds resources referenced in current frame (and how they're referenced)
-  std::map<ResourceId, FrameRefType> m_FrameReferencedResources;
+  // used during capture - holds resources referenced in current frame (and how they're referenced).
+  // Sharded with its own locks so threads marking references don't all serialise on m_Lock
+  ShardedResourceIdMap<FrameRefType> m_FrameReferencedResources;
 
   // used during capture - holds resources marked as dirty, needing initial contents
   std::set<ResourceId> m_DirtyResources;
 
+  // used during background capture - writes and dirty resources are buffered per-thread without
+  // taking m_Lock, and merged in batches into m_ResourceRefTimes and m_DirtyResources.
+  struct PendingReferences
+  {
+    Threading::CriticalSection lock;
+    rdcarray<rdcpair<ResourceId, FrameRefType>> writes;
+    rdcarray<ResourceId> dirty;
+  };
+
+  // once a thread has buffered this many references it merges them itself, so threads that never
+  // present don't grow without bound
+  static const size_t PendingReferenceLimit = 4096;
+
+  PendingReferences *GetPendingReferences();
+  void AddPendingWrite(ResourceId id, FrameRefType refType);
+  void AddPendingDirty(ResourceId id);
+  // parent must hold m_Lock
+  void MergePendingReferences();
+
+  uint64_t m_PendingReferencesSlot = 0;
+  Threading::CriticalSection m_PendingReferencesLock;
+  rdcarray<PendingReferences *> m_PendingReferences;
+
   struct InitialContentDataOrChunk
   {
     Chunk *chunk = NULL;
@@ -747,25 +926,30 @@ protected:
   // used during capture or replay - holds initial contents
   std::map<ResourceId, InitialContentDataOrChunk> m_InitialContents;
 
+  // used during capture - payloads written so far by InsertInitialContentsChunks, only valid while
+  // m_DeduplicatingInitialContents is set.
+  InitialContentsDedupTable m_InitialContentsDedup;
+  bool m_DeduplicatingInitialContents = false;
+
   // used during capture or replay - map of resources currently alive with their real IDs, used in
   // capture and replay.
-  std::unordered_map<ResourceId, WrappedResourceType> m_CurrentResourceMap;
+  ResourceIdMap<WrappedResourceType> m_CurrentResourceMap;
 
   // used during replay - maps back and forth from original id to live id and vice-versa
-  std::unordered_map<ResourceId, ResourceId> m_OriginalIDs, m_LiveIDs;
+  ResourceIdMap<ResourceId> m_OriginalIDs, m_LiveIDs;
 
   // used during replay - holds resources allocated and the original id that they represent
-  std::unordered_map<ResourceId, WrappedResourceType> m_LiveResourceMap;
+  ResourceIdMap<WrappedResourceType> m_LiveResourceMap;
 
-  // used during capture - holds resource records by id.
-  std::unordered_map<ResourceId, RecordType *> m_ResourceRecords;
-  Threading::RWLock m_ResourceRecordLock;
+  // used during capture - holds resource records by id. Looked up from every thread recording
+  // commands so it's sharded rather than having one lock
+  ShardedResourceIdMap<RecordType *> m_ResourceRecords;
 
   // used during replay - holds current resource replacements
   // replaced -> replacement
-  std::unordered_map<ResourceId, ResourceId> m_Replacements;
+  ResourceIdMap<ResourceId> m_Replacements;
   // replacement -> replaced (for looking up original IDs)
-  std::unordered_map<ResourceId, ResourceId> m_Replaced;
+  ResourceIdMap<ResourceId> m_Replaced;
 
   // During initial resources preparation, persistent resources are
   // postponed until serializing to RDC file.
@@ -797,6 +981,8 @@ protected:
   // in one atomic chunk).
   rdcarray<ResourceRefTimes> m_ResourceRefTimes;
 
+  inline void UpdateRefTimes(ResourceRefTimes &times, FrameRefType refType, double now);
+
   // Timestamp at the beginning of the frame capture. Used to determine which
   // resources to refresh for their last write or partial use time (see `ResourceRefTimes`).
   double m_captureStartTime;
@@ -811,6 +997,8 @@ template <typename Configuration>
 ResourceManager<Configuration>::ResourceManager(CaptureState &state) : m_State(state)
 {
   m_Capturing = IsCaptureMode(state);
+  if(m_Capturing)
+    m_PendingReferencesSlot = Threading::AllocateTLSSlot();
   RenderDoc::Inst().RegisterMemoryRegion(this, sizeof(ResourceManager));
 }
 
@@ -840,6 +1028,9 @@ ResourceManager<Configuration>::~ResourceManager()
   RDCASSERT(m_InitialContents.empty());
   RDCASSERT(m_ResourceRecords.empty());
 
+  for(PendingReferences *pending : m_PendingReferences)
+    delete pending;
+
   RenderDoc::Inst().UnregisterMemoryRegion(this);
 }
 
@@ -874,6 +1065,8 @@ void ResourceManager<Configuration>::CleanBackgroundFrameReferences()
 {
   SCOPED_LOCK_OPTIONAL(m_Lock, m_Capturing);
 
+  MergePendingReferences();
+
   if(IsBackgroundCapturing(m_State))
   {
     double now = m_ResourcesUpdateTimer.GetMilliseconds();
@@ -916,30 +1109,215 @@ void ResourceManager<Configuration>::CleanBackgroundFrameReferences()
 }
 
 template <typename Configuration>
-template <typename Compose>
-void ResourceManager<Configuration>::MarkResourceFrameReferenced(ResourceId id,
-                                                                 FrameRefType refType, Compose comp)
+void ResourceManager<Configuration>::FlushPendingReferences()
 {
   SCOPED_LOCK_OPTIONAL(m_Lock, m_Capturing);
+  MergePendingReferences();
+}
 
-  if(id == ResourceId())
+template <typename Configuration>
+typename ResourceManager<Configuration>::PendingReferences *
+ResourceManager<Configuration>::GetPendingReferences()
+{
+  PendingReferences *ret = (PendingReferences *)Threading::GetTLSValue(m_PendingReferencesSlot);
+  if(ret)
+    return ret;
+
+  // slow path, once per thread
+  ret = new PendingReferences;
+  Threading::SetTLSValue(m_PendingReferencesSlot, (void *)ret);
+
+  {
+    SCOPED_LOCK(m_PendingReferencesLock);
+    m_PendingReferences.push_back(ret);
+  }
+
+  return ret;
+}
+
+template <typename Configuration>
+void ResourceManager<Configuration>::AddPendingWrite(ResourceId id, FrameRefType refType)
+{
+  PendingReferences *pending = GetPendingReferences();
+
+  bool full = false;
+  {
+    SCOPED_LOCK(pending->lock);
+    pending->writes.push_back({id, refType});
+    full = pending->writes.size() >= PendingReferenceLimit;
+  }
+
+  if(full)
+    FlushPendingReferences();
+}
+
+template <typename Configuration>
+void ResourceManager<Configuration>::AddPendingDirty(ResourceId id)
+{
+  PendingReferences *pending = GetPendingReferences();
+
+  bool full = false;
+  {
+    SCOPED_LOCK(pending->lock);
+    pending->dirty.push_back(id);
+    full = pending->dirty.size() >= PendingReferenceLimit;
+  }
+
+  if(full)
+    FlushPendingReferences();
+}
+
+template <typename Configuration>
+void ResourceManager<Configuration>::MergePendingReferences()
+{
+  // parent must hold m_Lock for us
+
+  rdcarray<rdcarray<rdcpair<ResourceId, FrameRefType>>> writes;
+  rdcarray<rdcarray<ResourceId>> dirty;
+
+  {
+    SCOPED_LOCK(m_PendingReferencesLock);
+
+    for(PendingReferences *pending : m_PendingReferences)
+    {
+      SCOPED_LOCK(pending->lock);
+
+      if(!pending->writes.empty())
+      {
+        writes.push_back({});
+        writes.back().swap(pending->writes);
+      }
+
+      if(!pending->dirty.empty())
+      {
+        dirty.push_back({});
+        dirty.back().swap(pending->dirty);
+      }
+    }
+  }
+
+  if(writes.empty() && dirty.empty())
     return;
 
-  if(IsActiveCapturing(m_State))
+  // sort each thread's writes, and where a resource was written more than once on the same thread
+  // keep only the last write, as that's what decides whether it's still skippable.
+  for(rdcarray<rdcpair<ResourceId, FrameRefType>> &run : writes)
   {
-    SkipOrPostponeOrPrepare_InitialState(id, refType);
+    std::stable_sort(run.begin(), run.end(),
+                     [](const rdcpair<ResourceId, FrameRefType> &a,
+                        const rdcpair<ResourceId, FrameRefType> &b) { return a.first < b.first; });
 
-    if(IsDirtyFrameRef(refType))
+    size_t dst = 0;
+    for(size_t src = 0; src < run.size(); src++)
     {
-      Prepare_InitialStateIfPostponed(id, true);
+      if(dst > 0 && run[dst - 1].first == run[src].first)
+        run[dst - 1] = run[src];
+      else
+        run[dst++] = run[src];
     }
+    run.resize(dst);
   }
 
-  UpdateLastWriteTime(id, refType);
+  for(rdcarray<ResourceId> &run : dirty)
+  {
+    std::sort(run.begin(), run.end());
+    run.resize(std::unique(run.begin(), run.end()) - run.begin());
+  }
 
+  if(!writes.empty())
+  {
+    // writes on different threads have no order between them, so conservatively let any write
+    // that isn't a complete discard win.
+    rdcarray<rdcpair<ResourceId, FrameRefType>> merged;
+    MergeSortedRuns(writes, merged,
+                    [](const rdcpair<ResourceId, FrameRefType> &w) { return w.first; },
+                    [](rdcpair<ResourceId, FrameRefType> &w,
+                       const rdcpair<ResourceId, FrameRefType> &other) {
+                      if(other.second != eFrameRef_CompleteWriteAndDiscard)
+                        w.second = other.second;
+                    });
+
+    // a handful of writes can be looked up individually, otherwise do a single merge pass with the
+    // already-sorted write times rather than inserting into the middle of them one at a time
+    if(merged.size() * 16 <= m_ResourceRefTimes.size())
+    {
+      for(const rdcpair<ResourceId, FrameRefType> &w : merged)
+        UpdateLastWriteTime(w.first, w.second);
+    }
+    else
+    {
+      double now = m_ResourcesUpdateTimer.GetMilliseconds();
+
+      rdcarray<ResourceRefTimes> times;
+      times.reserve(m_ResourceRefTimes.size() + merged.size());
+
+      size_t t = 0;
+      for(const rdcpair<ResourceId, FrameRefType> &w : merged)
+      {
+        while(t < m_ResourceRefTimes.size() && m_ResourceRefTimes[t].id < w.first)
+          times.push_back(m_ResourceRefTimes[t++]);
+
+        if(t < m_ResourceRefTimes.size() && m_ResourceRefTimes[t].id == w.first)
+          times.push_back(m_ResourceRefTimes[t++]);
+        else
+          times.push_back({w.first, 0.0, 0.0});
+
+        UpdateRefTimes(times.back(), w.second, now);
+      }
+
+      times.append(m_ResourceRefTimes.data() + t, m_ResourceRefTimes.size() - t);
+      m_ResourceRefTimes.swap(times);
+    }
+  }
+
+  if(!dirty.empty())
+  {
+    rdcarray<ResourceId> merged;
+    MergeSortedRuns(dirty, merged, [](const ResourceId &id) { return id; },
+                    [](ResourceId &, const ResourceId &) {});
+
+    // the IDs are in order, so each one can be inserted after the previous
+    auto hint = m_DirtyResources.begin();
+    for(ResourceId id : merged)
+      hint = m_DirtyResources.insert(hint, id);
+  }
+}
+
+template <typename Configuration>
+template <typename Compose>
+void ResourceManager<Configuration>::MarkResourceFrameReferenced(ResourceId id,
+                                                                 FrameRefType refType, Compose comp)
+{
+  if(id == ResourceId())
+    return;
+
+  // in the background only writes are tracked, for their last write time. Read references don't
+  // need to be recorded at all, and writes are buffered on this thread to be merged in a batch
   if(IsBackgroundCapturing(m_State))
+  {
+    if(IsDirtyFrameRef(refType))
+      AddPendingWrite(id, refType);
     return;
+  }
 
+  {
+    SCOPED_LOCK_OPTIONAL(m_Lock, m_Capturing);
+
+    if(IsActiveCapturing(m_State))
+    {
+      SkipOrPostponeOrPrepare_InitialState(id, refType);
+
+      if(IsDirtyFrameRef(refType))
+      {
+        Prepare_InitialStateIfPostponed(id, true);
+      }
+    }
+
+    UpdateLastWriteTime(id, refType);
+  }
+
+  // the frame references have their own locks. Drivers serialise capture transitions against
+  // threads referencing resources so they can't be cleared underneath us.
   bool newRef = MarkReferenced(m_FrameReferencedResources, id, refType, comp);
 
   if(newRef)
@@ -960,11 +1338,17 @@ void ResourceManager<Configuration>::MarkResourceFrameReferenced(ResourceId id,
 template <typename Configuration>
 void ResourceManager<Configuration>::MarkDirtyResource(ResourceId res)
 {
-  SCOPED_LOCK_OPTIONAL(m_Lock, m_Capturing);
-
   if(res == ResourceId())
     return;
 
+  if(IsBackgroundCapturing(m_State))
+  {
+    AddPendingDirty(res);
+    return;
+  }
+
+  SCOPED_LOCK_OPTIONAL(m_Lock, m_Capturing);
+
   m_DirtyResources.insert(res);
 }
 
@@ -976,6 +1360,8 @@ bool ResourceManager<Configuration>::IsResourceDirty(ResourceId res)
   if(res == ResourceId())
     return false;
 
+  MergePendingReferences();
+
   return m_DirtyResources.find(res) != m_DirtyResources.end();
 }
 
@@ -1061,16 +1447,15 @@ void ResourceManager<Configuration>::Serialise_InitialContentsNeeded(WriteSerial
 
   // all resources that were recorded as being modified should be included in the list of those
   // needing initial contents
-  for(auto it = m_FrameReferencedResources.begin(); it != m_FrameReferencedResources.end(); ++it)
-  {
-    RecordType *record = GetResourceRecord(it->first);
-    if(IsDirtyFrameRef(it->second))
+  m_FrameReferencedResources.for_each([&](const ResourceId &id, FrameRefType ref) {
+    RecordType *record = GetResourceRecord(id);
+    if(IsDirtyFrameRef(ref))
     {
-      WrittenRecord wr = {it->first, record ? record->DataInSerialiser : true};
+      WrittenRecord wr = {id, record ? record->DataInSerialiser : true};
 
       NeededInitials.push_back(wr);
     }
-  }
+  });
 
   // any resources that had initial contents generated should also be included, even if they're only
   // referenced read-only, as anything not in this list will have its initial contents freed on
@@ -1081,7 +1466,7 @@ void ResourceManager<Configuration>::Serialise_InitialContentsNeeded(WriteSerial
     bool include = RenderDoc::Inst().GetCaptureOptions().refAllResources;
 
     ResourceId id = it->first;
-    if(m_FrameReferencedResources.find(id) != m_FrameReferencedResources.end())
+    if(m_FrameReferencedResources.contains(id))
       include = true;
 
     if(include)
@@ -1183,6 +1568,7 @@ template <typename Configuration>
 inline void ResourceManager<Configuration>::ResetLastWriteTimes()
 {
   SCOPED_LOCK_OPTIONAL(m_Lock, m_Capturing);
+  MergePendingReferences();
   for(auto it = m_ResourceRefTimes.begin(); it != m_ResourceRefTimes.end(); ++it)
   {
     // Reset only those resources which were below the threshold on
@@ -1213,20 +1599,25 @@ inline void ResourceManager<Configuration>::UpdateLastWriteTime(ResourceId id, F
     it = m_ResourceRefTimes.begin() + idx;
   }
 
-  double now = m_ResourcesUpdateTimer.GetMilliseconds();
+  UpdateRefTimes(*it, refType, m_ResourcesUpdateTimer.GetMilliseconds());
+}
 
-  it->writeTime = now;
+template <typename Configuration>
+inline void ResourceManager<Configuration>::UpdateRefTimes(ResourceRefTimes &times,
+                                                           FrameRefType refType, double now)
+{
+  times.writeTime = now;
 
   if(refType == eFrameRef_CompleteWriteAndDiscard)
   {
     // don't continually update it. We want to know that this resource *was* completely written and
     // discarded, and hasn't been written in any other way since then.
-    if(it->firstSkipTime == 0.0)
-      it->firstSkipTime = now;
+    if(times.firstSkipTime == 0.0)
+      times.firstSkipTime = now;
   }
   else
   {
-    it->firstSkipTime = 0.0;
+    times.firstSkipTime = 0.0;
   }
 }
 
@@ -1234,6 +1625,7 @@ template <typename Configuration>
 inline bool ResourceManager<Configuration>::HasPersistentAge(ResourceId id)
 {
   SCOPED_LOCK_OPTIONAL(m_Lock, m_Capturing);
+  MergePendingReferences();
 
   ResourceRefTimes *it = std::lower_bound(m_ResourceRefTimes.begin(), m_ResourceRefTimes.end(), id);
 
@@ -1247,6 +1639,7 @@ template <typename Configuration>
 inline bool ResourceManager<Configuration>::HasSkippableAge(ResourceId id)
 {
   SCOPED_LOCK_OPTIONAL(m_Lock, m_Capturing);
+  MergePendingReferences();
 
   ResourceRefTimes *it = std::lower_bound(m_ResourceRefTimes.begin(), m_ResourceRefTimes.end(), id);
 
@@ -1375,10 +1768,8 @@ rdcarray<ResourceId> ResourceManager<Configuration>::InitialContentResources()
 template <typename Configuration>
 void ResourceManager<Configuration>::MarkUnwrittenResources()
 {
-  SCOPED_READLOCK(m_ResourceRecordLock);
-
-  for(auto it = m_ResourceRecords.begin(); it != m_ResourceRecords.end(); ++it)
-    it->second->MarkDataUnwritten();
+  m_ResourceRecords.for_each(
+      [](const ResourceId &, RecordType *record) { record->MarkDataUnwritten(); });
 }
 
 template <typename Configuration>
@@ -1392,37 +1783,32 @@ void ResourceManager<Configuration>::InsertReferencedChunks(WriteSerialiser &ser
 
   if(RenderDoc::Inst().GetCaptureOptions().refAllResources)
   {
-    SCOPED_READLOCK(m_ResourceRecordLock);
-
     float num = float(m_ResourceRecords.size());
     float idx = 0.0f;
 
-    for(auto it = m_ResourceRecords.begin(); it != m_ResourceRecords.end(); ++it)
-    {
+    m_ResourceRecords.for_each([&](const ResourceId &id, RecordType *record) {
       RenderDoc::Inst().SetProgress(CaptureProgress::AddReferencedResources, idx / num);
       idx += 1.0f;
 
-      if(m_FrameReferencedResources.find(it->first) == m_FrameReferencedResources.end() &&
-         it->second->InternalResource)
-        continue;
+      if(!m_FrameReferencedResources.contains(id) && record->InternalResource)
+        return;
 
-      it->second->Insert(sortedChunks);
-    }
+      record->Insert(sortedChunks);
+    });
   }
   else
   {
     float num = float(m_FrameReferencedResources.size());
     float idx = 0.0f;
 
-    for(auto it = m_FrameReferencedResources.begin(); it != m_FrameReferencedResources.end(); ++it)
-    {
+    m_FrameReferencedResources.for_each([&](const ResourceId &id, FrameRefType) {
       RenderDoc::Inst().SetProgress(CaptureProgress::AddReferencedResources, idx / num);
       idx += 1.0f;
 
-      RecordType *record = GetResourceRecord(it->first);
+      RecordType *record = GetResourceRecord(id);
       if(record)
         record->Insert(sortedChunks);
-    }
+    });
   }
 
   RDCDEBUG("%u frame resource chunks", (uint32_t)sortedChunks.size());
@@ -1438,6 +1824,8 @@ void ResourceManager<Configuration>::PrepareInitialContents()
 {
   SCOPED_LOCK_OPTIONAL(m_Lock, m_Capturing);
 
+  MergePendingReferences();
+
   RDCDEBUG("Preparing up to %u potentially dirty resources", (uint32_t)m_DirtyResources.size());
   uint32_t prepared = 0;
   uint32_t postponed = 0;
@@ -1507,6 +1895,11 @@ void ResourceManager<Configuration>::InsertInitialContentsChunks(WriteSerialiser
   float num = float(m_InitialContents.size());
   float idx = 0.0f;
 
+  // chunks are written (and replayed) in this order, so any payload found in the table has already
+  // been serialised by the time a later resource refers to it.
+  m_InitialContentsDedup.Clear();
+  m_DeduplicatingInitialContents = InitialContentsDedupTable::Enabled();
+
   for(auto it = m_InitialContents.begin(); it != m_InitialContents.end(); ++it)
   {
     ResourceId id = it->first;
@@ -1514,7 +1907,7 @@ void ResourceManager<Configuration>::InsertInitialContentsChunks(WriteSerialiser
     RenderDoc::Inst().SetProgress(CaptureProgress::SerialiseInitialStates, idx / num);
     idx += 1.0f;
 
-    if(m_FrameReferencedResources.find(id) == m_FrameReferencedResources.end() &&
+    if(!m_FrameReferencedResources.contains(id) &&
        !RenderDoc::Inst().GetCaptureOptions().refAllResources)
     {
 #if ENABLED(VERBOSE_DIRTY_RESOURCES)
@@ -1576,6 +1969,28 @@ void ResourceManager<Configuration>::InsertInitialContentsChunks(WriteSerialiser
   }
 
   RDCDEBUG("Serialised %u resources, skipped %u unreferenced", dirty, skipped);
+
+  if(m_InitialContentsDedup.GetDeduplicatedCount() > 0)
+    RDCDEBUG("Deduplicated %llu initial contents payloads, saving %llu bytes",
+             m_InitialContentsDedup.GetDeduplicatedCount(),
+             m_InitialContentsDedup.GetDeduplicatedBytes());
+
+  m_DeduplicatingInitialContents = false;
+  m_InitialContentsDedup.Clear();
+}
+
+template <typename Configuration>
+ResourceId ResourceManager<Configuration>::DeduplicateInitialContents(ResourceId id,
+                                                                      uint32_t kind,
+                                                                      const byte *data,
+                                                                      uint64_t size)
+{
+  // only chunks written in order by InsertInitialContentsChunks can refer to each other, any other
+  // serialisation (e.g. into a standalone chunk) must be self-contained.
+  if(!m_DeduplicatingInitialContents || data == NULL || size == 0)
+    return ResourceId();
+
+  return m_InitialContentsDedup.FindOrAdd(id, kind, data, size);
 }
 
 template <typename Configuration>
@@ -1587,7 +2002,7 @@ void ResourceManager<Configuration>::ApplyInitialContentsNonChunks(WriteSerialis
   {
     ResourceId id = it->first;
 
-    if(m_FrameReferencedResources.find(id) == m_FrameReferencedResources.end() &&
+    if(!m_FrameReferencedResources.contains(id) &&
        !RenderDoc::Inst().GetCaptureOptions().refAllResources)
     {
       continue;
@@ -1608,17 +2023,16 @@ void ResourceManager<Configuration>::ClearReferencedResources()
 {
   SCOPED_LOCK_OPTIONAL(m_Lock, m_Capturing);
 
-  for(auto it = m_FrameReferencedResources.begin(); it != m_FrameReferencedResources.end(); ++it)
-  {
-    RecordType *record = GetResourceRecord(it->first);
+  m_FrameReferencedResources.for_each([this](const ResourceId &id, FrameRefType ref) {
+    RecordType *record = GetResourceRecord(id);
 
     if(record)
     {
-      if(IncludesWrite(it->second))
-        MarkDirtyResource(it->first);
+      if(IncludesWrite(ref))
+        MarkDirtyResource(id);
       record->Delete(this);
     }
-  }
+  });
 
   m_FrameReferencedResources.clear();
 }
@@ -1660,47 +2074,35 @@ void ResourceManager<Configuration>::RemoveReplacement(ResourceId id)
 template <typename Configuration>
 typename Configuration::RecordType *ResourceManager<Configuration>::GetResourceRecord(ResourceId id)
 {
-  SCOPED_READLOCK(m_ResourceRecordLock);
-
-  auto it = m_ResourceRecords.find(id);
-
-  if(it == m_ResourceRecords.end())
-    return NULL;
-
-  return it->second;
+  RecordType *ret = NULL;
+  m_ResourceRecords.find(id, ret);
+  return ret;
 }
 
 template <typename Configuration>
 bool ResourceManager<Configuration>::HasResourceRecord(ResourceId id)
 {
-  SCOPED_READLOCK(m_ResourceRecordLock);
-
-  auto it = m_ResourceRecords.find(id);
-
-  if(it == m_ResourceRecords.end())
-    return false;
-
-  return true;
+  return m_ResourceRecords.contains(id);
 }
 
 template <typename Configuration>
 typename Configuration::RecordType *ResourceManager<Configuration>::AddResourceRecord(ResourceId id)
 {
-  SCOPED_WRITELOCK(m_ResourceRecordLock);
+  RecordType *ret = new RecordType(id);
 
-  RDCASSERT(m_ResourceRecords.find(id) == m_ResourceRecords.end(), id);
+  m_ResourceRecords.update(id, [ret, id](RecordType *&record, bool isNew) {
+    RDCASSERT(isNew, id);
+    record = ret;
+  });
 
-  return (m_ResourceRecords[id] = new RecordType(id));
+  return ret;
 }
 
 template <typename Configuration>
 void ResourceManager<Configuration>::RemoveResourceRecord(ResourceId id)
 {
-  SCOPED_WRITELOCK(m_ResourceRecordLock);
-
-  RDCASSERT(m_ResourceRecords.find(id) != m_ResourceRecords.end(), id);
-
-  m_ResourceRecords.erase(id);
+  bool removed = m_ResourceRecords.erase(id);
+  RDCASSERT(removed, id);
 }
 
 template <typename Configuration>
@@ -1898,6 +2300,9 @@ void ResourceManager<Configuration>::ReleaseCurrentResource(ResourceId id)
     Prepare_InitialStateIfPostponed(id, true);
   }
 
+  // merge any buffered references first so they can't re-add this resource afterwards
+  MergePendingReferences();
+
   m_CurrentResourceMap.erase(id);
   m_DirtyResources.erase(id);
 
@@ -0,0 +1,373 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019-2022 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#pragma once
+
+#include <functional>
+#include <utility>
+#include "api/replay/renderdoc_replay.h"
+#include "common/threading.h"
+
+// An open-addressing hash map keyed on ResourceId, using Robin Hood hashing with backward-shift
+// deletion. All entries live inline in a single array so a lookup usually touches one or two cache
+// lines, unlike std::unordered_map which allocates a node per entry and chases pointers. It stays
+// O(1) with many thousands of entries, unlike rdcflatmap.
+//
+// It presents the same std::map-like interface as rdcflatmap, with similarly weaker guarantees:
+// iteration is in no particular order, and any insert or erase invalidates all iterators and
+// references into the map.
+template <typename Value>
+class ResourceIdMap
+{
+public:
+  using value_type = rdcpair<ResourceId, Value>;
+  using size_type = size_t;
+
+private:
+  struct Slot
+  {
+    value_type kv;
+    // distance from this entry's ideal slot, plus one. 0 means the slot is empty
+    uint32_t dist = 0;
+  };
+
+  template <typename Owner, typename Elem>
+  class iter_type
+  {
+    friend class ResourceIdMap;
+
+    Owner *map = NULL;
+    size_t idx = 0;
+
+    iter_type(Owner *m, size_t i) : map(m), idx(i) { skip(); }
+    void skip()
+    {
+      while(idx < map->m_Slots.size() && map->m_Slots[idx].dist == 0)
+        idx++;
+    }
+
+  public:
+    iter_type() = default;
+
+    Elem &operator*() const { return map->m_Slots[idx].kv; }
+    Elem *operator->() const { return &map->m_Slots[idx].kv; }
+    iter_type &operator++()
+    {
+      idx++;
+      skip();
+      return *this;
+    }
+    iter_type operator++(int)
+    {
+      iter_type tmp(*this);
+      operator++();
+      return tmp;
+    }
+    bool operator==(const iter_type &o) const { return idx == o.idx; }
+    bool operator!=(const iter_type &o) const { return idx != o.idx; }
+  };
+
+public:
+  using iterator = iter_type<ResourceIdMap, value_type>;
+  using const_iterator = iter_type<const ResourceIdMap, const value_type>;
+
+  iterator begin() { return iterator(this, 0); }
+  iterator end() { return iterator(this, m_Slots.size()); }
+  const_iterator begin() const { return const_iterator(this, 0); }
+  const_iterator end() const { return const_iterator(this, m_Slots.size()); }
+  size_t size() const { return m_Count; }
+  bool empty() const { return m_Count == 0; }
+  void clear()
+  {
+    m_Slots.clear();
+    m_Count = 0;
+  }
+
+  void reserve(size_t count)
+  {
+    size_t capacity = MinCapacity;
+    while(capacity * MaxLoadNum / MaxLoadDenom < count)
+      capacity *= 2;
+
+    if(capacity > m_Slots.size())
+      rehash(capacity);
+  }
+
+  iterator find(const ResourceId &id) { return iterator(this, find_index(id)); }
+  const_iterator find(const ResourceId &id) const { return const_iterator(this, find_index(id)); }
+  Value &operator[](const ResourceId &id)
+  {
+    size_t idx = find_index(id);
+    if(idx == m_Slots.size())
+      idx = insert_new(id, Value());
+    return m_Slots[idx].kv.second;
+  }
+
+  rdcpair<iterator, bool> insert(const value_type &val)
+  {
+    size_t idx = find_index(val.first);
+    if(idx != m_Slots.size())
+      return {iterator(this, idx), false};
+
+    idx = insert_new(val.first, val.second);
+    return {iterator(this, idx), true};
+  }
+
+  void erase(const ResourceId &id)
+  {
+    size_t idx = find_index(id);
+    if(idx != m_Slots.size())
+      erase_index(idx);
+  }
+  void erase(iterator it) { erase_index(it.idx); }
+private:
+  static const size_t MinCapacity = 16;
+  // grow when more than 7/8ths full. Robin Hood hashing keeps probe lengths short even at high load
+  static const size_t MaxLoadNum = 7;
+  static const size_t MaxLoadDenom = 8;
+
+  size_t ideal_index(const ResourceId &id) const
+  {
+    // IDs are allocated sequentially, so scramble them with a fibonacci hash and take the top bits
+    // which are the best mixed.
+    uint64_t h = uint64_t(std::hash<ResourceId>()(id)) * 0x9E3779B97F4A7C15ULL;
+    return size_t(h >> 32) & (m_Slots.size() - 1);
+  }
+
+  // returns m_Slots.size() if not found
+  size_t find_index(const ResourceId &id) const
+  {
+    if(m_Count == 0)
+      return m_Slots.size();
+
+    const size_t mask = m_Slots.size() - 1;
+    size_t idx = ideal_index(id);
+    for(uint32_t dist = 1;; dist++)
+    {
+      const Slot &s = m_Slots[idx];
+
+      // if we reach a slot that's closer to its ideal position than we would be (including empty
+      // slots), the key can't be present or it would have displaced that entry.
+      if(s.dist < dist)
+        return m_Slots.size();
+
+      if(s.kv.first == id)
+        return idx;
+
+      idx = (idx + 1) & mask;
+    }
+  }
+
+  // inserts a key known not to be present, returns the index it ended up at
+  size_t insert_new(const ResourceId &id, const Value &val)
+  {
+    if(m_Slots.empty() || (m_Count + 1) * MaxLoadDenom > m_Slots.size() * MaxLoadNum)
+      rehash(m_Slots.empty() ? MinCapacity : m_Slots.size() * 2);
+
+    m_Count++;
+
+    Slot cur;
+    cur.kv = {id, val};
+    cur.dist = 1;
+
+    const size_t mask = m_Slots.size() - 1;
+    size_t idx = ideal_index(id);
+    size_t ret = SIZE_MAX;
+    for(;;)
+    {
+      Slot &s = m_Slots[idx];
+
+      if(s.dist == 0)
+      {
+        s = std::move(cur);
+        return ret == SIZE_MAX ? idx : ret;
+      }
+
+      // steal from the rich: if the resident entry is closer to its ideal slot than the one we're
+      // placing, swap them and carry on placing the displaced entry.
+      if(s.dist < cur.dist)
+      {
+        std::swap(s, cur);
+        if(ret == SIZE_MAX)
+          ret = idx;
+      }
+
+      cur.dist++;
+      idx = (idx + 1) & mask;
+    }
+  }
+
+  void erase_index(size_t idx)
+  {
+    const size_t mask = m_Slots.size() - 1;
+
+    // shift following entries back by one until we hit an empty slot or one that's already in its
+    // ideal position, so there are never tombstones.
+    size_t next = (idx + 1) & mask;
+    while(m_Slots[next].dist > 1)
+    {
+      m_Slots[idx] = std::move(m_Slots[next]);
+      m_Slots[idx].dist--;
+      idx = next;
+      next = (next + 1) & mask;
+    }
+
+    m_Slots[idx] = Slot();
+    m_Count--;
+  }
+
+  void rehash(size_t capacity)
+  {
+    rdcarray<Slot> old;
+    old.swap(m_Slots);
+
+    m_Slots.resize(capacity);
+    m_Count = 0;
+
+    for(Slot &s : old)
+      if(s.dist > 0)
+        insert_new(s.kv.first, s.kv.second);
+  }
+
+  rdcarray<Slot> m_Slots;
+  size_t m_Count = 0;
+};
+
+// A ResourceId map that can be accessed concurrently from many threads. IDs are split across a fixed
+// number of shards, each an independent ResourceIdMap with its own lock, so threads working on
+// different resources rarely contend on the same lock or cache line.
+//
+// Since iterators can't be held safely across threads the interface works by value or through
+// callbacks that run with the relevant shard locked. Callbacks must not access the same map again.
+template <typename Value, size_t NumShards = 16>
+class ShardedResourceIdMap
+{
+  static_assert((NumShards & (NumShards - 1)) == 0, "Number of shards must be a power of two");
+
+public:
+  // returns true and fills out val if the ID is present
+  bool find(const ResourceId &id, Value &val) const
+  {
+    const Shard &s = shard(id);
+    SCOPED_READLOCK(s.lock);
+    auto it = s.map.find(id);
+    if(it == s.map.end())
+      return false;
+    val = it->second;
+    return true;
+  }
+
+  bool contains(const ResourceId &id) const
+  {
+    const Shard &s = shard(id);
+    SCOPED_READLOCK(s.lock);
+    return s.map.find(id) != s.map.end();
+  }
+
+  // returns false and does nothing if the ID was already present
+  bool insert(const ResourceId &id, const Value &val)
+  {
+    Shard &s = shard(id);
+    SCOPED_WRITELOCK(s.lock);
+    return s.map.insert({id, val}).second;
+  }
+
+  // calls func(Value &val, bool isNew) with the ID's shard write-locked. If the ID wasn't present it
+  // is inserted with a default-constructed value before calling.
+  template <typename Func>
+  void update(const ResourceId &id, Func func)
+  {
+    Shard &s = shard(id);
+    SCOPED_WRITELOCK(s.lock);
+    auto it = s.map.find(id);
+    const bool isNew = (it == s.map.end());
+    if(isNew)
+      it = s.map.insert({id, Value()}).first;
+    func(it->second, isNew);
+  }
+
+  // returns true if the ID was present
+  bool erase(const ResourceId &id)
+  {
+    Shard &s = shard(id);
+    SCOPED_WRITELOCK(s.lock);
+    size_t count = s.map.size();
+    s.map.erase(id);
+    return s.map.size() != count;
+  }
+
+  // calls func(const ResourceId &, const Value &) for every entry, in no particular order, with each
+  // shard read-locked in turn. Entries added or removed concurrently may or may not be visited.
+  template <typename Func>
+  void for_each(Func func) const
+  {
+    for(const Shard &s : m_Shards)
+    {
+      SCOPED_READLOCK(s.lock);
+      for(auto it = s.map.begin(); it != s.map.end(); ++it)
+        func(it->first, it->second);
+    }
+  }
+
+  size_t size() const
+  {
+    size_t ret = 0;
+    for(const Shard &s : m_Shards)
+    {
+      SCOPED_READLOCK(s.lock);
+      ret += s.map.size();
+    }
+    return ret;
+  }
+
+  bool empty() const { return size() == 0; }
+  void clear()
+  {
+    for(Shard &s : m_Shards)
+    {
+      SCOPED_WRITELOCK(s.lock);
+      s.map.clear();
+    }
+  }
+
+private:
+  struct Shard
+  {
+    mutable Threading::RWLock lock;
+    ResourceIdMap<Value> map;
+    // keep neighbouring shards' locks on separate cache lines
+    byte padding[64];
+  };
+
+  Shard &shard(const ResourceId &id)
+  {
+    return m_Shards[std::hash<ResourceId>()(id) & (NumShards - 1)];
+  }
+  const Shard &shard(const ResourceId &id) const
+  {
+    return m_Shards[std::hash<ResourceId>()(id) & (NumShards - 1)];
+  }
+
+  Shard m_Shards[NumShards];
+};
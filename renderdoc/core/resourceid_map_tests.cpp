@@ -0,0 +1,380 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019-2022 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#include "common/globalconfig.h"
+
+#if ENABLED(ENABLE_UNIT_TESTS)
+
+#include <map>
+#include <unordered_map>
+#include "api/replay/rdcarray.h"
+#include "common/timing.h"
+#include "resourceid_map.h"
+
+#include "catch/catch.hpp"
+
+static uint64_t NextRandom(uint64_t &seed)
+{
+  seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+  return seed >> 33;
+}
+
+template <typename Value>
+static void check_same(const ResourceIdMap<Value> &map,
+                       const std::unordered_map<ResourceId, Value> &ref)
+{
+  REQUIRE(map.size() == ref.size());
+
+  size_t count = 0;
+  for(auto it = map.begin(); it != map.end(); ++it)
+  {
+    auto refit = ref.find(it->first);
+    REQUIRE((refit != ref.end()));
+    CHECK(refit->second == it->second);
+    count++;
+  }
+  CHECK(count == ref.size());
+
+  for(auto it = ref.begin(); it != ref.end(); ++it)
+  {
+    auto mapit = map.find(it->first);
+    REQUIRE((mapit != map.end()));
+    CHECK(mapit->second == it->second);
+  }
+}
+
+TEST_CASE("Test ResourceIdMap type", "[resourceidmap]")
+{
+  rdcarray<ResourceId> ids;
+  ids.resize(2000);
+  for(ResourceId &id : ids)
+    id = ResourceIDGen::GetNewUniqueID();
+
+  SECTION("basic operations")
+  {
+    ResourceIdMap<uint32_t> map;
+
+    CHECK(map.empty());
+    CHECK((map.find(ids[0]) == map.end()));
+    CHECK((map.begin() == map.end()));
+
+    map[ids[0]] = 5;
+    CHECK(map.size() == 1);
+    CHECK(map.find(ids[0])->second == 5);
+
+    auto res = map.insert({ids[0], 10});
+    CHECK_FALSE(res.second);
+    CHECK(res.first->second == 5);
+
+    res = map.insert({ids[1], 10});
+    CHECK(res.second);
+    CHECK(res.first->second == 10);
+    CHECK(map.size() == 2);
+
+    map.erase(ids[0]);
+    CHECK((map.find(ids[0]) == map.end()));
+    CHECK(map.size() == 1);
+
+    map.erase(map.find(ids[1]));
+    CHECK(map.empty());
+
+    // erasing a missing key is a no-op
+    map.erase(ids[2]);
+    CHECK(map.empty());
+  };
+
+  SECTION("random operations match std::unordered_map")
+  {
+    ResourceIdMap<uint64_t> map;
+    std::unordered_map<ResourceId, uint64_t> ref;
+
+    uint64_t seed = 0x1234;
+
+    for(int i = 0; i < 20000; i++)
+    {
+      ResourceId id = ids[NextRandom(seed) % ids.size()];
+      uint64_t val = NextRandom(seed);
+
+      switch(NextRandom(seed) % 4)
+      {
+        case 0:
+        case 1:
+          map[id] = val;
+          ref[id] = val;
+          break;
+        case 2:
+          map.erase(id);
+          ref.erase(id);
+          break;
+        case 3:
+        {
+          auto it = map.find(id);
+          auto refit = ref.find(id);
+          REQUIRE((it == map.end()) == (refit == ref.end()));
+          if(it != map.end())
+            CHECK(it->second == refit->second);
+          break;
+        }
+      }
+    }
+
+    check_same(map, ref);
+
+    // erase everything through iterators, re-finding since erasing invalidates
+    while(!map.empty())
+    {
+      ResourceId id = map.begin()->first;
+      map.erase(map.find(id));
+      ref.erase(id);
+      check_same(map, ref);
+    }
+  };
+
+  SECTION("copies are independent")
+  {
+    ResourceIdMap<uint32_t> map;
+    for(uint32_t i = 0; i < 100; i++)
+      map[ids[i]] = i;
+
+    ResourceIdMap<uint32_t> copy = map;
+    copy[ids[0]] = 1000;
+    copy.erase(ids[1]);
+
+    CHECK(map[ids[0]] == 0);
+    CHECK((map.find(ids[1]) != map.end()));
+    CHECK(copy.size() == 99);
+  };
+};
+
+TEST_CASE("Benchmark ResourceIdMap against std::unordered_map", "[resourceidmap][.benchmark]")
+{
+  const uint32_t count = 1000000;
+
+  rdcarray<ResourceId> ids;
+  ids.resize(count);
+  for(ResourceId &id : ids)
+    id = ResourceIDGen::GetNewUniqueID();
+
+  // look up in a different order to insertion, like resources being used randomly during a frame
+  rdcarray<ResourceId> lookups = ids;
+  uint64_t seed = 0x5678;
+  for(uint32_t i = count - 1; i > 0; i--)
+    std::swap(lookups[i], lookups[NextRandom(seed) % (i + 1)]);
+
+  uint64_t sum = 0;
+
+  PerformanceTimer timer;
+
+  std::unordered_map<ResourceId, uint64_t> ref;
+  for(uint32_t i = 0; i < count; i++)
+    ref[ids[i]] = i;
+  double refInsert = timer.GetMilliseconds();
+
+  timer.Restart();
+  for(int pass = 0; pass < 4; pass++)
+    for(ResourceId id : lookups)
+      sum += ref.find(id)->second;
+  double refFind = timer.GetMilliseconds();
+
+  timer.Restart();
+  ResourceIdMap<uint64_t> map;
+  for(uint32_t i = 0; i < count; i++)
+    map[ids[i]] = i;
+  double mapInsert = timer.GetMilliseconds();
+
+  timer.Restart();
+  for(int pass = 0; pass < 4; pass++)
+    for(ResourceId id : lookups)
+      sum -= map.find(id)->second;
+  double mapFind = timer.GetMilliseconds();
+
+  CHECK(sum == 0);
+
+  RDCLOG("%u IDs: std::unordered_map insert %.2f ms, find %.2f ms", count, refInsert, refFind);
+  RDCLOG("%u IDs: ResourceIdMap insert %.2f ms, find %.2f ms", count, mapInsert, mapFind);
+}
+
+TEST_CASE("Test ShardedResourceIdMap type", "[resourceidmap]")
+{
+  rdcarray<ResourceId> ids;
+  ids.resize(1000);
+  for(ResourceId &id : ids)
+    id = ResourceIDGen::GetNewUniqueID();
+
+  SECTION("basic operations")
+  {
+    ShardedResourceIdMap<uint32_t> map;
+
+    uint32_t val = 0;
+    CHECK(map.empty());
+    CHECK_FALSE(map.find(ids[0], val));
+
+    CHECK(map.insert(ids[0], 5));
+    CHECK_FALSE(map.insert(ids[0], 10));
+    CHECK(map.find(ids[0], val));
+    CHECK(val == 5);
+    CHECK(map.contains(ids[0]));
+    CHECK_FALSE(map.contains(ids[1]));
+
+    map.update(ids[1], [](uint32_t &v, bool isNew) {
+      CHECK(isNew);
+      CHECK(v == 0);
+      v = 7;
+    });
+    map.update(ids[1], [](uint32_t &v, bool isNew) {
+      CHECK_FALSE(isNew);
+      v++;
+    });
+    CHECK(map.find(ids[1], val));
+    CHECK(val == 8);
+    CHECK(map.size() == 2);
+
+    CHECK(map.erase(ids[0]));
+    CHECK_FALSE(map.erase(ids[0]));
+    CHECK(map.size() == 1);
+
+    map.clear();
+    CHECK(map.empty());
+  };
+
+  SECTION("concurrent updates")
+  {
+    ShardedResourceIdMap<uint32_t> map;
+
+    const uint32_t numThreads = 8;
+    const uint32_t perThread = 10000;
+
+    // every thread increments every ID's count many times, in a different order per thread
+    Threading::ParallelFor(numThreads, 1, [&](uint32_t begin, uint32_t end) {
+      for(uint32_t t = begin; t < end; t++)
+      {
+        uint64_t seed = t + 1;
+        for(uint32_t i = 0; i < perThread; i++)
+        {
+          map.update(ids[NextRandom(seed) % ids.size()],
+                     [](uint32_t &v, bool isNew) { v = isNew ? 1 : v + 1; });
+        }
+      }
+    });
+
+    uint64_t total = 0;
+    size_t count = 0;
+    map.for_each([&](const ResourceId &id, uint32_t v) {
+      CHECK(ids.contains(id));
+      total += v;
+      count++;
+    });
+
+    CHECK(count == map.size());
+    CHECK(total == numThreads * perThread);
+  };
+};
+
+TEST_CASE("Benchmark ResourceId map contention", "[resourceidmap][.benchmark]")
+{
+  // simulate many threads recording commands, each looking up resource records and marking frame
+  // references for random resources
+  const uint32_t numIDs = 100000;
+  const uint32_t numThreads = 16;
+  const uint32_t opsPerThread = 500000;
+
+  rdcarray<ResourceId> ids;
+  ids.resize(numIDs);
+  for(ResourceId &id : ids)
+    id = ResourceIDGen::GetNewUniqueID();
+
+  auto runThreads = [&](std::function<void(ResourceId, bool)> op) {
+    PerformanceTimer timer;
+
+    rdcarray<Threading::ThreadHandle> threads;
+    for(uint32_t t = 0; t < numThreads; t++)
+    {
+      threads.push_back(Threading::CreateThread([&ids, &op, t, opsPerThread]() {
+        uint64_t seed = t + 1;
+        for(uint32_t i = 0; i < opsPerThread; i++)
+        {
+          uint64_t r = NextRandom(seed);
+          // one in eight operations is a write (marking a frame reference)
+          op(ids[r % ids.size()], (r & 0x70000) == 0);
+        }
+      }));
+    }
+
+    for(Threading::ThreadHandle t : threads)
+    {
+      Threading::JoinThread(t);
+      Threading::CloseThread(t);
+    }
+
+    return timer.GetMilliseconds();
+  };
+
+  // records in a single map behind one RWLock, frame references in a std::map behind one lock
+  double globalTime;
+  {
+    Threading::RWLock recordLock;
+    ResourceIdMap<uint64_t> records;
+    Threading::CriticalSection refLock;
+    std::map<ResourceId, uint32_t> refs;
+
+    for(ResourceId id : ids)
+      records[id] = 1;
+
+    globalTime = runThreads([&](ResourceId id, bool write) {
+      uint64_t rec;
+      {
+        SCOPED_READLOCK(recordLock);
+        rec = records.find(id)->second;
+      }
+
+      if(write)
+      {
+        SCOPED_LOCK(refLock);
+        refs[id] += uint32_t(rec);
+      }
+    });
+  }
+
+  double shardedTime;
+  {
+    ShardedResourceIdMap<uint64_t> records;
+    ShardedResourceIdMap<uint32_t> refs;
+
+    for(ResourceId id : ids)
+      records.insert(id, 1);
+
+    shardedTime = runThreads([&](ResourceId id, bool write) {
+      uint64_t rec = 0;
+      records.find(id, rec);
+
+      if(write)
+        refs.update(id, [rec](uint32_t &v, bool) { v += uint32_t(rec); });
+    });
+  }
+
+  RDCLOG("%u threads x %u ops: global locks %.2f ms, sharded %.2f ms", numThreads, opsPerThread,
+         globalTime, shardedTime);
+}
+
+#endif    // ENABLED(ENABLE_UNIT_TESTS)
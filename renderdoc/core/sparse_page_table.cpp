@@ -33,29 +33,185 @@ static uint32_t calcPageForTileCoord(const Coord &coord, const Coord &subresourc
   return (((coord.z * subresourcePageDim.y) + coord.y) * subresourcePageDim.x) + coord.x;
 }
 
-void PageRangeMapping::createPages(uint32_t numPages, uint32_t pageSize)
+void PageList::init(uint32_t numPages, uint32_t pageSize, const Page &first, bool reused)
 {
-  // don't do anything if the pages have already been populated
-  if(!pages.empty())
+  m_Runs.clear();
+  m_Count = numPages;
+  m_PageSize = pageSize;
+
+  if(numPages > 0)
+    m_Runs.insert({0, {first, reused}});
+}
+
+void PageList::splitAt(uint32_t idx)
+{
+  if(idx == 0 || idx >= m_Count)
+    return;
+
+  RunMap::iterator it = findRun(idx);
+  if(it->first == idx)
+    return;
+
+  Run split = {pageInRun(*it, idx), it->second.reused};
+  m_Runs.insert({idx, split});
+}
+
+bool PageList::tryMerge(Run &a, uint32_t aLen, const Run &b, uint32_t bLen) const
+{
+  if(a.first.memory != b.first.memory)
+    return false;
+
+  // a run of a single page could be either kind, so it takes on the kind of the run it's merging
+  // with. Two single pages are only merged if they are identical or consecutive.
+  bool reused;
+  if(aLen > 1)
+    reused = a.reused;
+  else if(bLen > 1)
+    reused = b.reused;
+  else
+    reused = (a.first.offset == b.first.offset);
+
+  if(bLen > 1 && b.reused != reused)
+    return false;
+
+  const uint64_t expectedOffset = a.first.offset + (reused ? 0 : uint64_t(m_PageSize) * aLen);
+  if(b.first.offset != expectedOffset)
+    return false;
+
+  a.reused = reused;
+  return true;
+}
+
+void PageList::set(uint32_t idx, uint32_t count, const Page &first, bool reused)
+{
+  if(idx >= m_Count)
+    return;
+
+  count = RDCMIN(count, m_Count - idx);
+  if(count == 0)
     return;
 
-  // otherwise allocate them. If we have a single page mapping we can just duplicate and it's easy
-  if(singlePageReused || singleMapping.memory == ResourceId())
+  // make sure runs start at both ends of the range, then remove any runs inside it apart from the
+  // first, which we'll overwrite
+  splitAt(idx);
+  splitAt(idx + count);
+
+  for(;;)
   {
-    pages.fill(numPages, singleMapping);
+    RunMap::iterator it = m_Runs.upper_bound(idx);
+    if(it == m_Runs.end() || it->first >= idx + count)
+      break;
+    m_Runs.erase(it);
   }
-  else
+
+  Run cur = {first, reused};
+  uint32_t len = count;
+
+  // merge the following run into this one if it continues on from it
+  RunMap::iterator next = m_Runs.upper_bound(idx);
+  if(next != m_Runs.end())
   {
-    // otherwise we need to allocate and increment
-    pages.reserve(numPages);
-    pages.clear();
-    for(uint32_t i = 0; i < numPages; i++)
+    const uint32_t nextLen = runEnd(next) - next->first;
+    if(tryMerge(cur, len, next->second, nextLen))
     {
-      pages.push_back(singleMapping);
-      singleMapping.offset += pageSize;
+      len += nextLen;
+      m_Runs.erase(next);
     }
   }
 
+  // similarly merge this run into the previous one, in which case it's removed entirely
+  if(idx > 0)
+  {
+    RunMap::iterator prev = findRun(idx - 1);
+    if(tryMerge(prev->second, idx - prev->first, cur, len))
+    {
+      m_Runs.erase(findRun(idx));
+      return;
+    }
+  }
+
+  findRun(idx)->second = cur;
+}
+
+rdcarray<Page> PageList::expand() const
+{
+  rdcarray<Page> ret;
+  ret.reserve(m_Count);
+  for(const_iterator it = begin(); it != end(); ++it)
+    ret.push_back(*it);
+  return ret;
+}
+
+void PageList::assign(const rdcarray<Page> &pages, uint32_t pageSize)
+{
+  m_Runs.clear();
+  m_Count = (uint32_t)pages.size();
+  m_PageSize = pageSize;
+
+  if(pages.empty())
+    return;
+
+  // build the runs in one pass, appending each page to the current run while it continues it
+  uint32_t start = 0, len = 1;
+  Run cur = {pages[0], true};
+  for(uint32_t i = 1; i < m_Count; i++)
+  {
+    const Run page = {pages[i], true};
+    if(tryMerge(cur, len, page, 1))
+    {
+      len++;
+    }
+    else
+    {
+      m_Runs.insert({start, cur});
+      start = i;
+      len = 1;
+      cur = page;
+    }
+  }
+
+  m_Runs.insert({start, cur});
+}
+
+rdcarray<PageRun> PageList::getRuns() const
+{
+  rdcarray<PageRun> ret;
+  ret.reserve(m_Runs.size());
+  for(RunMap::const_iterator it = m_Runs.begin(); it != m_Runs.end(); ++it)
+    ret.push_back({it->first, it->second.first, it->second.reused});
+  return ret;
+}
+
+void PageList::setRuns(uint32_t numPages, const rdcarray<PageRun> &runs)
+{
+  m_Runs.clear();
+  m_Count = numPages;
+
+  for(const PageRun &run : runs)
+  {
+    if(run.firstPage < numPages)
+      m_Runs.insert({run.firstPage, {run.page, run.reused}});
+  }
+
+  // there must always be a run starting at 0. This can only happen with corrupted data
+  if(m_Count > 0 && (m_Runs.empty() || m_Runs.begin()->first != 0))
+  {
+    RDCERR("Invalid page runs, first run doesn't start at page 0");
+    m_Runs.insert({0, {Page(), true}});
+  }
+}
+
+void PageRangeMapping::createPages(uint32_t numPages, uint32_t pageSize)
+{
+  // don't do anything if the pages have already been populated
+  if(!pages.empty())
+    return;
+
+  // otherwise start with a single run of pages. If we have a single page mapping every page uses
+  // it, otherwise the pages are consecutive
+  pages.init(numPages, pageSize, singleMapping,
+             singlePageReused || singleMapping.memory == ResourceId());
+
   // reset the single mapping to be super clear
   singleMapping = {};
   singlePageReused = false;
@@ -194,19 +350,14 @@ uint64_t PageTable::setMipTailRange(uint64_t resourceByteOffset, ResourceId memo
 
     mapping.createPages(numTailPages, m_PageByteSize);
 
-    // iterate through each referenced resource page
-    for(size_t
-            page = size_t(resourceByteOffset / m_PageByteSize),
-            endPage = size_t((resourceByteOffset + byteSize + m_PageByteSize - 1) / m_PageByteSize);
-        page < mapping.pages.size() && page < endPage; page++)
-    {
-      mapping.pages[page].memory = memory;
-      mapping.pages[page].offset = memoryByteOffset;
-
-      // if we're not mapping all resource pages to a single memory page, advance the offset
-      if(!useSinglePage && memory != ResourceId())
-        memoryByteOffset += m_PageByteSize;
-    }
+    // set the range of referenced resource pages
+    const uint64_t page = resourceByteOffset / m_PageByteSize;
+    const uint64_t endPage =
+        RDCMIN((uint64_t)mapping.pages.size(),
+               (resourceByteOffset + byteSize + m_PageByteSize - 1) / m_PageByteSize);
+    if(page < endPage)
+      mapping.pages.set(uint32_t(page), uint32_t(endPage - page), {memory, memoryByteOffset},
+                        useSinglePage || memory == ResourceId());
 
     // return how much of the mip tail we consumed, clamped to the size. Note resourceByteOffset has
     // been remapped to be mip-tail relative here
@@ -250,21 +401,23 @@ uint64_t PageTable::setMipTailRange(uint64_t resourceByteOffset, ResourceId memo
             uint32_t((mipTailSubresourceByteSize + m_PageByteSize - 1) / m_PageByteSize),
             m_PageByteSize);
 
-        // iterate through each referenced page in this subresource's mip tail. Note we only iterate
-        // over as many pages as this mapping has, even if the bound region is larger.
-        for(size_t page = size_t(resourceByteOffset / m_PageByteSize),
-                   endPage =
-                       size_t((resourceByteOffset + byteSize + m_PageByteSize - 1) / m_PageByteSize);
-            page < mapping.pages.size() && page < endPage; page++)
+        // set the referenced pages in this subresource's mip tail. Note we only set as many pages
+        // as this mapping has, even if the bound region is larger.
+        const uint64_t page = resourceByteOffset / m_PageByteSize;
+        const uint64_t endPage =
+            RDCMIN((uint64_t)mapping.pages.size(),
+                   (resourceByteOffset + byteSize + m_PageByteSize - 1) / m_PageByteSize);
+        if(page < endPage)
         {
-          mapping.pages[page].memory = memory;
-          mapping.pages[page].offset = memoryByteOffset;
+          const uint32_t numPages = uint32_t(endPage - page);
+          mapping.pages.set(uint32_t(page), numPages, {memory, memoryByteOffset},
+                            useSinglePage || memory == ResourceId());
 
           // if we're not mapping all resource pages to a single memory page, advance the offset
           if(!useSinglePage && memory != ResourceId())
-            memoryByteOffset += m_PageByteSize;
+            memoryByteOffset += numPages * m_PageByteSize;
 
-          consumedBytes += m_PageByteSize;
+          consumedBytes += numPages * m_PageByteSize;
         }
 
         memoryByteOffset += m_MipTail.byteStride - mipTailSubresourceByteSize;
@@ -369,18 +522,15 @@ void PageTable::setImageBoxRange(uint32_t subresource, const Sparse::Coord &coor
     {
       for(uint32_t y = curCoord.y; y < curCoord.y + curDim.y; y++)
       {
-        for(uint32_t x = curCoord.x; x < curCoord.x + curDim.x; x++)
-        {
-          // calculate the page
-          const uint32_t page = calcPageForTileCoord({x, y, z}, subresourcePageDim);
+        // each row of the box is a contiguous range of pages
+        const uint32_t page = calcPageForTileCoord({curCoord.x, y, z}, subresourcePageDim);
 
-          sub.pages[page].memory = memory;
-          sub.pages[page].offset = memoryByteOffset;
+        sub.pages.set(page, curDim.x, {memory, memoryByteOffset},
+                      useSinglePage || memory == ResourceId());
 
-          // if we're not mapping all resource pages to a single memory page, advance the offset
-          if(!useSinglePage && memory != ResourceId())
-            memoryByteOffset += m_PageByteSize;
-        }
+        // if we're not mapping all resource pages to a single memory page, advance the offset
+        if(!useSinglePage && memory != ResourceId())
+          memoryByteOffset += curDim.x * m_PageByteSize;
       }
     }
   }
@@ -494,19 +644,19 @@ rdcpair<uint32_t, Coord> PageTable::setImageWrappedRange(uint32_t subresource,
       uint32_t startingPage =
           (((curCoord.z * subresourcePageDim.y) + curCoord.y) * subresourcePageDim.x) + curCoord.x;
 
-      for(uint32_t page = startingPage;
-          page < startingPage + numPages && page < numSubresourcePages; page++)
+      const uint32_t endPage = RDCMIN(startingPage + numPages, numSubresourcePages);
+      if(startingPage < endPage)
       {
+        const uint32_t numSetPages = endPage - startingPage;
+
         if(updateMappings)
-        {
-          sub.pages[page].memory = memory;
-          sub.pages[page].offset = memoryByteOffset;
-        }
+          sub.pages.set(startingPage, numSetPages, {memory, memoryByteOffset},
+                        useSinglePage || memory == ResourceId());
 
         // if we're not mapping all resource pages to a single memory page, advance the offset
         if(!useSinglePage && memory != ResourceId())
-          memoryByteOffset += m_PageByteSize;
-        byteSize -= m_PageByteSize;
+          memoryByteOffset += numSetPages * m_PageByteSize;
+        byteSize -= numSetPages * m_PageByteSize;
       }
 
       // if we consumed all bytes and didn't get to the end of the subresource, calculate where we
@@ -663,7 +813,7 @@ void PageTable::copyImageBoxRange(uint32_t dstSubresource, const Coord &coordInT
             {coordInTiles.x + x, coordInTiles.y + y, coordInTiles.z + z}, dstSubSize);
         const uint32_t srcPage = calcPageForTileCoord(
             {srcCoordInTiles.x + x, srcCoordInTiles.y + y, srcCoordInTiles.z + z}, srcSubSize);
-        dstSub.pages[dstPage] = srcSub.getPage(srcPage, m_PageByteSize);
+        dstSub.pages.set(dstPage, srcSub.getPage(srcPage, m_PageByteSize));
       }
     }
   }
@@ -751,7 +901,7 @@ void PageTable::copyImageWrappedRange(uint32_t dstSubresource, const Coord &coor
     {
       // otherwise just copy the current page
       dstMapping->createPages(dstSubTiles, m_PageByteSize);
-      dstMapping->pages[dstPage] = srcMapping->getPage(srcPage, m_PageByteSize);
+      dstMapping->pages.set(dstPage, srcMapping->getPage(srcPage, m_PageByteSize));
 
       dstPage++;
       srcPage++;
@@ -848,25 +998,18 @@ uint64_t PageTable::GetSerialiseSize() const
   // size of the pair itself
   ret += sizeof(*this);
 
+  // each range mapping stores its single mapping, the number of pages, and the array of runs which
+  // is empty if there's a single mapping.
+  const uint64_t mappingSize =
+      sizeof(Sparse::Page) + sizeof(bool) + sizeof(uint32_t) + sizeof(uint64_t);
+
   // for each mip tail region
   for(uint32_t s = 0; s < getMipTail().mappings.size(); s++)
-  {
-    ret += sizeof(Sparse::PageRangeMapping);
-
-    // and the size of each page if the range mapping is expanded
-    if(!getMipTail().mappings[s].hasSingleMapping())
-      ret += sizeof(Sparse::Page) * getMipTail().mappings[s].pages.size();
-  }
+    ret += mappingSize + sizeof(Sparse::PageRun) * getMipTail().mappings[s].pages.runCount();
 
   // for each subresource the size of it
   for(uint32_t s = 0; s < getNumSubresources(); s++)
-  {
-    ret += sizeof(Sparse::PageRangeMapping);
-
-    // and the size of each page if the range mapping is expanded
-    if(!getSubresource(s).hasSingleMapping())
-      ret += sizeof(Sparse::Page) * getSubresource(s).pages.size();
-  }
+    ret += mappingSize + sizeof(Sparse::PageRun) * getSubresource(s).pages.runCount();
 
   return ret;
 }
@@ -887,11 +1030,32 @@ void DoSerialise(SerialiserType &ser, Sparse::Page &el)
   SERIALISE_MEMBER(offset);
 }
 
+template <typename SerialiserType>
+void DoSerialise(SerialiserType &ser, Sparse::PageRun &el)
+{
+  SERIALISE_MEMBER(firstPage);
+  SERIALISE_MEMBER(page);
+  SERIALISE_MEMBER(reused);
+}
+
 template <typename SerialiserType>
 void DoSerialise(SerialiserType &ser, Sparse::PageRangeMapping &el)
 {
   SERIALISE_MEMBER(singleMapping);
-  SERIALISE_MEMBER(pages);
+  SERIALISE_MEMBER(singlePageReused);
+
+  // the page size needed to interpret runs of consecutive pages is only known by the page table,
+  // which sets it after reading.
+  SERIALISE_ELEMENT_LOCAL(pageCount, el.pages.size());
+
+  rdcarray<Sparse::PageRun> runs;
+  if(ser.IsWriting())
+    runs = el.pages.getRuns();
+
+  SERIALISE_ELEMENT(runs);
+
+  if(ser.IsReading())
+    el.pages.setRuns(pageCount, runs);
 }
 
 template <typename SerialiserType>
@@ -914,16 +1078,112 @@ void DoSerialise(SerialiserType &ser, Sparse::PageTable &el)
   SERIALISE_MEMBER(m_PageTexelSize);
   SERIALISE_MEMBER(m_Subresources);
   SERIALISE_MEMBER(m_MipTail);
+
+  if(ser.IsReading())
+  {
+    for(Sparse::PageRangeMapping &mapping : el.m_Subresources)
+      mapping.pages.setPageSize(el.m_PageByteSize);
+    for(Sparse::PageRangeMapping &mapping : el.m_MipTail.mappings)
+      mapping.pages.setPageSize(el.m_PageByteSize);
+  }
+}
+
+// the older format of page tables, with every page stored when a mapping isn't a single mapping.
+// These are only ever read so the structs only exist here to convert to the current format.
+struct ExpandedPageRangeMapping
+{
+  Sparse::Page singleMapping;
+  rdcarray<Sparse::Page> pages;
+};
+
+struct ExpandedMipTail
+{
+  uint32_t firstMip;
+  uint64_t byteOffset;
+  uint64_t byteStride;
+  uint64_t totalPackedByteSize;
+  rdcarray<ExpandedPageRangeMapping> mappings;
+};
+
+// keep the same type names in structured data as when these were the current format
+template <>
+inline rdcliteral TypeName<ExpandedPageRangeMapping>()
+{
+  return STRING_LITERAL("Sparse::PageRangeMapping");
+}
+template <>
+inline rdcliteral TypeName<ExpandedMipTail>()
+{
+  return STRING_LITERAL("Sparse::MipTail");
+}
+
+template <typename SerialiserType>
+void DoSerialise(SerialiserType &ser, ExpandedPageRangeMapping &el)
+{
+  SERIALISE_MEMBER(singleMapping);
+  SERIALISE_MEMBER(pages);
+}
+
+template <typename SerialiserType>
+void DoSerialise(SerialiserType &ser, ExpandedMipTail &el)
+{
+  SERIALISE_MEMBER(firstMip);
+  SERIALISE_MEMBER(byteOffset);
+  SERIALISE_MEMBER(byteStride);
+  SERIALISE_MEMBER(totalPackedByteSize);
+  SERIALISE_MEMBER(mappings);
+}
+
+static void ConvertExpandedMapping(const ExpandedPageRangeMapping &expanded,
+                                   Sparse::PageRangeMapping &mapping, uint32_t pageSize)
+{
+  mapping.singleMapping = expanded.singleMapping;
+  mapping.pages.assign(expanded.pages, pageSize);
+}
+
+template <typename SerialiserType>
+void DoSerialise(SerialiserType &ser, Sparse::ExpandedPageTable &el)
+{
+  SERIALISE_MEMBER(m_TextureDim);
+  SERIALISE_MEMBER(m_MipCount);
+  SERIALISE_MEMBER(m_ArraySize);
+  SERIALISE_MEMBER(m_PageByteSize);
+  SERIALISE_MEMBER(m_PageTexelSize);
+
+  // this format is never written, so we only need to convert after reading
+  rdcarray<ExpandedPageRangeMapping> m_Subresources;
+  ExpandedMipTail m_MipTail = {};
+
+  SERIALISE_ELEMENT(m_Subresources);
+  SERIALISE_ELEMENT(m_MipTail);
+
+  if(ser.IsReading())
+  {
+    el.m_Subresources.resize(m_Subresources.size());
+    for(size_t i = 0; i < m_Subresources.size(); i++)
+      ConvertExpandedMapping(m_Subresources[i], el.m_Subresources[i], el.m_PageByteSize);
+
+    el.m_MipTail.firstMip = m_MipTail.firstMip;
+    el.m_MipTail.byteOffset = m_MipTail.byteOffset;
+    el.m_MipTail.byteStride = m_MipTail.byteStride;
+    el.m_MipTail.totalPackedByteSize = m_MipTail.totalPackedByteSize;
+    el.m_MipTail.mappings.resize(m_MipTail.mappings.size());
+    for(size_t i = 0; i < m_MipTail.mappings.size(); i++)
+      ConvertExpandedMapping(m_MipTail.mappings[i], el.m_MipTail.mappings[i], el.m_PageByteSize);
+  }
 }
 
 INSTANTIATE_SERIALISE_TYPE(Sparse::Coord);
 INSTANTIATE_SERIALISE_TYPE(Sparse::Page);
+INSTANTIATE_SERIALISE_TYPE(Sparse::PageRun);
 INSTANTIATE_SERIALISE_TYPE(Sparse::PageRangeMapping);
 INSTANTIATE_SERIALISE_TYPE(Sparse::MipTail);
 INSTANTIATE_SERIALISE_TYPE(Sparse::PageTable);
+INSTANTIATE_SERIALISE_TYPE(Sparse::ExpandedPageTable);
 
 #if ENABLED(ENABLE_UNIT_TESTS)
 
+#include "common/timing.h"
 #include "catch/catch.hpp"
 
 template <>
@@ -2725,4 +2985,313 @@ TEST_CASE("Test sparse page table mapping", "[sparse]")
   };
 };
 
+static uint32_t NextPageRandom(uint64_t &seed)
+{
+  seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+  return uint32_t(seed >> 33);
+}
+
+// reference implementation of PageList::set on a flat array of pages
+static void SetFlatPages(rdcarray<Sparse::Page> &pages, uint32_t idx, uint32_t count,
+                         Sparse::Page page, bool reused, uint32_t pageSize)
+{
+  for(uint32_t i = idx; i < idx + count && i < pages.size(); i++)
+  {
+    pages[i] = page;
+    if(!reused)
+      page.offset += pageSize;
+  }
+}
+
+TEST_CASE("Test sparse page list", "[sparse]")
+{
+  const uint32_t pageSize = 64;
+  const ResourceId mem0 = ResourceIDGen::GetNewUniqueID();
+  const ResourceId mem1 = ResourceIDGen::GetNewUniqueID();
+
+  Sparse::PageList list;
+
+  SECTION("basic operations")
+  {
+    CHECK(list.empty());
+    CHECK((list.begin() == list.end()));
+
+    list.init(16, pageSize, {mem0, 1024}, false);
+    REQUIRE(list.size() == 16);
+    CHECK(list.runCount() == 1);
+    CHECK(list[0] == Sparse::Page({mem0, 1024}));
+    CHECK(list[15] == Sparse::Page({mem0, 1024 + 15 * pageSize}));
+
+    // setting a page to the mapping it already has doesn't split anything
+    list.set(4, {mem0, 1024 + 4 * pageSize});
+    CHECK(list.runCount() == 1);
+
+    // setting a page in the middle splits the run in three
+    list.set(4, {mem1, 0});
+    CHECK(list.runCount() == 3);
+    CHECK(list[3] == Sparse::Page({mem0, 1024 + 3 * pageSize}));
+    CHECK(list[4] == Sparse::Page({mem1, 0}));
+    CHECK(list[5] == Sparse::Page({mem0, 1024 + 5 * pageSize}));
+
+    // consecutive pages merge into one run, as do repeated pages
+    list.set(5, {mem1, pageSize});
+    CHECK(list.runCount() == 3);
+    list.set(8, 4, {ResourceId(), 0}, true);
+    CHECK(list.runCount() == 5);
+    list.set(12, {ResourceId(), 0});
+    CHECK(list.runCount() == 5);
+    CHECK(list[12] == Sparse::Page({ResourceId(), 0}));
+    CHECK(list[13] == Sparse::Page({mem0, 1024 + 13 * pageSize}));
+
+    // restoring the original mappings merges everything back together
+    list.set(4, 9, {mem0, 1024 + 4 * pageSize}, false);
+    CHECK(list.runCount() == 1);
+
+    // setting past the end is clamped
+    list.set(14, 10, {mem1, 0}, true);
+    CHECK(list.size() == 16);
+    CHECK(list[15] == Sparse::Page({mem1, 0}));
+
+    uint32_t count = 0;
+    for(const Sparse::Page &page : list)
+      CHECK(page == list[count++]);
+    CHECK(count == 16);
+
+    list.clear();
+    CHECK(list.empty());
+    CHECK(list.runCount() == 0);
+  };
+
+  SECTION("random operations match a flat array")
+  {
+    const uint32_t numPages = 1000;
+
+    rdcarray<Sparse::Page> ref;
+    ref.resize(numPages);
+    SetFlatPages(ref, 0, numPages, {mem0, 0}, false, pageSize);
+    list.init(numPages, pageSize, {mem0, 0}, false);
+
+    uint64_t seed = 0x1234;
+    for(int i = 0; i < 5000; i++)
+    {
+      const uint32_t idx = NextPageRandom(seed) % numPages;
+      const uint32_t count = NextPageRandom(seed) % 20 + 1;
+      const uint32_t r = NextPageRandom(seed);
+      const bool reused = (r & 1) != 0;
+
+      Sparse::Page page;
+      switch((r >> 1) % 3)
+      {
+        // re-map to where the original mapping would have been, to test merging back together
+        case 0: page = {mem0, idx * pageSize}; break;
+        case 1: page = {mem1, (r % 64) * pageSize}; break;
+        default: page = {ResourceId(), 0}; break;
+      }
+
+      list.set(idx, count, page, reused);
+      SetFlatPages(ref, idx, count, page, reused, pageSize);
+
+      if((i % 100) == 0)
+      {
+        CHECK((list.expand() == ref));
+        CHECK(list[idx] == ref[idx]);
+      }
+    }
+
+    CHECK((list.expand() == ref));
+
+    // building from a flat array gives the same pages
+    Sparse::PageList rebuilt;
+    rebuilt.assign(ref, pageSize);
+    CHECK((rebuilt.expand() == ref));
+
+    // assigning without a page size only compresses identical pages but is still correct
+    rebuilt.assign(ref, 0);
+    CHECK((rebuilt.expand() == ref));
+
+    // converting through runs gives the same pages
+    rebuilt.setRuns(list.size(), list.getRuns());
+    rebuilt.setPageSize(pageSize);
+    CHECK(rebuilt.runCount() == list.runCount());
+    CHECK((rebuilt.expand() == ref));
+  };
+
+  SECTION("serialise round-trip")
+  {
+    Sparse::PageTable pageTable;
+    pageTable.Initialise(256 * pageSize, pageSize);
+    pageTable.setBufferRange(0, mem0, 0, 256 * pageSize, false);
+    pageTable.setBufferRange(10 * pageSize, mem1, 0, 20 * pageSize, false);
+    pageTable.setBufferRange(100 * pageSize, ResourceId(), 0, pageSize, true);
+
+    const Sparse::PageList &pages = pageTable.getMipTail().mappings[0].pages;
+    REQUIRE(pages.size() == 256);
+    CHECK(pages.runCount() == 5);
+
+    StreamWriter *buf = new StreamWriter(StreamWriter::DefaultScratchSize);
+    {
+      WriteSerialiser ser(buf, Ownership::Nothing);
+      SCOPED_SERIALISE_CHUNK(1);
+      SERIALISE_ELEMENT(pageTable);
+    }
+
+    Sparse::PageTable readTable;
+    {
+      ReadSerialiser ser(new StreamReader(buf->GetData(), buf->GetOffset()), Ownership::Stream);
+      ser.ReadChunk<uint32_t>();
+      ser.Serialise("pageTable"_lit, readTable);
+      ser.EndChunk();
+      CHECK_FALSE(ser.IsErrored());
+    }
+
+    delete buf;
+
+    const Sparse::PageList &readPages = readTable.getMipTail().mappings[0].pages;
+    CHECK(readPages.runCount() == 5);
+    CHECK((readPages.expand() == pages.expand()));
+    CHECK(readTable.GetSerialiseSize() == pageTable.GetSerialiseSize());
+  };
+
+  SECTION("read expanded format")
+  {
+    Sparse::PageTable pageTable;
+    pageTable.Initialise(256 * pageSize, pageSize);
+    pageTable.setBufferRange(0, mem0, 0, 256 * pageSize, false);
+    pageTable.setBufferRange(10 * pageSize, mem1, 0, 20 * pageSize, false);
+
+    const Sparse::PageList &pages = pageTable.getMipTail().mappings[0].pages;
+
+    // write the page table the way older captures did, with every page stored
+    StreamWriter *buf = new StreamWriter(StreamWriter::DefaultScratchSize);
+    {
+      WriteSerialiser ser(buf, Ownership::Nothing);
+      SCOPED_SERIALISE_CHUNK(1);
+
+      Sparse::Coord m_TextureDim = pageTable.getResourceSize();
+      uint32_t m_MipCount = pageTable.getMipCount();
+      uint32_t m_ArraySize = pageTable.getArraySize();
+      uint32_t m_PageByteSize = pageTable.getPageByteSize();
+      Sparse::Coord m_PageTexelSize = pageTable.getPageTexelSize();
+      rdcarray<ExpandedPageRangeMapping> m_Subresources;
+      ExpandedMipTail m_MipTail = {};
+      m_MipTail.totalPackedByteSize = pageTable.getMipTail().totalPackedByteSize;
+      m_MipTail.mappings.resize(1);
+      m_MipTail.mappings[0].pages = pages.expand();
+
+      SERIALISE_ELEMENT(m_TextureDim);
+      SERIALISE_ELEMENT(m_MipCount);
+      SERIALISE_ELEMENT(m_ArraySize);
+      SERIALISE_ELEMENT(m_PageByteSize);
+      SERIALISE_ELEMENT(m_PageTexelSize);
+      SERIALISE_ELEMENT(m_Subresources);
+      SERIALISE_ELEMENT(m_MipTail);
+    }
+
+    Sparse::ExpandedPageTable readTable;
+    {
+      ReadSerialiser ser(new StreamReader(buf->GetData(), buf->GetOffset()), Ownership::Stream);
+      ser.ReadChunk<uint32_t>();
+      SERIALISE_ELEMENT(readTable);
+      ser.EndChunk();
+      CHECK_FALSE(ser.IsErrored());
+    }
+
+    delete buf;
+
+    const Sparse::PageList &readPages = readTable.getMipTail().mappings[0].pages;
+    CHECK(readTable.getMipTail().totalPackedByteSize == 256 * pageSize);
+    CHECK(readPages.runCount() == pages.runCount());
+    CHECK((readPages.expand() == pages.expand()));
+  };
+};
+
+TEST_CASE("Benchmark sparse page table partial updates", "[sparse][.benchmark]")
+{
+  // a 64GB sparse buffer with 64KB pages - a million pages - which has a few large allocations
+  // bound and then is repeatedly partially re-bound, with the page table snapshotted regularly the
+  // way initial states capture it.
+  const uint32_t pageSize = 64 * 1024;
+  const uint32_t numPages = 1024 * 1024;
+  const uint32_t numUpdates = 20000;
+  const uint32_t snapshotInterval = 1000;
+
+  rdcarray<ResourceId> mems;
+  for(int i = 0; i < 16; i++)
+    mems.push_back(ResourceIDGen::GetNewUniqueID());
+
+  struct Update
+  {
+    uint32_t page, count;
+    ResourceId mem;
+    uint64_t offset;
+  };
+  rdcarray<Update> updates;
+  uint64_t seed = 0x5678;
+  for(uint32_t i = 0; i < numUpdates; i++)
+  {
+    Update u;
+    u.page = NextPageRandom(seed) % numPages;
+    u.count = NextPageRandom(seed) % 256 + 1;
+    u.mem = mems[NextPageRandom(seed) % mems.size()];
+    u.offset = uint64_t(NextPageRandom(seed) % 1024) * pageSize;
+    updates.push_back(u);
+  }
+
+  uint64_t check = 0;
+
+  PerformanceTimer timer;
+
+  // the previous representation, a flat array of pages
+  {
+    rdcarray<Sparse::Page> pages;
+    pages.resize(numPages);
+    SetFlatPages(pages, 0, numPages, {mems[0], 0}, false, pageSize);
+
+    rdcarray<Sparse::Page> snapshot;
+    for(uint32_t i = 0; i < numUpdates; i++)
+    {
+      SetFlatPages(pages, updates[i].page, updates[i].count, {updates[i].mem, updates[i].offset},
+                   false, pageSize);
+      if((i % snapshotInterval) == 0)
+        snapshot = pages;
+    }
+
+    for(uint32_t i = 0; i < numPages; i += 4097)
+      check += pages[i].offset;
+  }
+  double flatTime = timer.GetMilliseconds();
+
+  timer.Restart();
+  size_t runCount = 0;
+  uint64_t runSize = 0;
+  {
+    Sparse::PageTable pageTable;
+    pageTable.Initialise(uint64_t(numPages) * pageSize, pageSize);
+    pageTable.setBufferRange(0, mems[0], 0, uint64_t(numPages) * pageSize, false);
+
+    Sparse::PageTable snapshot;
+    for(uint32_t i = 0; i < numUpdates; i++)
+    {
+      pageTable.setBufferRange(uint64_t(updates[i].page) * pageSize, updates[i].mem,
+                               updates[i].offset, uint64_t(updates[i].count) * pageSize, false);
+      if((i % snapshotInterval) == 0)
+        snapshot = pageTable;
+    }
+
+    const Sparse::PageList &pages = pageTable.getMipTail().mappings[0].pages;
+    for(uint32_t i = 0; i < numPages; i += 4097)
+      check -= pages[i].offset;
+    runCount = pages.runCount();
+    runSize = pageTable.GetSerialiseSize();
+  }
+  double runTime = timer.GetMilliseconds();
+
+  CHECK(check == 0);
+
+  RDCLOG("%u pages, %u updates: flat array %.2f ms (%llu bytes), "
+         "runs %.2f ms (%u runs, %llu bytes)",
+         numPages, numUpdates, flatTime, uint64_t(numPages) * sizeof(Sparse::Page), runTime,
+         (uint32_t)runCount, runSize);
+}
+
 #endif    // ENABLED(ENABLE_UNIT_TESTS)
@@ -29,15 +29,19 @@
 #include "api/replay/rdcpair.h"
 #include "api/replay/resourceid.h"
 #include "api/replay/stringise.h"
+#include "core/intervals.h"
 
 namespace Sparse
 {
 class PageTable;
+struct ExpandedPageTable;
 };    // namespace Sparse
 
-// we pre-declare this function so we can make it a friend inside the PageTable implementation
+// we pre-declare these functions so we can make them friends inside the PageTable implementation
 template <class SerialiserType>
 void DoSerialise(SerialiserType &ser, Sparse::PageTable &el);
+template <class SerialiserType>
+void DoSerialise(SerialiserType &ser, Sparse::ExpandedPageTable &el);
 
 namespace Sparse
 {
@@ -55,6 +59,155 @@ struct Page
   uint64_t offset;
 
   bool operator==(const Page &o) const { return memory == o.memory && offset == o.offset; }
+  bool operator<(const Page &o) const
+  {
+    if(memory != o.memory)
+      return memory < o.memory;
+    return offset < o.offset;
+  }
+};
+
+// a run of pages in a PageList, as it is serialised
+struct PageRun
+{
+  // the index of the first page in the run. The run continues until the next run's first page
+  uint32_t firstPage;
+  // the mapping of the first page in the run
+  Page page;
+  // if true every page in the run maps to the same memory page, otherwise each page maps to the
+  // next page of memory.
+  bool reused;
+};
+
+// a list of per-page mappings, stored as runs of pages that either all map the same page of memory
+// or map consecutive pages of memory. Even heavily partially-mapped resources are usually made of
+// far fewer runs than pages, so this stays small for huge resources. Looking up or setting pages is
+// O(log n) in the number of runs, and adjacent runs are merged whenever they line up.
+//
+// Pages are returned by value since they are generated from the runs, so unlike an array the pages
+// can only be modified via set().
+class PageList
+{
+  struct Run
+  {
+    // the mapping of the first page in the run
+    Page first;
+    // if true every page in the run maps to the same memory page, otherwise each page maps to the
+    // next page of memory. Meaningless for runs of a single page.
+    bool reused;
+  };
+
+  typedef BTreeMap<uint32_t, Run> RunMap;
+
+public:
+  class const_iterator
+  {
+    friend class PageList;
+
+    const PageList *list = NULL;
+    RunMap::const_iterator run;
+    uint32_t idx = 0, runEnd = 0;
+
+    const_iterator(const PageList *l, RunMap::const_iterator r, uint32_t i)
+        : list(l), run(r), idx(i)
+    {
+      if(idx < list->m_Count)
+        runEnd = list->runEnd(run);
+    }
+
+  public:
+    const_iterator() = default;
+
+    Page operator*() const { return list->pageInRun(*run, idx); }
+    const_iterator &operator++()
+    {
+      if(++idx == runEnd && idx < list->m_Count)
+      {
+        ++run;
+        runEnd = list->runEnd(run);
+      }
+      return *this;
+    }
+    bool operator==(const const_iterator &o) const { return idx == o.idx; }
+    bool operator!=(const const_iterator &o) const { return idx != o.idx; }
+  };
+
+  const_iterator begin() const { return const_iterator(this, m_Runs.begin(), 0); }
+  const_iterator end() const { return const_iterator(this, m_Runs.end(), m_Count); }
+  uint32_t size() const { return m_Count; }
+  bool empty() const { return m_Count == 0; }
+  size_t runCount() const { return m_Runs.size(); }
+  void clear()
+  {
+    m_Runs.clear();
+    m_Count = 0;
+  }
+
+  // sets up numPages pages, the first mapping to first and the rest either re-using it or mapping
+  // consecutive pages of memory of pageSize bytes.
+  void init(uint32_t numPages, uint32_t pageSize, const Page &first, bool reused);
+
+  Page operator[](uint32_t idx) const
+  {
+    RunMap::const_iterator it = findRun(idx);
+    return pageInRun(*it, idx);
+  }
+
+  void set(uint32_t idx, const Page &page) { set(idx, 1, page, true); }
+  // sets count pages starting at idx, the same way as init()
+  void set(uint32_t idx, uint32_t count, const Page &first, bool reused);
+
+  // convert to and from a flat array of pages. The page size is needed to compress consecutive
+  // pages into runs, if it's 0 only identical pages are compressed.
+  rdcarray<Page> expand() const;
+  void assign(const rdcarray<Page> &pages, uint32_t pageSize);
+
+  // convert to and from the list of runs. The page size of the runs isn't stored so it must be set
+  // afterwards with setPageSize before the pages are accessed.
+  rdcarray<PageRun> getRuns() const;
+  void setRuns(uint32_t numPages, const rdcarray<PageRun> &runs);
+  void setPageSize(uint32_t pageSize) { m_PageSize = pageSize; }
+
+private:
+  // find the last run starting at or before idx. There's always a run starting at 0
+  RunMap::const_iterator findRun(uint32_t idx) const
+  {
+    RunMap::const_iterator it = m_Runs.upper_bound(idx);
+    --it;
+    return it;
+  }
+  RunMap::iterator findRun(uint32_t idx)
+  {
+    RunMap::iterator it = m_Runs.upper_bound(idx);
+    --it;
+    return it;
+  }
+
+  uint32_t runEnd(RunMap::const_iterator it) const
+  {
+    ++it;
+    return it == m_Runs.end() ? m_Count : it->first;
+  }
+  uint32_t runEnd(RunMap::iterator it)
+  {
+    ++it;
+    return it == m_Runs.end() ? m_Count : it->first;
+  }
+
+  Page pageInRun(const rdcpair<uint32_t, Run> &run, uint32_t idx) const
+  {
+    Page ret = run.second.first;
+    if(!run.second.reused)
+      ret.offset += uint64_t(m_PageSize) * (idx - run.first);
+    return ret;
+  }
+
+  void splitAt(uint32_t idx);
+  bool tryMerge(Run &a, uint32_t aLen, const Run &b, uint32_t bLen) const;
+
+  RunMap m_Runs;
+  uint32_t m_Count = 0;
+  uint32_t m_PageSize = 0;
 };
 
 struct PageRangeMapping
@@ -68,7 +221,7 @@ struct PageRangeMapping
   bool singlePageReused = false;
 
   // the memory mappings per-page if there are different mappings per-page
-  rdcarray<Page> pages;
+  PageList pages;
 
   Page getPage(uint32_t idx, uint32_t pageSize) const
   {
@@ -265,20 +418,36 @@ private:
   // the page tables for each subresource, if this is an image. Note for buffers everything goes in
   // the "mipTail".
   // For simplicity and robustness of access every subresource has an entry here, even those
-  // corresponding to mips that are in mip tails - the overhead is nominal with each entry being
-  // 5*ptrsize = 40 bytes.
+  // corresponding to mips that are in mip tails - the overhead is nominal since an entry with a
+  // single mapping doesn't allocate any pages.
   rdcarray<PageRangeMapping> m_Subresources;
 
   MipTail m_MipTail;
 
   template <typename SerialiserType>
   friend void ::DoSerialise(SerialiserType &ser, PageTable &el);
+  template <typename SerialiserType>
+  friend void ::DoSerialise(SerialiserType &ser, Sparse::ExpandedPageTable &el);
+};
+
+// page tables are serialised with their page lists as runs. Older captures stored them expanded
+// with an entry for every page - serialising this type instead reads that format.
+struct ExpandedPageTable : public PageTable
+{
 };
 
 };    // namespace Sparse
 
 DECLARE_REFLECTION_STRUCT(Sparse::Coord);
 DECLARE_REFLECTION_STRUCT(Sparse::Page);
+DECLARE_REFLECTION_STRUCT(Sparse::PageRun);
 DECLARE_REFLECTION_STRUCT(Sparse::PageRangeMapping);
 DECLARE_REFLECTION_STRUCT(Sparse::MipTail);
 DECLARE_REFLECTION_STRUCT(Sparse::PageTable);
+
+// the expanded format is still a PageTable in structured data
+template <>
+inline rdcliteral TypeName<Sparse::ExpandedPageTable>()
+{
+  return STRING_LITERAL("Sparse::PageTable");
+}
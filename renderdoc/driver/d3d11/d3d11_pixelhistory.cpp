@@ -2525,3 +2525,12 @@ rdcarray<PixelModification> D3D11Replay::PixelHistory(rdcarray<EventUsage> event
 
   return history;
 }
+
+rdcarray<PixelHistoryResult> D3D11Replay::PixelHistoryRegion(rdcarray<EventUsage> events,
+                                                           ResourceId target, uint32_t x,
+                                                           uint32_t y, uint32_t width,
+                                                           uint32_t height, const Subresource &sub,
+                                                           CompType typeCast)
+{
+  return PixelHistoryEachPixel(this, events, target, x, y, width, height, sub, typeCast);
+}
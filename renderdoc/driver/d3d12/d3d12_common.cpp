@@ -235,6 +235,10 @@ bool D3D12InitParams::IsSupportedVersion(uint64_t ver)
   if(ver == 0xC)
     return true;
 
+  // 0xD -> 0xE - Sparse page tables are serialised as runs of pages rather than per-page
+  if(ver == 0xD)
+    return true;
+
   return false;
 }
 
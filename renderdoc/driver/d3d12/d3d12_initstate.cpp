@@ -629,7 +629,7 @@ bool D3D12ResourceManager::Serialise_InitialState(SerialiserType &ser, ResourceI
 
     SparseBinds *sparseBinds = NULL;
 
-    if(ser.VersionAtLeast(0xB))
+    if(ser.VersionAtLeast(0xE))
     {
       Sparse::PageTable *sparseTable = initial ? initial->sparseTable : NULL;
 
@@ -638,6 +638,16 @@ bool D3D12ResourceManager::Serialise_InitialState(SerialiserType &ser, ResourceI
       if(sparseTable)
         sparseBinds = new SparseBinds(*sparseTable);
     }
+    else if(ser.VersionAtLeast(0xB))
+    {
+      // older captures stored the page table with every page expanded. This is only ever read
+      Sparse::ExpandedPageTable *sparseTable = NULL;
+
+      SERIALISE_ELEMENT_OPT(sparseTable);
+
+      if(sparseTable)
+        sparseBinds = new SparseBinds(*sparseTable);
+    }
 
     if(ser.IsWriting())
     {
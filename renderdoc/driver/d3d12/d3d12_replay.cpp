@@ -4189,6 +4189,15 @@ rdcarray<PixelModification> D3D12Replay::PixelHistory(rdcarray<EventUsage> event
   return {};
 }
 
+rdcarray<PixelHistoryResult> D3D12Replay::PixelHistoryRegion(rdcarray<EventUsage> events,
+                                                           ResourceId target, uint32_t x,
+                                                           uint32_t y, uint32_t width,
+                                                           uint32_t height, const Subresource &sub,
+                                                           CompType typeCast)
+{
+  return {};
+}
+
 ResourceId D3D12Replay::CreateProxyTexture(const TextureDescription &templateTex)
 {
   return ResourceId();
@@ -2308,7 +2308,7 @@ bool WrappedOpenGL::EndFrameCapture(DeviceOwnedWindow devWnd)
       props.version = m_SectionVersion;
       props.type = SectionType::FrameCapture;
 
-      captureWriter = rdc->WriteSection(props);
+      captureWriter = RenderDoc::Inst().WriteCaptureSection(rdc, props);
     }
     else
     {
@@ -2318,7 +2318,7 @@ bool WrappedOpenGL::EndFrameCapture(DeviceOwnedWindow devWnd)
     uint64_t captureSectionSize = 0;
 
     {
-      WriteSerialiser ser(captureWriter, Ownership::Stream);
+      WriteSerialiser ser(captureWriter, Ownership::Nothing);
 
       ser.SetChunkMetadataRecording(m_ScratchSerialiser.GetChunkMetadataRecording());
 
@@ -2409,7 +2409,8 @@ bool WrappedOpenGL::EndFrameCapture(DeviceOwnedWindow devWnd)
     RDCLOG("Captured GL frame with %f MB capture section in %f seconds",
            double(captureSectionSize) / (1024.0 * 1024.0), m_CaptureTimer.GetMilliseconds() / 1000.0);
 
-    RenderDoc::Inst().FinishCaptureWriting(rdc, m_CapturedFrames.back().frameNumber);
+    RenderDoc::Inst().FinishCaptureWriting(rdc, m_CapturedFrames.back().frameNumber,
+                                           captureWriter);
 
     m_State = CaptureState::BackgroundCapturing;
 
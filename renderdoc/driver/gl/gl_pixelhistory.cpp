@@ -241,3 +241,11 @@ rdcarray<PixelModification> GLReplay::PixelHistory(rdcarray<EventUsage> events,
   PixelHistoryDestroyResources(m_pDriver, resources);
   return history;
 }
+
+rdcarray<PixelHistoryResult> GLReplay::PixelHistoryRegion(rdcarray<EventUsage> events,
+                                                        ResourceId target, uint32_t x, uint32_t y,
+                                                        uint32_t width, uint32_t height,
+                                                        const Subresource &sub, CompType typeCast)
+{
+  return PixelHistoryEachPixel(this, events, target, x, y, width, height, sub, typeCast);
+}
@@ -23,6 +23,7 @@
  ******************************************************************************/
 
 #include "vk_common.h"
+#include <algorithm>
 #include "vk_core.h"
 #include "vk_manager.h"
 #include "vk_resources.h"
@@ -355,6 +356,18 @@ bool VkInitParams::IsSupportedVersion(uint64_t ver)
   if(ver == CurrentVersion)
     return true;
 
+  // 0x16 -> 0x17 - device memory initial contents only store their non-zero ranges
+  if(ver == 0x16)
+    return true;
+
+  // 0x15 -> 0x16 - identical initial contents payloads are stored once and referenced by ID
+  if(ver == 0x15)
+    return true;
+
+  // 0x14 -> 0x15 - sparse page tables are serialised as runs of pages rather than per-page
+  if(ver == 0x14)
+    return true;
+
   // 0x13 -> 0x14 - added missing VkCommandBufferInheritanceRenderingInfo::flags
   if(ver == 0x13)
     return true;
@@ -875,6 +888,98 @@ BASIC_TYPE_SERIALISE_STRINGIFY(VkPackedVersion, (uint32_t &)el, SDBasic::Unsigne
 
 INSTANTIATE_SERIALISE_TYPE(VkPackedVersion);
 
+template <typename SerialiserType>
+void DoSerialise(SerialiserType &ser, NonZeroMemoryRange &el)
+{
+  SERIALISE_MEMBER(offset);
+  SERIALISE_MEMBER(size);
+}
+
+INSTANTIATE_SERIALISE_TYPE(NonZeroMemoryRange);
+
+void FindNonZeroMemoryRanges(const byte *data, VkDeviceSize size,
+                             rdcarray<NonZeroMemoryRange> &ranges)
+{
+  // the granularity that zeros are detected at
+  const VkDeviceSize blockSize = 256;
+  // zero runs shorter than this are kept in the data, as each range has its own overhead
+  const VkDeviceSize minZeroRun = 4096;
+
+  ranges.clear();
+
+  NonZeroMemoryRange cur = {};
+  bool inRange = false;
+
+  for(VkDeviceSize offs = 0; offs < size; offs += blockSize)
+  {
+    VkDeviceSize len = RDCMIN(blockSize, size - offs);
+
+    if(IsZeroBuffer(data + offs, (size_t)len))
+      continue;
+
+    if(inRange && offs - (cur.offset + cur.size) < minZeroRun)
+    {
+      cur.size = offs + len - cur.offset;
+      continue;
+    }
+
+    if(inRange)
+      ranges.push_back(cur);
+
+    cur.offset = offs;
+    cur.size = len;
+    inRange = true;
+  }
+
+  if(inRange)
+    ranges.push_back(cur);
+}
+
+void GetPackedMemoryResetRegions(const rdcarray<VkBufferCopy> &packed, VkDeviceSize start,
+                                 VkDeviceSize finish, rdcarray<VkBufferCopy> &copies,
+                                 rdcarray<rdcpair<VkDeviceSize, VkDeviceSize>> &fills)
+{
+  // the zero bytes after the packed data, used for the unaligned ends of zero runs that can't be
+  // filled
+  const VkDeviceSize zeroOffset = packed.empty() ? 0 : packed.back().srcOffset + packed.back().size;
+
+  auto zeroRange = [&](VkDeviceSize a, VkDeviceSize b) {
+    VkDeviceSize alignedStart = RDCMIN(AlignUp4(a), b);
+    VkDeviceSize alignedEnd = RDCMAX(b & ~VkDeviceSize(3), alignedStart);
+
+    if(alignedStart > a)
+      copies.push_back({zeroOffset, a, alignedStart - a});
+    if(alignedEnd > alignedStart)
+      fills.push_back({alignedStart, alignedEnd - alignedStart});
+    if(b > alignedEnd)
+      copies.push_back({zeroOffset, alignedEnd, b - alignedEnd});
+  };
+
+  // find the first packed range that ends after the start
+  size_t i = std::lower_bound(packed.begin(), packed.end(), start,
+                              [](const VkBufferCopy &c, VkDeviceSize offs) {
+                                return c.dstOffset + c.size <= offs;
+                              }) -
+             packed.begin();
+
+  VkDeviceSize pos = start;
+
+  for(; i < packed.size() && packed[i].dstOffset < finish; i++)
+  {
+    VkDeviceSize s = RDCMAX(packed[i].dstOffset, start);
+    VkDeviceSize e = RDCMIN(packed[i].dstOffset + packed[i].size, finish);
+
+    if(s > pos)
+      zeroRange(pos, s);
+
+    copies.push_back({packed[i].srcOffset + (s - packed[i].dstOffset), s, e - s});
+    pos = e;
+  }
+
+  if(finish > pos)
+    zeroRange(pos, finish);
+}
+
 template <typename SerialiserType>
 void DoSerialise(SerialiserType &ser, VkInitParams &el)
 {
@@ -1461,4 +1566,126 @@ TEST_CASE("Validate CombineDepthStencilLayouts works", "[vulkan]")
   };
 }
 
+TEST_CASE("Check finding non-zero memory ranges", "[vulkan]")
+{
+  bytebuf data;
+  data.resize(64 * 1024);
+
+  rdcarray<NonZeroMemoryRange> ranges;
+
+  SECTION("All zero")
+  {
+    CHECK(IsZeroBuffer(data.data(), data.size()));
+
+    FindNonZeroMemoryRanges(data.data(), data.size(), ranges);
+    CHECK(ranges.empty());
+  };
+
+  SECTION("Every byte position is detected")
+  {
+    for(size_t i = 0; i < 200; i++)
+    {
+      data[i] = 1;
+      CHECK_FALSE(IsZeroBuffer(data.data(), 200));
+      CHECK(IsZeroBuffer(data.data() + i + 1, 200 - i - 1));
+      data[i] = 0;
+    }
+  };
+
+  SECTION("Separate and merged ranges")
+  {
+    // two blocks close enough together to be merged
+    data[300] = 1;
+    data[1000] = 1;
+    // a block far from the others
+    data[20000] = 1;
+    // the last byte, in a block that's cut short
+    data.resize(data.size() + 10);
+    data.back() = 1;
+
+    FindNonZeroMemoryRanges(data.data(), data.size(), ranges);
+
+    REQUIRE(ranges.size() == 3);
+    CHECK(ranges[0].offset == 256);
+    CHECK(ranges[0].size == 1024 - 256);
+    CHECK(ranges[1].offset == 19968);
+    CHECK(ranges[1].size == 256);
+    CHECK(ranges[2].offset == 64 * 1024);
+    CHECK(ranges[2].size == 10);
+  };
+}
+
+TEST_CASE("Check resetting memory from packed ranges", "[vulkan]")
+{
+  // two ranges packed together, at [100, 200) and [300, 400) in the memory
+  rdcarray<VkBufferCopy> packed = {{0, 100, 100}, {100, 300, 100}};
+
+  rdcarray<VkBufferCopy> copies;
+  rdcarray<rdcpair<VkDeviceSize, VkDeviceSize>> fills;
+
+  // apply the copies and fills to a CPU buffer and compare against the unpacked data
+  auto check = [&](VkDeviceSize start, VkDeviceSize finish) {
+    bytebuf src, expected, actual;
+    src.resize(200 + 16);
+    for(size_t i = 0; i < 200; i++)
+      src[i] = byte(i + 1);
+
+    expected.resize(500);
+    for(size_t i = 0; i < 200; i++)
+      expected[(i < 100 ? 100 : 200) + i] = src[i];
+
+    actual.resize(500);
+    memset(actual.data(), 0xcc, actual.size());
+
+    copies.clear();
+    fills.clear();
+    GetPackedMemoryResetRegions(packed, start, finish, copies, fills);
+
+    for(const rdcpair<VkDeviceSize, VkDeviceSize> &f : fills)
+    {
+      CHECK(f.first % 4 == 0);
+      CHECK(f.second % 4 == 0);
+      memset(actual.data() + f.first, 0, (size_t)f.second);
+    }
+
+    for(const VkBufferCopy &c : copies)
+    {
+      CHECK(c.srcOffset + c.size <= src.size());
+      memcpy(actual.data() + c.dstOffset, src.data() + c.srcOffset, (size_t)c.size);
+    }
+
+    for(VkDeviceSize i = 0; i < 500; i++)
+    {
+      bool inRange = (i >= start && i < finish);
+      if(inRange)
+        CHECK(actual[(size_t)i] == expected[(size_t)i]);
+      else
+        CHECK(actual[(size_t)i] == 0xcc);
+    }
+  };
+
+  SECTION("Whole memory")
+  {
+    check(0, 500);
+    CHECK(copies.size() == 2);
+    CHECK(fills.size() == 3);
+  };
+
+  SECTION("Inside one range")
+  {
+    check(120, 150);
+    CHECK(copies.size() == 1);
+    CHECK(fills.empty());
+  };
+
+  SECTION("Unaligned zero runs")
+  {
+    check(1, 103);
+    check(199, 301);
+    check(201, 299);
+    check(397, 499);
+    check(401, 402);
+  };
+}
+
 #endif
@@ -441,6 +441,29 @@ struct MemoryAllocation
   bool buffer = false;
 };
 
+// a range of a device memory initial contents payload that contains non-zero data. Anything outside
+// of these ranges is zero, and is neither stored in the capture nor uploaded on replay.
+struct NonZeroMemoryRange
+{
+  VkDeviceSize offset;
+  VkDeviceSize size;
+};
+
+DECLARE_REFLECTION_STRUCT(NonZeroMemoryRange);
+
+// finds the non-zero ranges of data, in increasing order. Zero runs too short to be worth skipping
+// are included in the neighbouring ranges. Ranges start and end on 256-byte boundaries, except at
+// the end of the data.
+void FindNonZeroMemoryRanges(const byte *data, VkDeviceSize size,
+                             rdcarray<NonZeroMemoryRange> &ranges);
+
+// given the copies from a packed buffer of non-zero ranges (followed by at least 4 zero bytes) to
+// the memory they came from, in increasing order, returns the copies and the (offset, size) fills
+// of zero that will reset [start, finish) of the memory. Fills are always 4-byte aligned.
+void GetPackedMemoryResetRegions(const rdcarray<VkBufferCopy> &packed, VkDeviceSize start,
+                                 VkDeviceSize finish, rdcarray<VkBufferCopy> &copies,
+                                 rdcarray<rdcpair<VkDeviceSize, VkDeviceSize>> &fills);
+
 #define IMPLEMENT_FUNCTION_SERIALISED(ret, func, ...) \
   ret func(__VA_ARGS__);                              \
   template <typename SerialiserType>                  \
@@ -527,6 +550,9 @@ struct BindingStorage
     memset(elems.data(), 0, elems.byteSize());
   }
 
+  // the storage behind all of binds, e.g. to compare the whole set's contents at once
+  const rdcarray<DescriptorSetSlot> &elements() const { return elems; }
+
   void copy(DescriptorSetSlot *&slots, uint32_t &slotCount, byte *&inlineData, size_t &inlineSize)
   {
     slotCount = elems.count();
@@ -39,6 +39,12 @@
 
 RDOC_EXTERN_CONFIG(bool, Vulkan_Debug_VerboseCommandRecording);
 
+RDOC_CONFIG(uint32_t, Vulkan_ReplayCheckpointInterval, 2000,
+            "The minimum number of events between replay checkpoints, which let a replay to a "
+            "later event skip the queue submissions before it. 0 disables checkpoints.");
+RDOC_CONFIG(uint32_t, Vulkan_ReplayCheckpointBudgetMB, 1024,
+            "The maximum amount of GPU memory in MB used by replay checkpoints.");
+
 uint64_t VkInitParams::GetSerialiseSize()
 {
   // misc bytes and fixed integer members
@@ -2233,7 +2239,7 @@ bool WrappedVulkan::EndFrameCapture(DeviceOwnedWindow devWnd)
     props.version = m_SectionVersion;
     props.type = SectionType::FrameCapture;
 
-    captureWriter = rdc->WriteSection(props);
+    captureWriter = RenderDoc::Inst().WriteCaptureSection(rdc, props);
   }
   else
   {
@@ -2243,7 +2249,7 @@ bool WrappedVulkan::EndFrameCapture(DeviceOwnedWindow devWnd)
   uint64_t captureSectionSize = 0;
 
   {
-    WriteSerialiser ser(captureWriter, Ownership::Stream);
+    WriteSerialiser ser(captureWriter, Ownership::Nothing);
 
     ser.SetChunkMetadataRecording(GetThreadSerialiser().GetChunkMetadataRecording());
 
@@ -2290,10 +2296,11 @@ bool WrappedVulkan::EndFrameCapture(DeviceOwnedWindow devWnd)
       RDCDEBUG("Flushing %u command buffer records to file serialiser",
                (uint32_t)m_CmdBufferRecords.size());
 
-      std::map<int64_t, Chunk *> recordlist;
+      rdcarray<ResourceRecord::ChunkRun> chunkRuns;
 
       // ensure all command buffer records within the frame evne if recorded before, but
-      // otherwise order must be preserved (vs. queue submits and desc set updates)
+      // otherwise order must be preserved (vs. queue submits and desc set updates). Each record's
+      // chunks are already sorted by ID, so they're merged in order as they're written
       for(size_t i = 0; i < m_CmdBufferRecords.size(); i++)
       {
         if(Vulkan_Debug_VerboseCommandRecording())
@@ -2307,28 +2314,20 @@ bool WrappedVulkan::EndFrameCapture(DeviceOwnedWindow devWnd)
                    ToStr(m_CmdBufferRecords[i]->GetResourceID()).c_str());
         }
 
-        size_t prevSize = recordlist.size();
+        size_t prevSize = chunkRuns.size();
         (void)prevSize;
 
-        m_CmdBufferRecords[i]->Insert(recordlist);
+        m_CmdBufferRecords[i]->InsertRuns(chunkRuns);
 
-        RDCDEBUG("Added %zu chunks to file serialiser", recordlist.size() - prevSize);
+        RDCDEBUG("Added %zu chunk lists to file serialiser", chunkRuns.size() - prevSize);
       }
 
-      m_FrameCaptureRecord->Insert(recordlist);
-
-      RDCDEBUG("Flushing %u chunks to file serialiser from context record",
-               (uint32_t)recordlist.size());
+      m_FrameCaptureRecord->InsertRuns(chunkRuns);
 
-      float num = float(recordlist.size());
-      float idx = 0.0f;
+      RDCDEBUG("Flushing %u chunk lists to file serialiser from context record",
+               (uint32_t)chunkRuns.size());
 
-      for(auto it = recordlist.begin(); it != recordlist.end(); ++it)
-      {
-        RenderDoc::Inst().SetProgress(CaptureProgress::SerialiseFrameContents, idx / num);
-        idx += 1.0f;
-        it->second->Write(ser);
-      }
+      ResourceRecord::WriteChunkRuns(ser, chunkRuns, CaptureProgress::SerialiseFrameContents);
 
       RDCDEBUG("Done");
     }
@@ -2339,7 +2338,8 @@ bool WrappedVulkan::EndFrameCapture(DeviceOwnedWindow devWnd)
   RDCLOG("Captured Vulkan frame with %f MB capture section in %f seconds",
          double(captureSectionSize) / (1024.0 * 1024.0), m_CaptureTimer.GetMilliseconds() / 1000.0);
 
-  RenderDoc::Inst().FinishCaptureWriting(rdc, m_CapturedFrames.back().frameNumber);
+  RenderDoc::Inst().FinishCaptureWriting(rdc, m_CapturedFrames.back().frameNumber,
+                                         captureWriter);
 
   m_HeaderChunk->Delete();
   m_HeaderChunk = NULL;
@@ -3784,6 +3784,19 @@ void WrappedVulkan::ReplayLog(uint32_t startEventID, uint32_t endEventID, Replay
     VkMarkerRegion::Begin("!!!!RenderDoc Internal: ApplyInitialContents");
     ApplyInitialContents();
     VkMarkerRegion::End();
+
+    if(m_UseReplayCheckpoints)
+    {
+      uint32_t lastEventID =
+          replayType == eReplay_WithoutDraw ? RDCMAX(1U, endEventID) - 1 : endEventID;
+      uint32_t checkpoint = m_ReplayCheckpointSchedule.FindRestorePoint(lastEventID);
+      if(checkpoint > 0)
+      {
+        VkMarkerRegion::Begin("!!!!RenderDoc Internal: RestoreReplayCheckpoint");
+        RestoreReplayCheckpoint(checkpoint);
+        VkMarkerRegion::End();
+      }
+    }
   }
 
   m_State = CaptureState::ActiveReplaying;
@@ -3899,6 +3912,8 @@ void WrappedVulkan::ReplayLog(uint32_t startEventID, uint32_t endEventID, Replay
 
     RDCASSERTEQUAL(status.code, ResultCode::Succeeded);
 
+    m_ReplayCheckpointEvent = 0;
+
     if(m_OutsideCmdBuffer != VK_NULL_HANDLE)
     {
       VkCommandBuffer cmd = m_OutsideCmdBuffer;
@@ -3943,6 +3958,455 @@ void WrappedVulkan::ReplayLog(uint32_t startEventID, uint32_t endEventID, Replay
   VkMarkerRegion::Set("!!!!RenderDoc Internal: Done replay");
 }
 
+void WrappedVulkan::ReplayLogWithCheckpoints(uint32_t endEventID, ReplayLogType replayType)
+{
+  m_ReplayCheckpointSchedule.Configure(Vulkan_ReplayCheckpointInterval(),
+                                       uint64_t(Vulkan_ReplayCheckpointBudgetMB()) * 1024 * 1024);
+
+  if(!m_ReplayCheckpointSchedule.Enabled() && !m_ReplayCheckpoints.empty())
+    ClearReplayCheckpoints();
+
+  // only replays from the start of the frame restore checkpoints, and not if an action callback
+  // needs to see the skipped events
+  m_UseReplayCheckpoints = m_ReplayCheckpointSchedule.Enabled() && m_ActionCallback == NULL &&
+                           (replayType == eReplay_Full || replayType == eReplay_WithoutDraw) &&
+                           ReplayCheckpointsSupported();
+
+  ReplayLog(0, endEventID, replayType);
+
+  m_UseReplayCheckpoints = false;
+}
+
+bool WrappedVulkan::ReplayCheckpointsSupported()
+{
+  if(m_ReplayCheckpointsSupported < 0)
+  {
+    m_ReplayCheckpointsSupported = m_StructuredFile ? 1 : 0;
+
+    // query results and sparse bindings aren't part of a checkpoint, so anything that depends on
+    // them could see different results after restoring one
+    for(size_t i = 0; m_StructuredFile && i < m_StructuredFile->chunks.size(); i++)
+    {
+      VulkanChunk chunk = (VulkanChunk)m_StructuredFile->chunks[i]->metadata.chunkID;
+      if(chunk == VulkanChunk::vkCmdCopyQueryPoolResults || chunk == VulkanChunk::vkQueueBindSparse)
+      {
+        RDCLOG("Replay checkpoints disabled, capture uses %s", ToStr(chunk).c_str());
+        m_ReplayCheckpointsSupported = 0;
+        break;
+      }
+    }
+  }
+
+  return m_ReplayCheckpointsSupported == 1;
+}
+
+void WrappedVulkan::CreateReplayCheckpoint(uint32_t eventId)
+{
+  VulkanResourceManager *rm = GetResourceManager();
+  VkDevice dev = m_Device;
+  const VkDevDispatchTable *vt = ObjDisp(dev);
+
+  ReplayCheckpoint checkpoint;
+
+  // memory is copied through its whole-memory buffer. Written images that aren't covered by one of
+  // those are copied individually.
+  std::set<ResourceId> copiedMemory;
+
+  for(auto it = m_CreationInfo.m_Memory.begin(); it != m_CreationInfo.m_Memory.end(); ++it)
+  {
+    if(it->second.wholeMemBuf == VK_NULL_HANDLE)
+      continue;
+
+    ResourceId orig = rm->GetOriginalID(it->first);
+
+    bool written = false;
+
+    MemRefs *memRefs = rm->FindMemRefs(orig);
+    if(memRefs)
+    {
+      for(auto ref = memRefs->rangeRefs.begin(); ref != memRefs->rangeRefs.end() && !written; ++ref)
+        written = IncludesWrite(ref->value());
+    }
+    else
+    {
+      // with no usage information, assume any memory the frame uses could be written
+      written = rm->GetInitialContents(orig).type == eResDeviceMemory;
+    }
+
+    if(!written)
+      continue;
+
+    ReplayCheckpoint::Snapshot snap;
+    snap.id = it->first;
+    snap.size = it->second.wholeMemBufSize;
+    checkpoint.snapshots.push_back(snap);
+    copiedMemory.insert(it->first);
+  }
+
+  uint64_t totalSize = 0;
+  for(const ReplayCheckpoint::Snapshot &snap : checkpoint.snapshots)
+    totalSize += snap.size;
+
+  for(auto it = m_ImageStates.begin(); it != m_ImageStates.end(); ++it)
+  {
+    LockedConstImageStateRef state = it->second.LockRead();
+    checkpoint.imageStates[it->first] = *state;
+
+    if(copiedMemory.find(state->boundMemory) != copiedMemory.end() ||
+       !rm->HasCurrentResource(it->first))
+      continue;
+
+    if(!IncludesWrite(state->maxRefType) && state->maxRefType != eFrameRef_Unknown)
+      continue;
+
+    auto info = m_CreationInfo.m_Image.find(it->first);
+
+    // multi-planar images would need a copy per plane, don't try to checkpoint them
+    if(info == m_CreationInfo.m_Image.end() || IsYUVFormat(info->second.format))
+      return;
+
+    ReplayCheckpoint::Snapshot snap;
+    snap.id = it->first;
+    snap.size = info->second.mrq.size;
+    checkpoint.snapshots.push_back(snap);
+    totalSize += snap.size;
+  }
+
+  if(checkpoint.snapshots.empty() || !m_ReplayCheckpointSchedule.CanFit(totalSize))
+    return;
+
+  for(uint32_t evicted : m_ReplayCheckpointSchedule.Add(eventId, totalSize))
+    FreeReplayCheckpoint(evicted);
+
+  m_ReplayCheckpoints[eventId] = checkpoint;
+
+  // allocate the copies, and give up on this checkpoint if we run out of memory
+  bool success = true;
+  totalSize = 0;
+
+  HandleOOM(true);
+
+  for(ReplayCheckpoint::Snapshot &snap : m_ReplayCheckpoints[eventId].snapshots)
+  {
+    VkMemoryRequirements mrq = {};
+    VkResult vkr = VK_SUCCESS;
+
+    if(copiedMemory.find(snap.id) != copiedMemory.end())
+    {
+      VkBufferCreateInfo bufInfo = {
+          VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+          NULL,
+          0,
+          snap.size,
+          VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+      };
+
+      vkr = vt->CreateBuffer(Unwrap(dev), &bufInfo, NULL, &snap.buf);
+      if(vkr == VK_SUCCESS)
+        vt->GetBufferMemoryRequirements(Unwrap(dev), snap.buf, &mrq);
+    }
+    else
+    {
+      const VulkanCreationInfo::Image &info = m_CreationInfo.m_Image[snap.id];
+
+      VkImageCreateInfo imInfo = {
+          VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+          NULL,
+          0,
+          info.type,
+          info.format,
+          info.extent,
+          info.mipLevels,
+          info.arrayLayers,
+          info.samples,
+          VK_IMAGE_TILING_OPTIMAL,
+          VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+          VK_SHARING_MODE_EXCLUSIVE,
+          0,
+          NULL,
+          VK_IMAGE_LAYOUT_UNDEFINED,
+      };
+
+      vkr = vt->CreateImage(Unwrap(dev), &imInfo, NULL, &snap.image);
+      if(vkr == VK_SUCCESS)
+        vt->GetImageMemoryRequirements(Unwrap(dev), snap.image, &mrq);
+    }
+
+    if(vkr == VK_SUCCESS)
+    {
+      VkMemoryAllocateInfo allocInfo = {
+          VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+          NULL,
+          mrq.size,
+          GetGPULocalMemoryIndex(mrq.memoryTypeBits),
+      };
+
+      vkr = vt->AllocateMemory(Unwrap(dev), &allocInfo, NULL, &snap.mem);
+    }
+
+    if(vkr == VK_SUCCESS)
+    {
+      if(snap.buf != VK_NULL_HANDLE)
+        vkr = vt->BindBufferMemory(Unwrap(dev), snap.buf, snap.mem, 0);
+      else
+        vkr = vt->BindImageMemory(Unwrap(dev), snap.image, snap.mem, 0);
+    }
+
+    if(vkr != VK_SUCCESS)
+    {
+      RDCWARN("Couldn't allocate replay checkpoint at %u: %s", eventId, ToStr(vkr).c_str());
+      success = false;
+      break;
+    }
+
+    totalSize += mrq.size;
+  }
+
+  HandleOOM(false);
+
+  if(!success)
+  {
+    FreeReplayCheckpoint(eventId);
+    return;
+  }
+
+  // account for the real allocation sizes, which may evict more checkpoints
+  m_ReplayCheckpointSchedule.Remove(eventId);
+  for(uint32_t evicted : m_ReplayCheckpointSchedule.Add(eventId, totalSize))
+    FreeReplayCheckpoint(evicted);
+
+  // the copies must see the results of every previous submission, on any queue
+  SubmitCmds();
+  FlushQ();
+
+  VkResult vkr = vt->DeviceWaitIdle(Unwrap(dev));
+  CheckVkResult(vkr);
+
+  ReplayCheckpoint &created = m_ReplayCheckpoints[eventId];
+
+  for(const ReplayCheckpoint::Snapshot &snap : created.snapshots)
+  {
+    if(snap.image != VK_NULL_HANDLE)
+      m_ImageStates.find(snap.id)->second.LockRead()->TempTransition(
+          m_QueueFamilyIdx, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_ACCESS_TRANSFER_READ_BIT,
+          m_setupImageBarriers, m_cleanupImageBarriers, GetImageTransitionInfo());
+  }
+
+  SubmitAndFlushImageStateBarriers(m_setupImageBarriers);
+
+  VkCommandBuffer cmd = GetNextCmd();
+
+  if(cmd == VK_NULL_HANDLE)
+    return;
+
+  VkCommandBufferBeginInfo beginInfo = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO, NULL,
+                                        VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT};
+
+  vkr = ObjDisp(cmd)->BeginCommandBuffer(Unwrap(cmd), &beginInfo);
+  CheckVkResult(vkr);
+
+  rdcarray<VkImageMemoryBarrier> barriers;
+
+  for(const ReplayCheckpoint::Snapshot &snap : created.snapshots)
+  {
+    if(snap.image == VK_NULL_HANDLE)
+      continue;
+
+    VkImageMemoryBarrier barrier = {
+        VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+        NULL,
+        0,
+        VK_ACCESS_TRANSFER_WRITE_BIT,
+        VK_IMAGE_LAYOUT_UNDEFINED,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        VK_QUEUE_FAMILY_IGNORED,
+        VK_QUEUE_FAMILY_IGNORED,
+        snap.image,
+        {FormatImageAspects(m_CreationInfo.m_Image[snap.id].format), 0, VK_REMAINING_MIP_LEVELS, 0,
+         VK_REMAINING_ARRAY_LAYERS},
+    };
+    barriers.push_back(barrier);
+  }
+
+  if(!barriers.empty())
+    DoPipelineBarrier(cmd, barriers.size(), barriers.data());
+
+  for(const ReplayCheckpoint::Snapshot &snap : created.snapshots)
+  {
+    if(snap.buf != VK_NULL_HANDLE)
+    {
+      VkBufferCopy region = {0, 0, snap.size};
+      ObjDisp(cmd)->CmdCopyBuffer(Unwrap(cmd), Unwrap(m_CreationInfo.m_Memory[snap.id].wholeMemBuf),
+                                  snap.buf, 1, &region);
+    }
+    else
+    {
+      const VulkanCreationInfo::Image &info = m_CreationInfo.m_Image[snap.id];
+      VkImage live = rm->GetCurrentHandle<VkImage>(snap.id);
+
+      for(uint32_t m = 0; m < info.mipLevels; m++)
+      {
+        VkImageCopy region = {
+            {FormatImageAspects(info.format), m, 0, info.arrayLayers},
+            {0, 0, 0},
+            {FormatImageAspects(info.format), m, 0, info.arrayLayers},
+            {0, 0, 0},
+            {RDCMAX(1U, info.extent.width >> m), RDCMAX(1U, info.extent.height >> m),
+             RDCMAX(1U, info.extent.depth >> m)},
+        };
+
+        ObjDisp(cmd)->CmdCopyImage(Unwrap(cmd), Unwrap(live), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                                   snap.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+      }
+    }
+  }
+
+  // the snapshot images stay ready to be copied back from
+  for(VkImageMemoryBarrier &barrier : barriers)
+  {
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+  }
+
+  if(!barriers.empty())
+    DoPipelineBarrier(cmd, barriers.size(), barriers.data());
+
+  vkr = ObjDisp(cmd)->EndCommandBuffer(Unwrap(cmd));
+  CheckVkResult(vkr);
+
+  SubmitCmds();
+  FlushQ();
+
+  SubmitAndFlushImageStateBarriers(m_cleanupImageBarriers);
+
+  RDCDEBUG("Created replay checkpoint at %u with %zu copies, %llu bytes", eventId,
+           created.snapshots.size(), totalSize);
+}
+
+void WrappedVulkan::RestoreReplayCheckpoint(uint32_t eventId)
+{
+  auto checkpointIt = m_ReplayCheckpoints.find(eventId);
+  if(checkpointIt == m_ReplayCheckpoints.end())
+    return;
+
+  const ReplayCheckpoint &checkpoint = checkpointIt->second;
+
+  // move every image to the layout it had at the checkpoint
+  for(auto it = checkpoint.imageStates.begin(); it != checkpoint.imageStates.end(); ++it)
+  {
+    auto stateIt = m_ImageStates.find(it->first);
+    if(stateIt == m_ImageStates.end())
+      continue;
+
+    LockedImageStateRef state = stateIt->second.LockWrite();
+    state->Transition(it->second, VK_ACCESS_ALL_WRITE_BITS, VK_ACCESS_ALL_READ_BITS,
+                      m_setupImageBarriers, GetImageTransitionInfo());
+    *state = it->second;
+  }
+
+  SubmitAndFlushImageStateBarriers(m_setupImageBarriers);
+
+  for(const ReplayCheckpoint::Snapshot &snap : checkpoint.snapshots)
+  {
+    auto stateIt = m_ImageStates.find(snap.id);
+    if(snap.image != VK_NULL_HANDLE && stateIt != m_ImageStates.end())
+      stateIt->second.LockRead()->TempTransition(
+          m_QueueFamilyIdx, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT,
+          m_setupImageBarriers, m_cleanupImageBarriers, GetImageTransitionInfo());
+  }
+
+  SubmitAndFlushImageStateBarriers(m_setupImageBarriers);
+
+  VkCommandBuffer cmd = GetNextCmd();
+
+  if(cmd == VK_NULL_HANDLE)
+    return;
+
+  VkCommandBufferBeginInfo beginInfo = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO, NULL,
+                                        VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT};
+
+  VkResult vkr = ObjDisp(cmd)->BeginCommandBuffer(Unwrap(cmd), &beginInfo);
+  CheckVkResult(vkr);
+
+  for(const ReplayCheckpoint::Snapshot &snap : checkpoint.snapshots)
+  {
+    if(snap.buf != VK_NULL_HANDLE)
+    {
+      VkBufferCopy region = {0, 0, snap.size};
+      ObjDisp(cmd)->CmdCopyBuffer(Unwrap(cmd), snap.buf,
+                                  Unwrap(m_CreationInfo.m_Memory[snap.id].wholeMemBuf), 1, &region);
+    }
+    else
+    {
+      const VulkanCreationInfo::Image &info = m_CreationInfo.m_Image[snap.id];
+      VkImage live = GetResourceManager()->GetCurrentHandle<VkImage>(snap.id);
+
+      if(live == VK_NULL_HANDLE || m_ImageStates.find(snap.id) == m_ImageStates.end())
+        continue;
+
+      for(uint32_t m = 0; m < info.mipLevels; m++)
+      {
+        VkImageCopy region = {
+            {FormatImageAspects(info.format), m, 0, info.arrayLayers},
+            {0, 0, 0},
+            {FormatImageAspects(info.format), m, 0, info.arrayLayers},
+            {0, 0, 0},
+            {RDCMAX(1U, info.extent.width >> m), RDCMAX(1U, info.extent.height >> m),
+             RDCMAX(1U, info.extent.depth >> m)},
+        };
+
+        ObjDisp(cmd)->CmdCopyImage(Unwrap(cmd), snap.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                                   Unwrap(live), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+      }
+    }
+  }
+
+  VkMemoryBarrier memBarrier = {
+      VK_STRUCTURE_TYPE_MEMORY_BARRIER, NULL, VK_ACCESS_ALL_WRITE_BITS, VK_ACCESS_ALL_READ_BITS,
+  };
+
+  DoPipelineBarrier(cmd, 1, &memBarrier);
+
+  vkr = ObjDisp(cmd)->EndCommandBuffer(Unwrap(cmd));
+  CheckVkResult(vkr);
+
+  SubmitCmds();
+  FlushQ();
+
+  SubmitAndFlushImageStateBarriers(m_cleanupImageBarriers);
+
+  m_ReplayCheckpointEvent = eventId;
+}
+
+void WrappedVulkan::FreeReplayCheckpoint(uint32_t eventId)
+{
+  auto it = m_ReplayCheckpoints.find(eventId);
+  if(it == m_ReplayCheckpoints.end())
+    return;
+
+  VkDevice dev = m_Device;
+
+  for(const ReplayCheckpoint::Snapshot &snap : it->second.snapshots)
+  {
+    ObjDisp(dev)->DestroyBuffer(Unwrap(dev), snap.buf, NULL);
+    ObjDisp(dev)->DestroyImage(Unwrap(dev), snap.image, NULL);
+    ObjDisp(dev)->FreeMemory(Unwrap(dev), snap.mem, NULL);
+  }
+
+  m_ReplayCheckpoints.erase(it);
+  m_ReplayCheckpointSchedule.Remove(eventId);
+}
+
+void WrappedVulkan::ClearReplayCheckpoints()
+{
+  m_ReplayCheckpointSchedule.Clear();
+
+  while(!m_ReplayCheckpoints.empty())
+    FreeReplayCheckpoint(m_ReplayCheckpoints.begin()->first);
+}
+
 template <typename SerialiserType>
 void WrappedVulkan::Serialise_DebugMessages(SerialiserType &ser)
 {
@@ -25,6 +25,7 @@
 #pragma once
 
 #include "common/timing.h"
+#include "replay/replay_driver.h"
 #include "serialise/serialiser.h"
 #include "vk_common.h"
 #include "vk_info.h"
@@ -53,7 +54,7 @@ struct VkInitParams
   uint64_t GetSerialiseSize();
 
   // check if a frame capture section version is supported
-  static const uint64_t CurrentVersion = 0x14;
+  static const uint64_t CurrentVersion = 0x17;
   static bool IsSupportedVersion(uint64_t ver);
 };
 
@@ -954,6 +955,40 @@ private:
 
   std::set<ResourceId> m_SparseBindResources;
 
+  // copies of everything the frame writes, taken at the start of a queue submission. A replay from
+  // the start of the frame to a later event can restore one of these and skip all submissions
+  // before it, instead of executing the whole frame again.
+  struct ReplayCheckpoint
+  {
+    struct Snapshot
+    {
+      // the live memory for a copy of its whole-memory buffer, or the live image for an image copy
+      // of memory that has no whole-memory buffer
+      ResourceId id;
+      VkBuffer buf = VK_NULL_HANDLE;
+      VkImage image = VK_NULL_HANDLE;
+      VkDeviceMemory mem = VK_NULL_HANDLE;
+      VkDeviceSize size = 0;
+    };
+
+    rdcarray<Snapshot> snapshots;
+    std::map<ResourceId, ImageState> imageStates;
+  };
+
+  std::map<uint32_t, ReplayCheckpoint> m_ReplayCheckpoints;
+  ReplayCheckpointSchedule m_ReplayCheckpointSchedule;
+  // -1 until the capture has been checked for anything checkpoints can't restore
+  int m_ReplayCheckpointsSupported = -1;
+  // set while replaying in a way that may take and restore checkpoints
+  bool m_UseReplayCheckpoints = false;
+  // the checkpoint this replay was restored from, submissions before it are skipped
+  uint32_t m_ReplayCheckpointEvent = 0;
+
+  bool ReplayCheckpointsSupported();
+  void CreateReplayCheckpoint(uint32_t eventId);
+  void RestoreReplayCheckpoint(uint32_t eventId);
+  void FreeReplayCheckpoint(uint32_t eventId);
+
   RDResult m_FailedReplayResult = ResultCode::APIReplayFailed;
 
   VulkanActionTreeNode m_ParentAction;
@@ -1075,6 +1110,10 @@ public:
   }
   void Shutdown();
   void ReplayLog(uint32_t startEventID, uint32_t endEventID, ReplayLogType replayType);
+  // a replay from the start of the frame which can restore and take replay checkpoints. Only
+  // suitable when nothing is observing or modifying the replay before endEventID.
+  void ReplayLogWithCheckpoints(uint32_t endEventID, ReplayLogType replayType);
+  void ClearReplayCheckpoints();
   void ReplayDraw(VkCommandBuffer cmd, const ActionDescription &action);
   RDResult ReadLogInitialisation(RDCFile *rdc, bool storeStructuredBuffers);
 
@@ -4120,6 +4120,11 @@ void VulkanReplay::PostVS::Destroy(WrappedVulkan *driver)
 {
   if(XFBQueryPool != VK_NULL_HANDLE)
     driver->vkDestroyQueryPool(driver->GetDev(), XFBQueryPool, NULL);
+
+  VkDevice dev = driver->GetDev();
+  for(VkFence fence : FreeFences)
+    ObjDisp(dev)->DestroyFence(Unwrap(dev), fence, NULL);
+  FreeFences.clear();
 }
 
 void VulkanReplay::Feedback::Destroy(WrappedVulkan *driver)
@@ -543,7 +543,8 @@ struct VulkanCreationInfo
       LinearAndTiled = 0x3,
     };
 
-    Intervals<MemoryBinding> bindings;
+    // large allocations can have many thousands of sub-allocations bound
+    BTreeIntervals<MemoryBinding> bindings;
 
     void BindMemory(uint64_t offs, uint64_t sz, MemoryBinding b)
     {
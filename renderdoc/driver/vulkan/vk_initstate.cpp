@@ -40,7 +40,17 @@ template <typename SerialiserType>
 void DoSerialise(SerialiserType &ser, AspectSparseTable &el)
 {
   SERIALISE_MEMBER(aspectMask);
-  SERIALISE_MEMBER(table);
+
+  if(ser.VersionAtLeast(0x15))
+  {
+    SERIALISE_MEMBER(table);
+  }
+  else
+  {
+    Sparse::ExpandedPageTable table;
+    SERIALISE_ELEMENT(table);
+    el.table = std::move(table);
+  }
 }
 
 bool WrappedVulkan::Prepare_InitialState(WrappedVkRes *res)
@@ -1422,11 +1432,81 @@ bool WrappedVulkan::Serialise_InitialState(SerialiserType &ser, ResourceId id, V
         CheckVkResult(vkr);
       }
     }
+
+    // if the contents are identical to those of a resource serialised earlier in the capture, we
+    // only store that resource's ID and share its uploaded contents on replay.
+    ResourceId ContentsSource;
+    if(ser.VersionAtLeast(0x16))
+    {
+      // memory and images are uploaded differently so they can't share contents
+      if(ser.IsWriting() && Contents)
+        ContentsSource = GetResourceManager()->DeduplicateInitialContents(id, (uint32_t)type,
+                                                                          Contents, ContentsSize);
+
+      SERIALISE_ELEMENT(ContentsSource);
+    }
+
+    // set when uploadBuf/uploadMemory belong to ContentsSource's initial contents
+    bool sharedContents = false;
+    const rdcarray<VkBufferCopy> *sharedPackedRegions = NULL;
+
+    // device memory only stores its non-zero ranges, which are packed together in the upload buffer
+    // followed by some zeros to reset any unaligned bytes in between.
+    const VkDeviceSize packedZeroPadding = 16;
+    bool packed = type == eResDeviceMemory && ContentsSource == ResourceId() &&
+                  ser.VersionAtLeast(0x17);
+    rdcarray<NonZeroMemoryRange> NonZeroRanges;
+    VkDeviceSize uploadSize = ContentsSize;
+
+    if(packed)
+    {
+      if(ser.IsWriting() && Contents)
+        FindNonZeroMemoryRanges(Contents, ContentsSize, NonZeroRanges);
+
+      SERIALISE_ELEMENT(NonZeroRanges);
+
+      uploadSize = packedZeroPadding;
+      VkDeviceSize prevEnd = 0;
+      for(const NonZeroMemoryRange &range : NonZeroRanges)
+      {
+        if(range.offset < prevEnd || range.size > ContentsSize ||
+           range.offset > ContentsSize - range.size)
+        {
+          RDCERR("Invalid non-zero range %llu, %llu in %llu bytes of contents", range.offset,
+                 range.size, ContentsSize);
+          return false;
+        }
+
+        prevEnd = range.offset + range.size;
+        uploadSize += range.size;
+      }
+    }
+
+    if(ContentsSource != ResourceId())
+    {
+      if(IsReplayingAndReading() && !ser.IsErrored())
+      {
+        VkInitialContents sourceContents = GetResourceManager()->GetInitialContents(ContentsSource);
+
+        if(sourceContents.buf == VK_NULL_HANDLE ||
+           (!sourceContents.packedRegions && sourceContents.mem.size < ContentsSize))
+        {
+          RDCERR("Initial contents for %s refer to missing contents from %s", ToStr(id).c_str(),
+                 ToStr(ContentsSource).c_str());
+          return false;
+        }
+
+        uploadBuf = sourceContents.buf;
+        uploadMemory = sourceContents.mem;
+        sharedContents = true;
+        sharedPackedRegions = sourceContents.packedRegions;
+      }
+    }
     else if(IsReplayingAndReading() && !ser.IsErrored())
     {
       // create a buffer with memory attached, which we will fill with the initial contents
       VkBufferCreateInfo bufInfo = {
-          VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO, NULL, 0, ContentsSize,
+          VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO, NULL, 0, uploadSize,
           VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT};
 
       vkr = vkCreateBuffer(d, &bufInfo, NULL, &uploadBuf);
@@ -1461,7 +1541,28 @@ bool WrappedVulkan::Serialise_InitialState(SerialiserType &ser, ResourceId id, V
 
     // not using SERIALISE_ELEMENT_ARRAY so we can deliberately avoid allocation - we serialise
     // directly into upload memory
-    ser.Serialise("Contents"_lit, Contents, ContentsSize, SerialiserFlags::NoFlags).Important();
+    if(packed)
+    {
+      // each range is read from or written to its place in the contents
+      VkDeviceSize packedOffset = 0;
+      for(const NonZeroMemoryRange &range : NonZeroRanges)
+      {
+        byte *rangeContents = NULL;
+        if(Contents)
+          rangeContents = Contents + (ser.IsWriting() ? range.offset : packedOffset);
+
+        ser.Serialise("Contents"_lit, rangeContents, range.size, SerialiserFlags::NoFlags);
+
+        packedOffset += range.size;
+      }
+
+      if(IsReplayingAndReading() && Contents)
+        memset(Contents + packedOffset, 0, (size_t)packedZeroPadding);
+    }
+    else if(ContentsSource == ResourceId())
+    {
+      ser.Serialise("Contents"_lit, Contents, ContentsSize, SerialiserFlags::NoFlags).Important();
+    }
 
     // unmap the resource we mapped before - we need to do this on read and on write.
     if(!IsStructuredExporting(m_State) && mappedMem.mem != VK_NULL_HANDLE)
@@ -1496,12 +1597,32 @@ bool WrappedVulkan::Serialise_InitialState(SerialiserType &ser, ResourceId id, V
       {
         VkInitialContents initialContents(type, uploadMemory);
         initialContents.buf = uploadBuf;
+        initialContents.sharedContents = sharedContents;
+        initialContents.unpackedSize = ContentsSize;
+
+        if(packed)
+        {
+          initialContents.packedRegions = new rdcarray<VkBufferCopy>;
+          initialContents.packedRegions->reserve(NonZeroRanges.size());
+
+          VkDeviceSize packedOffset = 0;
+          for(const NonZeroMemoryRange &range : NonZeroRanges)
+          {
+            initialContents.packedRegions->push_back({packedOffset, range.offset, range.size});
+            packedOffset += range.size;
+          }
+        }
+        else if(sharedPackedRegions)
+        {
+          initialContents.packedRegions = new rdcarray<VkBufferCopy>(*sharedPackedRegions);
+        }
 
         GetResourceManager()->SetInitialContents(id, initialContents);
       }
       else
       {
         VkInitialContents initialContents(type, uploadMemory);
+        initialContents.sharedContents = sharedContents;
 
         // if we have sparse page tables, store them here now
         if(!sparseTables.empty())
@@ -1584,12 +1705,16 @@ bool WrappedVulkan::Serialise_InitialState(SerialiserType &ser, ResourceId id, V
           SubmitCmds();
           FlushQ();
 
-          // destroy the buffer as it's no longer needed.
-          vkDestroyBuffer(d, uploadBuf, NULL);
-          FreeMemoryAllocation(uploadMemory);
+          // destroy the buffer as it's no longer needed, unless it's shared with another resource
+          if(!sharedContents)
+          {
+            vkDestroyBuffer(d, uploadBuf, NULL);
+            FreeMemoryAllocation(uploadMemory);
+          }
 
           initialContents.buf = gpuBuf;
           initialContents.mem = gpuUploadMemory;
+          initialContents.sharedContents = false;
         }
 
         GetResourceManager()->SetInitialContents(id, initialContents);
@@ -2177,11 +2302,14 @@ void WrappedVulkan::Apply_InitialState(WrappedVkRes *live, const VkInitialConten
     ResourceId orig = GetResourceManager()->GetOriginalID(id);
     MemRefs *memRefs = GetResourceManager()->FindMemRefs(orig);
 
+    // packed contents are smaller than the memory they reset
+    VkDeviceSize contentsSize = initial.packedRegions ? initial.unpackedSize : initial.mem.size;
+
     if(!memRefs)
     {
       // No information about the memory usage in the frame.
       // Pessimistically assume the entire memory needs to be reset.
-      resetReq.update(0, initial.mem.size, eInitReq_Copy,
+      resetReq.update(0, contentsSize, eInitReq_Copy,
                       [](InitReqType x, InitReqType y) -> InitReqType { return RDCMAX(x, y); });
     }
     else
@@ -2209,7 +2337,7 @@ void WrappedVulkan::Apply_InitialState(WrappedVkRes *live, const VkInitialConten
     VkBuffer srcBuf = initial.buf;
 
     VkBuffer dstBuf = m_CreationInfo.m_Memory[id].wholeMemBuf;
-    VkDeviceSize dstBufSize = RDCMIN(initial.mem.size, m_CreationInfo.m_Memory[id].wholeMemBufSize);
+    VkDeviceSize dstBufSize = RDCMIN(contentsSize, m_CreationInfo.m_Memory[id].wholeMemBufSize);
     if(dstBuf == VK_NULL_HANDLE)
     {
       RDCERR("Whole memory buffer not present for %s", ToStr(orig).c_str());
@@ -2233,6 +2361,7 @@ void WrappedVulkan::Apply_InitialState(WrappedVkRes *live, const VkInitialConten
     VkMarkerRegion::Begin(StringFormat::Fmt("Initial state for %s", ToStr(orig).c_str()), cmd);
 
     rdcarray<VkBufferCopy> regions;
+    rdcarray<rdcpair<VkDeviceSize, VkDeviceSize>> zeroFills;
     uint32_t fillCount = 0;
     for(auto it = resetReq.begin(); it != resetReq.end(); it++)
     {
@@ -2249,10 +2378,21 @@ void WrappedVulkan::Apply_InitialState(WrappedVkRes *live, const VkInitialConten
           ObjDisp(cmd)->CmdFillBuffer(Unwrap(cmd), Unwrap(dstBuf), start, size, 0);
           fillCount++;
           break;
-        case eInitReq_Copy: regions.push_back({start, start, size}); break;
+        case eInitReq_Copy:
+          // only the non-zero parts are copied, the rest is filled with zero
+          if(initial.packedRegions)
+            GetPackedMemoryResetRegions(*initial.packedRegions, start, finish, regions, zeroFills);
+          else
+            regions.push_back({start, start, size});
+          break;
         default: break;
       }
     }
+    for(const rdcpair<VkDeviceSize, VkDeviceSize> &fill : zeroFills)
+    {
+      ObjDisp(cmd)->CmdFillBuffer(Unwrap(cmd), Unwrap(dstBuf), fill.first, fill.second, 0);
+      fillCount++;
+    }
     RDCDEBUG("Apply_InitialState (Mem %s): %d fills, %d copies", ToStr(orig).c_str(), fillCount,
              regions.size());
     if(regions.size() > 0)
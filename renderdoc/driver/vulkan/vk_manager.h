@@ -106,10 +106,13 @@ struct VkInitialContents
     SAFE_DELETE_ARRAY(inlineInfo);
     FreeAlignedBuffer(inlineData);
 
-    rm->ResourceTypeRelease(GetWrapped(buf));
+    // shared contents are released along with the resource that owns them
+    if(!sharedContents)
+      rm->ResourceTypeRelease(GetWrapped(buf));
 
     SAFE_DELETE(sparseTables);
     SAFE_DELETE(sparseBind);
+    SAFE_DELETE(packedRegions);
 
     // MemoryAllocation is not free'd here
   }
@@ -128,6 +131,13 @@ struct VkInitialContents
   VkBuffer buf;
   MemoryAllocation mem;
   Tag tag;
+  // buf and mem belong to another resource's initial contents with an identical payload
+  bool sharedContents;
+
+  // for device memory on replay, if buf only holds the non-zero ranges of the contents packed
+  // together, the copies from buf that place them in memory of size unpackedSize.
+  rdcarray<VkBufferCopy> *packedRegions;
+  VkDeviceSize unpackedSize;
 
   // for sparse resources. The tables pointer is only valid on capture, it is converted to the queue
   // sparse bind. Similar to the descriptors above
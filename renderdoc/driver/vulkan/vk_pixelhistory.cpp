@@ -107,6 +107,9 @@
 #include "vk_replay.h"
 #include "vk_shader_cache.h"
 
+// how many pixels' occlusion results are kept for re-use by later pixel history queries
+static const size_t MaxCachedOcclusionPixels = 256;
+
 bool isDirectWrite(ResourceUsage usage)
 {
   return ((usage >= ResourceUsage::VS_RWResource && usage <= ResourceUsage::CS_RWResource) ||
@@ -630,8 +633,13 @@ struct VulkanPixelHistoryCallback : public VulkanActionCallback
   // Update the given scissor to just the pixel for which pixel history was requested.
   void ScissorToPixel(const VkViewport &view, VkRect2D &scissor)
   {
-    float fx = (float)m_CallbackInfo.x;
-    float fy = (float)m_CallbackInfo.y;
+    ScissorToPixel(view, scissor, m_CallbackInfo.x, m_CallbackInfo.y);
+  }
+
+  void ScissorToPixel(const VkViewport &view, VkRect2D &scissor, uint32_t x, uint32_t y)
+  {
+    float fx = (float)x;
+    float fy = (float)y;
     float y_start = view.y;
     float y_end = view.y + view.height;
     if(view.height < 0)
@@ -646,8 +654,8 @@ struct VulkanPixelHistoryCallback : public VulkanActionCallback
     }
     else
     {
-      scissor.offset.x = m_CallbackInfo.x;
-      scissor.offset.y = m_CallbackInfo.y;
+      scissor.offset.x = x;
+      scissor.offset.y = y;
       scissor.extent.width = scissor.extent.height = 1;
     }
   }
@@ -1420,11 +1428,12 @@ struct VulkanOcclusionCallback : public VulkanPixelHistoryCallback
 {
   VulkanOcclusionCallback(WrappedVulkan *vk, PixelHistoryShaderCache *shaderCache,
                           const PixelHistoryCallbackInfo &callbackInfo, VkQueryPool occlusionPool,
-                          const rdcarray<EventUsage> &allEvents)
-      : VulkanPixelHistoryCallback(vk, shaderCache, callbackInfo, occlusionPool)
+                          const rdcarray<uint32_t> &events,
+                          const rdcarray<rdcpair<uint32_t, uint32_t>> &pixels)
+      : VulkanPixelHistoryCallback(vk, shaderCache, callbackInfo, occlusionPool),
+        m_Events(events),
+        m_Pixels(pixels)
   {
-    for(size_t i = 0; i < allEvents.size(); i++)
-      m_Events.push_back(allEvents[i].eventId);
   }
 
   ~VulkanOcclusionCallback()
@@ -1435,22 +1444,31 @@ struct VulkanOcclusionCallback : public VulkanPixelHistoryCallback
 
   void PreDraw(uint32_t eid, VkCommandBuffer cmd)
   {
-    if(!m_Events.contains(eid))
+    if(!m_Events.contains(eid) || m_OcclusionQueries.find(eid) != m_OcclusionQueries.end())
       return;
     VulkanRenderState prevState = m_pDriver->GetCmdRenderState();
     VulkanRenderState &pipestate = m_pDriver->GetCmdRenderState();
 
     VkPipeline pipe = GetPixelOcclusionPipeline(eid, prevState.graphics.pipeline,
                                                 GetColorAttachmentIndex(prevState));
-    // set the scissor
-    for(uint32_t i = 0; i < pipestate.views.size(); i++)
-      ScissorToPixel(pipestate.views[i], pipestate.scissors[i]);
     // set stencil state (though it's unused here)
     pipestate.front.compare = pipestate.front.write = 0xff;
     pipestate.front.ref = 0;
     pipestate.back = pipestate.front;
     pipestate.graphics.pipeline = GetResID(pipe);
-    ReplayDrawWithQuery(cmd, eid);
+
+    // the queries for this event's pixels are allocated contiguously
+    uint32_t occlIndex = (uint32_t)(m_OcclusionQueries.size() * m_Pixels.size());
+    m_OcclusionQueries.insert(std::make_pair(eid, occlIndex));
+
+    for(size_t p = 0; p < m_Pixels.size(); p++)
+    {
+      // set the scissor
+      for(uint32_t i = 0; i < pipestate.views.size(); i++)
+        ScissorToPixel(pipestate.views[i], pipestate.scissors[i], m_Pixels[p].first,
+                       m_Pixels[p].second);
+      ReplayDrawWithQuery(cmd, eid, occlIndex + (uint32_t)p);
+    }
 
     m_pDriver->GetCmdRenderState() = prevState;
     m_pDriver->GetCmdRenderState().BindPipeline(m_pDriver, cmd, VulkanRenderState::BindGraphics,
@@ -1483,7 +1501,7 @@ struct VulkanOcclusionCallback : public VulkanPixelHistoryCallback
     if(m_OcclusionQueries.size() == 0)
       return;
 
-    m_OcclusionResults.resize(m_OcclusionQueries.size());
+    m_OcclusionResults.resize(m_OcclusionQueries.size() * m_Pixels.size());
     VkResult vkr = ObjDisp(m_pDriver->GetDev())
                        ->GetQueryPoolResults(Unwrap(m_pDriver->GetDev()), m_OcclusionPool, 0,
                                              (uint32_t)m_OcclusionResults.size(),
@@ -1493,31 +1511,29 @@ struct VulkanOcclusionCallback : public VulkanPixelHistoryCallback
     m_pDriver->CheckVkResult(vkr);
   }
 
-  uint64_t GetOcclusionResult(uint32_t eventId)
+  uint64_t GetOcclusionResult(uint32_t eventId, size_t pixelIndex)
   {
     auto it = m_OcclusionQueries.find(eventId);
     if(it == m_OcclusionQueries.end())
       return 0;
-    RDCASSERT(it->second < m_OcclusionResults.size());
-    return m_OcclusionResults[it->second];
+    RDCASSERT(it->second + pixelIndex < m_OcclusionResults.size());
+    return m_OcclusionResults[it->second + pixelIndex];
   }
 
 private:
   // ReplayDrawWithQuery binds the pipeline in the current state, and replays a single
   // draw with an occlusion query.
-  void ReplayDrawWithQuery(VkCommandBuffer cmd, uint32_t eventId)
+  void ReplayDrawWithQuery(VkCommandBuffer cmd, uint32_t eventId, uint32_t occlIndex)
   {
     const ActionDescription *action = m_pDriver->GetAction(eventId);
     m_pDriver->GetCmdRenderState().BindPipeline(m_pDriver, cmd, VulkanRenderState::BindGraphics,
                                                 false);
 
-    uint32_t occlIndex = (uint32_t)m_OcclusionQueries.size();
     ObjDisp(cmd)->CmdBeginQuery(Unwrap(cmd), m_OcclusionPool, occlIndex, m_QueryFlags);
 
     m_pDriver->ReplayDraw(cmd, *action);
 
     ObjDisp(cmd)->CmdEndQuery(Unwrap(cmd), m_OcclusionPool, occlIndex);
-    m_OcclusionQueries.insert(std::make_pair(eventId, occlIndex));
   }
 
   VkPipeline GetPixelOcclusionPipeline(uint32_t eid, ResourceId pipeline, uint32_t outputIndex)
@@ -1550,7 +1566,9 @@ private:
 private:
   std::map<ResourceId, VkPipeline> m_PipeCache;
   rdcarray<uint32_t> m_Events;
-  // Key is event ID, and value is an index of where the occlusion result.
+  // The pixels tested for each event, each with their own query.
+  rdcarray<rdcpair<uint32_t, uint32_t>> m_Pixels;
+  // Key is event ID, and value is the index of the occlusion result for the first pixel.
   std::map<uint32_t, uint32_t> m_OcclusionQueries;
   rdcarray<uint64_t> m_OcclusionResults;
 };
@@ -3692,18 +3710,36 @@ rdcarray<PixelModification> VulkanReplay::PixelHistory(rdcarray<EventUsage> even
                                                        ResourceId target, uint32_t x, uint32_t y,
                                                        const Subresource &sub, CompType typeCast)
 {
-  rdcarray<PixelModification> history;
+  rdcarray<PixelHistoryResult> results =
+      PixelHistoryRegion(events, target, x, y, 1, 1, sub, typeCast);
+
+  if(results.empty())
+    return {};
+
+  return results[0].modifications;
+}
+
+rdcarray<PixelHistoryResult> VulkanReplay::PixelHistoryRegion(rdcarray<EventUsage> events,
+                                                             ResourceId target, uint32_t x,
+                                                             uint32_t y, uint32_t width,
+                                                             uint32_t height,
+                                                             const Subresource &sub,
+                                                             CompType typeCast)
+{
+  rdcarray<PixelHistoryResult> results;
 
-  if(events.empty())
-    return history;
+  if(events.empty() || width == 0 || height == 0)
+    return results;
 
   const VulkanCreationInfo::Image &imginfo = GetDebugManager()->GetImageInfo(target);
   if(imginfo.format == VK_FORMAT_UNDEFINED)
-    return history;
+    return results;
 
   rdcstr regionName = StringFormat::Fmt(
-      "PixelHistory: pixel: (%u, %u) on %s subresource (%u, %u, %u) cast to %s with %zu events", x, y,
-      ToStr(target).c_str(), sub.mip, sub.slice, sub.sample, ToStr(typeCast).c_str(), events.size());
+      "PixelHistory: pixels: (%u, %u) %ux%u on %s subresource (%u, %u, %u) cast to %s with %zu "
+      "events",
+      x, y, width, height, ToStr(target).c_str(), sub.mip, sub.slice, sub.sample,
+      ToStr(typeCast).c_str(), events.size());
 
   RDCDEBUG("%s", regionName.c_str());
 
@@ -3727,8 +3763,6 @@ rdcarray<PixelModification> VulkanReplay::PixelHistory(rdcarray<EventUsage> even
     sampleIdx = 0;
 
   VkDevice dev = m_pDriver->GetDev();
-  VkQueryPool occlusionPool;
-  CreateOcclusionPool(m_pDriver, (uint32_t)events.size(), &occlusionPool);
 
   PixelHistoryResources resources = {};
   // TODO: perhaps should do this after making an occlusion query, since we will
@@ -3748,8 +3782,6 @@ rdcarray<PixelModification> VulkanReplay::PixelHistory(rdcarray<EventUsage> even
   callbackInfo.samples = imginfo.samples;
   callbackInfo.extent = imginfo.extent;
   callbackInfo.targetSubresource = sub;
-  callbackInfo.x = x;
-  callbackInfo.y = y;
   callbackInfo.sampleMask = sampleMask;
   callbackInfo.subImage = resources.colorImage;
   callbackInfo.subImageView = resources.colorImageView;
@@ -3758,362 +3790,461 @@ rdcarray<PixelModification> VulkanReplay::PixelHistory(rdcarray<EventUsage> even
   callbackInfo.dsImageView = resources.dsImageView;
   callbackInfo.dstBuffer = resources.dstBuffer;
 
-  VulkanOcclusionCallback occlCb(m_pDriver, shaderCache, callbackInfo, occlusionPool, events);
-  {
-    VkMarkerRegion occlRegion("VulkanOcclusionCallback");
-    m_pDriver->ReplayLog(0, events.back().eventId, eReplay_Full);
-    m_pDriver->SubmitCmds();
-    m_pDriver->FlushQ();
-    occlCb.FetchOcclusionResults();
-  }
+  rdcarray<rdcpair<uint32_t, uint32_t>> pixels;
+  for(uint32_t py = y; py < y + height; py++)
+    for(uint32_t px = x; px < x + width; px++)
+      pixels.push_back({px, py});
 
-  // Gather all draw events that could have written to pixel for another replay pass,
-  // to determine if these draws failed for some reason (for ex., depth test).
-  rdcarray<uint32_t> modEvents;
-  rdcarray<uint32_t> drawEvents;
-  for(size_t ev = 0; ev < events.size(); ev++)
-  {
-    bool clear = (events[ev].usage == ResourceUsage::Clear);
-    bool directWrite = isDirectWrite(events[ev].usage);
+  // occlusion results for each pixel, starting from any cached by earlier queries
+  rdcarray<std::map<uint32_t, uint64_t>> pixelOcclusion;
+  pixelOcclusion.resize(pixels.size());
 
-    if(events[ev].view != ResourceId())
+  for(size_t p = 0; p < pixels.size(); p++)
+  {
+    for(const PixelHistoryOcclusion &cached : m_PixelHistoryOcclusion)
     {
-      // TODO: Check that the slice and mip matches.
-      VulkanCreationInfo::ImageView viewInfo =
-          m_pDriver->GetDebugManager()->GetImageViewInfo(events[ev].view);
-      uint32_t layerEnd = viewInfo.range.baseArrayLayer + viewInfo.range.layerCount;
-      if(sub.slice < viewInfo.range.baseArrayLayer || sub.slice >= layerEnd)
+      if(cached.target == target && cached.sub == sub && cached.x == pixels[p].first &&
+         cached.y == pixels[p].second)
       {
-        RDCDEBUG("Usage %d at %u didn't refer to the matching mip/slice (%u/%u)", events[ev].usage,
-                 events[ev].eventId, sub.mip, sub.slice);
-        continue;
+        pixelOcclusion[p] = cached.results;
+        break;
       }
     }
+  }
 
-    if(directWrite || clear)
-    {
-      modEvents.push_back(events[ev].eventId);
-    }
-    else
+  rdcarray<uint32_t> occlEvents;
+  for(size_t ev = 0; ev < events.size(); ev++)
+  {
+    for(size_t p = 0; p < pixels.size(); p++)
     {
-      uint64_t occlData = occlCb.GetOcclusionResult((uint32_t)events[ev].eventId);
-      VkMarkerRegion::Set(StringFormat::Fmt("%u has occl %llu", events[ev].eventId, occlData));
-      if(occlData > 0)
+      if(pixelOcclusion[p].find(events[ev].eventId) == pixelOcclusion[p].end())
       {
-        drawEvents.push_back(events[ev].eventId);
-        modEvents.push_back(events[ev].eventId);
+        occlEvents.push_back(events[ev].eventId);
+        break;
       }
     }
   }
 
-  VulkanColorAndStencilCallback cb(m_pDriver, shaderCache, callbackInfo, modEvents);
+  // only test events that some pixel doesn't have a result for yet, testing every pixel in the
+  // region in the same replay.
+  if(!occlEvents.empty())
   {
-    VkMarkerRegion colorStencilRegion("VulkanColorAndStencilCallback");
-    m_pDriver->ReplayLog(0, events.back().eventId, eReplay_Full);
-    m_pDriver->SubmitCmds();
-    m_pDriver->FlushQ();
-  }
+    VkQueryPool occlusionPool;
+    CreateOcclusionPool(m_pDriver, (uint32_t)(occlEvents.size() * pixels.size()), &occlusionPool);
 
-  // If there are any draw events, do another replay pass, in order to figure out
-  // which tests failed for each draw event.
-  TestsFailedCallback *tfCb = NULL;
-  if(drawEvents.size() > 0)
-  {
-    VkMarkerRegion testsRegion("TestsFailedCallback");
-    VkQueryPool tfOcclusionPool;
-    CreateOcclusionPool(m_pDriver, (uint32_t)drawEvents.size() * 6, &tfOcclusionPool);
-
-    tfCb = new TestsFailedCallback(m_pDriver, shaderCache, callbackInfo, tfOcclusionPool, drawEvents);
-    m_pDriver->ReplayLog(0, events.back().eventId, eReplay_Full);
-    m_pDriver->SubmitCmds();
-    m_pDriver->FlushQ();
-    tfCb->FetchOcclusionResults();
-    ObjDisp(dev)->DestroyQueryPool(Unwrap(dev), tfOcclusionPool, NULL);
-  }
+    VulkanOcclusionCallback occlCb(m_pDriver, shaderCache, callbackInfo, occlusionPool,
+                                   occlEvents, pixels);
+    {
+      VkMarkerRegion occlRegion("VulkanOcclusionCallback");
+      m_pDriver->ReplayLog(0, occlEvents.back(), eReplay_Full);
+      m_pDriver->SubmitCmds();
+      m_pDriver->FlushQ();
+      occlCb.FetchOcclusionResults();
+    }
 
-  for(size_t ev = 0; ev < events.size(); ev++)
-  {
-    uint32_t eventId = events[ev].eventId;
-    bool clear = (events[ev].usage == ResourceUsage::Clear);
-    bool directWrite = isDirectWrite(events[ev].usage);
+    for(size_t p = 0; p < pixels.size(); p++)
+      for(uint32_t eid : occlEvents)
+        pixelOcclusion[p][eid] = occlCb.GetOcclusionResult(eid, p);
 
-    if(drawEvents.contains(events[ev].eventId) || clear || directWrite)
-    {
-      PixelModification mod;
-      RDCEraseEl(mod);
+    ObjDisp(dev)->DestroyQueryPool(Unwrap(dev), occlusionPool, NULL);
 
-      mod.eventId = eventId;
-      mod.directShaderWrite = directWrite;
-      mod.unboundPS = false;
+    for(size_t p = 0; p < pixels.size(); p++)
+    {
+      PixelHistoryOcclusion *cached = NULL;
+      for(PixelHistoryOcclusion &c : m_PixelHistoryOcclusion)
+      {
+        if(c.target == target && c.sub == sub && c.x == pixels[p].first &&
+           c.y == pixels[p].second)
+        {
+          cached = &c;
+          break;
+        }
+      }
 
-      if(!clear && !directWrite)
+      if(!cached)
       {
-        RDCASSERT(tfCb != NULL);
-        uint32_t flags = tfCb->GetEventFlags(eventId);
-        VkMarkerRegion::Set(StringFormat::Fmt("%u has flags %x", eventId, flags));
-        if(flags & TestMustFail_Culling)
-          mod.backfaceCulled = true;
-        if(flags & TestMustFail_DepthTesting)
-          mod.depthTestFailed = true;
-        if(flags & TestMustFail_Scissor)
-          mod.scissorClipped = true;
-        if(flags & TestMustFail_SampleMask)
-          mod.sampleMasked = true;
-        if(flags & UnboundFragmentShader)
-          mod.unboundPS = true;
-
-        UpdateTestsFailed(tfCb, eventId, flags, mod);
+        // drop the oldest pixel to keep the cache bounded
+        if(m_PixelHistoryOcclusion.size() >= MaxCachedOcclusionPixels)
+          m_PixelHistoryOcclusion.erase(0);
+
+        m_PixelHistoryOcclusion.push_back(PixelHistoryOcclusion());
+        cached = &m_PixelHistoryOcclusion.back();
+        cached->target = target;
+        cached->sub = sub;
+        cached->x = pixels[p].first;
+        cached->y = pixels[p].second;
       }
-      history.push_back(mod);
+
+      cached->results = pixelOcclusion[p];
     }
   }
 
-  // Try to read memory back
+  results.resize(pixels.size());
 
-  EventInfo *eventsInfo;
-  VkResult vkr =
-      m_pDriver->vkMapMemory(dev, resources.bufferMemory, 0, VK_WHOLE_SIZE, 0, (void **)&eventsInfo);
-  CheckVkResult(vkr);
-  if(vkr != VK_SUCCESS)
-    return history;
-  if(!eventsInfo)
+  for(size_t p = 0; p < pixels.size(); p++)
   {
-    RDCERR("Manually reporting failed memory map");
-    CheckVkResult(VK_ERROR_MEMORY_MAP_FAILED);
-    return history;
-  }
+    results[p].x = pixels[p].first;
+    results[p].y = pixels[p].second;
 
-  std::map<uint32_t, uint32_t> eventsWithFrags;
-  std::map<uint32_t, ModificationValue> eventPremods;
-  ResourceFormat fmt = MakeResourceFormat(imginfo.format);
+    rdcarray<PixelModification> &history = results[p].modifications;
 
-  for(size_t h = 0; h < history.size();)
-  {
-    PixelModification &mod = history[h];
+    callbackInfo.x = pixels[p].first;
+    callbackInfo.y = pixels[p].second;
 
-    int32_t eventIndex = cb.GetEventIndex(mod.eventId);
-    if(eventIndex == -1)
+    // Gather all draw events that could have written to pixel for another replay pass,
+    // to determine if these draws failed for some reason (for ex., depth test).
+    rdcarray<uint32_t> modEvents;
+    rdcarray<uint32_t> drawEvents;
+    for(size_t ev = 0; ev < events.size(); ev++)
     {
-      // There is no information, skip the event.
-      mod.preMod.SetInvalid();
-      mod.postMod.SetInvalid();
-      mod.shaderOut.SetInvalid();
-      h++;
-      continue;
-    }
-    const EventInfo &ei = eventsInfo[eventIndex];
-    FillInColor(fmt, ei.premod, mod.preMod);
-    FillInColor(fmt, ei.postmod, mod.postMod);
-    VkFormat depthFormat = cb.GetDepthFormat(mod.eventId);
-    if(depthFormat != VK_FORMAT_UNDEFINED)
-    {
-      mod.preMod.stencil = ei.premod.stencil;
-      mod.postMod.stencil = ei.postmod.stencil;
-      if(multisampled)
+      bool clear = (events[ev].usage == ResourceUsage::Clear);
+      bool directWrite = isDirectWrite(events[ev].usage);
+
+      if(events[ev].view != ResourceId())
+      {
+        // TODO: Check that the slice and mip matches.
+        VulkanCreationInfo::ImageView viewInfo =
+            m_pDriver->GetDebugManager()->GetImageViewInfo(events[ev].view);
+        uint32_t layerEnd = viewInfo.range.baseArrayLayer + viewInfo.range.layerCount;
+        if(sub.slice < viewInfo.range.baseArrayLayer || sub.slice >= layerEnd)
+        {
+          RDCDEBUG("Usage %d at %u didn't refer to the matching mip/slice (%u/%u)",
+                   events[ev].usage, events[ev].eventId, sub.mip, sub.slice);
+          continue;
+        }
+      }
+
+      if(directWrite || clear)
       {
-        mod.preMod.depth = ei.premod.depth.fdepth;
-        mod.postMod.depth = ei.postmod.depth.fdepth;
+        modEvents.push_back(events[ev].eventId);
       }
       else
       {
-        mod.preMod.depth = GetDepthValue(depthFormat, ei.premod);
-        mod.postMod.depth = GetDepthValue(depthFormat, ei.postmod);
+        uint64_t occlData = pixelOcclusion[p][events[ev].eventId];
+        VkMarkerRegion::Set(StringFormat::Fmt("%u has occl %llu", events[ev].eventId, occlData));
+        if(occlData > 0)
+        {
+          drawEvents.push_back(events[ev].eventId);
+          modEvents.push_back(events[ev].eventId);
+        }
       }
     }
 
-    int32_t frags = int32_t(ei.dsWithoutShaderDiscard[4]);
-    int32_t fragsClipped = int32_t(ei.dsWithShaderDiscard[4]);
-    mod.shaderOut.col.intValue[0] = frags;
-    mod.shaderOut.col.intValue[1] = fragsClipped;
-    bool someFragsClipped = (fragsClipped < frags);
-    mod.primitiveID = someFragsClipped;
-    // Draws in secondary command buffers will fail this check,
-    // so nothing else needs to be checked in the callback itself.
-    if(frags > 0)
+    VulkanColorAndStencilCallback cb(m_pDriver, shaderCache, callbackInfo, modEvents);
     {
-      eventsWithFrags[mod.eventId] = frags;
-      eventPremods[mod.eventId] = mod.preMod;
+      VkMarkerRegion colorStencilRegion("VulkanColorAndStencilCallback");
+      m_pDriver->ReplayLog(0, events.back().eventId, eReplay_Full);
+      m_pDriver->SubmitCmds();
+      m_pDriver->FlushQ();
     }
 
-    for(int32_t f = 1; f < frags; f++)
+    // If there are any draw events, do another replay pass, in order to figure out
+    // which tests failed for each draw event.
+    TestsFailedCallback *tfCb = NULL;
+    if(drawEvents.size() > 0)
     {
-      history.insert(h + 1, mod);
-    }
-    for(int32_t f = 0; f < frags; f++)
-      history[h + f].fragIndex = f;
-    h += RDCMAX(1, frags);
-    RDCDEBUG(
-        "PixelHistory event id: %u, fixed shader stencilValue = %u, original shader stencilValue = "
-        "%u",
-        mod.eventId, ei.dsWithoutShaderDiscard[4], ei.dsWithShaderDiscard[4]);
-  }
-  m_pDriver->vkUnmapMemory(dev, resources.bufferMemory);
+      VkMarkerRegion testsRegion("TestsFailedCallback");
+      VkQueryPool tfOcclusionPool;
+      CreateOcclusionPool(m_pDriver, (uint32_t)drawEvents.size() * 6, &tfOcclusionPool);
 
-  if(eventsWithFrags.size() > 0)
-  {
-    // Replay to get shader output value, post modification value and primitive ID for every
-    // fragment.
-    VulkanPixelHistoryPerFragmentCallback perFragmentCB(m_pDriver, shaderCache, callbackInfo,
-                                                        eventsWithFrags, eventPremods);
-    {
-      VkMarkerRegion perFragmentRegion("VulkanPixelHistoryPerFragmentCallback");
-      m_pDriver->ReplayLog(0, eventsWithFrags.rbegin()->first, eReplay_Full);
+      tfCb = new TestsFailedCallback(m_pDriver, shaderCache, callbackInfo, tfOcclusionPool,
+                                     drawEvents);
+      m_pDriver->ReplayLog(0, events.back().eventId, eReplay_Full);
       m_pDriver->SubmitCmds();
       m_pDriver->FlushQ();
+      tfCb->FetchOcclusionResults();
+      ObjDisp(dev)->DestroyQueryPool(Unwrap(dev), tfOcclusionPool, NULL);
+    }
+
+    for(size_t ev = 0; ev < events.size(); ev++)
+    {
+      uint32_t eventId = events[ev].eventId;
+      bool clear = (events[ev].usage == ResourceUsage::Clear);
+      bool directWrite = isDirectWrite(events[ev].usage);
+
+      if(drawEvents.contains(events[ev].eventId) || clear || directWrite)
+      {
+        PixelModification mod;
+        RDCEraseEl(mod);
+
+        mod.eventId = eventId;
+        mod.directShaderWrite = directWrite;
+        mod.unboundPS = false;
+
+        if(!clear && !directWrite)
+        {
+          RDCASSERT(tfCb != NULL);
+          uint32_t flags = tfCb->GetEventFlags(eventId);
+          VkMarkerRegion::Set(StringFormat::Fmt("%u has flags %x", eventId, flags));
+          if(flags & TestMustFail_Culling)
+            mod.backfaceCulled = true;
+          if(flags & TestMustFail_DepthTesting)
+            mod.depthTestFailed = true;
+          if(flags & TestMustFail_Scissor)
+            mod.scissorClipped = true;
+          if(flags & TestMustFail_SampleMask)
+            mod.sampleMasked = true;
+          if(flags & UnboundFragmentShader)
+            mod.unboundPS = true;
+
+          UpdateTestsFailed(tfCb, eventId, flags, mod);
+        }
+        history.push_back(mod);
+      }
     }
 
-    PerFragmentInfo *bp = NULL;
-    vkr = m_pDriver->vkMapMemory(dev, resources.bufferMemory, 0, VK_WHOLE_SIZE, 0, (void **)&bp);
+    // Try to read memory back
+
+    EventInfo *eventsInfo;
+    VkResult vkr = m_pDriver->vkMapMemory(dev, resources.bufferMemory, 0, VK_WHOLE_SIZE, 0,
+                                          (void **)&eventsInfo);
     CheckVkResult(vkr);
-    if(vkr != VK_SUCCESS)
-      return history;
-    if(!bp)
+    if(vkr == VK_SUCCESS && !eventsInfo)
     {
       RDCERR("Manually reporting failed memory map");
       CheckVkResult(VK_ERROR_MEMORY_MAP_FAILED);
-      return history;
+      vkr = VK_ERROR_MEMORY_MAP_FAILED;
     }
+    if(vkr != VK_SUCCESS)
+    {
+      SAFE_DELETE(tfCb);
+      break;
+    }
+
+    std::map<uint32_t, uint32_t> eventsWithFrags;
+    std::map<uint32_t, ModificationValue> eventPremods;
+    ResourceFormat fmt = MakeResourceFormat(imginfo.format);
 
-    // Retrieve primitive ID values where fragment shader discarded some
-    // fragments. For these primitives we are going to perform an occlusion
-    // query to see if a primitive was discarded.
-    std::map<uint32_t, rdcarray<int32_t> > discardedPrimsEvents;
-    uint32_t primitivesToCheck = 0;
-    for(size_t h = 0; h < history.size(); h++)
+    for(size_t h = 0; h < history.size();)
     {
-      uint32_t eid = history[h].eventId;
-      if(eventsWithFrags.find(eid) == eventsWithFrags.end())
+      PixelModification &mod = history[h];
+
+      int32_t eventIndex = cb.GetEventIndex(mod.eventId);
+      if(eventIndex == -1)
+      {
+        // There is no information, skip the event.
+        mod.preMod.SetInvalid();
+        mod.postMod.SetInvalid();
+        mod.shaderOut.SetInvalid();
+        h++;
         continue;
-      uint32_t f = history[h].fragIndex;
-      bool someFragsClipped = (history[h].primitiveID == 1);
-      int32_t primId = bp[perFragmentCB.GetEventOffset(eid) + f].primitiveID;
-      history[h].primitiveID = primId;
-      if(someFragsClipped)
+      }
+      const EventInfo &ei = eventsInfo[eventIndex];
+      FillInColor(fmt, ei.premod, mod.preMod);
+      FillInColor(fmt, ei.postmod, mod.postMod);
+      VkFormat depthFormat = cb.GetDepthFormat(mod.eventId);
+      if(depthFormat != VK_FORMAT_UNDEFINED)
+      {
+        mod.preMod.stencil = ei.premod.stencil;
+        mod.postMod.stencil = ei.postmod.stencil;
+        if(multisampled)
+        {
+          mod.preMod.depth = ei.premod.depth.fdepth;
+          mod.postMod.depth = ei.postmod.depth.fdepth;
+        }
+        else
+        {
+          mod.preMod.depth = GetDepthValue(depthFormat, ei.premod);
+          mod.postMod.depth = GetDepthValue(depthFormat, ei.postmod);
+        }
+      }
+
+      int32_t frags = int32_t(ei.dsWithoutShaderDiscard[4]);
+      int32_t fragsClipped = int32_t(ei.dsWithShaderDiscard[4]);
+      mod.shaderOut.col.intValue[0] = frags;
+      mod.shaderOut.col.intValue[1] = fragsClipped;
+      bool someFragsClipped = (fragsClipped < frags);
+      mod.primitiveID = someFragsClipped;
+      // Draws in secondary command buffers will fail this check,
+      // so nothing else needs to be checked in the callback itself.
+      if(frags > 0)
+      {
+        eventsWithFrags[mod.eventId] = frags;
+        eventPremods[mod.eventId] = mod.preMod;
+      }
+
+      for(int32_t f = 1; f < frags; f++)
       {
-        discardedPrimsEvents[eid].push_back(primId);
-        primitivesToCheck++;
+        history.insert(h + 1, mod);
       }
+      for(int32_t f = 0; f < frags; f++)
+        history[h + f].fragIndex = f;
+      h += RDCMAX(1, frags);
+      RDCDEBUG(
+          "PixelHistory event id: %u, fixed shader stencilValue = %u, original shader "
+          "stencilValue = %u",
+          mod.eventId, ei.dsWithoutShaderDiscard[4], ei.dsWithShaderDiscard[4]);
     }
+    m_pDriver->vkUnmapMemory(dev, resources.bufferMemory);
 
-    // without the geometry shader feature we can't get the primitive ID, so we can't establish
-    // discard per-primitive so we assume all shaders don't discard.
-    if(m_pDriver->GetDeviceEnabledFeatures().geometryShader)
+    if(eventsWithFrags.size() > 0)
     {
-      if(primitivesToCheck > 0)
+      // Replay to get shader output value, post modification value and primitive ID for every
+      // fragment.
+      VulkanPixelHistoryPerFragmentCallback perFragmentCB(m_pDriver, shaderCache, callbackInfo,
+                                                          eventsWithFrags, eventPremods);
       {
-        VkMarkerRegion discardedRegion("VulkanPixelHistoryDiscardedFragmentsCallback");
-        VkQueryPool occlPool;
-        CreateOcclusionPool(m_pDriver, primitivesToCheck, &occlPool);
-
-        // Replay to see which primitives were discarded.
-        VulkanPixelHistoryDiscardedFragmentsCallback discardedCb(
-            m_pDriver, shaderCache, callbackInfo, discardedPrimsEvents, occlPool);
+        VkMarkerRegion perFragmentRegion("VulkanPixelHistoryPerFragmentCallback");
         m_pDriver->ReplayLog(0, eventsWithFrags.rbegin()->first, eReplay_Full);
         m_pDriver->SubmitCmds();
         m_pDriver->FlushQ();
-        discardedCb.FetchOcclusionResults();
-        ObjDisp(dev)->DestroyQueryPool(Unwrap(dev), occlPool, NULL);
+      }
 
-        for(size_t h = 0; h < history.size(); h++)
-          history[h].shaderDiscarded =
-              discardedCb.PrimitiveDiscarded(history[h].eventId, history[h].primitiveID);
+      PerFragmentInfo *bp = NULL;
+      vkr = m_pDriver->vkMapMemory(dev, resources.bufferMemory, 0, VK_WHOLE_SIZE, 0, (void **)&bp);
+      CheckVkResult(vkr);
+      if(vkr == VK_SUCCESS && !bp)
+      {
+        RDCERR("Manually reporting failed memory map");
+        CheckVkResult(VK_ERROR_MEMORY_MAP_FAILED);
+        vkr = VK_ERROR_MEMORY_MAP_FAILED;
+      }
+      if(vkr != VK_SUCCESS)
+      {
+        SAFE_DELETE(tfCb);
+        break;
       }
-    }
-    else
-    {
-      // mark that we have no primitive IDs
-      for(size_t h = 0; h < history.size(); h++)
-        history[h].primitiveID = ~0U;
-    }
 
-    uint32_t discardOffset = 0;
-    ResourceFormat shaderOutFormat = MakeResourceFormat(VK_FORMAT_R32G32B32A32_SFLOAT);
-    for(size_t h = 0; h < history.size(); h++)
-    {
-      uint32_t eid = history[h].eventId;
-      uint32_t f = history[h].fragIndex;
-      // Reset discard offset if this is a new event.
-      if(h > 0 && (eid != history[h - 1].eventId))
-        discardOffset = 0;
-      if(eventsWithFrags.find(eid) != eventsWithFrags.end())
+      // Retrieve primitive ID values where fragment shader discarded some
+      // fragments. For these primitives we are going to perform an occlusion
+      // query to see if a primitive was discarded.
+      std::map<uint32_t, rdcarray<int32_t> > discardedPrimsEvents;
+      uint32_t primitivesToCheck = 0;
+      for(size_t h = 0; h < history.size(); h++)
       {
-        if(history[h].shaderDiscarded)
-        {
-          discardOffset++;
-          // Copy previous post-mod value if its not the first event
-          if(h > 0)
-            history[h].postMod = history[h - 1].postMod;
+        uint32_t eid = history[h].eventId;
+        if(eventsWithFrags.find(eid) == eventsWithFrags.end())
           continue;
-        }
-        uint32_t offset = perFragmentCB.GetEventOffset(eid) + f - discardOffset;
-        FillInColor(shaderOutFormat, bp[offset].shaderOut, history[h].shaderOut);
-        history[h].shaderOut.depth = bp[offset].shaderOut.depth.fdepth;
-
-        if((h < history.size() - 1) && (history[h].eventId == history[h + 1].eventId))
+        uint32_t f = history[h].fragIndex;
+        bool someFragsClipped = (history[h].primitiveID == 1);
+        int32_t primId = bp[perFragmentCB.GetEventOffset(eid) + f].primitiveID;
+        history[h].primitiveID = primId;
+        if(someFragsClipped)
         {
-          // Get post-modification value if this is not the last fragment for the event.
-          FillInColor(fmt, bp[offset].postMod, history[h].postMod);
-          // MSAA depth is expanded out to floats in the compute shader
-          if((uint32_t)callbackInfo.samples > 1)
-            history[h].postMod.depth = bp[offset].postMod.depth.fdepth;
-          else
-            history[h].postMod.depth = GetDepthValue(cb.GetDepthFormat(eid), bp[offset].postMod);
+          discardedPrimsEvents[eid].push_back(primId);
+          primitivesToCheck++;
         }
-        // If it is not the first fragment for the event, set the preMod to the
-        // postMod of the previous fragment.
-        if(h > 0 && (history[h].eventId == history[h - 1].eventId))
+      }
+
+      // without the geometry shader feature we can't get the primitive ID, so we can't establish
+      // discard per-primitive so we assume all shaders don't discard.
+      if(m_pDriver->GetDeviceEnabledFeatures().geometryShader)
+      {
+        if(primitivesToCheck > 0)
         {
-          history[h].preMod = history[h - 1].postMod;
+          VkMarkerRegion discardedRegion("VulkanPixelHistoryDiscardedFragmentsCallback");
+          VkQueryPool occlPool;
+          CreateOcclusionPool(m_pDriver, primitivesToCheck, &occlPool);
+
+          // Replay to see which primitives were discarded.
+          VulkanPixelHistoryDiscardedFragmentsCallback discardedCb(
+              m_pDriver, shaderCache, callbackInfo, discardedPrimsEvents, occlPool);
+          m_pDriver->ReplayLog(0, eventsWithFrags.rbegin()->first, eReplay_Full);
+          m_pDriver->SubmitCmds();
+          m_pDriver->FlushQ();
+          discardedCb.FetchOcclusionResults();
+          ObjDisp(dev)->DestroyQueryPool(Unwrap(dev), occlPool, NULL);
+
+          for(size_t h = 0; h < history.size(); h++)
+            history[h].shaderDiscarded =
+                discardedCb.PrimitiveDiscarded(history[h].eventId, history[h].primitiveID);
         }
       }
-
-      // check the depth value between premod/shaderout against the known test if we have valid
-      // depth values, as we don't have per-fragment depth test information.
-      if(history[h].preMod.depth >= 0.0f && history[h].shaderOut.depth >= 0.0f && tfCb &&
-         tfCb->HasEventFlags(history[h].eventId))
+      else
       {
-        uint32_t flags = tfCb->GetEventFlags(history[h].eventId);
-
-        flags &= 0x7 << DepthTest_Shift;
-
-        VkFormat dfmt = cb.GetDepthFormat(eid);
-        float shadDepth = history[h].shaderOut.depth;
+        // mark that we have no primitive IDs
+        for(size_t h = 0; h < history.size(); h++)
+          history[h].primitiveID = ~0U;
+      }
 
-        // quantise depth to match before comparing
-        if(dfmt == VK_FORMAT_D24_UNORM_S8_UINT || dfmt == VK_FORMAT_X8_D24_UNORM_PACK32)
+      uint32_t discardOffset = 0;
+      ResourceFormat shaderOutFormat = MakeResourceFormat(VK_FORMAT_R32G32B32A32_SFLOAT);
+      for(size_t h = 0; h < history.size(); h++)
+      {
+        uint32_t eid = history[h].eventId;
+        uint32_t f = history[h].fragIndex;
+        // Reset discard offset if this is a new event.
+        if(h > 0 && (eid != history[h - 1].eventId))
+          discardOffset = 0;
+        if(eventsWithFrags.find(eid) != eventsWithFrags.end())
         {
-          shadDepth = float(uint32_t(float(shadDepth * 0xffffff))) / float(0xffffff);
+          if(history[h].shaderDiscarded)
+          {
+            discardOffset++;
+            // Copy previous post-mod value if its not the first event
+            if(h > 0)
+              history[h].postMod = history[h - 1].postMod;
+            continue;
+          }
+          uint32_t offset = perFragmentCB.GetEventOffset(eid) + f - discardOffset;
+          FillInColor(shaderOutFormat, bp[offset].shaderOut, history[h].shaderOut);
+          history[h].shaderOut.depth = bp[offset].shaderOut.depth.fdepth;
+
+          if((h < history.size() - 1) && (history[h].eventId == history[h + 1].eventId))
+          {
+            // Get post-modification value if this is not the last fragment for the event.
+            FillInColor(fmt, bp[offset].postMod, history[h].postMod);
+            // MSAA depth is expanded out to floats in the compute shader
+            if((uint32_t)callbackInfo.samples > 1)
+              history[h].postMod.depth = bp[offset].postMod.depth.fdepth;
+            else
+              history[h].postMod.depth = GetDepthValue(cb.GetDepthFormat(eid), bp[offset].postMod);
+          }
+          // If it is not the first fragment for the event, set the preMod to the
+          // postMod of the previous fragment.
+          if(h > 0 && (history[h].eventId == history[h - 1].eventId))
+          {
+            history[h].preMod = history[h - 1].postMod;
+          }
         }
-        else if(dfmt == VK_FORMAT_D16_UNORM || dfmt == VK_FORMAT_D16_UNORM_S8_UINT)
+
+        // check the depth value between premod/shaderout against the known test if we have valid
+        // depth values, as we don't have per-fragment depth test information.
+        if(history[h].preMod.depth >= 0.0f && history[h].shaderOut.depth >= 0.0f && tfCb &&
+           tfCb->HasEventFlags(history[h].eventId))
         {
-          shadDepth = float(uint32_t(float(shadDepth * 0xffff))) / float(0xffff);
-        }
+          uint32_t flags = tfCb->GetEventFlags(history[h].eventId);
+
+          flags &= 0x7 << DepthTest_Shift;
 
-        bool passed = true;
-        if(flags == DepthTest_Equal)
-          passed = (shadDepth == history[h].preMod.depth);
-        else if(flags == DepthTest_NotEqual)
-          passed = (shadDepth != history[h].preMod.depth);
-        else if(flags == DepthTest_Less)
-          passed = (shadDepth < history[h].preMod.depth);
-        else if(flags == DepthTest_LessEqual)
-          passed = (shadDepth <= history[h].preMod.depth);
-        else if(flags == DepthTest_Greater)
-          passed = (shadDepth > history[h].preMod.depth);
-        else if(flags == DepthTest_GreaterEqual)
-          passed = (shadDepth >= history[h].preMod.depth);
-
-        if(!passed)
-          history[h].depthTestFailed = true;
+          VkFormat dfmt = cb.GetDepthFormat(eid);
+          float shadDepth = history[h].shaderOut.depth;
+
+          // quantise depth to match before comparing
+          if(dfmt == VK_FORMAT_D24_UNORM_S8_UINT || dfmt == VK_FORMAT_X8_D24_UNORM_PACK32)
+          {
+            shadDepth = float(uint32_t(float(shadDepth * 0xffffff))) / float(0xffffff);
+          }
+          else if(dfmt == VK_FORMAT_D16_UNORM || dfmt == VK_FORMAT_D16_UNORM_S8_UINT)
+          {
+            shadDepth = float(uint32_t(float(shadDepth * 0xffff))) / float(0xffff);
+          }
+
+          bool passed = true;
+          if(flags == DepthTest_Equal)
+            passed = (shadDepth == history[h].preMod.depth);
+          else if(flags == DepthTest_NotEqual)
+            passed = (shadDepth != history[h].preMod.depth);
+          else if(flags == DepthTest_Less)
+            passed = (shadDepth < history[h].preMod.depth);
+          else if(flags == DepthTest_LessEqual)
+            passed = (shadDepth <= history[h].preMod.depth);
+          else if(flags == DepthTest_Greater)
+            passed = (shadDepth > history[h].preMod.depth);
+          else if(flags == DepthTest_GreaterEqual)
+            passed = (shadDepth >= history[h].preMod.depth);
+
+          if(!passed)
+            history[h].depthTestFailed = true;
+        }
       }
     }
-  }
 
-  SAFE_DELETE(tfCb);
+    SAFE_DELETE(tfCb);
+  }
 
   GetDebugManager()->PixelHistoryDestroyResources(resources);
-  ObjDisp(dev)->DestroyQueryPool(Unwrap(dev), occlusionPool, NULL);
   delete shaderCache;
 
-  return history;
+  return results;
 }
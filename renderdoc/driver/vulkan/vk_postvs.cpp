@@ -35,6 +35,9 @@
 
 RDOC_CONFIG(rdcstr, Vulkan_Debug_PostVSDumpDirPath, "",
             "Path to dump gnerated SPIR-V compute shaders for fetching post-vs.");
+RDOC_CONFIG(bool, Vulkan_PostVSBatchReadback, true,
+            "When fetching vertex outputs for a whole pass, keep each event's readback in flight "
+            "and unpack it while later events are processed, instead of waiting on every event.");
 RDOC_EXTERN_CONFIG(bool, Vulkan_Debug_DisableBufferDeviceAddress);
 
 #undef None
@@ -2717,120 +2720,42 @@ void VulkanReplay::FetchVSOut(uint32_t eventId, VulkanRenderState &state)
     vkr = ObjDisp(dev)->EndCommandBuffer(Unwrap(cmd));
     CheckVkResult(vkr);
 
-    // submit & flush so that we don't have to keep pipeline around for a while
     m_pDriver->SubmitCmds();
-    m_pDriver->FlushQ();
-  }
 
-  for(CompactedAttrBuffer attrBuf : vbuffers)
-  {
-    m_pDriver->vkDestroyBuffer(dev, attrBuf.buf, NULL);
-    m_pDriver->vkFreeMemory(dev, attrBuf.mem, NULL);
+    // submit & flush so that we don't have to keep pipeline around for a while. When batching a
+    // whole pass, leave the work in flight and read it back once it's done.
+    if(!m_PostVS.Batching)
+      m_pDriver->FlushQ();
   }
 
-  // readback mesh data
-  byte *byteData = NULL;
-  vkr = m_pDriver->vkMapMemory(m_Device, readbackMem, 0, VK_WHOLE_SIZE, 0, (void **)&byteData);
-  CheckVkResult(vkr);
-  if(vkr != VK_SUCCESS || !byteData)
-  {
-    if(!byteData)
-    {
-      RDCERR("Manually reporting failed memory map");
-      CheckVkResult(VK_ERROR_MEMORY_MAP_FAILED);
-    }
-    ret.vsout.status = "Couldn't read back vertex output data from GPU";
-    return;
-  }
-
-  VkMappedMemoryRange range = {
-      VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE, NULL, readbackMem, 0, VK_WHOLE_SIZE,
-  };
-
-  vkr = m_pDriver->vkInvalidateMappedMemoryRanges(m_Device, 1, &range);
-  CheckVkResult(vkr);
-
-  // do near/far calculations
-
-  float nearp = 0.1f;
-  float farp = 100.0f;
-
-  Vec4f *pos0 = (Vec4f *)byteData;
-
-  bool found = false;
-
-  // expect position at the start of the buffer, as system values are sorted first
-  // and position is the first value
-
-  for(uint32_t i = 1;
-      refl->outputSignature[0].systemValue == ShaderBuiltin::Position && i < numVerts; i++)
-  {
-    //////////////////////////////////////////////////////////////////////////////////
-    // derive near/far, assuming a standard perspective matrix
-    //
-    // the transformation from from pre-projection {Z,W} to post-projection {Z,W}
-    // is linear. So we can say Zpost = Zpre*m + c . Here we assume Wpre = 1
-    // and we know Wpost = Zpre from the perspective matrix.
-    // we can then see from the perspective matrix that
-    // m = F/(F-N)
-    // c = -(F*N)/(F-N)
-    //
-    // with re-arranging and substitution, we then get:
-    // N = -c/m
-    // F = c/(1-m)
-    //
-    // so if we can derive m and c then we can determine N and F. We can do this with
-    // two points, and we pick them reasonably distinct on z to reduce floating-point
-    // error
-
-    Vec4f *pos = (Vec4f *)(byteData + i * bufStride);
-
-    // skip invalid vertices (w=0)
-    if(pos->w != 0.0f && fabs(pos->w - pos0->w) > 0.01f && fabs(pos->z - pos0->z) > 0.01f)
-    {
-      Vec2f A(pos0->w, pos0->z);
-      Vec2f B(pos->w, pos->z);
-
-      float m = (B.y - A.y) / (B.x - A.x);
-      float c = B.y - B.x * m;
-
-      if(m == 1.0f || c == 0.0f)
-        continue;
-
-      if(-c / m <= 0.000001f)
-        continue;
-
-      nearp = -c / m;
-      farp = c / (1 - m);
-
-      found = true;
+  VulkanReplay::PostVS::Readback readback;
+  readback.eventId = eventId;
+  readback.readbackBuffer = readbackBuffer;
+  readback.readbackMem = readbackMem;
+  readback.numVerts = numVerts;
+  readback.stride = bufStride;
+  readback.hasPosOut = refl->outputSignature[0].systemValue == ShaderBuiltin::Position;
 
-      break;
-    }
-  }
-
-  // if we didn't find anything, all z's and w's were identical.
-  // If the z is positive and w greater for the first element then
-  // we detect this projection as reversed z with infinite far plane
-  if(!found && pos0->z > 0.0f && pos0->w > pos0->z)
+  for(CompactedAttrBuffer attrBuf : vbuffers)
   {
-    nearp = pos0->z;
-    farp = FLT_MAX;
+    readback.tempBuffers.push_back(attrBuf.buf);
+    readback.tempMems.push_back(attrBuf.mem);
   }
 
-  m_pDriver->vkUnmapMemory(m_Device, readbackMem);
-
-  // clean up temporary memories
-  m_pDriver->vkDestroyBuffer(m_Device, readbackBuffer, NULL);
-  m_pDriver->vkFreeMemory(m_Device, readbackMem, NULL);
-
   if(uniqIdxBuf != VK_NULL_HANDLE)
   {
-    m_pDriver->vkDestroyBuffer(m_Device, uniqIdxBuf, NULL);
-    m_pDriver->vkFreeMemory(m_Device, uniqIdxBufMem, NULL);
+    readback.tempBuffers.push_back(uniqIdxBuf);
+    readback.tempMems.push_back(uniqIdxBufMem);
   }
 
-  // fill out m_PostVS.Data
+  readback.descpool = descpool;
+  readback.descSets = descSets;
+  readback.setLayouts = setLayouts;
+  readback.pipeLayout = pipeLayout;
+  readback.pipe = pipe;
+  readback.module = module;
+
+  // fill out m_PostVS.Data. The near and far planes are filled in from the readback
   ret.vsin.topo = state.primitiveTopology;
   ret.vsout.topo = state.primitiveTopology;
   ret.vsout.buf = meshBuffer;
@@ -2841,8 +2766,6 @@ void VulkanReplay::FetchVSOut(uint32_t eventId, VulkanRenderState &state)
   ret.vsout.numViews = numViews;
 
   ret.vsout.vertStride = bufStride;
-  ret.vsout.nearPlane = nearp;
-  ret.vsout.farPlane = farp;
 
   ret.vsout.useIndices = bool(action->flags & ActionFlags::Indexed);
   ret.vsout.numVerts = action->numIndices;
@@ -2865,29 +2788,200 @@ void VulkanReplay::FetchVSOut(uint32_t eventId, VulkanRenderState &state)
     ret.vsout.idxFmt = type;
   }
 
-  ret.vsout.hasPosOut = refl->outputSignature[0].systemValue == ShaderBuiltin::Position;
+  ret.vsout.hasPosOut = readback.hasPosOut;
   ret.vsout.flipY = state.views.empty() ? false : state.views[0].height < 0.0f;
 
-  if(descpool != VK_NULL_HANDLE)
+  if(m_PostVS.Batching)
   {
-    // delete descriptors. Technically we don't have to free the descriptor sets, but our tracking
-    // on replay doesn't handle destroying children of pooled objects so we do it explicitly anyway.
-    m_pDriver->vkFreeDescriptorSets(dev, descpool, (uint32_t)descSets.size(), descSets.data());
+    if(!m_PostVS.FreeFences.empty())
+    {
+      readback.fence = m_PostVS.FreeFences.back();
+      m_PostVS.FreeFences.pop_back();
+    }
+    else
+    {
+      VkFenceCreateInfo fenceInfo = {VK_STRUCTURE_TYPE_FENCE_CREATE_INFO};
+      vkr = ObjDisp(dev)->CreateFence(Unwrap(dev), &fenceInfo, NULL, &readback.fence);
+      CheckVkResult(vkr);
+    }
 
-    m_pDriver->vkDestroyDescriptorPool(dev, descpool, NULL);
+    // an empty submit signals the fence once everything submitted so far has completed
+    VkQueue q = m_pDriver->GetQ();
+    vkr = ObjDisp(q)->QueueSubmit(Unwrap(q), 0, NULL, readback.fence);
+    CheckVkResult(vkr);
 
-    for(VkDescriptorSetLayout layout : setLayouts)
-      m_pDriver->vkDestroyDescriptorSetLayout(dev, layout, NULL);
+    m_PostVS.Pending.push_back(readback);
+
+    // unpack any earlier events that finished while this one was being set up
+    ResolvePostVSReadbacks(false);
+    return;
   }
 
-  // delete pipeline layout
-  m_pDriver->vkDestroyPipelineLayout(dev, pipeLayout, NULL);
+  m_PostVS.Pending.push_back(readback);
+  ResolvePostVSReadbacks(true);
+}
 
-  // delete pipeline
-  m_pDriver->vkDestroyPipeline(dev, pipe, NULL);
+void VulkanReplay::ResolvePostVSReadbacks(bool wait)
+{
+  VkDevice dev = m_Device;
+  VkResult vkr = VK_SUCCESS;
 
-  // delete shader/shader module
-  m_pDriver->vkDestroyShaderModule(dev, module, NULL);
+  size_t resolved = 0;
+
+  // the queue completes in order, so stop at the first readback that isn't finished yet
+  for(; resolved < m_PostVS.Pending.size(); resolved++)
+  {
+    VulkanReplay::PostVS::Readback &readback = m_PostVS.Pending[resolved];
+
+    if(readback.fence != VK_NULL_HANDLE)
+    {
+      if(wait)
+        vkr = ObjDisp(dev)->WaitForFences(Unwrap(dev), 1, &readback.fence, VK_TRUE, UINT64_MAX);
+      else
+        vkr = ObjDisp(dev)->GetFenceStatus(Unwrap(dev), readback.fence);
+
+      if(vkr == VK_NOT_READY)
+        break;
+      CheckVkResult(vkr);
+
+      vkr = ObjDisp(dev)->ResetFences(Unwrap(dev), 1, &readback.fence);
+      CheckVkResult(vkr);
+
+      m_PostVS.FreeFences.push_back(readback.fence);
+    }
+
+    VulkanPostVSData &ret = m_PostVS.Data[readback.eventId];
+
+    // readback mesh data
+    byte *byteData = NULL;
+    vkr = m_pDriver->vkMapMemory(m_Device, readback.readbackMem, 0, VK_WHOLE_SIZE, 0,
+                                 (void **)&byteData);
+    CheckVkResult(vkr);
+    if(vkr != VK_SUCCESS || !byteData)
+    {
+      if(!byteData)
+      {
+        RDCERR("Manually reporting failed memory map");
+        CheckVkResult(VK_ERROR_MEMORY_MAP_FAILED);
+      }
+      ret.vsout.status = "Couldn't read back vertex output data from GPU";
+    }
+    else
+    {
+      VkMappedMemoryRange range = {
+          VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE, NULL, readback.readbackMem, 0, VK_WHOLE_SIZE,
+      };
+
+      vkr = m_pDriver->vkInvalidateMappedMemoryRanges(m_Device, 1, &range);
+      CheckVkResult(vkr);
+
+      // do near/far calculations
+
+      float nearp = 0.1f;
+      float farp = 100.0f;
+
+      Vec4f *pos0 = (Vec4f *)byteData;
+
+      bool found = false;
+
+      // expect position at the start of the buffer, as system values are sorted first
+      // and position is the first value
+
+      for(uint32_t i = 1; readback.hasPosOut && i < readback.numVerts; i++)
+      {
+        //////////////////////////////////////////////////////////////////////////////////
+        // derive near/far, assuming a standard perspective matrix
+        //
+        // the transformation from from pre-projection {Z,W} to post-projection {Z,W}
+        // is linear. So we can say Zpost = Zpre*m + c . Here we assume Wpre = 1
+        // and we know Wpost = Zpre from the perspective matrix.
+        // we can then see from the perspective matrix that
+        // m = F/(F-N)
+        // c = -(F*N)/(F-N)
+        //
+        // with re-arranging and substitution, we then get:
+        // N = -c/m
+        // F = c/(1-m)
+        //
+        // so if we can derive m and c then we can determine N and F. We can do this with
+        // two points, and we pick them reasonably distinct on z to reduce floating-point
+        // error
+
+        Vec4f *pos = (Vec4f *)(byteData + i * readback.stride);
+
+        // skip invalid vertices (w=0)
+        if(pos->w != 0.0f && fabs(pos->w - pos0->w) > 0.01f && fabs(pos->z - pos0->z) > 0.01f)
+        {
+          Vec2f A(pos0->w, pos0->z);
+          Vec2f B(pos->w, pos->z);
+
+          float m = (B.y - A.y) / (B.x - A.x);
+          float c = B.y - B.x * m;
+
+          if(m == 1.0f || c == 0.0f)
+            continue;
+
+          if(-c / m <= 0.000001f)
+            continue;
+
+          nearp = -c / m;
+          farp = c / (1 - m);
+
+          found = true;
+
+          break;
+        }
+      }
+
+      // if we didn't find anything, all z's and w's were identical.
+      // If the z is positive and w greater for the first element then
+      // we detect this projection as reversed z with infinite far plane
+      if(!found && pos0->z > 0.0f && pos0->w > pos0->z)
+      {
+        nearp = pos0->z;
+        farp = FLT_MAX;
+      }
+
+      m_pDriver->vkUnmapMemory(m_Device, readback.readbackMem);
+
+      ret.vsout.nearPlane = nearp;
+      ret.vsout.farPlane = farp;
+    }
+
+    // clean up temporary memories
+    m_pDriver->vkDestroyBuffer(m_Device, readback.readbackBuffer, NULL);
+    m_pDriver->vkFreeMemory(m_Device, readback.readbackMem, NULL);
+
+    for(VkBuffer buf : readback.tempBuffers)
+      m_pDriver->vkDestroyBuffer(dev, buf, NULL);
+    for(VkDeviceMemory mem : readback.tempMems)
+      m_pDriver->vkFreeMemory(dev, mem, NULL);
+
+    if(readback.descpool != VK_NULL_HANDLE)
+    {
+      // delete descriptors. Technically we don't have to free the descriptor sets, but our
+      // tracking on replay doesn't handle destroying children of pooled objects so we do it
+      // explicitly anyway.
+      m_pDriver->vkFreeDescriptorSets(dev, readback.descpool, (uint32_t)readback.descSets.size(),
+                                      readback.descSets.data());
+
+      m_pDriver->vkDestroyDescriptorPool(dev, readback.descpool, NULL);
+
+      for(VkDescriptorSetLayout layout : readback.setLayouts)
+        m_pDriver->vkDestroyDescriptorSetLayout(dev, layout, NULL);
+    }
+
+    // delete pipeline layout
+    m_pDriver->vkDestroyPipelineLayout(dev, readback.pipeLayout, NULL);
+
+    // delete pipeline
+    m_pDriver->vkDestroyPipeline(dev, readback.pipe, NULL);
+
+    // delete shader/shader module
+    m_pDriver->vkDestroyShaderModule(dev, readback.module, NULL);
+  }
+
+  m_PostVS.Pending.erase(0, resolved);
 }
 
 void VulkanReplay::FetchTessGSOut(uint32_t eventId, VulkanRenderState &state)
@@ -3575,12 +3669,20 @@ void VulkanReplay::InitPostVSBuffers(const rdcarray<uint32_t> &events)
   // command buffer
   m_pDriver->ReplayLog(0, events[first], eReplay_WithoutDraw);
 
-  VulkanInitPostVSCallback cb(m_pDriver, events);
+  m_PostVS.Batching = Vulkan_PostVSBatchReadback();
+
+  {
+    VulkanInitPostVSCallback cb(m_pDriver, events);
+
+    // now we replay the events, which are guaranteed (because we generated them in
+    // GetPassEvents above) to come from the same command buffer, so the event IDs are
+    // still locally continuous, even if we jump into replaying.
+    m_pDriver->ReplayLog(events[first], events.back(), eReplay_Full);
+  }
 
-  // now we replay the events, which are guaranteed (because we generated them in
-  // GetPassEvents above) to come from the same command buffer, so the event IDs are
-  // still locally continuous, even if we jump into replaying.
-  m_pDriver->ReplayLog(events[first], events.back(), eReplay_Full);
+  // unpack whatever is still in flight
+  ResolvePostVSReadbacks(true);
+  m_PostVS.Batching = false;
 }
 
 MeshFormat VulkanReplay::GetPostVSBuffers(uint32_t eventId, uint32_t instID, uint32_t viewID,
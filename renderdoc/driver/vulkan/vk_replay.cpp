@@ -226,7 +226,7 @@ RDResult VulkanReplay::ReadLogInitialisation(RDCFile *rdc, bool storeStructuredB
 
 void VulkanReplay::ReplayLog(uint32_t endEventID, ReplayLogType replayType)
 {
-  m_pDriver->ReplayLog(0, endEventID, replayType);
+  m_pDriver->ReplayLogWithCheckpoints(endEventID, replayType);
 }
 
 SDFile *VulkanReplay::GetStructuredFile()
@@ -1851,6 +1851,9 @@ void VulkanReplay::SavePipelineState(uint32_t eventId)
   ret.graphics.descriptorSets.resize(state.graphics.descSets.size());
   ret.compute.descriptorSets.resize(state.compute.descSets.size());
 
+  m_FetchedDescriptorSets[0].resize(state.graphics.descSets.size());
+  m_FetchedDescriptorSets[1].resize(state.compute.descSets.size());
+
   {
     rdcarray<VKPipe::DescriptorSet> *dsts[] = {
         &ret.graphics.descriptorSets, &ret.compute.descriptorSets,
@@ -1914,12 +1917,33 @@ void VulkanReplay::SavePipelineState(uint32_t eventId)
           continue;
         }
 
-        dst.inlineData = m_pDriver->m_DescriptorSetState[src].data.inlineBytes;
+        const BindingStorage &srcData = m_pDriver->m_DescriptorSetState[src].data;
 
         curBind.bindset = (uint32_t)i;
 
         ResourceId layoutId = m_pDriver->m_DescriptorSetState[src].layout;
 
+        // which of the used binds belong to this set, to check if the set's usage changed
+        rdcarray<BindpointIndex> setUsedBinds;
+        for(size_t u = 0; u < usedBindsSize; u++)
+          if(usedBindsData[u].bindset == (int32_t)i)
+            setUsedBinds.push_back(usedBindsData[u]);
+
+        // if the set and everything about how it's used is the same as the last fetch, reuse that
+        FetchedDescriptorSet &prev = m_FetchedDescriptorSets[p][i];
+        if(prev.set == src && prev.layout == layoutId &&
+           prev.variableDescriptorCount == srcData.variableDescriptorCount &&
+           prev.offsets == (*srcs[p])[i].offsets && prev.hasUsedBinds == hasUsedBinds &&
+           prev.usedBinds == setUsedBinds && prev.inlineBytes == srcData.inlineBytes &&
+           prev.slots.size() == srcData.elements().size() &&
+           memcmp(prev.slots.data(), srcData.elements().data(), prev.slots.byteSize()) == 0)
+        {
+          dst = prev.fetched;
+          continue;
+        }
+
+        dst.inlineData = srcData.inlineBytes;
+
         // push descriptors don't have a real descriptor set backing them
         if(c.m_DescSetLayout[layoutId].flags & VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR)
         {
@@ -2218,6 +2242,16 @@ void VulkanReplay::SavePipelineState(uint32_t eventId)
             dst.bindings[b].lastUsedIndex = 0x7fffffff;
           }
         }
+
+        prev.set = src;
+        prev.layout = layoutId;
+        prev.slots = srcData.elements();
+        prev.inlineBytes = srcData.inlineBytes;
+        prev.variableDescriptorCount = srcData.variableDescriptorCount;
+        prev.offsets = (*srcs[p])[i].offsets;
+        prev.hasUsedBinds = hasUsedBinds;
+        prev.usedBinds.swap(setUsedBinds);
+        prev.fetched = dst;
       }
     }
   }
@@ -4358,6 +4392,7 @@ void VulkanReplay::ReplaceResource(ResourceId from, ResourceId to)
 
   ClearPostVSCache();
   ClearFeedbackCache();
+  m_PixelHistoryOcclusion.clear();
 }
 
 void VulkanReplay::RemoveReplacement(ResourceId id)
@@ -4370,6 +4405,7 @@ void VulkanReplay::RemoveReplacement(ResourceId id)
 
     ClearPostVSCache();
     ClearFeedbackCache();
+    m_PixelHistoryOcclusion.clear();
   }
 }
 
@@ -4377,6 +4413,9 @@ void VulkanReplay::RefreshDerivedReplacements()
 {
   VkDevice dev = m_pDriver->GetDev();
 
+  // checkpoints hold the results of the replaced resources, so they are now out of date
+  m_pDriver->ClearReplayCheckpoints();
+
   VulkanResourceManager *rm = m_pDriver->GetResourceManager();
 
   // we defer deletes of old replaced resources since it will invalidate elements in the vector
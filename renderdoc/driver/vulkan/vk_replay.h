@@ -399,6 +399,10 @@ public:
 
   rdcarray<PixelModification> PixelHistory(rdcarray<EventUsage> events, ResourceId target, uint32_t x,
                                            uint32_t y, const Subresource &sub, CompType typeCast);
+  rdcarray<PixelHistoryResult> PixelHistoryRegion(rdcarray<EventUsage> events, ResourceId target,
+                                                  uint32_t x, uint32_t y, uint32_t width,
+                                                  uint32_t height, const Subresource &sub,
+                                                  CompType typeCast);
   ShaderDebugTrace *DebugVertex(uint32_t eventId, uint32_t vertid, uint32_t instid, uint32_t idx,
                                 uint32_t view);
   ShaderDebugTrace *DebugPixel(uint32_t eventId, uint32_t x, uint32_t y, uint32_t sample,
@@ -458,6 +462,7 @@ private:
 
   void FetchVSOut(uint32_t eventId, VulkanRenderState &state);
   void FetchTessGSOut(uint32_t eventId, VulkanRenderState &state);
+  void ResolvePostVSReadbacks(bool wait);
   void ClearPostVSCache();
 
   void RefreshDerivedReplacements();
@@ -744,6 +749,34 @@ private:
 
     std::map<uint32_t, VulkanPostVSData> Data;
     std::map<uint32_t, uint32_t> Alias;
+
+    // a vertex output fetch whose GPU work has been submitted but not yet read back. Everything
+    // the dispatch uses is kept alive until the fence signals and the data has been unpacked.
+    struct Readback
+    {
+      uint32_t eventId = 0;
+      VkFence fence = VK_NULL_HANDLE;
+
+      VkBuffer readbackBuffer = VK_NULL_HANDLE;
+      VkDeviceMemory readbackMem = VK_NULL_HANDLE;
+      uint32_t numVerts = 0;
+      uint32_t stride = 0;
+      bool hasPosOut = false;
+
+      rdcarray<VkBuffer> tempBuffers;
+      rdcarray<VkDeviceMemory> tempMems;
+      VkDescriptorPool descpool = VK_NULL_HANDLE;
+      rdcarray<VkDescriptorSet> descSets;
+      rdcarray<VkDescriptorSetLayout> setLayouts;
+      VkPipelineLayout pipeLayout = VK_NULL_HANDLE;
+      VkPipeline pipe = VK_NULL_HANDLE;
+      VkShaderModule module = VK_NULL_HANDLE;
+    };
+
+    // set while fetching a whole pass, so readbacks are deferred instead of flushed per event
+    bool Batching = false;
+    rdcarray<Readback> Pending;
+    rdcarray<VkFence> FreeFences;
   } m_PostVS;
 
   struct Feedback
@@ -755,6 +788,34 @@ private:
     std::map<uint32_t, VKDynamicShaderFeedback> Usage;
   } m_BindlessFeedback;
 
+  // pixel history occlusion results for recently queried pixels, by event. Each result only
+  // depends on that draw, so later queries on the same pixel only need to test new events.
+  struct PixelHistoryOcclusion
+  {
+    ResourceId target;
+    Subresource sub;
+    uint32_t x = 0, y = 0;
+    std::map<uint32_t, uint64_t> results;
+  };
+  rdcarray<PixelHistoryOcclusion> m_PixelHistoryOcclusion;
+
+  // the descriptor sets bound at the last pipeline state fetch, and what was fetched for them, so
+  // a set whose contents haven't changed doesn't need to be fetched again. Indexed by graphics and
+  // compute, then by set index.
+  struct FetchedDescriptorSet
+  {
+    ResourceId set;
+    ResourceId layout;
+    rdcarray<DescriptorSetSlot> slots;
+    bytebuf inlineBytes;
+    uint32_t variableDescriptorCount = 0;
+    rdcarray<uint32_t> offsets;
+    bool hasUsedBinds = false;
+    rdcarray<BindpointIndex> usedBinds;
+    VKPipe::DescriptorSet fetched;
+  };
+  rdcarray<FetchedDescriptorSet> m_FetchedDescriptorSets[2];
+
   ShaderDebugData m_ShaderDebugData;
 
   rdcarray<ResourceDescription> m_Resources;
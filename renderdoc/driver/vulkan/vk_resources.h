@@ -1010,7 +1010,8 @@ struct ResourceInfo
 
 struct MemRefs
 {
-  Intervals<FrameRefType> rangeRefs;
+  // large allocations can have many thousands of separately referenced sub-allocations
+  BTreeIntervals<FrameRefType> rangeRefs;
   WrappedVkRes *initializedLiveRes;
   inline MemRefs() : initializedLiveRes(NULL) {}
   inline MemRefs(VkDeviceSize offset, VkDeviceSize size, FrameRefType refType)
@@ -1109,7 +1109,8 @@ bool WrappedVulkan::Serialise_vkBeginCommandBuffer(SerialiserType &ser, VkComman
             partial = true;
             partialType = p;
           }
-          else if(it->baseEvent <= m_LastEventID)
+          else if(it->baseEvent <= m_LastEventID &&
+                  it->baseEvent + length >= m_ReplayCheckpointEvent)
           {
 #if ENABLED(VERBOSE_PARTIAL_REPLAY)
             RDCDEBUG("vkBegin - full re-record detected %u < %u <= %u, %s -> %s", it->baseEvent,
@@ -1117,7 +1118,8 @@ bool WrappedVulkan::Serialise_vkBeginCommandBuffer(SerialiserType &ser, VkComman
                      ToStr(BakedCommandBuffer).c_str());
 #endif
 
-            // this submission is completely within the range, so it should still be re-recorded
+            // this submission is completely within the range, so it should still be re-recorded.
+            // Submissions entirely before a restored replay checkpoint are never executed.
             rerecord = true;
           }
         }
@@ -876,6 +876,8 @@ void WrappedVulkan::Shutdown()
 
   m_PersistentEvents.clear();
 
+  ClearReplayCheckpoints();
+
   // since we didn't create proper registered resources for our command buffers,
   // they won't be taken down properly with the pool. So we release them (just our
   // data) here.
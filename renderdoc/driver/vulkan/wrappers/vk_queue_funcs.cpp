@@ -394,8 +394,16 @@ void WrappedVulkan::ReplayQueueSubmit(VkQueue queue, VkSubmitInfo2 submitInfo, r
       RDCDEBUG("Queue Submit no replay %u == %u", m_LastEventID, startEID);
 #endif
     }
+    else if(startEID < m_ReplayCheckpointEvent)
+    {
+      // the results of this submission are already in the replay checkpoint that was restored
+    }
     else
     {
+      // snapshot the state before this submission executes, including its image state updates
+      if(m_UseReplayCheckpoints && m_ReplayCheckpointSchedule.WantCheckpoint(startEID))
+        CreateReplayCheckpoint(startEID);
+
 #if ENABLED(VERBOSE_PARTIAL_REPLAY)
       RDCDEBUG("Queue Submit from re-recorded commands, root EID %u last EID", m_RootEventID,
                m_LastEventID);
@@ -891,7 +891,11 @@ bool WrappedVulkan::Serialise_vkUnmapMemory(SerialiserType &ser, VkDevice device
 
   bool directStream = true;
 
-  if(IsReplayingAndReading() && memory != VK_NULL_HANDLE)
+  // writes before a restored replay checkpoint are already in its copy of the memory, so the data
+  // is skipped
+  bool beforeCheckpoint = IsActiveReplaying(m_State) && m_RootEventID < m_ReplayCheckpointEvent;
+
+  if(IsReplayingAndReading() && memory != VK_NULL_HANDLE && !beforeCheckpoint)
   {
     if(IsLoading(m_State))
       m_ResourceUses[GetResID(memory)].push_back(EventUsage(m_RootEventID, ResourceUsage::CPUWrite));
@@ -912,7 +916,7 @@ bool WrappedVulkan::Serialise_vkUnmapMemory(SerialiserType &ser, VkDevice device
       return false;
     }
 
-    const Intervals<VulkanCreationInfo::Memory::MemoryBinding> &bindings =
+    const BTreeIntervals<VulkanCreationInfo::Memory::MemoryBinding> &bindings =
         m_CreationInfo.m_Memory[GetResID(memory)].bindings;
 
     uint64_t finish = MapOffset + MapSize;
@@ -953,7 +957,7 @@ bool WrappedVulkan::Serialise_vkUnmapMemory(SerialiserType &ser, VkDevice device
     byte *tmp = m_MaskedMapData.data();
     ser.Serialise("MapData"_lit, tmp, MapSize, SerialiserFlags::NoFlags).Important();
 
-    const Intervals<VulkanCreationInfo::Memory::MemoryBinding> &bindings =
+    const BTreeIntervals<VulkanCreationInfo::Memory::MemoryBinding> &bindings =
         m_CreationInfo.m_Memory[GetResID(memory)].bindings;
 
     uint64_t finish = MapOffset + MapSize;
@@ -1103,7 +1107,11 @@ bool WrappedVulkan::Serialise_vkFlushMappedMemoryRanges(SerialiserType &ser, VkD
 
   bool directStream = true;
 
-  if(IsReplayingAndReading() && MemRange.memory != VK_NULL_HANDLE && MemRange.size > 0)
+  // as in vkUnmapMemory, skip writes that are already in a restored replay checkpoint
+  bool beforeCheckpoint = IsActiveReplaying(m_State) && m_RootEventID < m_ReplayCheckpointEvent;
+
+  if(IsReplayingAndReading() && MemRange.memory != VK_NULL_HANDLE && MemRange.size > 0 &&
+     !beforeCheckpoint)
   {
     if(IsLoading(m_State))
       m_ResourceUses[GetResID(MemRange.memory)].push_back(
@@ -1124,7 +1132,7 @@ bool WrappedVulkan::Serialise_vkFlushMappedMemoryRanges(SerialiserType &ser, VkD
     }
 
     const VulkanCreationInfo::Memory &memInfo = m_CreationInfo.m_Memory[GetResID(MemRange.memory)];
-    const Intervals<VulkanCreationInfo::Memory::MemoryBinding> &bindings = memInfo.bindings;
+    const BTreeIntervals<VulkanCreationInfo::Memory::MemoryBinding> &bindings = memInfo.bindings;
 
     memRangeSize = MemRange.size;
     if(memRangeSize == VK_WHOLE_SIZE)
@@ -1168,7 +1176,7 @@ bool WrappedVulkan::Serialise_vkFlushMappedMemoryRanges(SerialiserType &ser, VkD
     byte *tmp = m_MaskedMapData.data();
     ser.Serialise("MapData"_lit, tmp, memRangeSize, SerialiserFlags::NoFlags).Important();
 
-    const Intervals<VulkanCreationInfo::Memory::MemoryBinding> &bindings =
+    const BTreeIntervals<VulkanCreationInfo::Memory::MemoryBinding> &bindings =
         m_CreationInfo.m_Memory[GetResID(MemRange.memory)].bindings;
 
     uint64_t mappedRegionStart = MemRange.offset;
@@ -180,5 +180,9 @@ typedef uint8_t byte;
 struct ResourceFormat;
 FloatVector DecodeFormattedComponents(const ResourceFormat &fmt, const byte *data,
                                       bool *success = NULL);
+// decodes count pixels spaced stride bytes apart. The conversion is chosen once up-front for the
+// whole row, so this is much faster than calling DecodeFormattedComponents per-pixel.
+void DecodeFormattedComponentsRow(const ResourceFormat &fmt, const byte *data, size_t stride,
+                                  size_t count, FloatVector *out, bool *success = NULL);
 void EncodeFormattedComponents(const ResourceFormat &fmt, FloatVector v, byte *data,
                                bool *success = NULL);
@@ -149,6 +149,9 @@ void SetTLSValue(uint64_t slot, void *value);
 // must typedef CriticalSectionTemplate<X> CriticalSection
 
 void SetCurrentThreadName(const rdcstr &name);
+// lowers the scheduling priority of the calling thread, for background work that shouldn't compete
+// with the application
+void SetCurrentThreadLowPriority();
 
 typedef uint64_t ThreadHandle;
 ThreadHandle CreateThread(std::function<void()> entryFunc);
@@ -157,6 +160,7 @@ void JoinThread(ThreadHandle handle);
 void DetachThread(ThreadHandle handle);
 void CloseThread(ThreadHandle handle);
 void Sleep(uint32_t milliseconds);
+uint32_t GetNumCores();
 
 // kind of windows specific, to handle this case:
 // http://blogs.msdn.com/b/oldnewthing/archive/2013/11/05/10463645.aspx
@@ -343,6 +347,19 @@ void logfile_close(LogFileHandle *logHandle, const rdcstr &deleteFilename);
 // may fail on the shared logfile
 rdcstr logfile_readall(uint64_t offset, const rdcstr &filename);
 
+// watches a single file for changes. The callback is invoked on a background thread when the file
+// is written to, and again once the write has completed (the file was closed after writing, or was
+// replaced by renaming another file over it). Returns NULL if watching isn't supported on this
+// platform, in which case callers must fall back to being told about changes some other way.
+enum FileWatchEvent
+{
+  FileModified,
+  FileWriteCompleted,
+};
+struct FileWatch;
+FileWatch *WatchFile(const rdcstr &filename, std::function<void(FileWatchEvent)> callback);
+void UnwatchFile(FileWatch *watch);
+
 // utility functions
 inline bool WriteAll(const rdcstr &filename, const void *buffer, size_t size)
 {
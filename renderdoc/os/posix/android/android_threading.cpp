@@ -24,6 +24,8 @@
 
 #include "os/os_specific.h"
 
+#include <sys/resource.h>
+#include <sys/syscall.h>
 #include <time.h>
 #include <unistd.h>
 
@@ -42,3 +44,9 @@ uint64_t Timing::GetTick()
 void Threading::SetCurrentThreadName(const rdcstr &name)
 {
 }
+
+void Threading::SetCurrentThreadLowPriority()
+{
+  // on linux the nice value is per-thread when given a thread ID
+  setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), 10);
+}
@@ -205,6 +205,16 @@ void GetLibraryFilename(rdcstr &selfName)
     selfName = "";
   }
 }
+
+FileWatch *WatchFile(const rdcstr &filename, std::function<void(FileWatchEvent)> callback)
+{
+  // not supported on this platform
+  return NULL;
+}
+
+void UnwatchFile(FileWatch *watch)
+{
+}
 };
 
 namespace StringFormat
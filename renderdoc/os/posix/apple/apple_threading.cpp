@@ -25,6 +25,7 @@
 #include "os/os_specific.h"
 
 #include <mach/mach_time.h>
+#include <pthread.h>
 
 double Timing::GetTickFrequency()
 {
@@ -44,3 +45,8 @@ uint64_t Timing::GetTick()
 void Threading::SetCurrentThreadName(const rdcstr &name)
 {
 }
+
+void Threading::SetCurrentThreadLowPriority()
+{
+  pthread_set_qos_class_self_np(QOS_CLASS_UTILITY, 0);
+}
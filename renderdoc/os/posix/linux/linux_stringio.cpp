@@ -26,9 +26,13 @@
 #include <dlfcn.h>
 #include <errno.h>
 #include <iconv.h>
+#include <limits.h>
+#include <poll.h>
 #include <pwd.h>
 #include <stdio.h>
 #include <string.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <time.h>
@@ -712,6 +716,119 @@ void GetLibraryFilename(rdcstr &selfName)
 
   selfName = librenderdoc_path;
 }
+
+struct FileWatch
+{
+  int inotifyFD = -1;
+  int shutdownFD = -1;
+  rdcstr basename;
+  std::function<void(FileWatchEvent)> callback;
+  Threading::ThreadHandle thread = 0;
+};
+
+static void FileWatchThread(FileWatch *watch)
+{
+  // large enough for several events with maximum length names
+  char buf[16 * (sizeof(inotify_event) + NAME_MAX + 1)]
+      __attribute__((aligned(__alignof__(inotify_event))));
+
+  pollfd fds[2] = {};
+  fds[0].fd = watch->inotifyFD;
+  fds[0].events = POLLIN;
+  fds[1].fd = watch->shutdownFD;
+  fds[1].events = POLLIN;
+
+  for(;;)
+  {
+    int ret = poll(fds, 2, -1);
+
+    if(ret < 0 && errno == EINTR)
+      continue;
+
+    if(ret < 0 || (fds[1].revents & POLLIN))
+      break;
+
+    ssize_t len = read(watch->inotifyFD, buf, sizeof(buf));
+
+    if(len <= 0)
+      continue;
+
+    for(char *ptr = buf; ptr < buf + len;)
+    {
+      const inotify_event *ev = (const inotify_event *)ptr;
+      ptr += sizeof(inotify_event) + ev->len;
+
+      // we watch the directory so that saves which write a temporary file and rename it over the
+      // original are still seen, so ignore events for any other files
+      if(ev->len == 0 || watch->basename != ev->name)
+        continue;
+
+      if(ev->mask & (IN_CLOSE_WRITE | IN_MOVED_TO))
+        watch->callback(FileWriteCompleted);
+      else if(ev->mask & (IN_MODIFY | IN_CREATE))
+        watch->callback(FileModified);
+    }
+  }
+}
+
+FileWatch *WatchFile(const rdcstr &filename, std::function<void(FileWatchEvent)> callback)
+{
+  rdcstr path = GetFullPathname(filename);
+
+  int inotifyFD = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+  if(inotifyFD < 0)
+  {
+    RDCWARN("Couldn't create inotify instance to watch %s: %s", path.c_str(), strerror(errno));
+    return NULL;
+  }
+
+  int wd = inotify_add_watch(inotifyFD, get_dirname(path).c_str(),
+                             IN_MODIFY | IN_CREATE | IN_CLOSE_WRITE | IN_MOVED_TO);
+
+  if(wd < 0)
+  {
+    RDCWARN("Couldn't watch %s: %s", path.c_str(), strerror(errno));
+    close(inotifyFD);
+    return NULL;
+  }
+
+  int shutdownFD = eventfd(0, EFD_CLOEXEC);
+
+  if(shutdownFD < 0)
+  {
+    RDCWARN("Couldn't create eventfd to watch %s: %s", path.c_str(), strerror(errno));
+    close(inotifyFD);
+    return NULL;
+  }
+
+  FileWatch *watch = new FileWatch;
+  watch->inotifyFD = inotifyFD;
+  watch->shutdownFD = shutdownFD;
+  watch->basename = get_basename(path);
+  watch->callback = callback;
+  watch->thread = Threading::CreateThread([watch]() { FileWatchThread(watch); });
+
+  return watch;
+}
+
+void UnwatchFile(FileWatch *watch)
+{
+  if(!watch)
+    return;
+
+  uint64_t val = 1;
+  ssize_t written = write(watch->shutdownFD, &val, sizeof(val));
+  (void)written;
+
+  Threading::JoinThread(watch->thread);
+  Threading::CloseThread(watch->thread);
+
+  close(watch->inotifyFD);
+  close(watch->shutdownFD);
+
+  delete watch;
+}
 };
 
 namespace StringFormat
@@ -25,6 +25,8 @@
 #include "os/os_specific.h"
 
 #include <sys/prctl.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
 #include <time.h>
 #include <unistd.h>
 
@@ -44,3 +46,9 @@ void Threading::SetCurrentThreadName(const rdcstr &name)
 {
   prctl(PR_SET_NAME, (unsigned long)name.c_str(), 0, 0, 0);
 }
+
+void Threading::SetCurrentThreadLowPriority()
+{
+  // on linux the nice value is per-thread when given a thread ID
+  setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), 10);
+}
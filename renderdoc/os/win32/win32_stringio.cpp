@@ -445,6 +445,16 @@ uint64_t GetFileSize(const rdcstr &filename)
   return 0;
 }
 
+FileWatch *WatchFile(const rdcstr &filename, std::function<void(FileWatchEvent)> callback)
+{
+  // not supported on this platform
+  return NULL;
+}
+
+void UnwatchFile(FileWatch *watch)
+{
+}
+
 bool Copy(const rdcstr &from, const rdcstr &to, bool allowOverwrite)
 {
   rdcwstr wfrom = StringFormat::UTF82Wide(from);
@@ -324,6 +324,11 @@ void SetCurrentThreadName(const rdcstr &name)
   }
 }
 
+void SetCurrentThreadLowPriority()
+{
+  SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_LOWEST);
+}
+
 uint64_t GetCurrentID()
 {
   return (uint64_t)::GetCurrentThreadId();
@@ -368,4 +373,11 @@ void Sleep(uint32_t milliseconds)
 {
   ::Sleep((DWORD)milliseconds);
 }
+
+uint32_t GetNumCores()
+{
+  SYSTEM_INFO info = {};
+  GetSystemInfo(&info);
+  return info.dwNumberOfProcessors > 0 ? (uint32_t)info.dwNumberOfProcessors : 1;
+}
 };
@@ -23,6 +23,8 @@
  ******************************************************************************/
 
 #include "dummy_driver.h"
+#include <algorithm>
+#include "serialise/rdcfile.h"
 
 DummyDriver::DummyDriver(IReplayDriver *original, const rdcarray<ShaderReflection *> &shaders,
                          SDFile *sdfile)
@@ -45,6 +47,25 @@ DummyDriver::DummyDriver(IReplayDriver *original, const rdcarray<ShaderReflectio
   m_CustomPrefixes = original->GetCustomShaderSourcePrefixes();
 }
 
+DummyDriver::DummyDriver(RDCDriver driverType)
+{
+  m_Analysis = true;
+  m_DriverType = driverType;
+  m_SDFile = NULL;
+  m_Proxy = false;
+
+  switch(driverType)
+  {
+    case RDCDriver::D3D12: m_Props.pipelineType = GraphicsAPI::D3D12; break;
+    case RDCDriver::OpenGL:
+    case RDCDriver::OpenGLES: m_Props.pipelineType = GraphicsAPI::OpenGL; break;
+    case RDCDriver::Vulkan: m_Props.pipelineType = GraphicsAPI::Vulkan; break;
+    default: m_Props.pipelineType = GraphicsAPI::D3D11; break;
+  }
+
+  m_Props.localRenderer = m_Props.pipelineType;
+}
+
 DummyDriver::~DummyDriver()
 {
   // we own the shaders
@@ -126,11 +147,18 @@ rdcarray<rdcstr> DummyDriver::GetDisassemblyTargets(bool withPipeline)
 rdcstr DummyDriver::DisassembleShader(ResourceId pipeline, const ShaderReflection *refl,
                                       const rdcstr &target)
 {
+  if(m_Analysis)
+    return "; No disassembly available in analysis-only replay.";
+
   return "; No disassembly available due to unrecoverable error analysing capture.";
 }
 
 rdcarray<EventUsage> DummyDriver::GetUsage(ResourceId id)
 {
+  auto it = m_Usage.find(id);
+  if(it != m_Usage.end())
+    return it->second;
+
   return {};
 }
 
@@ -150,7 +178,31 @@ FrameRecord DummyDriver::GetFrameRecord()
 
 RDResult DummyDriver::ReadLogInitialisation(RDCFile *rdc, bool storeStructuredBuffers)
 {
-  return ResultCode::APIReplayFailed;
+  if(!m_Analysis || rdc == NULL)
+    return ResultCode::APIReplayFailed;
+
+  int sectionIdx = rdc->SectionIndex(SectionType::FrameCapture);
+
+  if(sectionIdx < 0)
+    RETURN_ERROR_RESULT(ResultCode::FileCorrupted, "File does not contain captured API data");
+
+  StructuredProcessor proc = RenderDoc::Inst().GetStructuredProcessor(m_DriverType);
+
+  if(!proc)
+    RETURN_ERROR_RESULT(ResultCode::APIUnsupported, "Can't get structured data for driver %s",
+                        rdc->GetDriverName().c_str());
+
+  SAFE_DELETE(m_SDFile);
+  m_SDFile = new SDFile;
+
+  RDResult result = proc(rdc, *m_SDFile);
+
+  if(result != ResultCode::Succeeded)
+    return result;
+
+  AnalyseChunks(rdc, sectionIdx);
+
+  return ResultCode::Succeeded;
 }
 
 void DummyDriver::ReplayLog(uint32_t endEventID, ReplayLogType replayType)
@@ -162,9 +214,38 @@ SDFile *DummyDriver::GetStructuredFile()
   return m_SDFile;
 }
 
+// returns the draws earlier in the same pass as the action at eventId, like real drivers
+static rdcarray<uint32_t> PassEventsForAction(const rdcarray<ActionDescription> &actions,
+                                              const rdcarray<uint32_t> &actionPass,
+                                              uint32_t eventId)
+{
+  auto it = std::lower_bound(actions.begin(), actions.end(), eventId,
+                             [](const ActionDescription &a, uint32_t e) { return a.eventId < e; });
+
+  if(it == actions.end() || it->eventId != eventId)
+    return {};
+
+  const size_t idx = it - actions.begin();
+
+  size_t start = idx;
+  while(start > 0 && actionPass[start - 1] == actionPass[idx])
+    start--;
+
+  rdcarray<uint32_t> passEvents;
+
+  for(size_t i = start; i < idx; i++)
+    if(actions[i].flags & ActionFlags::Drawcall)
+      passEvents.push_back(actions[i].eventId);
+
+  return passEvents;
+}
+
 rdcarray<uint32_t> DummyDriver::GetPassEvents(uint32_t eventId)
 {
-  return {eventId};
+  if(!m_Analysis)
+    return {eventId};
+
+  return PassEventsForAction(m_FrameRecord.actionList, m_ActionPass, eventId);
 }
 
 void DummyDriver::InitPostVSBuffers(uint32_t eventId)
@@ -251,6 +332,15 @@ rdcarray<PixelModification> DummyDriver::PixelHistory(rdcarray<EventUsage> event
   return {};
 }
 
+rdcarray<PixelHistoryResult> DummyDriver::PixelHistoryRegion(rdcarray<EventUsage> events,
+                                                           ResourceId target, uint32_t x,
+                                                           uint32_t y, uint32_t width,
+                                                           uint32_t height, const Subresource &sub,
+                                                           CompType typeCast)
+{
+  return {};
+}
+
 ShaderDebugTrace *DummyDriver::DebugVertex(uint32_t eventId, uint32_t vertid, uint32_t instid,
                                            uint32_t idx, uint32_t view)
 {
@@ -509,3 +599,507 @@ uint32_t DummyDriver::PickVertex(uint32_t eventId, int32_t width, int32_t height
 {
   return ~0U;
 }
+
+// classify a chunk as an action based on its function name. Chunk names are API function names like
+// vkCmdDrawIndexed, ID3D11DeviceContext::ClearRenderTargetView or glDrawArraysInstanced, so this
+// works across APIs without needing to know each driver's chunk enum.
+static ActionFlags ClassifyChunk(const rdcstr &name)
+{
+  ActionFlags flags = ActionFlags::NoFlags;
+
+  // these are state setting functions despite their names
+  if(name.contains("DrawBuffer") || name.contains("ClearState") || name.endsWith("ClearColor") ||
+     name.endsWith("ClearDepth") || name.endsWith("ClearDepthf") || name.endsWith("ClearStencil") ||
+     name.contains("Descriptor"))
+    return flags;
+
+  if(name.contains("BeginRenderPass") || name.contains("BeginRendering"))
+    return ActionFlags::PassBoundary | ActionFlags::BeginPass;
+  if(name.contains("EndRenderPass") || name.contains("EndRendering"))
+    return ActionFlags::PassBoundary | ActionFlags::EndPass;
+
+  if(name.contains("Draw") || name.contains("ExecuteIndirect"))
+  {
+    flags = ActionFlags::Drawcall;
+
+    if(name.contains("Indexed") || name.contains("Elements"))
+      flags |= ActionFlags::Indexed;
+    if(name.contains("Instanced"))
+      flags |= ActionFlags::Instanced;
+    if(name.contains("Auto"))
+      flags |= ActionFlags::Auto;
+  }
+  else if(name.contains("Dispatch") || name.contains("TraceRays"))
+  {
+    flags = ActionFlags::Dispatch;
+  }
+  else if(name.contains("Clear"))
+  {
+    flags = ActionFlags::Clear;
+
+    if(name.contains("Depth") || name.contains("Stencil"))
+      flags |= ActionFlags::ClearDepthStencil;
+    else
+      flags |= ActionFlags::ClearColor;
+  }
+  else if(name.contains("Resolve"))
+  {
+    flags = ActionFlags::Resolve;
+  }
+  else if(name.contains("GenerateMip"))
+  {
+    flags = ActionFlags::GenMips;
+  }
+  else if(name.contains("Copy") || name.contains("Blit"))
+  {
+    flags = ActionFlags::Copy;
+  }
+  else if(name.contains("Present") || name.contains("SwapBuffers"))
+  {
+    flags = ActionFlags::Present;
+  }
+
+  if(flags != ActionFlags::NoFlags && name.contains("Indirect"))
+    flags |= ActionFlags::Indirect;
+
+  return flags;
+}
+
+static bool IsResourceUpdate(const rdcstr &name)
+{
+  if(name.contains("Descriptor"))
+    return false;
+
+  return name.contains("Update") || name.contains("Unmap") || name.contains("FlushMapped") ||
+         name.contains("BufferData") || name.contains("BufferSubData") || name.contains("SubImage");
+}
+
+static bool IsOutputBind(const rdcstr &name)
+{
+  return name.contains("SetRenderTargets") || name.contains("BindFramebuffer");
+}
+
+static ResourceType GuessResourceType(const rdcstr &name)
+{
+  if(!name.contains("Create") && !name.contains("Gen"))
+    return ResourceType::Unknown;
+
+  // check for the most specific names first, e.g. CreateShaderResourceView is a view
+  if(name.contains("Pipeline"))
+    return ResourceType::PipelineState;
+  if(name.contains("View"))
+    return ResourceType::View;
+  if(name.contains("Swapchain") || name.contains("SwapChain"))
+    return ResourceType::SwapchainImage;
+  if(name.contains("Sampler"))
+    return ResourceType::Sampler;
+  if(name.contains("Buffer") && !name.contains("CommandBuffer") && !name.contains("Framebuffer"))
+    return ResourceType::Buffer;
+  if(name.contains("Image") || name.contains("Texture") || name.contains("Renderbuffer"))
+    return ResourceType::Texture;
+  if(name.contains("Shader") || name.contains("Program"))
+    return ResourceType::Shader;
+  if(name.contains("RenderPass") || name.contains("Framebuffer"))
+    return ResourceType::RenderPass;
+  if(name.contains("Query") || name.contains("Queries"))
+    return ResourceType::Query;
+  if(name.contains("Fence") || name.contains("Semaphore") || name.contains("Event"))
+    return ResourceType::Sync;
+  if(name.contains("Pool") || name.contains("Allocator"))
+    return ResourceType::Pool;
+  if(name.contains("Memory") || name.contains("Heap"))
+    return ResourceType::Memory;
+  if(name.contains("CommandBuffer") || name.contains("CommandList"))
+    return ResourceType::CommandBuffer;
+  if(name.contains("Device"))
+    return ResourceType::Device;
+
+  return ResourceType::Unknown;
+}
+
+static void GatherResourceReferences(const SDObject *obj, rdcarray<ResourceId> &ids)
+{
+  if(obj->type.basetype == SDBasic::Resource)
+  {
+    if(obj->data.basic.id != ResourceId())
+      ids.push_back(obj->data.basic.id);
+    return;
+  }
+
+  for(size_t i = 0; i < obj->NumChildren(); i++)
+    GatherResourceReferences(obj->GetChild(i), ids);
+}
+
+// gathers each resource referenced by a chunk once, in ID order. Chunks like descriptor updates can
+// reference thousands of resources so de-duplicate with a sort rather than searching as we go.
+static void GatherUniqueResourceReferences(const SDChunk *chunk, rdcarray<ResourceId> &ids)
+{
+  ids.clear();
+  GatherResourceReferences(chunk, ids);
+
+  std::sort(ids.begin(), ids.end());
+  ids.resize(std::unique(ids.begin(), ids.end()) - ids.begin());
+}
+
+static ResourceUsage UsageForChunk(ActionFlags flags, const rdcstr &name)
+{
+  if(flags & ActionFlags::Clear)
+    return ResourceUsage::Clear;
+  if(flags & ActionFlags::Copy)
+    return ResourceUsage::Copy;
+  if(flags & ActionFlags::Resolve)
+    return ResourceUsage::Resolve;
+  if(flags & ActionFlags::GenMips)
+    return ResourceUsage::GenMips;
+  if(name.contains("Barrier"))
+    return ResourceUsage::Barrier;
+  if(IsResourceUpdate(name))
+    return ResourceUsage::CPUWrite;
+
+  // we don't know how the resource is bound, so consider it a generic reference
+  return ResourceUsage::All_Resource;
+}
+
+// builds the action list, resources and usage purely from the structured chunks. actionPass gets
+// the pass index of each action in record.actionList
+static void AnalyseStructuredChunks(const rdcarray<SDChunk *> &chunks, FrameRecord &record,
+                                    rdcarray<ResourceDescription> &resources,
+                                    std::map<ResourceId, rdcarray<EventUsage>> &usageMap,
+                                    rdcarray<uint32_t> &actionPass)
+{
+  FrameStatistics &stats = record.frameInfo.stats;
+  stats.recorded = true;
+  stats.draws.counts.resize(DrawcallStats::BucketCount);
+  stats.updates.types.resize(uint32_t(TextureType::Count));
+  stats.updates.sizes.resize(ResourceUpdateStats::BucketCount);
+
+  // everything after the capture begin chunk is part of the frame, everything before is
+  // initialisation. If there's no such chunk treat everything as part of the frame
+  size_t frameStart = 0;
+  for(size_t c = 0; c < chunks.size(); c++)
+  {
+    if(chunks[c]->metadata.chunkID == (uint32_t)SystemChunk::CaptureBegin)
+    {
+      frameStart = c + 1;
+      break;
+    }
+  }
+
+  resources.clear();
+  usageMap.clear();
+  actionPass.clear();
+
+  std::map<ResourceId, size_t> resourceIndex;
+  rdcarray<ResourceId> ids;
+
+  for(size_t c = 0; c < frameStart; c++)
+  {
+    const SDChunk *chunk = chunks[c];
+
+    if(chunk->metadata.chunkID == (uint32_t)SystemChunk::InitialContents)
+      record.frameInfo.initDataSize += chunk->metadata.length;
+
+    GatherUniqueResourceReferences(chunk, ids);
+
+    for(ResourceId id : ids)
+    {
+      auto it = resourceIndex.find(id);
+      if(it == resourceIndex.end())
+      {
+        it = resourceIndex.insert(std::make_pair(id, resources.size())).first;
+
+        ResourceDescription desc;
+        desc.resourceId = id;
+        // the first chunk to reference a resource is almost always the one that created it
+        desc.type = GuessResourceType(chunk->name);
+
+        uint64_t num = 0;
+        memcpy(&num, &id, sizeof(num));
+        desc.name = StringFormat::Fmt("%s %llu", ToStr(desc.type).c_str(), num);
+
+        resources.push_back(desc);
+      }
+
+      resources[it->second].initialisationChunks.push_back((uint32_t)c);
+    }
+  }
+
+  rdcarray<APIEvent> pendingEvents;
+  uint32_t eventId = 0;
+  uint32_t pass = 0;
+
+  for(size_t c = frameStart; c < chunks.size(); c++)
+  {
+    const SDChunk *chunk = chunks[c];
+
+    if(chunk->metadata.chunkID < (uint32_t)SystemChunk::FirstDriverChunk)
+      continue;
+
+    record.frameInfo.persistentSize += chunk->metadata.length;
+
+    APIEvent ev;
+    ev.eventId = ++eventId;
+    ev.chunkIndex = (uint32_t)c;
+    pendingEvents.push_back(ev);
+
+    const ActionFlags flags = ClassifyChunk(chunk->name);
+
+    if(IsResourceUpdate(chunk->name))
+      stats.updates.calls++;
+
+    if(IsOutputBind(chunk->name) || (flags & (ActionFlags::BeginPass | ActionFlags::Clear)))
+      pass++;
+
+    GatherUniqueResourceReferences(chunk, ids);
+
+    const ResourceUsage usage = UsageForChunk(flags, chunk->name);
+    for(ResourceId id : ids)
+      usageMap[id].push_back(EventUsage(eventId, usage));
+
+    if(flags == ActionFlags::NoFlags)
+      continue;
+
+    if(flags & ActionFlags::Drawcall)
+    {
+      stats.draws.calls++;
+      if(flags & ActionFlags::Instanced)
+        stats.draws.instanced++;
+      if(flags & ActionFlags::Indirect)
+        stats.draws.indirect++;
+    }
+    else if(flags & ActionFlags::Dispatch)
+    {
+      stats.dispatches.calls++;
+      if(flags & ActionFlags::Indirect)
+        stats.dispatches.indirect++;
+    }
+
+    ActionDescription action;
+    action.eventId = eventId;
+    action.actionId = (uint32_t)record.actionList.size() + 1;
+    action.flags = flags;
+    action.customName = chunk->name;
+    action.events.swap(pendingEvents);
+
+    record.actionList.push_back(action);
+    actionPass.push_back(pass);
+
+    if(flags & ActionFlags::EndPass)
+      pass++;
+  }
+
+  // like real drivers, finish with a present if the capture didn't end with one
+  if(record.actionList.empty() || !(record.actionList.back().flags & ActionFlags::Present) ||
+     !pendingEvents.empty())
+  {
+    if(pendingEvents.empty())
+    {
+      APIEvent ev;
+      ev.eventId = ++eventId;
+      ev.chunkIndex = APIEvent::NoChunk;
+      pendingEvents.push_back(ev);
+    }
+
+    ActionDescription action;
+    action.eventId = eventId;
+    action.actionId = (uint32_t)record.actionList.size() + 1;
+    action.flags = ActionFlags::Present;
+    action.customName = "End of Capture";
+    action.events.swap(pendingEvents);
+
+    record.actionList.push_back(action);
+    actionPass.push_back(pass + 1);
+  }
+}
+
+void DummyDriver::AnalyseChunks(RDCFile *rdc, int sectionIdx)
+{
+  m_FrameRecord = FrameRecord();
+
+  FrameDescription &frameInfo = m_FrameRecord.frameInfo;
+  frameInfo.uncompressedFileSize = rdc->GetSectionProperties(sectionIdx).uncompressedSize;
+  frameInfo.compressedFileSize = rdc->GetSectionProperties(sectionIdx).compressedSize;
+  frameInfo.captureTime = rdc->GetTimestampBase();
+
+  AnalyseStructuredChunks(m_SDFile->chunks, m_FrameRecord, m_Resources, m_Usage, m_ActionPass);
+}
+
+RDResult DUMMY_CreateAnalysisReplayDevice(RDCFile *rdc, IReplayDriver **driver)
+{
+  if(rdc == NULL || driver == NULL)
+    return ResultCode::InvalidParameter;
+
+  RDCDriver driverType = rdc->GetDriver();
+
+  if(driverType == RDCDriver::Image || !RenderDoc::Inst().GetStructuredProcessor(driverType))
+    RETURN_ERROR_RESULT(ResultCode::APIUnsupported,
+                        "Analysis-only replay is not supported for driver %s",
+                        rdc->GetDriverName().c_str());
+
+  RDCLOG("Creating analysis-only replay for %s capture", rdc->GetDriverName().c_str());
+
+  *driver = new DummyDriver(driverType);
+
+  return ResultCode::Succeeded;
+}
+
+#if ENABLED(ENABLE_UNIT_TESTS)
+
+#include "catch/catch.hpp"
+
+static SDChunk *MakeAnalysisChunk(const char *name, const rdcarray<ResourceId> &ids,
+                                  uint32_t chunkID = (uint32_t)SystemChunk::FirstDriverChunk + 1)
+{
+  SDChunk *chunk = new SDChunk(rdcstr(name));
+  chunk->metadata.chunkID = chunkID;
+  for(ResourceId id : ids)
+    chunk->AddAndOwnChild(makeSDResourceId("resource"_lit, id));
+  return chunk;
+}
+
+TEST_CASE("Check analysis replay chunk classification", "[analysis]")
+{
+  SECTION("Actions")
+  {
+    // vulkan
+    CHECK(ClassifyChunk("vkCmdDraw") == ActionFlags::Drawcall);
+    CHECK(ClassifyChunk("vkCmdDrawIndexed") == (ActionFlags::Drawcall | ActionFlags::Indexed));
+    CHECK(ClassifyChunk("vkCmdDrawIndexedIndirect") ==
+          (ActionFlags::Drawcall | ActionFlags::Indexed | ActionFlags::Indirect));
+    CHECK(ClassifyChunk("vkCmdDispatch") == ActionFlags::Dispatch);
+    CHECK(ClassifyChunk("vkCmdTraceRaysKHR") == ActionFlags::Dispatch);
+    CHECK(ClassifyChunk("vkCmdClearColorImage") == (ActionFlags::Clear | ActionFlags::ClearColor));
+    CHECK(ClassifyChunk("vkCmdClearDepthStencilImage") ==
+          (ActionFlags::Clear | ActionFlags::ClearDepthStencil));
+    CHECK(ClassifyChunk("vkCmdCopyBufferToImage") == ActionFlags::Copy);
+    CHECK(ClassifyChunk("vkCmdBlitImage") == ActionFlags::Copy);
+    CHECK(ClassifyChunk("vkCmdResolveImage") == ActionFlags::Resolve);
+    CHECK(ClassifyChunk("vkCmdBeginRenderPass") ==
+          (ActionFlags::PassBoundary | ActionFlags::BeginPass));
+    CHECK(ClassifyChunk("vkCmdEndRendering") == (ActionFlags::PassBoundary | ActionFlags::EndPass));
+    CHECK(ClassifyChunk("vkQueuePresentKHR") == ActionFlags::Present);
+    CHECK(ClassifyChunk("vkCmdBindDescriptorSets") == ActionFlags::NoFlags);
+    CHECK(ClassifyChunk("vkCmdSetViewport") == ActionFlags::NoFlags);
+
+    // D3D
+    CHECK(ClassifyChunk("ID3D11DeviceContext::DrawIndexedInstanced") ==
+          (ActionFlags::Drawcall | ActionFlags::Indexed | ActionFlags::Instanced));
+    CHECK(ClassifyChunk("ID3D11DeviceContext::DrawAuto") ==
+          (ActionFlags::Drawcall | ActionFlags::Auto));
+    CHECK(ClassifyChunk("ID3D11DeviceContext::ClearRenderTargetView") ==
+          (ActionFlags::Clear | ActionFlags::ClearColor));
+    CHECK(ClassifyChunk("ID3D11DeviceContext::ClearDepthStencilView") ==
+          (ActionFlags::Clear | ActionFlags::ClearDepthStencil));
+    CHECK(ClassifyChunk("ID3D11DeviceContext::ClearState") == ActionFlags::NoFlags);
+    CHECK(ClassifyChunk("ID3D11DeviceContext::GenerateMips") == ActionFlags::GenMips);
+    CHECK(ClassifyChunk("ID3D12GraphicsCommandList::ExecuteIndirect") ==
+          (ActionFlags::Drawcall | ActionFlags::Indirect));
+    CHECK(ClassifyChunk("ID3D12GraphicsCommandList::SetGraphicsRootDescriptorTable") ==
+          ActionFlags::NoFlags);
+    CHECK(ClassifyChunk("IDXGISwapChain::Present") == ActionFlags::Present);
+
+    // GL
+    CHECK(ClassifyChunk("glDrawArraysInstanced") ==
+          (ActionFlags::Drawcall | ActionFlags::Instanced));
+    CHECK(ClassifyChunk("glDrawElements") == (ActionFlags::Drawcall | ActionFlags::Indexed));
+    CHECK(ClassifyChunk("glDrawBuffers") == ActionFlags::NoFlags);
+    CHECK(ClassifyChunk("glClear") == (ActionFlags::Clear | ActionFlags::ClearColor));
+    CHECK(ClassifyChunk("glClearColor") == ActionFlags::NoFlags);
+    CHECK(ClassifyChunk("glClearDepthf") == ActionFlags::NoFlags);
+    CHECK(ClassifyChunk("glBlitFramebuffer") == ActionFlags::Copy);
+    CHECK(ClassifyChunk("SwapBuffers") == ActionFlags::Present);
+  };
+
+  SECTION("Resource types")
+  {
+    CHECK(GuessResourceType("vkCreateBuffer") == ResourceType::Buffer);
+    CHECK(GuessResourceType("vkCreateImage") == ResourceType::Texture);
+    CHECK(GuessResourceType("vkCreateImageView") == ResourceType::View);
+    CHECK(GuessResourceType("vkCreateGraphicsPipelines") == ResourceType::PipelineState);
+    CHECK(GuessResourceType("vkCreateShaderModule") == ResourceType::Shader);
+    CHECK(GuessResourceType("vkCreateFramebuffer") == ResourceType::RenderPass);
+    CHECK(GuessResourceType("vkCreateCommandPool") == ResourceType::Pool);
+    CHECK(GuessResourceType("vkCreateSwapchainKHR") == ResourceType::SwapchainImage);
+    CHECK(GuessResourceType("vkCreateSemaphore") == ResourceType::Sync);
+    CHECK(GuessResourceType("vkCreateDevice") == ResourceType::Device);
+    CHECK(GuessResourceType("vkCmdDraw") == ResourceType::Unknown);
+
+    CHECK(GuessResourceType("ID3D11Device::CreateTexture2D") == ResourceType::Texture);
+    CHECK(GuessResourceType("ID3D11Device::CreateShaderResourceView") == ResourceType::View);
+    CHECK(GuessResourceType("ID3D12Device::CreateCommandList") == ResourceType::CommandBuffer);
+    CHECK(GuessResourceType("ID3D12Device::CreateDescriptorHeap") == ResourceType::Memory);
+    CHECK(GuessResourceType("ID3D12Device::CreateFence") == ResourceType::Sync);
+
+    CHECK(GuessResourceType("glGenBuffers") == ResourceType::Buffer);
+    CHECK(GuessResourceType("glGenTextures") == ResourceType::Texture);
+    CHECK(GuessResourceType("glCreateShaderProgramv") == ResourceType::Shader);
+    CHECK(GuessResourceType("glGenQueries") == ResourceType::Query);
+    CHECK(GuessResourceType("glBindBuffer") == ResourceType::Unknown);
+  };
+
+  SECTION("Pass splitting and resource references")
+  {
+    const ResourceId buf = ResourceIDGen::GetNewUniqueID();
+    const ResourceId img = ResourceIDGen::GetNewUniqueID();
+
+    SDFile file;
+    file.chunks.push_back(MakeAnalysisChunk("vkCreateImage", {img}));
+    // references are de-duplicated within a chunk
+    file.chunks.push_back(MakeAnalysisChunk("vkCreateBuffer", {buf, img, buf}));
+    file.chunks.push_back(MakeAnalysisChunk("Beginning of Capture", {},
+                                            (uint32_t)SystemChunk::CaptureBegin));
+
+    // eventId 1 - 4 are the first pass
+    file.chunks.push_back(MakeAnalysisChunk("vkCmdBeginRenderPass", {}));
+    file.chunks.push_back(MakeAnalysisChunk("vkCmdDraw", {buf}));
+    file.chunks.push_back(MakeAnalysisChunk("vkCmdBindVertexBuffers", {buf, buf}));
+    file.chunks.push_back(MakeAnalysisChunk("vkCmdDrawIndexed", {img, buf}));
+    file.chunks.push_back(MakeAnalysisChunk("vkCmdEndRenderPass", {}));
+
+    // then a D3D-style pass delimited by binding render targets
+    file.chunks.push_back(MakeAnalysisChunk("ID3D11DeviceContext::OMSetRenderTargets", {img}));
+    file.chunks.push_back(MakeAnalysisChunk("ID3D11DeviceContext::Draw", {}));
+    file.chunks.push_back(MakeAnalysisChunk("ID3D11DeviceContext::Draw", {}));
+
+    FrameRecord record;
+    rdcarray<ResourceDescription> resources;
+    std::map<ResourceId, rdcarray<EventUsage>> usage;
+    rdcarray<uint32_t> actionPass;
+
+    AnalyseStructuredChunks(file.chunks, record, resources, usage, actionPass);
+
+    REQUIRE(resources.size() == 2);
+    CHECK(resources[0].resourceId == img);
+    CHECK(resources[0].type == ResourceType::Texture);
+    CHECK(resources[0].initialisationChunks == rdcarray<uint32_t>({0, 1}));
+    CHECK(resources[1].resourceId == buf);
+    CHECK(resources[1].type == ResourceType::Buffer);
+    CHECK(resources[1].initialisationChunks == rdcarray<uint32_t>({1}));
+
+    // one usage per event, even when referenced twice
+    CHECK(usage[buf].size() == 3);
+    CHECK(usage[img].size() == 2);
+
+    const rdcarray<ActionDescription> &actions = record.actionList;
+
+    // begin, draw, drawindexed, end, draw, draw, and an implicit present
+    REQUIRE(actions.size() == 7);
+    REQUIRE(actionPass.size() == actions.size());
+    CHECK(actions[2].eventId == 4);
+    CHECK(actions[2].events.size() == 2);
+    CHECK(actions.back().flags == ActionFlags::Present);
+
+    CHECK(PassEventsForAction(actions, actionPass, 2) == rdcarray<uint32_t>());
+    CHECK(PassEventsForAction(actions, actionPass, 4) == rdcarray<uint32_t>({2}));
+    CHECK(PassEventsForAction(actions, actionPass, 5) == rdcarray<uint32_t>({2, 4}));
+
+    // the output bind starts a new pass
+    CHECK(PassEventsForAction(actions, actionPass, 7) == rdcarray<uint32_t>());
+    CHECK(PassEventsForAction(actions, actionPass, 8) == rdcarray<uint32_t>({7}));
+
+    // not an action
+    CHECK(PassEventsForAction(actions, actionPass, 3) == rdcarray<uint32_t>());
+  };
+}
+
+#endif    // ENABLED(ENABLE_UNIT_TESTS)
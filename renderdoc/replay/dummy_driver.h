@@ -30,10 +30,17 @@
 // some fatal problem and shouldn't be used further. It saves significantly on needing to
 // bullet-proof each driver since instead we just need to make error paths clear and short, and rely
 // on the replay controller to detect errors and swap to a dummy driver immediately
+//
+// It can also be created standalone in an analysis-only mode, where instead of taking data from a
+// real driver it builds the action list, resource usage, pass events and statistics from the
+// capture's structured chunk stream alone. This doesn't need a GPU or any API support, so can be used
+// to bulk-process captures on headless machines. The results are approximate since they're derived
+// from chunk names and the resources each chunk references, not from replayed state.
 class DummyDriver : public IReplayDriver
 {
 public:
   DummyDriver(IReplayDriver *original, const rdcarray<ShaderReflection *> &shaders, SDFile *sdfile);
+  DummyDriver(RDCDriver driverType);
 
   void Shutdown();
 
@@ -99,6 +106,10 @@ public:
 
   rdcarray<PixelModification> PixelHistory(rdcarray<EventUsage> events, ResourceId target, uint32_t x,
                                            uint32_t y, const Subresource &sub, CompType typeCast);
+  rdcarray<PixelHistoryResult> PixelHistoryRegion(rdcarray<EventUsage> events, ResourceId target,
+                                                  uint32_t x, uint32_t y, uint32_t width,
+                                                  uint32_t height, const Subresource &sub,
+                                                  CompType typeCast);
   ShaderDebugTrace *DebugVertex(uint32_t eventId, uint32_t vertid, uint32_t instid, uint32_t idx,
                                 uint32_t view);
   ShaderDebugTrace *DebugPixel(uint32_t eventId, uint32_t x, uint32_t y, uint32_t sample,
@@ -181,6 +192,8 @@ public:
 private:
   virtual ~DummyDriver();
 
+  void AnalyseChunks(RDCFile *rdc, int sectionIdx);
+
   rdcarray<ShaderReflection *> m_Shaders;
   SDFile *m_SDFile;
 
@@ -197,4 +210,13 @@ private:
   rdcarray<WindowingSystem> m_WindowSystems;
   rdcarray<ShaderEncoding> m_CustomEncodings;
   rdcarray<ShaderSourcePrefix> m_CustomPrefixes;
+
+  // only used in analysis mode
+  bool m_Analysis = false;
+  RDCDriver m_DriverType = RDCDriver::Unknown;
+  std::map<ResourceId, rdcarray<EventUsage>> m_Usage;
+  // the pass index of each action in m_FrameRecord.actionList
+  rdcarray<uint32_t> m_ActionPass;
 };
+
+RDResult DUMMY_CreateAnalysisReplayDevice(RDCFile *rdc, IReplayDriver **driver);
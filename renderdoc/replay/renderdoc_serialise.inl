@@ -895,6 +895,16 @@ void DoSerialise(SerialiserType &ser, PixelModification &el)
   SIZE_CHECK(100);
 }
 
+template <typename SerialiserType>
+void DoSerialise(SerialiserType &ser, PixelHistoryResult &el)
+{
+  SERIALISE_MEMBER(x);
+  SERIALISE_MEMBER(y);
+  SERIALISE_MEMBER(modifications);
+
+  SIZE_CHECK(32);
+}
+
 template <typename SerialiserType>
 void DoSerialise(SerialiserType &ser, EventUsage &el)
 {
@@ -943,6 +953,7 @@ void DoSerialise(SerialiserType &ser, ReplayOptions &el)
   SERIALISE_MEMBER(forceGPUDeviceID);
   SERIALISE_MEMBER(forceGPUDriverName);
   SERIALISE_MEMBER(optimisation);
+  SERIALISE_MEMBER(analysisOnly);
 
   SIZE_CHECK(48);
 }
@@ -2391,6 +2402,7 @@ INSTANTIATE_SERIALISE_TYPE(CounterDescription)
 INSTANTIATE_SERIALISE_TYPE(PixelValue)
 INSTANTIATE_SERIALISE_TYPE(Subresource)
 INSTANTIATE_SERIALISE_TYPE(PixelModification)
+INSTANTIATE_SERIALISE_TYPE(PixelHistoryResult)
 INSTANTIATE_SERIALISE_TYPE(EventUsage)
 INSTANTIATE_SERIALISE_TYPE(CounterResult)
 INSTANTIATE_SERIALISE_TYPE(CounterValue)
@@ -27,12 +27,15 @@
 #include <string.h>
 #include <time.h>
 #include "common/dds_readwrite.h"
+#include "common/threading.h"
+#include "core/settings.h"
 #include "driver/ihv/amd/amd_isa.h"
 #include "driver/ihv/amd/amd_rgp.h"
 #include "jpeg-compressor/jpgd.h"
 #include "jpeg-compressor/jpge.h"
 #include "maths/formatpacking.h"
 #include "os/os_specific.h"
+#include "replay/dummy_driver.h"
 #include "serialise/rdcfile.h"
 #include "serialise/serialiser.h"
 #include "stb/stb_image.h"
@@ -40,6 +43,10 @@
 #include "strings/string_utils.h"
 #include "tinyexr/tinyexr.h"
 
+RDOC_CONFIG(uint32_t, Replay_PipelineStateCacheSize, 16,
+            "The number of recently selected events to keep the pipeline state for, so that "
+            "selecting them again is quicker. 0 disables the cache.");
+
 static void fileWriteFunc(void *context, void *data, int size)
 {
   FileIO::fwrite(data, 1, size, (FILE *)context);
@@ -84,7 +91,7 @@ void ReplayController::SetFrameEvent(uint32_t eventId, bool force)
     m_pDevice->ReplayLog(eventId, eReplay_OnlyDraw);
     FatalErrorCheck();
 
-    FetchPipelineState(eventId);
+    FetchPipelineState(eventId, force);
   }
 }
 
@@ -730,8 +737,29 @@ ResultDetails ReplayController::SaveTexture(const TextureSave &saveData, const r
     sd.slice.slicesAsGrid = false;
   }
 
+  // block compressed formats can be decoded on the CPU instead of needing a GPU remap, as long
+  // as no range mapping or type cast is needed. BC6 decodes to float so is only decoded for HDR
+  // outputs
+  const bool hdrDest = (sd.destType == FileType::HDR || sd.destType == FileType::EXR);
+  ResourceFormat compressedFormat;
+  bool cpuDecode = false;
+
+  if(sd.destType != FileType::DDS && CanCodeBlockCompressed(td.format) &&
+     sd.comp.blackPoint == 0.0f && sd.comp.whitePoint == 1.0f &&
+     (sd.typeCast == CompType::Typeless || sd.typeCast == td.format.compType) &&
+     (hdrDest || td.format.type != ResourceFormatType::BC6))
+  {
+    cpuDecode = true;
+    compressedFormat = td.format;
+    td.format = GetBlockCompressedDecodeFormat(compressedFormat);
+
+    // sRGB data is written as-is to LDR files
+    if(!hdrDest)
+      td.format.compType = CompType::UNorm;
+  }
+
   // force downcast to be able to do grid mappings
-  if(sd.slice.cubeCruciform || sd.slice.slicesAsGrid)
+  if((sd.slice.cubeCruciform || sd.slice.slicesAsGrid) && !cpuDecode)
     downcast = true;
 
   // we don't support any file formats that handle these block compression formats
@@ -877,6 +905,36 @@ ResultDetails ReplayController::SaveTexture(const TextureSave &saveData, const r
                             sub.slice, sub.sample);
       }
 
+      if(cpuDecode)
+      {
+        uint32_t w = RDCMAX(1U, td.width >> m);
+        uint32_t h = RDCMAX(1U, td.height >> m);
+        uint32_t d = RDCMAX(1U, td.depth >> m);
+
+        const size_t compressedSlice = RDCMAX(1U, (w + 3) / 4) * RDCMAX(1U, (h + 3) / 4) *
+                                       GetBlockCompressedBlockSize(compressedFormat);
+        const size_t decodedSlice = w * h * bytesPerPixel;
+
+        if(data.size() < compressedSlice * d)
+        {
+          for(size_t i = 0; i < subdata.size(); i++)
+            delete[] subdata[i];
+
+          RETURN_ERROR_RESULT(ResultCode::DataNotAvailable,
+                              "Insufficient data for mip %u, slice %u, sample %u", sub.mip,
+                              sub.slice, sub.sample);
+        }
+
+        bytebuf decoded;
+        decoded.resize(decodedSlice * d);
+
+        for(uint32_t di = 0; di < d; di++)
+          DecodeBlockCompressed(compressedFormat, w, h, data.data() + compressedSlice * di,
+                                decoded.data() + decodedSlice * di);
+
+        data.swap(decoded);
+      }
+
       if(td.depth == 1)
       {
         byte *bytes = new byte[data.size()];
@@ -952,28 +1010,25 @@ ResultDetails ReplayController::SaveTexture(const TextureSave &saveData, const r
 
     memset(combinedData, 0, td.width * td.height * pixelStride);
 
-    for(size_t i = 0; i < subdata.size(); i++)
-    {
-      uint32_t gridx = (uint32_t)i % sd.slice.sliceGridWidth;
-      uint32_t gridy = (uint32_t)i / sd.slice.sliceGridWidth;
-
-      uint32_t yoffs = gridy * sliceHeight;
-      uint32_t xoffs = gridx * sliceWidth;
+    const uint32_t gridWidth = sd.slice.sliceGridWidth;
+    const uint32_t combinedWidth = td.width;
 
-      for(uint32_t y = 0; y < sliceHeight; y++)
+    Threading::ParallelFor((uint32_t)subdata.size(), 1, [&](uint32_t begin, uint32_t end) {
+      for(uint32_t i = begin; i < end; i++)
       {
-        for(uint32_t x = 0; x < sliceWidth; x++)
-        {
-          uint32_t *srcpix = (uint32_t *)&subdata[i][(y * sliceWidth + x) * pixelStride + 0];
-          uint32_t *dstpix =
-              (uint32_t *)&combinedData[((y + yoffs) * td.width + x + xoffs) * pixelStride + 0];
+        uint32_t gridx = i % gridWidth;
+        uint32_t gridy = i / gridWidth;
 
-          memcpy(dstpix, srcpix, pixelStride);
-        }
-      }
+        uint32_t yoffs = gridy * sliceHeight;
+        uint32_t xoffs = gridx * sliceWidth;
 
-      delete[] subdata[i];
-    }
+        for(uint32_t y = 0; y < sliceHeight; y++)
+          memcpy(&combinedData[((y + yoffs) * combinedWidth + xoffs) * pixelStride],
+                 &subdata[i][y * sliceWidth * pixelStride], sliceWidth * pixelStride);
+
+        delete[] subdata[i];
+      }
+    });
 
     subdata.resize(1);
     subdata[0] = combinedData;
@@ -1020,16 +1075,8 @@ ResultDetails ReplayController::SaveTexture(const TextureSave &saveData, const r
       uint32_t xoffs = gridx[i] * sliceWidth;
 
       for(uint32_t y = 0; y < sliceHeight; y++)
-      {
-        for(uint32_t x = 0; x < sliceWidth; x++)
-        {
-          uint32_t *srcpix = (uint32_t *)&subdata[i][(y * sliceWidth + x) * pixelStride + 0];
-          uint32_t *dstpix =
-              (uint32_t *)&combinedData[((y + yoffs) * td.width + x + xoffs) * pixelStride + 0];
-
-          memcpy(dstpix, srcpix, pixelStride);
-        }
-      }
+        memcpy(&combinedData[((y + yoffs) * td.width + xoffs) * pixelStride],
+               &subdata[i][y * sliceWidth * pixelStride], sliceWidth * pixelStride);
 
       delete[] subdata[i];
     }
@@ -1266,7 +1313,7 @@ ResultDetails ReplayController::SaveTexture(const TextureSave &saveData, const r
         abgr[3] = new float[td.width * td.height];
       }
 
-      byte *srcData = subdata[0];
+      const byte *srcData = subdata[0];
 
       ResourceFormat saveFmt = td.format;
       if(saveFmt.compType == CompType::Typeless)
@@ -1280,59 +1327,74 @@ ResultDetails ReplayController::SaveTexture(const TextureSave &saveData, const r
       if(saveFmt.compType == CompType::Depth && pixStride == 3)
         pixStride = 4;
 
-      for(uint32_t y = 0; y < td.height; y++)
-      {
-        for(uint32_t x = 0; x < td.width; x++)
-        {
-          FloatVector pixel = DecodeFormattedComponents(saveFmt, srcData);
-          srcData += pixStride;
+      const bool clampNegative = (sd.destType == FileType::HDR);
+      const int32_t channelExtract = sd.channelExtract;
+      const uint32_t width = td.width;
 
-          // HDR can't represent negative values
-          if(sd.destType == FileType::HDR)
-          {
-            pixel.x = RDCMAX(pixel.x, 0.0f);
-            pixel.y = RDCMAX(pixel.y, 0.0f);
-            pixel.z = RDCMAX(pixel.z, 0.0f);
-            pixel.w = RDCMAX(pixel.w, 0.0f);
-          }
+      // decode whole rows at once so the format conversion is only selected once per row, and
+      // spread the rows across threads since this can be slow for large images
+      Threading::ParallelFor(td.height, 64, [&](uint32_t yBegin, uint32_t yEnd) {
+        rdcarray<FloatVector> row;
+        row.resize(width);
 
-          if(sd.channelExtract == 0)
-          {
-            pixel.y = pixel.z = pixel.x;
-            pixel.w = 1.0f;
-          }
-          else if(sd.channelExtract == 1)
-          {
-            pixel.x = pixel.z = pixel.y;
-            pixel.w = 1.0f;
-          }
-          else if(sd.channelExtract == 2)
-          {
-            pixel.x = pixel.y = pixel.z;
-            pixel.w = 1.0f;
-          }
-          else if(sd.channelExtract == 3)
-          {
-            pixel.x = pixel.y = pixel.z = pixel.w;
-            pixel.w = 1.0f;
-          }
+        for(uint32_t y = yBegin; y < yEnd; y++)
+        {
+          DecodeFormattedComponentsRow(saveFmt, srcData + size_t(y) * width * pixStride, pixStride,
+                                       width, row.data());
 
-          if(fldata)
-          {
-            fldata[(y * td.width + x) * 4 + 0] = pixel.x;
-            fldata[(y * td.width + x) * 4 + 1] = pixel.y;
-            fldata[(y * td.width + x) * 4 + 2] = pixel.z;
-            fldata[(y * td.width + x) * 4 + 3] = pixel.w;
-          }
-          else
+          for(uint32_t x = 0; x < width; x++)
           {
-            abgr[0][(y * td.width + x)] = pixel.w;
-            abgr[1][(y * td.width + x)] = pixel.z;
-            abgr[2][(y * td.width + x)] = pixel.y;
-            abgr[3][(y * td.width + x)] = pixel.x;
+            FloatVector pixel = row[x];
+
+            // HDR can't represent negative values
+            if(clampNegative)
+            {
+              pixel.x = RDCMAX(pixel.x, 0.0f);
+              pixel.y = RDCMAX(pixel.y, 0.0f);
+              pixel.z = RDCMAX(pixel.z, 0.0f);
+              pixel.w = RDCMAX(pixel.w, 0.0f);
+            }
+
+            if(channelExtract == 0)
+            {
+              pixel.y = pixel.z = pixel.x;
+              pixel.w = 1.0f;
+            }
+            else if(channelExtract == 1)
+            {
+              pixel.x = pixel.z = pixel.y;
+              pixel.w = 1.0f;
+            }
+            else if(channelExtract == 2)
+            {
+              pixel.x = pixel.y = pixel.z;
+              pixel.w = 1.0f;
+            }
+            else if(channelExtract == 3)
+            {
+              pixel.x = pixel.y = pixel.z = pixel.w;
+              pixel.w = 1.0f;
+            }
+
+            const size_t idx = size_t(y) * width + x;
+
+            if(fldata)
+            {
+              fldata[idx * 4 + 0] = pixel.x;
+              fldata[idx * 4 + 1] = pixel.y;
+              fldata[idx * 4 + 2] = pixel.z;
+              fldata[idx * 4 + 3] = pixel.w;
+            }
+            else
+            {
+              abgr[0][idx] = pixel.w;
+              abgr[1][idx] = pixel.z;
+              abgr[2][idx] = pixel.y;
+              abgr[3][idx] = pixel.x;
+            }
           }
         }
-      }
+      });
 
       if(sd.destType == FileType::HDR)
       {
@@ -1412,17 +1474,11 @@ ResultDetails ReplayController::SaveTexture(const TextureSave &saveData, const r
   return res;
 }
 
-rdcarray<PixelModification> ReplayController::PixelHistory(ResourceId target, uint32_t x, uint32_t y,
-                                                           const Subresource &sub, CompType typeCast)
+bool ReplayController::PreparePixelHistory(ResourceId target, uint32_t x, uint32_t y,
+                                           uint32_t &width, uint32_t &height,
+                                           Subresource &subresource, ResourceId &liveId,
+                                           rdcarray<EventUsage> &events)
 {
-  CHECK_REPLAY_THREAD();
-
-  RENDERDOC_PROFILEFUNCTION();
-
-  rdcarray<PixelModification> ret;
-
-  Subresource subresource = sub;
-
   for(size_t t = 0; t < m_Textures.size(); t++)
   {
     if(m_Textures[t].resourceId == target)
@@ -1431,9 +1487,12 @@ rdcarray<PixelModification> ReplayController::PixelHistory(ResourceId target, ui
       {
         RDCDEBUG("PixelHistory out of bounds on %s (%u,%u) vs (%u,%u)", ToStr(target).c_str(), x, y,
                  m_Textures[t].width, m_Textures[t].height);
-        return ret;
+        return false;
       }
 
+      width = RDCMIN(width, m_Textures[t].width - x);
+      height = RDCMIN(height, m_Textures[t].height - y);
+
       if(m_Textures[t].msSamp == 1)
         subresource.sample = ~0U;
 
@@ -1455,12 +1514,10 @@ rdcarray<PixelModification> ReplayController::PixelHistory(ResourceId target, ui
   ResourceId id = m_pDevice->GetLiveID(target);
 
   if(id == ResourceId())
-    return ret;
+    return false;
 
   rdcarray<EventUsage> usage = m_pDevice->GetUsage(id);
 
-  rdcarray<EventUsage> events;
-
   for(size_t i = 0; i < usage.size(); i++)
   {
     if(usage[i].eventId > m_EventID)
@@ -1527,12 +1584,29 @@ rdcarray<PixelModification> ReplayController::PixelHistory(ResourceId target, ui
   if(events.empty())
   {
     RDCDEBUG("Target %s not written to before %u", ToStr(target).c_str(), m_EventID);
-    return ret;
+    return false;
   }
 
-  id = m_pDevice->GetLiveID(target);
+  liveId = m_pDevice->GetLiveID(target);
 
-  if(id == ResourceId())
+  return liveId != ResourceId();
+}
+
+rdcarray<PixelModification> ReplayController::PixelHistory(ResourceId target, uint32_t x, uint32_t y,
+                                                           const Subresource &sub, CompType typeCast)
+{
+  CHECK_REPLAY_THREAD();
+
+  RENDERDOC_PROFILEFUNCTION();
+
+  rdcarray<PixelModification> ret;
+
+  Subresource subresource = sub;
+  uint32_t width = 1, height = 1;
+  ResourceId id;
+  rdcarray<EventUsage> events;
+
+  if(!PreparePixelHistory(target, x, y, width, height, subresource, id, events))
     return ret;
 
   ret = m_pDevice->PixelHistory(events, id, x, y, subresource, typeCast);
@@ -1543,6 +1617,36 @@ rdcarray<PixelModification> ReplayController::PixelHistory(ResourceId target, ui
   return ret;
 }
 
+rdcarray<PixelHistoryResult> ReplayController::PixelHistoryRegion(ResourceId target, uint32_t x,
+                                                                  uint32_t y, uint32_t width,
+                                                                  uint32_t height,
+                                                                  const Subresource &sub,
+                                                                  CompType typeCast)
+{
+  CHECK_REPLAY_THREAD();
+
+  RENDERDOC_PROFILEFUNCTION();
+
+  rdcarray<PixelHistoryResult> ret;
+
+  if(width == 0 || height == 0)
+    return ret;
+
+  Subresource subresource = sub;
+  ResourceId id;
+  rdcarray<EventUsage> events;
+
+  if(!PreparePixelHistory(target, x, y, width, height, subresource, id, events))
+    return ret;
+
+  ret = m_pDevice->PixelHistoryRegion(events, id, x, y, width, height, subresource, typeCast);
+  FatalErrorCheck();
+
+  SetFrameEvent(m_EventID, true);
+
+  return ret;
+}
+
 PixelValue ReplayController::PickPixel(ResourceId tex, uint32_t x, uint32_t y,
                                        const Subresource &sub, CompType typeCast)
 {
@@ -2107,7 +2211,12 @@ RDResult ReplayController::CreateDevice(RDCFile *rdc, const ReplayOptions &opts)
   RENDERDOC_PROFILEFUNCTION();
 
   IReplayDriver *driver = NULL;
-  RDResult result = RenderDoc::Inst().CreateReplayDriver(rdc, opts, &driver);
+  RDResult result;
+
+  if(opts.analysisOnly)
+    result = DUMMY_CreateAnalysisReplayDevice(rdc, &driver);
+  else
+    result = RenderDoc::Inst().CreateReplayDriver(rdc, opts, &driver);
 
   if(driver && result == ResultCode::Succeeded)
   {
@@ -2177,7 +2286,7 @@ RDResult ReplayController::PostCreateInit(IReplayDriver *device, RDCFile *rdc)
   m_Actions.clear();
   SetupActionPointers(m_Actions, m_FrameRecord.actionList);
 
-  FetchPipelineState(m_Actions.back()->eventId);
+  FetchPipelineState(m_Actions.back()->eventId, true);
   FatalErrorCheck();
 
   return m_FatalError;
@@ -2197,14 +2306,53 @@ APIProperties ReplayController::GetAPIProperties()
   return m_pDevice->GetAPIProperties();
 }
 
-void ReplayController::FetchPipelineState(uint32_t eventId)
+template <typename State>
+static bool FetchCachedPipelineState(PipelineStateCache<State> &cache, uint32_t eventId,
+                                     State &state, bool force)
+{
+  cache.SetCapacity(Replay_PipelineStateCacheSize());
+
+  // a forced fetch means the state could have changed, so nothing cached is valid any more
+  if(force)
+    cache.Clear();
+
+  return cache.Fetch(eventId, state);
+}
+
+void ReplayController::FetchPipelineState(uint32_t eventId, bool force)
 {
   CHECK_REPLAY_THREAD();
 
   RENDERDOC_PROFILEFUNCTION();
 
-  m_pDevice->SavePipelineState(eventId);
-  FatalErrorCheck();
+  bool cached = false;
+
+  if(m_APIProps.pipelineType == GraphicsAPI::D3D11)
+    cached = FetchCachedPipelineState(m_D3D11PipelineStateCache, eventId, m_D3D11PipelineState,
+                                      force);
+  else if(m_APIProps.pipelineType == GraphicsAPI::D3D12)
+    cached = FetchCachedPipelineState(m_D3D12PipelineStateCache, eventId, m_D3D12PipelineState,
+                                      force);
+  else if(m_APIProps.pipelineType == GraphicsAPI::OpenGL)
+    cached = FetchCachedPipelineState(m_GLPipelineStateCache, eventId, m_GLPipelineState, force);
+  else if(m_APIProps.pipelineType == GraphicsAPI::Vulkan)
+    cached = FetchCachedPipelineState(m_VulkanPipelineStateCache, eventId, m_VulkanPipelineState,
+                                      force);
+
+  if(!cached)
+  {
+    m_pDevice->SavePipelineState(eventId);
+    FatalErrorCheck();
+
+    if(m_APIProps.pipelineType == GraphicsAPI::D3D11)
+      m_D3D11PipelineStateCache.Store(eventId, m_D3D11PipelineState);
+    else if(m_APIProps.pipelineType == GraphicsAPI::D3D12)
+      m_D3D12PipelineStateCache.Store(eventId, m_D3D12PipelineState);
+    else if(m_APIProps.pipelineType == GraphicsAPI::OpenGL)
+      m_GLPipelineStateCache.Store(eventId, m_GLPipelineState);
+    else if(m_APIProps.pipelineType == GraphicsAPI::Vulkan)
+      m_VulkanPipelineStateCache.Store(eventId, m_VulkanPipelineState);
+  }
 
   if(m_APIProps.pipelineType == GraphicsAPI::D3D11)
     m_PipeState.SetState(&m_D3D11PipelineState);
@@ -2215,3 +2363,64 @@ void ReplayController::FetchPipelineState(uint32_t eventId)
   else if(m_APIProps.pipelineType == GraphicsAPI::Vulkan)
     m_PipeState.SetState(&m_VulkanPipelineState);
 }
+
+#if ENABLED(ENABLE_UNIT_TESTS)
+
+#include "catch/catch.hpp"
+
+TEST_CASE("Check pipeline state cache", "[replay]")
+{
+  PipelineStateCache<rdcstr> cache;
+  rdcstr state;
+
+  SECTION("Nothing is cached with no capacity")
+  {
+    cache.Store(10, "ten");
+    CHECK(cache.GetCount() == 0);
+    CHECK_FALSE(cache.Fetch(10, state));
+  };
+
+  cache.SetCapacity(2);
+
+  SECTION("Cached states are returned")
+  {
+    cache.Store(10, "ten");
+    cache.Store(20, "twenty");
+
+    CHECK(cache.Fetch(10, state));
+    CHECK(state == "ten");
+    CHECK(cache.Fetch(20, state));
+    CHECK(state == "twenty");
+    CHECK_FALSE(cache.Fetch(30, state));
+    CHECK(state == "twenty");
+
+    cache.Store(10, "TEN");
+    CHECK(cache.Fetch(10, state));
+    CHECK(state == "TEN");
+    CHECK(cache.GetCount() == 2);
+  };
+
+  SECTION("The least recently used state is dropped")
+  {
+    cache.Store(10, "ten");
+    cache.Store(20, "twenty");
+
+    // using 10 makes 20 the least recently used
+    CHECK(cache.Fetch(10, state));
+
+    cache.Store(30, "thirty");
+    CHECK(cache.GetCount() == 2);
+    CHECK(cache.Fetch(10, state));
+    CHECK(cache.Fetch(30, state));
+    CHECK_FALSE(cache.Fetch(20, state));
+
+    cache.SetCapacity(1);
+    CHECK(cache.GetCount() == 1);
+    CHECK(cache.Fetch(30, state));
+
+    cache.Clear();
+    CHECK(cache.GetCount() == 0);
+  };
+}
+
+#endif    // ENABLED(ENABLE_UNIT_TESTS)
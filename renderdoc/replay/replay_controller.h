@@ -123,6 +123,68 @@ private:
   friend struct ReplayController;
 };
 
+// copies of the pipeline state fetched at recently selected events, so that selecting one of them
+// again doesn't need the driver to fetch the whole state again. The least recently used state is
+// dropped once more than the capacity are cached.
+template <typename State>
+class PipelineStateCache
+{
+public:
+  void SetCapacity(size_t capacity)
+  {
+    m_Capacity = capacity;
+    Trim();
+  }
+
+  bool Fetch(uint32_t eventId, State &state)
+  {
+    auto it = m_Entries.find(eventId);
+    if(it == m_Entries.end())
+      return false;
+
+    it->second.lastUse = ++m_UseCounter;
+    state = it->second.state;
+    return true;
+  }
+
+  void Store(uint32_t eventId, const State &state)
+  {
+    if(m_Capacity == 0)
+      return;
+
+    Entry &entry = m_Entries[eventId];
+    entry.lastUse = ++m_UseCounter;
+    entry.state = state;
+    Trim();
+  }
+
+  void Clear() { m_Entries.clear(); }
+  size_t GetCount() const { return m_Entries.size(); }
+
+private:
+  void Trim()
+  {
+    while(m_Entries.size() > m_Capacity)
+    {
+      auto lru = m_Entries.begin();
+      for(auto it = m_Entries.begin(); it != m_Entries.end(); ++it)
+        if(it->second.lastUse < lru->second.lastUse)
+          lru = it;
+      m_Entries.erase(lru);
+    }
+  }
+
+  struct Entry
+  {
+    uint64_t lastUse;
+    State state;
+  };
+
+  std::map<uint32_t, Entry> m_Entries;
+  size_t m_Capacity = 0;
+  uint64_t m_UseCounter = 0;
+};
+
 struct ReplayController : public IReplayController
 {
 public:
@@ -194,6 +256,9 @@ public:
                                   float minval, float maxval, const rdcfixedarray<bool, 4> &channels);
   rdcarray<PixelModification> PixelHistory(ResourceId target, uint32_t x, uint32_t y,
                                            const Subresource &sub, CompType typeCast);
+  rdcarray<PixelHistoryResult> PixelHistoryRegion(ResourceId target, uint32_t x, uint32_t y,
+                                                  uint32_t width, uint32_t height,
+                                                  const Subresource &sub, CompType typeCast);
   ShaderDebugTrace *DebugVertex(uint32_t vertid, uint32_t instid, uint32_t idx, uint32_t view);
   ShaderDebugTrace *DebugPixel(uint32_t x, uint32_t y, uint32_t sample, uint32_t primitive);
   ShaderDebugTrace *DebugThread(const rdcfixedarray<uint32_t, 3> &groupid,
@@ -233,7 +298,10 @@ private:
   virtual ~ReplayController();
   RDResult PostCreateInit(IReplayDriver *device, RDCFile *rdc);
 
-  void FetchPipelineState(uint32_t eventId);
+  void FetchPipelineState(uint32_t eventId, bool force);
+  bool PreparePixelHistory(ResourceId target, uint32_t x, uint32_t y, uint32_t &width,
+                           uint32_t &height, Subresource &subresource, ResourceId &liveId,
+                           rdcarray<EventUsage> &events);
 
   ActionDescription *GetActionByEID(uint32_t eventId);
   bool ContainsMarker(const rdcarray<ActionDescription> &actions);
@@ -264,6 +332,11 @@ private:
   VKPipe::State m_VulkanPipelineState;
   PipeState m_PipeState;
 
+  PipelineStateCache<D3D11Pipe::State> m_D3D11PipelineStateCache;
+  PipelineStateCache<D3D12Pipe::State> m_D3D12PipelineStateCache;
+  PipelineStateCache<GLPipe::State> m_GLPipelineStateCache;
+  PipelineStateCache<VKPipe::State> m_VulkanPipelineStateCache;
+
   rdcarray<ReplayOutput *> m_Outputs;
 
   rdcarray<ResourceDescription> m_Resources;
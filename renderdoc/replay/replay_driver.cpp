@@ -23,6 +23,7 @@
  ******************************************************************************/
 
 #include "replay_driver.h"
+#include "common/threading.h"
 #include "compressonator/CMP_Core.h"
 #include "maths/formatpacking.h"
 #include "maths/half_convert.h"
@@ -785,6 +786,30 @@ uint64_t CalcMeshOutputSize(uint64_t curSize, uint64_t requiredOutput)
   return curSize;
 }
 
+rdcarray<PixelHistoryResult> PixelHistoryEachPixel(IReplayDriver *driver,
+                                                   const rdcarray<EventUsage> &events,
+                                                   ResourceId target, uint32_t x, uint32_t y,
+                                                   uint32_t width, uint32_t height,
+                                                   const Subresource &sub, CompType typeCast)
+{
+  rdcarray<PixelHistoryResult> ret;
+  ret.reserve(width * height);
+
+  for(uint32_t py = y; py < y + height; py++)
+  {
+    for(uint32_t px = x; px < x + width; px++)
+    {
+      PixelHistoryResult res;
+      res.x = px;
+      res.y = py;
+      res.modifications = driver->PixelHistory(events, target, px, py, sub, typeCast);
+      ret.push_back(res);
+    }
+  }
+
+  return ret;
+}
+
 FloatVector HighlightCache::InterpretVertex(const byte *data, uint32_t vert, const MeshDisplay &cfg,
                                             const byte *end, bool useidx, bool &valid)
 {
@@ -1647,110 +1672,59 @@ bytebuf GetDiscardPattern(DiscardType type, const ResourceFormat &fmt, uint32_t
           fmt.type == ResourceFormatType::BC5 || fmt.type == ResourceFormatType::BC6 ||
           fmt.type == ResourceFormatType::BC7)
   {
-#if ENABLED(RDOC_ANDROID)
-    RDCERR("Format %s not supported on android", fmt.Name().c_str());
-#else
-    const uint16_t whalf = ConvertToHalf(1000.0f);
-
-    byte block[16];
-
-    uint32_t blockSize =
-        fmt.type == ResourceFormatType::BC1 || fmt.type == ResourceFormatType::BC4 ? 8 : 16;
-    uint32_t tightPitch = (DiscardPatternWidth / 4) * blockSize;
-    rowPitch = RDCMAX(rowPitch, tightPitch);
+    // build the pattern as an uncompressed image in the format EncodeBlockCompressed expects, then
+    // compress it
+    const bool bc6 = (fmt.type == ResourceFormatType::BC6);
+    const uint32_t pixelSize = bc6 ? sizeof(float) * 4 : sizeof(uint32_t);
 
-    ret.reserve(rowPitch * (DiscardPatternHeight / 4));
+    bytebuf decoded;
+    decoded.resize(DiscardPatternWidth * DiscardPatternHeight * pixelSize);
 
-    bytebuf inblock;
+    byte *out = decoded.data();
 
-    void *bc6opts = NULL;
-
-    CreateOptionsBC6(&bc6opts);
-
-    SetQualityBC6(bc6opts, 0.1f);
-
-    for(uint32_t yi = 0; yi < DiscardPatternHeight; yi += 4)
+    for(uint32_t yi = 0; yi < DiscardPatternHeight; yi++)
     {
-      uint32_t baseY = invert ? DiscardPatternHeight - 1 - yi : yi;
-
-      for(uint32_t baseX = 0; baseX < DiscardPatternWidth; baseX += 4)
+      uint32_t y = invert ? DiscardPatternHeight - 1 - yi : yi;
+      for(uint32_t x = 0; x < DiscardPatternWidth; x++)
       {
-        inblock.clear();
+        char c = pattern.c_str()[y * DiscardPatternWidth + x];
 
-        // inblock is 4x4 RGBA8_UNORM
-        if(fmt.type == ResourceFormatType::BC1 || fmt.type == ResourceFormatType::BC2 ||
-           fmt.type == ResourceFormatType::BC3 || fmt.type == ResourceFormatType::BC7)
+        if(bc6)
         {
-          for(uint32_t y = baseY; y < baseY + 4; invert ? y-- : y++)
-          {
-            for(uint32_t x = baseX; x < baseX + 4; x++)
-            {
-              char c = pattern.c_str()[y * DiscardPatternWidth + x];
-
-              inblock.push_back(c == '#' ? 0xff : 0x00);
-              inblock.push_back(c == '#' ? 0xff : 0x00);
-              inblock.push_back(c == '#' ? 0xff : 0x00);
-              inblock.push_back(c == '#' ? 0xff : 0x00);
-            }
-          }
+          float col[4] = {0.0f, 0.0f, 0.0f, 1.0f};
+          if(c == '#')
+            col[0] = col[1] = col[2] = 1000.0f;
+          memcpy(out, col, sizeof(col));
         }
-        // inblock is 4x4 R8_UNORM
-        else if(fmt.type == ResourceFormatType::BC4 || fmt.type == ResourceFormatType::BC5)
+        else
         {
-          for(uint32_t y = baseY; y < baseY + 4; invert ? y-- : y++)
-          {
-            for(uint32_t x = baseX; x < baseX + 4; x++)
-            {
-              char c = pattern.c_str()[y * DiscardPatternWidth + x];
-
-              inblock.push_back(c == '#' ? 0xff : 0x00);
-            }
-          }
+          memset(out, c == '#' ? 0xff : 0x00, pixelSize);
         }
-        // inblock is 4x4 RGB16_FLOAT
-        else if(fmt.type == ResourceFormatType::BC6)
-        {
-          for(uint32_t y = baseY; y < baseY + 4; invert ? y-- : y++)
-          {
-            for(uint32_t x = baseX; x < baseX + 4; x++)
-            {
-              char c = pattern.c_str()[y * DiscardPatternWidth + x];
 
-              inblock.push_back(c == '#' ? (whalf & 0xff) : 0x00);
-              inblock.push_back(c == '#' ? ((whalf >> 8) & 0xff) : 0x00);
+        out += pixelSize;
+      }
+    }
 
-              inblock.push_back(c == '#' ? (whalf & 0xff) : 0x00);
-              inblock.push_back(c == '#' ? ((whalf >> 8) & 0xff) : 0x00);
+    uint32_t blockSize = GetBlockCompressedBlockSize(fmt);
+    uint32_t tightPitch = (DiscardPatternWidth / 4) * blockSize;
+    rowPitch = RDCMAX(rowPitch, tightPitch);
 
-              inblock.push_back(c == '#' ? (whalf & 0xff) : 0x00);
-              inblock.push_back(c == '#' ? ((whalf >> 8) & 0xff) : 0x00);
-            }
-          }
-        }
+    bytebuf encoded;
+    encoded.resize(tightPitch * (DiscardPatternHeight / 4));
 
-        if(fmt.type == ResourceFormatType::BC1)
-          CompressBlockBC1(inblock.data(), 4 * sizeof(uint32_t), block, NULL);
-        else if(fmt.type == ResourceFormatType::BC2)
-          CompressBlockBC2(inblock.data(), 4 * sizeof(uint32_t), block, NULL);
-        else if(fmt.type == ResourceFormatType::BC3)
-          CompressBlockBC3(inblock.data(), 4 * sizeof(uint32_t), block, NULL);
-        else if(fmt.type == ResourceFormatType::BC4)
-          CompressBlockBC4(inblock.data(), 4, block, NULL);
-        else if(fmt.type == ResourceFormatType::BC5)
-          CompressBlockBC5(inblock.data(), 4, inblock.data(), 4, block, NULL);
-        else if(fmt.type == ResourceFormatType::BC6)
-          CompressBlockBC6((uint16_t *)inblock.data(), 4 * 3, block, bc6opts);
-        else if(fmt.type == ResourceFormatType::BC7)
-          CompressBlockBC7(inblock.data(), 4 * sizeof(uint32_t), block, NULL);
-
-        ret.append(block, blockSize);
-      }
+    // the pattern is only black and white, so BC6 doesn't need the slow default quality
+    if(EncodeBlockCompressed(fmt, DiscardPatternWidth, DiscardPatternHeight, decoded.data(),
+                             encoded.data(), 0.1f))
+    {
+      ret.resize(rowPitch * (DiscardPatternHeight / 4));
 
-      ret.resize(ret.size() + (rowPitch - tightPitch));
+      for(uint32_t y = 0; y < DiscardPatternHeight / 4; y++)
+        memcpy(ret.data() + y * rowPitch, encoded.data() + y * tightPitch, tightPitch);
+    }
+    else
+    {
+      RDCERR("Format %s not supported for CPU block compression", fmt.Name().c_str());
     }
-
-    DestroyOptionsBC6(bc6opts);
-#endif
   }
   else if(fmt.type == ResourceFormatType::ETC2 || fmt.type == ResourceFormatType::EAC ||
           fmt.type == ResourceFormatType::ASTC || fmt.type == ResourceFormatType::PVRTC ||
@@ -1797,3 +1771,492 @@ bytebuf GetDiscardPattern(DiscardType type, const ResourceFormat &fmt, uint32_t
 
   return ret;
 }
+
+static bool IsBlockCompressed(const ResourceFormat &fmt)
+{
+  return fmt.type == ResourceFormatType::BC1 || fmt.type == ResourceFormatType::BC2 ||
+         fmt.type == ResourceFormatType::BC3 || fmt.type == ResourceFormatType::BC4 ||
+         fmt.type == ResourceFormatType::BC5 || fmt.type == ResourceFormatType::BC6 ||
+         fmt.type == ResourceFormatType::BC7;
+}
+
+uint32_t GetBlockCompressedBlockSize(const ResourceFormat &fmt)
+{
+  if(!IsBlockCompressed(fmt))
+    return 0;
+
+  return fmt.type == ResourceFormatType::BC1 || fmt.type == ResourceFormatType::BC4 ? 8 : 16;
+}
+
+bool CanCodeBlockCompressed(const ResourceFormat &fmt)
+{
+#if ENABLED(RDOC_ANDROID)
+  return false;
+#else
+  if(!IsBlockCompressed(fmt))
+    return false;
+
+  // the codecs only handle unsigned data
+  if((fmt.type == ResourceFormatType::BC4 || fmt.type == ResourceFormatType::BC5 ||
+      fmt.type == ResourceFormatType::BC6) &&
+     fmt.compType == CompType::SNorm)
+    return false;
+
+  return true;
+#endif
+}
+
+ResourceFormat GetBlockCompressedDecodeFormat(const ResourceFormat &fmt)
+{
+  ResourceFormat ret;
+  ret.type = ResourceFormatType::Regular;
+  ret.compCount = 4;
+
+  if(fmt.type == ResourceFormatType::BC6)
+  {
+    ret.compByteWidth = 4;
+    ret.compType = CompType::Float;
+  }
+  else
+  {
+    ret.compByteWidth = 1;
+    ret.compType = fmt.compType == CompType::UNormSRGB ? CompType::UNormSRGB : CompType::UNorm;
+  }
+
+  return ret;
+}
+
+bool DecodeBlockCompressed(const ResourceFormat &fmt, uint32_t width, uint32_t height,
+                           const byte *src, byte *dst)
+{
+  if(!CanCodeBlockCompressed(fmt))
+    return false;
+
+#if ENABLED(RDOC_ANDROID)
+  return false;
+#else
+  const uint32_t blockSize = GetBlockCompressedBlockSize(fmt);
+  const uint32_t blocksWide = RDCMAX(1U, (width + 3) / 4);
+  const uint32_t blocksHigh = RDCMAX(1U, (height + 3) / 4);
+  const ResourceFormatType type = fmt.type;
+  const uint32_t pixelSize = type == ResourceFormatType::BC6 ? sizeof(float) * 4 : sizeof(uint32_t);
+
+  Threading::ParallelFor(blocksHigh, 16, [=](uint32_t begin, uint32_t end) {
+    byte rgba[4 * 4 * 4];
+    byte r[4 * 4], g[4 * 4];
+    uint16_t rgbHalf[4 * 4 * 3];
+    float rgbaFloat[4 * 4 * 4];
+
+    for(uint32_t by = begin; by < end; by++)
+    {
+      const byte *block = src + by * blocksWide * blockSize;
+
+      for(uint32_t bx = 0; bx < blocksWide; bx++, block += blockSize)
+      {
+        const byte *decoded = rgba;
+
+        switch(type)
+        {
+          case ResourceFormatType::BC1: DecompressBlockBC1(block, rgba, NULL); break;
+          case ResourceFormatType::BC2: DecompressBlockBC2(block, rgba, NULL); break;
+          case ResourceFormatType::BC3: DecompressBlockBC3(block, rgba, NULL); break;
+          case ResourceFormatType::BC7: DecompressBlockBC7(block, rgba, NULL); break;
+          case ResourceFormatType::BC4:
+          case ResourceFormatType::BC5:
+          {
+            memset(g, 0, sizeof(g));
+            if(type == ResourceFormatType::BC4)
+              DecompressBlockBC4(block, r, NULL);
+            else
+              DecompressBlockBC5(block, r, g, NULL);
+
+            for(uint32_t i = 0; i < 16; i++)
+            {
+              rgba[i * 4 + 0] = r[i];
+              rgba[i * 4 + 1] = g[i];
+              rgba[i * 4 + 2] = 0;
+              rgba[i * 4 + 3] = 0xff;
+            }
+            break;
+          }
+          case ResourceFormatType::BC6:
+          {
+            DecompressBlockBC6(block, rgbHalf, NULL);
+
+            for(uint32_t i = 0; i < 16; i++)
+            {
+              rgbaFloat[i * 4 + 0] = ConvertFromHalf(rgbHalf[i * 3 + 0]);
+              rgbaFloat[i * 4 + 1] = ConvertFromHalf(rgbHalf[i * 3 + 1]);
+              rgbaFloat[i * 4 + 2] = ConvertFromHalf(rgbHalf[i * 3 + 2]);
+              rgbaFloat[i * 4 + 3] = 1.0f;
+            }
+
+            decoded = (const byte *)rgbaFloat;
+            break;
+          }
+          default: break;
+        }
+
+        // copy the block out, clipping to the texture dimensions
+        const uint32_t x = bx * 4, y = by * 4;
+        const uint32_t copyWidth = RDCMIN(4U, width - x);
+
+        for(uint32_t row = 0; row < 4 && y + row < height; row++)
+          memcpy(dst + ((y + row) * width + x) * pixelSize, decoded + row * 4 * pixelSize,
+                 copyWidth * pixelSize);
+      }
+    }
+  });
+
+  return true;
+#endif
+}
+
+bool EncodeBlockCompressed(const ResourceFormat &fmt, uint32_t width, uint32_t height,
+                           const byte *src, byte *dst, float bc6Quality)
+{
+  // signed formats are deliberately not rejected here, the unsigned codecs are used and the bits
+  // written as-is. That's fine for fill patterns which only need a recognisable bit pattern.
+  if(!IsBlockCompressed(fmt))
+    return false;
+
+#if ENABLED(RDOC_ANDROID)
+  return false;
+#else
+  void *bc6opts = NULL;
+  if(fmt.type == ResourceFormatType::BC6)
+  {
+    CreateOptionsBC6(&bc6opts);
+    SetQualityBC6(bc6opts, bc6Quality);
+  }
+
+  const uint32_t blockSize = GetBlockCompressedBlockSize(fmt);
+  const uint32_t blocksWide = RDCMAX(1U, (width + 3) / 4);
+  const uint32_t blocksHigh = RDCMAX(1U, (height + 3) / 4);
+  const ResourceFormatType type = fmt.type;
+  const uint32_t pixelSize = type == ResourceFormatType::BC6 ? sizeof(float) * 4 : sizeof(uint32_t);
+
+  // encoding is much slower than decoding, so split more finely across threads
+  Threading::ParallelFor(blocksHigh, 1, [=](uint32_t begin, uint32_t end) {
+    byte rgba[4 * 4 * 4];
+    byte r[4 * 4], g[4 * 4];
+    uint16_t rgbHalf[4 * 4 * 3];
+    float rgbaFloat[4 * 4 * 4];
+
+    byte *inblock = type == ResourceFormatType::BC6 ? (byte *)rgbaFloat : rgba;
+
+    for(uint32_t by = begin; by < end; by++)
+    {
+      byte *block = dst + by * blocksWide * blockSize;
+
+      for(uint32_t bx = 0; bx < blocksWide; bx++, block += blockSize)
+      {
+        // gather the block, clamping to the edge of the texture for partial blocks
+        for(uint32_t row = 0; row < 4; row++)
+        {
+          const uint32_t y = RDCMIN(by * 4 + row, height - 1);
+
+          for(uint32_t col = 0; col < 4; col++)
+          {
+            const uint32_t x = RDCMIN(bx * 4 + col, width - 1);
+            memcpy(inblock + (row * 4 + col) * pixelSize, src + (y * width + x) * pixelSize,
+                   pixelSize);
+          }
+        }
+
+        switch(type)
+        {
+          case ResourceFormatType::BC1:
+            CompressBlockBC1(rgba, 4 * sizeof(uint32_t), block, NULL);
+            break;
+          case ResourceFormatType::BC2:
+            CompressBlockBC2(rgba, 4 * sizeof(uint32_t), block, NULL);
+            break;
+          case ResourceFormatType::BC3:
+            CompressBlockBC3(rgba, 4 * sizeof(uint32_t), block, NULL);
+            break;
+          case ResourceFormatType::BC7:
+            CompressBlockBC7(rgba, 4 * sizeof(uint32_t), block, NULL);
+            break;
+          case ResourceFormatType::BC4:
+          case ResourceFormatType::BC5:
+          {
+            for(uint32_t i = 0; i < 16; i++)
+            {
+              r[i] = rgba[i * 4 + 0];
+              g[i] = rgba[i * 4 + 1];
+            }
+
+            if(type == ResourceFormatType::BC4)
+              CompressBlockBC4(r, 4, block, NULL);
+            else
+              CompressBlockBC5(r, 4, g, 4, block, NULL);
+            break;
+          }
+          case ResourceFormatType::BC6:
+          {
+            for(uint32_t i = 0; i < 16; i++)
+            {
+              rgbHalf[i * 3 + 0] = ConvertToHalf(rgbaFloat[i * 4 + 0]);
+              rgbHalf[i * 3 + 1] = ConvertToHalf(rgbaFloat[i * 4 + 1]);
+              rgbHalf[i * 3 + 2] = ConvertToHalf(rgbaFloat[i * 4 + 2]);
+            }
+
+            CompressBlockBC6(rgbHalf, 4 * 3, block, bc6opts);
+            break;
+          }
+          default: break;
+        }
+      }
+    }
+  });
+
+  if(bc6opts)
+    DestroyOptionsBC6(bc6opts);
+
+  return true;
+#endif
+}
+
+void ReplayCheckpointSchedule::Configure(uint32_t interval, uint64_t budget)
+{
+  m_Interval = interval;
+  m_Budget = budget;
+}
+
+uint32_t ReplayCheckpointSchedule::FindRestorePoint(uint32_t eventId)
+{
+  for(size_t i = m_Checkpoints.size(); i > 0; i--)
+  {
+    Checkpoint &c = m_Checkpoints[i - 1];
+    if(c.eventId <= eventId)
+    {
+      c.lastUse = ++m_UseCounter;
+      return c.eventId;
+    }
+  }
+
+  return 0;
+}
+
+bool ReplayCheckpointSchedule::WantCheckpoint(uint32_t eventId) const
+{
+  // a checkpoint near the start of the frame saves less than it costs to take
+  if(!Enabled() || eventId < m_Interval)
+    return false;
+
+  for(const Checkpoint &c : m_Checkpoints)
+  {
+    uint32_t dist = c.eventId > eventId ? c.eventId - eventId : eventId - c.eventId;
+    if(dist < m_Interval)
+      return false;
+  }
+
+  return true;
+}
+
+rdcarray<uint32_t> ReplayCheckpointSchedule::Add(uint32_t eventId, uint64_t byteSize)
+{
+  rdcarray<uint32_t> evicted;
+
+  if(!CanFit(byteSize))
+    return evicted;
+
+  while(m_TotalSize + byteSize > m_Budget && !m_Checkpoints.empty())
+  {
+    size_t lru = 0;
+    for(size_t i = 1; i < m_Checkpoints.size(); i++)
+      if(m_Checkpoints[i].lastUse < m_Checkpoints[lru].lastUse)
+        lru = i;
+
+    evicted.push_back(m_Checkpoints[lru].eventId);
+    m_TotalSize -= m_Checkpoints[lru].byteSize;
+    m_Checkpoints.erase(lru);
+  }
+
+  size_t idx = 0;
+  while(idx < m_Checkpoints.size() && m_Checkpoints[idx].eventId < eventId)
+    idx++;
+
+  Checkpoint checkpoint = {eventId, byteSize, ++m_UseCounter};
+  m_Checkpoints.insert(idx, checkpoint);
+  m_TotalSize += byteSize;
+
+  return evicted;
+}
+
+void ReplayCheckpointSchedule::Remove(uint32_t eventId)
+{
+  for(size_t i = 0; i < m_Checkpoints.size(); i++)
+  {
+    if(m_Checkpoints[i].eventId == eventId)
+    {
+      m_TotalSize -= m_Checkpoints[i].byteSize;
+      m_Checkpoints.erase(i);
+      return;
+    }
+  }
+}
+
+rdcarray<uint32_t> ReplayCheckpointSchedule::Clear()
+{
+  rdcarray<uint32_t> ret;
+  for(const Checkpoint &c : m_Checkpoints)
+    ret.push_back(c.eventId);
+  m_Checkpoints.clear();
+  m_TotalSize = 0;
+  return ret;
+}
+
+#if ENABLED(ENABLE_UNIT_TESTS)
+
+#include "catch/catch.hpp"
+
+TEST_CASE("Check CPU block compression round-trips", "[bcn]")
+{
+  // deliberately not a multiple of the block size, to check partial blocks
+  const uint32_t width = 10, height = 6;
+
+  for(ResourceFormatType type :
+      {ResourceFormatType::BC1, ResourceFormatType::BC2, ResourceFormatType::BC3,
+       ResourceFormatType::BC4, ResourceFormatType::BC5, ResourceFormatType::BC6,
+       ResourceFormatType::BC7})
+  {
+    ResourceFormat fmt;
+    fmt.type = type;
+    fmt.compType = type == ResourceFormatType::BC6 ? CompType::Float : CompType::UNorm;
+
+    INFO("format: " << fmt.Name());
+
+    REQUIRE(CanCodeBlockCompressed(fmt));
+
+    ResourceFormat decodedFmt = GetBlockCompressedDecodeFormat(fmt);
+    const uint32_t pixelSize = decodedFmt.ElementSize();
+    const uint32_t numBlocks = ((width + 3) / 4) * ((height + 3) / 4);
+
+    // each 4x4 block is a solid colour so the compression is lossless (or very nearly so)
+    bytebuf source, encoded, decoded;
+    source.resize(width * height * pixelSize);
+    encoded.resize(numBlocks * GetBlockCompressedBlockSize(fmt));
+    decoded.resize(source.size());
+
+    for(uint32_t y = 0; y < height; y++)
+    {
+      for(uint32_t x = 0; x < width; x++)
+      {
+        bool set = (((x / 4) + (y / 4)) % 2) == 0;
+        byte *pixel = source.data() + (y * width + x) * pixelSize;
+
+        if(type == ResourceFormatType::BC6)
+        {
+          float col[4] = {set ? 1000.0f : 0.0f, set ? 2.0f : 0.0f, 0.5f, 1.0f};
+          memcpy(pixel, col, sizeof(col));
+        }
+        else
+        {
+          byte col[4] = {set ? byte(0xff) : byte(0), set ? byte(0) : byte(0xff), 0, 0xff};
+
+          // only R and RG are preserved for BC4 and BC5
+          if(type == ResourceFormatType::BC4)
+            col[1] = 0;
+          memcpy(pixel, col, sizeof(col));
+        }
+      }
+    }
+
+    REQUIRE(EncodeBlockCompressed(fmt, width, height, source.data(), encoded.data()));
+    REQUIRE(DecodeBlockCompressed(fmt, width, height, encoded.data(), decoded.data()));
+
+    for(uint32_t i = 0; i < width * height; i++)
+    {
+      INFO("pixel: " << i);
+
+      FloatVector a = DecodeFormattedComponents(decodedFmt, source.data() + i * pixelSize);
+      FloatVector b = DecodeFormattedComponents(decodedFmt, decoded.data() + i * pixelSize);
+
+      const float eps = type == ResourceFormatType::BC6 ? RDCMAX(a.x, 1.0f) * 0.01f : 0.01f;
+
+      CHECK(fabsf(a.x - b.x) <= eps);
+      CHECK(fabsf(a.y - b.y) <= eps);
+      CHECK(fabsf(a.z - b.z) <= eps);
+      CHECK(fabsf(a.w - b.w) <= eps);
+    }
+  }
+}
+
+TEST_CASE("Check replay checkpoint scheduling", "[replay]")
+{
+  ReplayCheckpointSchedule sched;
+
+  SECTION("Disabled by default")
+  {
+    CHECK_FALSE(sched.Enabled());
+    CHECK_FALSE(sched.WantCheckpoint(5000));
+    CHECK(sched.Add(5000, 10).empty());
+    CHECK(sched.GetCount() == 0);
+    CHECK(sched.FindRestorePoint(10000) == 0);
+  };
+
+  sched.Configure(1000, 100);
+
+  SECTION("Checkpoints are spaced by the interval")
+  {
+    CHECK_FALSE(sched.WantCheckpoint(500));
+    CHECK(sched.WantCheckpoint(1000));
+
+    sched.Add(1000, 10);
+    CHECK_FALSE(sched.WantCheckpoint(1000));
+    CHECK_FALSE(sched.WantCheckpoint(1999));
+    CHECK(sched.WantCheckpoint(2000));
+
+    sched.Add(3000, 10);
+    CHECK_FALSE(sched.WantCheckpoint(2500));
+    CHECK(sched.WantCheckpoint(4000));
+  };
+
+  SECTION("Restore points are the latest checkpoint not after the event")
+  {
+    sched.Add(3000, 10);
+    sched.Add(1000, 10);
+    sched.Add(5000, 10);
+
+    CHECK(sched.FindRestorePoint(999) == 0);
+    CHECK(sched.FindRestorePoint(1000) == 1000);
+    CHECK(sched.FindRestorePoint(2999) == 1000);
+    CHECK(sched.FindRestorePoint(4000) == 3000);
+    CHECK(sched.FindRestorePoint(100000) == 5000);
+
+    sched.Remove(3000);
+    CHECK(sched.FindRestorePoint(4000) == 1000);
+    CHECK(sched.GetTotalSize() == 20);
+  };
+
+  SECTION("Least recently used checkpoints are evicted to stay in budget")
+  {
+    CHECK_FALSE(sched.CanFit(101));
+    CHECK(sched.Add(1000, 101).empty());
+    CHECK(sched.GetCount() == 0);
+
+    CHECK(sched.Add(1000, 40).empty());
+    CHECK(sched.Add(2000, 40).empty());
+
+    // using the first checkpoint makes the second the least recently used
+    CHECK(sched.FindRestorePoint(1500) == 1000);
+
+    rdcarray<uint32_t> evicted = sched.Add(3000, 40);
+    CHECK(evicted == rdcarray<uint32_t>({2000}));
+    CHECK(sched.GetCount() == 2);
+    CHECK(sched.GetTotalSize() == 80);
+
+    evicted = sched.Add(4000, 100);
+    CHECK(evicted.size() == 2);
+    CHECK(sched.GetCount() == 1);
+    CHECK(sched.GetTotalSize() == 100);
+
+    evicted = sched.Clear();
+    CHECK(evicted == rdcarray<uint32_t>({4000}));
+    CHECK(sched.GetTotalSize() == 0);
+  };
+}
+
+#endif    // ENABLED(ENABLE_UNIT_TESTS)
@@ -197,6 +197,11 @@ public:
   virtual rdcarray<PixelModification> PixelHistory(rdcarray<EventUsage> events, ResourceId target,
                                                    uint32_t x, uint32_t y, const Subresource &sub,
                                                    CompType typeCast) = 0;
+  virtual rdcarray<PixelHistoryResult> PixelHistoryRegion(rdcarray<EventUsage> events,
+                                                          ResourceId target, uint32_t x, uint32_t y,
+                                                          uint32_t width, uint32_t height,
+                                                          const Subresource &sub,
+                                                          CompType typeCast) = 0;
   virtual ShaderDebugTrace *DebugVertex(uint32_t eventId, uint32_t vertid, uint32_t instid,
                                         uint32_t idx, uint32_t view) = 0;
   virtual ShaderDebugTrace *DebugPixel(uint32_t eventId, uint32_t x, uint32_t y, uint32_t sample,
@@ -312,6 +317,13 @@ void PatchTriangleFanRestartIndexBufer(rdcarray<uint32_t> &patchedIndices, uint3
 
 uint64_t CalcMeshOutputSize(uint64_t curSize, uint64_t requiredOutput);
 
+// for drivers with no way to share work between pixels, run a pixel history on each pixel in turn
+rdcarray<PixelHistoryResult> PixelHistoryEachPixel(IReplayDriver *driver,
+                                                   const rdcarray<EventUsage> &events,
+                                                   ResourceId target, uint32_t x, uint32_t y,
+                                                   uint32_t width, uint32_t height,
+                                                   const Subresource &sub, CompType typeCast);
+
 void StandardFillCBufferVariable(ResourceId shader, const ShaderConstantType &desc,
                                  uint32_t dataOffset, const bytebuf &data, ShaderVariable &outvar,
                                  uint32_t matStride);
@@ -365,3 +377,56 @@ static constexpr uint32_t DiscardPatternHeight = 8;
 // returns a pattern to fill the texture with
 bytebuf GetDiscardPattern(DiscardType type, const ResourceFormat &fmt, uint32_t rowPitch = 1,
                           bool invert = false);
+
+// CPU encoding and decoding of BC1-BC7 data, so textures can be converted without the GPU. The
+// uncompressed side is tightly packed RGBA8 for all formats except BC6, which uses RGBA32 float.
+// BC4 and BC5 read/write the R and RG channels of that. Compressed data is tightly packed blocks.
+// CanCodeBlockCompressed is only true for formats that decode correctly - encoding also accepts
+// signed formats but treats them as unsigned.
+uint32_t GetBlockCompressedBlockSize(const ResourceFormat &fmt);
+bool CanCodeBlockCompressed(const ResourceFormat &fmt);
+ResourceFormat GetBlockCompressedDecodeFormat(const ResourceFormat &fmt);
+bool DecodeBlockCompressed(const ResourceFormat &fmt, uint32_t width, uint32_t height,
+                           const byte *src, byte *dst);
+bool EncodeBlockCompressed(const ResourceFormat &fmt, uint32_t width, uint32_t height,
+                           const byte *src, byte *dst, float bc6Quality = 1.0f);
+
+// bookkeeping for drivers that snapshot their replay state part-way through the frame, so that a
+// replay to a later event can restore the nearest earlier snapshot instead of replaying everything
+// from the start. The driver owns the snapshot data, this only decides where a new checkpoint is
+// worth taking and which checkpoints to evict - least recently used first - to stay in budget.
+class ReplayCheckpointSchedule
+{
+public:
+  // interval is the minimum number of events between checkpoints, budget is the maximum total
+  // size in bytes of all checkpoints. Either being 0 disables checkpoints.
+  void Configure(uint32_t interval, uint64_t budget);
+  bool Enabled() const { return m_Interval > 0 && m_Budget > 0; }
+  // returns the latest checkpoint at or before eventId and marks it as used, or 0 if there is none
+  uint32_t FindRestorePoint(uint32_t eventId);
+  // returns whether eventId is far enough from any existing checkpoint to be worth taking one
+  bool WantCheckpoint(uint32_t eventId) const;
+  bool CanFit(uint64_t byteSize) const { return Enabled() && byteSize <= m_Budget; }
+  // records a new checkpoint, and returns the checkpoints that were evicted to make room for it
+  rdcarray<uint32_t> Add(uint32_t eventId, uint64_t byteSize);
+  void Remove(uint32_t eventId);
+  // removes all checkpoints and returns them
+  rdcarray<uint32_t> Clear();
+  uint64_t GetTotalSize() const { return m_TotalSize; }
+  size_t GetCount() const { return m_Checkpoints.size(); }
+
+private:
+  struct Checkpoint
+  {
+    uint32_t eventId;
+    uint64_t byteSize;
+    uint64_t lastUse;
+  };
+
+  // sorted by eventId
+  rdcarray<Checkpoint> m_Checkpoints;
+  uint32_t m_Interval = 0;
+  uint64_t m_Budget = 0;
+  uint64_t m_TotalSize = 0;
+  uint64_t m_UseCounter = 0;
+};
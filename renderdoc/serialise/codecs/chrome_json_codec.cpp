@@ -22,12 +22,106 @@
  * THE SOFTWARE.
  ******************************************************************************/
 
+#include <map>
 #include <utility>
 #include "api/replay/structured_data.h"
 #include "common/common.h"
 #include "common/formatting.h"
 #include "serialise/rdcfile.h"
 
+// accumulates JSON text and writes it out to the file whenever a reasonable amount has built up, so
+// that we never hold the whole trace in memory.
+struct ChromeTraceWriter
+{
+  ChromeTraceWriter(FILE *file) : f(file) { buf.reserve(FlushSize + 1024); }
+  ~ChromeTraceWriter()
+  {
+    Flush();
+    FileIO::fclose(f);
+  }
+
+  void Append(const rdcstr &str)
+  {
+    buf += str;
+    if(buf.size() >= FlushSize)
+      Flush();
+  }
+
+  // JSON doesn't allow trailing commas so we write the separator before each event except the first
+  void Event(const rdcstr &str)
+  {
+    Append(first ? "\n    " : ",\n    ");
+    first = false;
+    Append(str);
+  }
+
+  void Flush()
+  {
+    if(!buf.empty())
+      FileIO::fwrite(buf.data(), 1, buf.size(), f);
+    buf.clear();
+  }
+
+private:
+  static const size_t FlushSize = 1024 * 1024;
+
+  FILE *f;
+  rdcstr buf;
+  bool first = true;
+};
+
+static rdcstr JSONEscape(const rdcstr &str)
+{
+  rdcstr ret;
+  ret.reserve(str.size());
+  for(char c : str)
+  {
+    if(c == '"' || c == '\\')
+    {
+      ret.push_back('\\');
+      ret.push_back(c);
+    }
+    else if((unsigned char)c < 0x20)
+    {
+      ret += StringFormat::Fmt("\\u%04x", (uint32_t)c);
+    }
+    else
+    {
+      ret.push_back(c);
+    }
+  }
+  return ret;
+}
+
+static bool IsQueueSubmission(const SDChunk *chunk)
+{
+  return strstr(chunk->name.c_str(), "QueueSubmit") ||
+         strstr(chunk->name.c_str(), "ExecuteCommandList");
+}
+
+// chunks recorded into a command buffer or list, where the first resource is the one being recorded.
+// Other chunks (e.g. fence or semaphore waits) also reference objects that get submitted so they
+// are not used as flow sources.
+static bool IsCommandRecording(const SDChunk *chunk)
+{
+  const char *name = chunk->name.c_str();
+  return strstr(name, "vkCmd") || strstr(name, "vkBeginCommandBuffer") ||
+         strstr(name, "vkEndCommandBuffer") || strstr(name, "CommandList::");
+}
+
+static void GatherResources(const SDObject *obj, rdcarray<ResourceId> &ids)
+{
+  if(obj->IsResource())
+  {
+    if(obj->data.basic.id != ResourceId())
+      ids.push_back(obj->data.basic.id);
+    return;
+  }
+
+  for(size_t i = 0; i < obj->NumChildren(); i++)
+    GatherResources(obj->GetChild(i), ids);
+}
+
 RDResult exportChrome(const rdcstr &filename, const RDCFile &rdc, const SDFile &structData,
                       RENDERDOC_ProgressCallback progress)
 {
@@ -37,44 +131,117 @@ RDResult exportChrome(const rdcstr &filename, const RDCFile &rdc, const SDFile &
     RETURN_ERROR_RESULT(ResultCode::FileIOFailed, "Failed to open '%s' for write: %s",
                         filename.c_str(), FileIO::ErrorString().c_str());
 
-  rdcstr str;
+  ChromeTraceWriter writer(f);
 
   // add header, customise this as needed.
-  str = R"({
+  writer.Append(R"({
   "displayTimeUnit": "ns",
-  "traceEvents": [)";
+  "traceEvents": [)");
+
+  const uint32_t pid = 5;
+
+  writer.Event(StringFormat::Fmt(
+      R"({ "name": "process_name", "ph": "M", "pid": %u, "args": { "name": "%s capture" } })", pid,
+      JSONEscape(rdc.GetDriverName()).c_str()));
 
   const char *category = "Initialisation";
 
-  // stupid JSON not allowing trailing ,s :(
-  bool first = true;
+  // each recording thread gets its own lane, numbered in order of first appearance. Thread IDs can
+  // be larger than JSON numbers can represent exactly so they're only used in the lane name.
+  std::map<uint64_t, uint32_t> lanes;
+
+  // the last recording chunk on each command buffer/list, used as the source of flow events into
+  // queue submissions. Normally that will be the end of recording.
+  struct ChunkLocation
+  {
+    uint64_t ts;
+    uint32_t lane;
+  };
+  std::map<ResourceId, ChunkLocation> lastUse;
+  uint32_t flowID = 1;
+
+  uint64_t totalBytes = 0;
 
   int i = 0;
   int numChunks = structData.chunks.count();
 
   for(const SDChunk *chunk : structData.chunks)
   {
-    if(chunk->metadata.chunkID == (uint32_t)SystemChunk::FirstDriverChunk + 1)
+    const SDChunkMetaData &meta = chunk->metadata;
+
+    if(meta.chunkID == (uint32_t)SystemChunk::FirstDriverChunk + 1)
       category = "Frame Capture";
 
-    if(!first)
-      str += ",";
+    auto it = lanes.find(meta.threadID);
+    if(it == lanes.end())
+    {
+      uint32_t lane = (uint32_t)lanes.size() + 1;
+      it = lanes.insert(std::make_pair(meta.threadID, lane)).first;
 
-    first = false;
+      writer.Event(StringFormat::Fmt(
+          R"({ "name": "thread_name", "ph": "M", "pid": %u, "tid": %u, "args": { "name": "Thread 0x%llx" } })",
+          pid, lane, meta.threadID));
+      writer.Event(StringFormat::Fmt(
+          R"({ "name": "thread_sort_index", "ph": "M", "pid": %u, "tid": %u, "args": { "sort_index": %u } })",
+          pid, lane, lane));
+    }
 
-    const char *fmt = R"(
-    { "name": "%s", "cat": "%s", "ph": "B", "ts": %llu, "pid": 5, "tid": %u },
-    { "ph": "E", "ts": %llu, "pid": 5, "tid": %u })";
+    const uint32_t lane = it->second;
+    const rdcstr name = JSONEscape(chunk->name);
 
-    if(chunk->metadata.durationMicro == 0)
+    rdcstr args = StringFormat::Fmt(R"("chunkID": %u, "bytes": %llu)", meta.chunkID, meta.length);
+    if(meta.flags & SDChunkFlags::HasCallstack)
+      args += StringFormat::Fmt(R"(, "callstackDepth": %llu)", (uint64_t)meta.callstack.size());
+
+    if(meta.durationMicro > 0)
+    {
+      writer.Event(StringFormat::Fmt(
+          R"({ "name": "%s", "cat": "%s", "ph": "X", "ts": %llu, "dur": %lld, "pid": %u, "tid": %u, "args": { %s } })",
+          name.c_str(), category, meta.timestampMicro, meta.durationMicro, pid, lane, args.c_str()));
+    }
+    else
     {
-      fmt = R"(
-    { "name": "%s", "cat": "%s", "ph": "i", "ts": %llu, "pid": 5, "tid": %u })";
+      writer.Event(StringFormat::Fmt(
+          R"({ "name": "%s", "cat": "%s", "ph": "i", "s": "t", "ts": %llu, "pid": %u, "tid": %u, "args": { %s } })",
+          name.c_str(), category, meta.timestampMicro, pid, lane, args.c_str()));
     }
 
-    str += StringFormat::Fmt(
-        fmt, chunk->name.c_str(), category, chunk->metadata.timestampMicro, chunk->metadata.threadID,
-        chunk->metadata.timestampMicro + chunk->metadata.durationMicro, chunk->metadata.threadID);
+    rdcarray<ResourceId> ids;
+    for(size_t c = 0; c < chunk->NumChildren(); c++)
+      GatherResources(chunk->GetChild(c), ids);
+
+    if(IsQueueSubmission(chunk))
+    {
+      // draw a flow arrow from wherever each submitted object was last used (skipping the first
+      // resource which is the queue itself) to this submission
+      for(size_t r = 1; r < ids.size(); r++)
+      {
+        auto src = lastUse.find(ids[r]);
+        if(src == lastUse.end())
+          continue;
+
+        writer.Event(StringFormat::Fmt(
+            R"({ "name": "submit", "cat": "submission", "ph": "s", "id": %u, "ts": %llu, "pid": %u, "tid": %u })",
+            flowID, src->second.ts, pid, src->second.lane));
+        writer.Event(StringFormat::Fmt(
+            R"({ "name": "submit", "cat": "submission", "ph": "f", "bp": "e", "id": %u, "ts": %llu, "pid": %u, "tid": %u })",
+            flowID, meta.timestampMicro, pid, lane));
+        flowID++;
+      }
+    }
+    else if(!ids.empty() && IsCommandRecording(chunk))
+    {
+      lastUse[ids[0]] = {meta.timestampMicro, lane};
+    }
+
+    totalBytes += meta.length;
+
+    writer.Event(StringFormat::Fmt(
+        R"({ "name": "Serialised data", "ph": "C", "ts": %llu, "pid": %u, "args": { "bytes": %llu } })",
+        meta.timestampMicro, pid, totalBytes));
+    writer.Event(StringFormat::Fmt(
+        R"({ "name": "Chunks", "ph": "C", "ts": %llu, "pid": %u, "args": { "count": %d } })",
+        meta.timestampMicro, pid, i + 1));
 
     if(progress)
       progress(float(i) / float(numChunks));
@@ -86,11 +253,7 @@ RDResult exportChrome(const rdcstr &filename, const RDCFile &rdc, const SDFile &
     progress(1.0f);
 
   // end trace events
-  str += "\n  ]\n}";
-
-  FileIO::fwrite(str.data(), 1, str.size(), f);
-
-  FileIO::fclose(f);
+  writer.Append("\n  ]\n}");
 
   return ResultCode::Succeeded;
 }
@@ -100,6 +263,7 @@ static ConversionRegistration XMLConversionRegistration(
     {
         "chrome.json", "Chrome profiler JSON",
         R"(Exports the chunk threadID, timestamp and duration data to a JSON format that can be loaded
-by chrome's profiler at chrome://tracing)",
+by chrome's profiler at chrome://tracing. Each thread is shown in its own lane, with flow arrows into
+queue submissions and counters for the serialised data size.)",
         false,
     });
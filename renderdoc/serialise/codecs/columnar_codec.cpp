@@ -0,0 +1,573 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019-2022 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#include <map>
+#include "api/replay/structured_data.h"
+#include "common/common.h"
+#include "common/formatting.h"
+#include "serialise/rdcfile.h"
+#include "serialise/streamio.h"
+
+// The columnar format is a simple self-contained binary layout, all values little-endian:
+//
+//   char[8]  magic "RDCCOLS\0"
+//   uint32   format version
+//   uint64   structured data version
+//   string   driver name
+//   uint32   number of tables
+//   table[]
+//
+// Each table is:
+//
+//   string   table name
+//   uint32   number of columns
+//   { string name, uint32 ColumnType }[] column descriptions
+//   rowgroup[] terminated by a row group with 0 rows
+//
+// Each row group is a uint64 row count followed by each column's data for that many rows. Fixed
+// width columns are a tightly packed array of values. String columns are dictionary encoded, with a
+// uint32 dictionary size, that many strings, then a uint32 dictionary index per row.
+//
+// Strings are a uint32 byte length followed by the UTF-8 bytes, without a NULL terminator.
+//
+// Row groups bound the memory needed to write (and read) the file, and mean that readers can scan a
+// column without parsing anything else in the row group.
+
+static const char ColumnarMagic[8] = {'R', 'D', 'C', 'C', 'O', 'L', 'S', '\0'};
+static const uint32_t ColumnarVersion = 1;
+static const uint64_t ColumnarRowGroupSize = 64 * 1024;
+
+enum class ColumnType : uint32_t
+{
+  UInt32 = 0,
+  UInt64 = 1,
+  SInt64 = 2,
+  Float64 = 3,
+  String = 4,
+};
+
+static void WriteString(StreamWriter &writer, const rdcstr &str)
+{
+  writer.Write((uint32_t)str.size());
+  writer.Write(str.c_str(), str.size());
+}
+
+struct ColumnarColumn
+{
+  rdcstr name;
+  ColumnType type;
+
+  // fixed width values for the current row group
+  bytebuf data;
+
+  // dictionary and indices for string columns in the current row group
+  rdcarray<rdcstr> dict;
+  std::map<rdcstr, uint32_t> lookup;
+  rdcarray<uint32_t> indices;
+
+  template <typename T>
+  void Add(T val)
+  {
+    data.append((const byte *)&val, sizeof(T));
+  }
+
+  void AddString(const rdcstr &str)
+  {
+    auto it = lookup.find(str);
+    if(it == lookup.end())
+    {
+      it = lookup.insert(std::make_pair(str, (uint32_t)dict.size())).first;
+      dict.push_back(str);
+    }
+    indices.push_back(it->second);
+  }
+
+  void Flush(StreamWriter &writer)
+  {
+    if(type == ColumnType::String)
+    {
+      writer.Write((uint32_t)dict.size());
+      for(const rdcstr &s : dict)
+        WriteString(writer, s);
+      writer.Write(indices.data(), indices.byteSize());
+
+      dict.clear();
+      lookup.clear();
+      indices.clear();
+    }
+    else
+    {
+      writer.Write(data.data(), data.size());
+      data.clear();
+    }
+  }
+};
+
+struct ColumnarTable
+{
+  ColumnarTable(StreamWriter &w, const rdcstr &name,
+                const rdcarray<rdcpair<rdcstr, ColumnType>> &columnDescs)
+      : writer(w)
+  {
+    WriteString(writer, name);
+    writer.Write((uint32_t)columnDescs.size());
+
+    columns.resize(columnDescs.size());
+    for(size_t i = 0; i < columnDescs.size(); i++)
+    {
+      columns[i].name = columnDescs[i].first;
+      columns[i].type = columnDescs[i].second;
+
+      WriteString(writer, columns[i].name);
+      writer.Write(columns[i].type);
+    }
+  }
+
+  ColumnarColumn &operator[](size_t i) { return columns[i]; }
+  void EndRow()
+  {
+    rows++;
+    if(rows >= ColumnarRowGroupSize)
+      FlushRowGroup();
+  }
+
+  void Finish()
+  {
+    FlushRowGroup();
+
+    // terminating empty row group
+    writer.Write(uint64_t(0));
+  }
+
+private:
+  void FlushRowGroup()
+  {
+    if(rows == 0)
+      return;
+
+    writer.Write(rows);
+    for(ColumnarColumn &col : columns)
+      col.Flush(writer);
+
+    rows = 0;
+  }
+
+  StreamWriter &writer;
+  rdcarray<ColumnarColumn> columns;
+  uint64_t rows = 0;
+};
+
+enum FieldColumn
+{
+  Field_Chunk,
+  Field_Path,
+  Field_BaseType,
+  Field_TypeName,
+  Field_ArrayIndex,
+  Field_Raw,
+  Field_Value,
+  Field_String,
+};
+
+static void FlattenObject(ColumnarTable &fields, uint32_t chunkIndex, const SDObject *obj,
+                          const rdcstr &path, uint32_t arrayIndex)
+{
+  if(obj->type.basetype == SDBasic::Struct || obj->type.basetype == SDBasic::Array)
+  {
+    const bool isArray = obj->type.basetype == SDBasic::Array;
+    for(size_t i = 0; i < obj->NumChildren(); i++)
+    {
+      const SDObject *child = obj->GetChild(i);
+
+      if(isArray)
+        FlattenObject(fields, chunkIndex, child, path + "[]", (uint32_t)i);
+      else
+        FlattenObject(fields, chunkIndex, child,
+                      path.empty() ? rdcstr(child->name) : path + "." + child->name, arrayIndex);
+    }
+
+    // empty structs and arrays are still recorded so their presence is visible
+    if(obj->NumChildren() > 0)
+      return;
+  }
+
+  uint64_t raw = obj->data.basic.u;
+  double value = 0.0;
+
+  switch(obj->type.basetype)
+  {
+    case SDBasic::Boolean:
+      raw = obj->data.basic.b ? 1 : 0;
+      value = double(raw);
+      break;
+    case SDBasic::Character:
+      raw = (uint8_t)obj->data.basic.c;
+      value = double(raw);
+      break;
+    case SDBasic::SignedInteger: value = double(obj->data.basic.i); break;
+    case SDBasic::Float: value = obj->data.basic.d; break;
+    case SDBasic::UnsignedInteger:
+    case SDBasic::Enum:
+    case SDBasic::Buffer: value = double(obj->data.basic.u); break;
+    default: break;
+  }
+
+  fields[Field_Chunk].Add(chunkIndex);
+  fields[Field_Path].AddString(path);
+  fields[Field_BaseType].Add((uint32_t)obj->type.basetype);
+  fields[Field_TypeName].AddString(obj->type.name);
+  fields[Field_ArrayIndex].Add(arrayIndex);
+  fields[Field_Raw].Add(raw);
+  fields[Field_Value].Add(value);
+  fields[Field_String].AddString(obj->data.str);
+  fields.EndRow();
+}
+
+RDResult exportColumnar(const rdcstr &filename, const RDCFile &rdc, const SDFile &structData,
+                        RENDERDOC_ProgressCallback progress)
+{
+  FILE *f = FileIO::fopen(filename, FileIO::WriteBinary);
+
+  if(!f)
+    RETURN_ERROR_RESULT(ResultCode::FileIOFailed, "Failed to open '%s' for write: %s",
+                        filename.c_str(), FileIO::ErrorString().c_str());
+
+  StreamWriter writer(f, Ownership::Stream);
+
+  writer.Write(ColumnarMagic, sizeof(ColumnarMagic));
+  writer.Write(ColumnarVersion);
+  writer.Write(structData.version);
+  WriteString(writer, rdc.GetDriverName());
+  writer.Write(uint32_t(2));
+
+  const uint32_t numChunks = (uint32_t)structData.chunks.size();
+
+  {
+    ColumnarTable chunks(writer, "chunks",
+                         {
+                             {"chunkID", ColumnType::UInt32},
+                             {"name", ColumnType::String},
+                             {"threadID", ColumnType::UInt64},
+                             {"timestamp", ColumnType::UInt64},
+                             {"duration", ColumnType::SInt64},
+                             {"length", ColumnType::UInt64},
+                             {"flags", ColumnType::UInt32},
+                         });
+
+    for(const SDChunk *chunk : structData.chunks)
+    {
+      chunks[0].Add(chunk->metadata.chunkID);
+      chunks[1].AddString(chunk->name);
+      chunks[2].Add(chunk->metadata.threadID);
+      chunks[3].Add(chunk->metadata.timestampMicro);
+      chunks[4].Add(chunk->metadata.durationMicro);
+      chunks[5].Add(chunk->metadata.length);
+      chunks[6].Add((uint32_t)chunk->metadata.flags);
+      chunks.EndRow();
+    }
+
+    chunks.Finish();
+  }
+
+  if(progress)
+    progress(0.1f);
+
+  {
+    // every leaf object in every chunk, with the path to it from the chunk and the innermost array
+    // index (or ~0U if it's not in an array).
+    ColumnarTable fields(writer, "fields",
+                         {
+                             {"chunk", ColumnType::UInt32},
+                             {"path", ColumnType::String},
+                             {"basetype", ColumnType::UInt32},
+                             {"typename", ColumnType::String},
+                             {"index", ColumnType::UInt32},
+                             {"raw", ColumnType::UInt64},
+                             {"value", ColumnType::Float64},
+                             {"string", ColumnType::String},
+                         });
+
+    for(uint32_t c = 0; c < numChunks; c++)
+    {
+      const SDChunk *chunk = structData.chunks[c];
+
+      for(size_t o = 0; o < chunk->NumChildren(); o++)
+        FlattenObject(fields, c, chunk->GetChild(o), chunk->GetChild(o)->name, ~0U);
+
+      if(progress)
+        progress(0.1f + 0.9f * (float(c) / float(numChunks)));
+    }
+
+    fields.Finish();
+  }
+
+  if(progress)
+    progress(1.0f);
+
+  return writer.GetError();
+}
+
+static ConversionRegistration ColumnarConversionRegistration(
+    &exportColumnar,
+    {
+        "rdcols", "Columnar binary",
+        R"(Exports chunk metadata and every structured data field flattened into columns in a compact
+binary format, for fast bulk analysis. Buffer contents are not included. The renderdoc python
+module can read these files with ReadColumnarExport.)",
+        false,
+    });
+
+#if ENABLED(ENABLE_UNIT_TESTS)
+
+#include "catch/catch.hpp"
+
+struct DecodedColumn
+{
+  rdcstr name;
+  ColumnType type;
+  // fixed width columns widened to 64-bit, string columns decoded
+  rdcarray<uint64_t> values;
+  rdcarray<rdcstr> strings;
+};
+
+static rdcstr ReadString(StreamReader &reader)
+{
+  uint32_t len = 0;
+  reader.Read(len);
+  rdcstr ret;
+  ret.resize(len);
+  reader.Read(ret.data(), len);
+  return ret;
+}
+
+static std::map<rdcstr, rdcarray<DecodedColumn>> ReadColumnarFile(const bytebuf &file,
+                                                                  rdcstr &driver)
+{
+  std::map<rdcstr, rdcarray<DecodedColumn>> ret;
+
+  StreamReader reader(file);
+
+  char magic[8] = {};
+  reader.Read(magic, sizeof(magic));
+  REQUIRE(memcmp(magic, ColumnarMagic, sizeof(magic)) == 0);
+
+  uint32_t version = 0;
+  reader.Read(version);
+  REQUIRE(version == ColumnarVersion);
+
+  uint64_t sdversion = 0;
+  reader.Read(sdversion);
+  driver = ReadString(reader);
+
+  uint32_t numTables = 0;
+  reader.Read(numTables);
+
+  for(uint32_t t = 0; t < numTables; t++)
+  {
+    rdcarray<DecodedColumn> &columns = ret[ReadString(reader)];
+
+    uint32_t numColumns = 0;
+    reader.Read(numColumns);
+    columns.resize(numColumns);
+    for(DecodedColumn &col : columns)
+    {
+      col.name = ReadString(reader);
+      reader.Read(col.type);
+    }
+
+    uint64_t rows = 0;
+    reader.Read(rows);
+    while(rows > 0)
+    {
+      for(DecodedColumn &col : columns)
+      {
+        if(col.type == ColumnType::String)
+        {
+          uint32_t dictSize = 0;
+          reader.Read(dictSize);
+          rdcarray<rdcstr> dict;
+          for(uint32_t i = 0; i < dictSize; i++)
+            dict.push_back(ReadString(reader));
+
+          for(uint64_t r = 0; r < rows; r++)
+          {
+            uint32_t idx = 0;
+            reader.Read(idx);
+            REQUIRE(idx < dictSize);
+            col.strings.push_back(dict[idx]);
+          }
+        }
+        else
+        {
+          for(uint64_t r = 0; r < rows; r++)
+          {
+            uint64_t val = 0;
+            reader.Read(&val, col.type == ColumnType::UInt32 ? 4 : 8);
+            col.values.push_back(val);
+          }
+        }
+      }
+
+      reader.Read(rows);
+    }
+  }
+
+  CHECK(reader.AtEnd());
+  CHECK_FALSE(reader.IsErrored());
+
+  return ret;
+}
+
+TEST_CASE("Check columnar export round-trips", "[columnar]")
+{
+  SDFile file;
+  file.version = 42;
+
+  const ResourceId buf = ResourceIDGen::GetNewUniqueID();
+  uint64_t bufRaw = 0;
+  memcpy(&bufRaw, &buf, sizeof(bufRaw));
+
+  {
+    SDChunk *chunk = new SDChunk("vkCreateBuffer"_lit);
+    chunk->metadata.chunkID = 1000;
+    chunk->metadata.threadID = 0x1234;
+    chunk->metadata.timestampMicro = 100;
+    chunk->metadata.durationMicro = 5;
+    chunk->metadata.length = 64;
+
+    SDObject *createInfo = chunk->AddAndOwnChild(new SDObject("CreateInfo"_lit, "Info"_lit));
+    createInfo->type.basetype = SDBasic::Struct;
+    createInfo->AddAndOwnChild(makeSDUInt64("size"_lit, 256));
+    createInfo->AddAndOwnChild(makeSDEnum("usage"_lit, 3));
+    chunk->AddAndOwnChild(makeSDResourceId("Buffer"_lit, buf));
+
+    file.chunks.push_back(chunk);
+  }
+
+  // enough array elements to need several row groups, so dictionaries are split
+  const uint32_t arraySize = uint32_t(ColumnarRowGroupSize * 2 + 10);
+
+  {
+    SDChunk *chunk = new SDChunk("vkCmdDraw"_lit);
+    chunk->metadata.chunkID = 1001;
+    chunk->metadata.threadID = 0x1234;
+    chunk->metadata.timestampMicro = 200;
+    chunk->metadata.durationMicro = -1;
+
+    chunk->AddAndOwnChild(makeSDFloat("depth"_lit, 0.5f));
+    chunk->AddAndOwnChild(makeSDString("marker"_lit, "hello"));
+
+    SDObject *offsets = chunk->AddAndOwnChild(makeSDArray("offsets"_lit));
+    for(uint32_t i = 0; i < arraySize; i++)
+      offsets->AddAndOwnChild(makeSDUInt32("$el"_lit, i * 2));
+
+    file.chunks.push_back(chunk);
+  }
+
+  RDCFile rdc;
+  rdc.SetData(RDCDriver::Vulkan, "Vulkan", 0, NULL, 0, 1.0);
+
+  rdcstr filename = FileIO::GetTempFolderFilename() + "/columnar_test.rdcols";
+
+  RDResult res = exportColumnar(filename, rdc, file, NULL);
+  REQUIRE(res.code == ResultCode::Succeeded);
+
+  bytebuf contents;
+  REQUIRE(FileIO::ReadAll(filename, contents));
+  FileIO::Delete(filename);
+
+  rdcstr driver;
+  std::map<rdcstr, rdcarray<DecodedColumn>> tables = ReadColumnarFile(contents, driver);
+
+  CHECK(driver == "Vulkan");
+  REQUIRE(tables.size() == 2);
+
+  SECTION("chunks table")
+  {
+    const rdcarray<DecodedColumn> &chunks = tables["chunks"];
+    REQUIRE(chunks.size() == 7);
+
+    CHECK(chunks[0].name == "chunkID");
+    CHECK(chunks[0].values == rdcarray<uint64_t>({1000, 1001}));
+    CHECK(chunks[1].strings == rdcarray<rdcstr>({"vkCreateBuffer", "vkCmdDraw"}));
+    CHECK(chunks[2].values == rdcarray<uint64_t>({0x1234, 0x1234}));
+    CHECK(chunks[3].values == rdcarray<uint64_t>({100, 200}));
+    CHECK(chunks[4].values == rdcarray<uint64_t>({5, uint64_t(-1)}));
+    CHECK(chunks[5].values == rdcarray<uint64_t>({64, 0}));
+  };
+
+  SECTION("fields table")
+  {
+    const rdcarray<DecodedColumn> &fields = tables["fields"];
+    REQUIRE(fields.size() == 8);
+
+    const DecodedColumn &chunk = fields[Field_Chunk];
+    const DecodedColumn &path = fields[Field_Path];
+    const DecodedColumn &basetype = fields[Field_BaseType];
+    const DecodedColumn &index = fields[Field_ArrayIndex];
+    const DecodedColumn &raw = fields[Field_Raw];
+    const DecodedColumn &value = fields[Field_Value];
+    const DecodedColumn &str = fields[Field_String];
+
+    CHECK(path.name == "path");
+
+    const size_t numRows = 5 + arraySize;
+    REQUIRE(chunk.values.size() == numRows);
+    REQUIRE(path.strings.size() == numRows);
+    REQUIRE(str.strings.size() == numRows);
+
+    CHECK(chunk.values[0] == 0);
+    CHECK(path.strings[0] == "CreateInfo.size");
+    CHECK(raw.values[0] == 256);
+    CHECK(index.values[0] == ~0U);
+
+    CHECK(path.strings[1] == "CreateInfo.usage");
+    CHECK(basetype.values[1] == (uint64_t)SDBasic::Enum);
+    CHECK(raw.values[1] == 3);
+
+    CHECK(path.strings[2] == "Buffer");
+    CHECK(basetype.values[2] == (uint64_t)SDBasic::Resource);
+    CHECK(raw.values[2] == bufRaw);
+
+    double d = 0.0;
+    memcpy(&d, &value.values[3], sizeof(d));
+    CHECK(chunk.values[3] == 1);
+    CHECK(path.strings[3] == "depth");
+    CHECK(d == 0.5);
+
+    CHECK(path.strings[4] == "marker");
+    CHECK(str.strings[4] == "hello");
+
+    for(uint32_t i = 0; i < arraySize; i++)
+    {
+      if(path.strings[5 + i] != "offsets[]" || index.values[5 + i] != i ||
+         raw.values[5 + i] != i * 2)
+      {
+        FAIL("Array element " << i << " is wrong");
+      }
+    }
+  };
+}
+
+#endif    // ENABLED(ENABLE_UNIT_TESTS)
@@ -26,7 +26,9 @@
 #include "api/replay/structured_data.h"
 #include "common/common.h"
 #include "common/formatting.h"
+#include "common/threading.h"
 #include "serialise/rdcfile.h"
+#include "serialise/serialiser.h"
 #include "strings/string_utils.h"
 
 #include "miniz/miniz.h"
@@ -71,6 +73,33 @@ struct xml_file_writer : pugi::xml_writer
   void write(const void *data, size_t size) { stream.Write(data, size); }
 };
 
+// rather than building a DOM for the whole file and saving it at the end, each top-level element
+// (and each chunk) is built in a scratch document, written out, then discarded. The output is
+// identical to what saving the full document would produce, but memory use is bounded by the
+// largest single element instead of growing with the capture.
+struct xml_stream_writer : xml_file_writer
+{
+  xml_stream_writer(const rdcstr &filename) : xml_file_writer(filename) {}
+
+  void raw(const char *str) { write(str, strlen(str)); }
+
+  // returns a fresh node to fill out, to be written with Flush()
+  pugi::xml_node Begin(const char *name)
+  {
+    scratch.reset();
+    return scratch.append_child(name);
+  }
+
+  void Flush(unsigned int depth)
+  {
+    scratch.first_child().print(*this, "\t", pugi::format_default, pugi::encoding_auto, depth);
+    scratch.reset();
+  }
+
+private:
+  pugi::xml_document scratch;
+};
+
 // avoid &, <, and > since they throw off the ascii alignment
 static constexpr bool IsXMLPrintable(const char c)
 {
@@ -287,12 +316,12 @@ static void Obj2XML(pugi::xml_node &parent, SDObject &child)
 static RDResult Structured2XML(const rdcstr &filename, const RDCFile &file, uint64_t version,
                                const StructuredChunkList &chunks, RENDERDOC_ProgressCallback progress)
 {
-  pugi::xml_document doc;
+  xml_stream_writer writer(filename);
 
-  pugi::xml_node xRoot = doc.append_child("rdc");
+  writer.raw("<?xml version=\"1.0\"?>\n<rdc>\n");
 
   {
-    pugi::xml_node xHeader = xRoot.append_child("header");
+    pugi::xml_node xHeader = writer.Begin("header");
 
     pugi::xml_node xDriver = xHeader.append_child("driver");
     xDriver.append_attribute("id") = (uint32_t)file.GetDriver();
@@ -324,6 +353,8 @@ static RDResult Structured2XML(const rdcstr &filename, const RDCFile &file, uint
 
     xTimebase.append_attribute("base") = file.GetTimestampBase();
     xTimebase.append_attribute("frequency") = file.GetTimestampFrequency();
+
+    writer.Flush(1);
   }
 
   if(progress)
@@ -348,7 +379,7 @@ static RDResult Structured2XML(const rdcstr &filename, const RDCFile &file, uint
         bool succeeded = reader->SkipBytes(thumbHeader.len) && !reader->IsErrored();
         if(succeeded && (uint32_t)thumbHeader.format < (uint32_t)FileType::Count)
         {
-          pugi::xml_node xExtThumbnail = xRoot.append_child("extended_thumbnail");
+          pugi::xml_node xExtThumbnail = writer.Begin("extended_thumbnail");
 
           xExtThumbnail.append_attribute("width") = thumbHeader.width;
           xExtThumbnail.append_attribute("height") = thumbHeader.height;
@@ -362,6 +393,8 @@ static RDResult Structured2XML(const rdcstr &filename, const RDCFile &file, uint
             xExtThumbnail.text() = "ext_thumb.raw";
           else
             RDCERR("Unexpected extended thumbnail format %s", ToStr(thumbHeader.format).c_str());
+
+          writer.Flush(1);
         }
       }
 
@@ -370,14 +403,16 @@ static RDResult Structured2XML(const rdcstr &filename, const RDCFile &file, uint
     }
     else if(props.type == SectionType::EmbeddedLogfile)
     {
-      pugi::xml_node xLogfile = xRoot.append_child("diagnostic_log");
+      pugi::xml_node xLogfile = writer.Begin("diagnostic_log");
       xLogfile.text() = "diagnostic.log";
 
+      writer.Flush(1);
+
       delete reader;
       continue;
     }
 
-    pugi::xml_node xSection = xRoot.append_child("section");
+    pugi::xml_node xSection = writer.Begin("section");
 
     if(props.flags & SectionFlags::ASCIIStored)
       xSection.append_attribute("ascii");
@@ -415,19 +450,19 @@ static RDResult Structured2XML(const rdcstr &filename, const RDCFile &file, uint
       data.text().set(hexdata.c_str());
     }
 
+    writer.Flush(1);
+
     delete reader;
   }
 
   if(progress)
     progress(StructuredProgress(0.2f));
 
-  pugi::xml_node xChunks = xRoot.append_child("chunks");
-
-  xChunks.append_attribute("version") = version;
+  writer.raw(StringFormat::Fmt("\t<chunks version=\"%llu\">\n", version).c_str());
 
   for(size_t c = 0; c < chunks.size(); c++)
   {
-    pugi::xml_node xChunk = xChunks.append_child("chunk");
+    pugi::xml_node xChunk = writer.Begin("chunk");
     SDChunk *chunk = chunks[c];
 
     xChunk.append_attribute("id") = chunk->metadata.chunkID;
@@ -464,20 +499,21 @@ static RDResult Structured2XML(const rdcstr &filename, const RDCFile &file, uint
         Obj2XML(xChunk, *chunk->GetChild(o));
     }
 
+    writer.Flush(2);
+
     if(progress)
       progress(StructuredProgress(0.2f + 0.8f * (float(c) / float(chunks.size()))));
   }
 
-  xml_file_writer writer(filename);
-  doc.save(writer);
+  writer.raw("\t</chunks>\n</rdc>\n");
 
   return writer.stream.GetError();
 }
 
 static SDObject *XML2Obj(pugi::xml_node &obj)
 {
-  SDObject *ret = new SDObject(rdcstr(obj.attribute("name").as_string()),
-                               rdcstr(obj.attribute("typename").as_string()));
+  SDObject *ret = new SDObject(InternStructuredName(obj.attribute("name").as_string()),
+                               InternStructuredName(obj.attribute("typename").as_string()));
 
   rdcstr name = obj.name();
 
@@ -517,11 +553,6 @@ static SDObject *XML2Obj(pugi::xml_node &obj)
   if(obj.attribute("hiddenchildren"))
     ret->type.flags |= SDTypeFlags::HiddenChildren;
 
-  if(obj.attribute("typename"))
-    ret->type.name = obj.attribute("typename").as_string();
-
-  ret->name = obj.attribute("name").as_string();
-
   if(ret->type.basetype == SDBasic::Chunk)
   {
     RDCFATAL("Nested chunks!");
@@ -537,7 +568,7 @@ static SDObject *XML2Obj(pugi::xml_node &obj)
       SDObject *c = ret->AddAndOwnChild(XML2Obj(child));
 
       if(ret->type.basetype == SDBasic::Array)
-        c->name = "$el";
+        c->name = "$el"_lit;
     }
 
     if(ret->type.basetype == SDBasic::Array && ret->NumChildren() > 0)
@@ -576,13 +607,15 @@ static SDObject *XML2Obj(pugi::xml_node &obj)
   return ret;
 }
 
-static RDResult XML2Structured(const rdcstr &xml, const ThumbTypeAndData &thumb,
+static RDResult XML2Structured(rdcstr &xml, const ThumbTypeAndData &thumb,
                                const ThumbTypeAndData &extThumb, const bytebuf &logfile,
                                const StructuredBufferList &buffers, RDCFile *rdc, uint64_t &version,
                                StructuredChunkList &chunks, RENDERDOC_ProgressCallback progress)
 {
   pugi::xml_document doc;
-  doc.load_string(xml.c_str());
+  // parse in place so we don't hold a second copy of the whole document while building the DOM.
+  // This modifies xml, but it's only used to hold the file contents.
+  doc.load_buffer_inplace(xml.data(), xml.size());
 
   pugi::xml_node root = doc.child("rdc");
 
@@ -790,7 +823,7 @@ static RDResult XML2Structured(const rdcstr &xml, const ThumbTypeAndData &thumb,
                           "Malformed xml document, expected <chunk> child under <chunks>, got <%s>",
                           xChunk.name());
 
-    SDChunk *chunk = new SDChunk(rdcstr(xChunk.attribute("name").as_string()));
+    SDChunk *chunk = new SDChunk(InternStructuredName(xChunk.attribute("name").as_string()));
 
     chunk->metadata.chunkID = xChunk.attribute("id").as_uint();
     chunk->metadata.length = xChunk.attribute("length").as_uint();
@@ -858,12 +891,70 @@ static RDResult Buffers2ZIP(const rdcstr &filename, const RDCFile &file,
                         zipFile.c_str(), mz_zip_get_error_string(zip.m_last_error));
   }
 
-  for(size_t i = 0; i < buffers.size(); i++)
+  // miniz's writer is single threaded, so deflate batches of buffers in parallel and add them to
+  // the archive pre-compressed. Batches are limited in total size so that only a bounded amount of
+  // compressed data is held at once.
+  const uint64_t batchBudget = 256ULL * 1024 * 1024;
+  const int bufferLevel = 2;
+  const mz_uint compFlags = tdefl_create_comp_flags_from_zip_params(
+      bufferLevel, -MZ_DEFAULT_WINDOW_BITS, MZ_DEFAULT_STRATEGY);
+
+  struct CompressedBuffer
   {
-    mz_zip_writer_add_mem(&zip, GetBufferName(i).c_str(), buffers[i]->data(), buffers[i]->size(), 2);
+    void *data = NULL;
+    size_t size = 0;
+    mz_uint32 crc = 0;
+  };
 
-    if(progress)
-      progress(BufferProgress(float(i) / float(buffers.size())));
+  rdcarray<CompressedBuffer> compressed;
+
+  for(size_t begin = 0; begin < buffers.size();)
+  {
+    size_t end = begin;
+    uint64_t batchSize = 0;
+    while(end < buffers.size() && (end == begin || batchSize + buffers[end]->size() <= batchBudget))
+      batchSize += buffers[end++]->size();
+
+    compressed.clear();
+    compressed.resize(end - begin);
+
+    Threading::ParallelFor(uint32_t(end - begin), 1, [&](uint32_t batchBegin, uint32_t batchEnd) {
+      for(uint32_t i = batchBegin; i < batchEnd; i++)
+      {
+        const bytebuf &buf = *buffers[begin + i];
+        CompressedBuffer &comp = compressed[i];
+
+        if(buf.empty())
+          continue;
+
+        comp.crc = (mz_uint32)mz_crc32(MZ_CRC32_INIT, buf.data(), buf.size());
+        comp.data = tdefl_compress_mem_to_heap(buf.data(), buf.size(), &comp.size, compFlags);
+      }
+    });
+
+    for(size_t i = begin; i < end; i++)
+    {
+      CompressedBuffer &comp = compressed[i - begin];
+
+      if(comp.data)
+      {
+        mz_zip_writer_add_mem_ex(&zip, GetBufferName(i).c_str(), comp.data, comp.size, NULL, 0,
+                                 bufferLevel | MZ_ZIP_FLAG_COMPRESSED_DATA, buffers[i]->size(),
+                                 comp.crc);
+        mz_free(comp.data);
+      }
+      else
+      {
+        // empty buffers, or if compression failed let miniz handle it
+        mz_zip_writer_add_mem(&zip, GetBufferName(i).c_str(), buffers[i]->data(),
+                              buffers[i]->size(), bufferLevel);
+      }
+
+      if(progress)
+        progress(BufferProgress(float(i) / float(buffers.size())));
+    }
+
+    begin = end;
   }
 
   const RDCThumb &th = file.GetThumbnail();
@@ -966,9 +1057,9 @@ static RDResult ZIP2Buffers(const rdcstr &filename, ThumbTypeAndData &thumb,
       mz_zip_archive_file_stat zstat;
       mz_zip_reader_file_stat(&zip, i, &zstat);
 
-      size_t sz = 0;
-
-      byte *buf = (byte *)mz_zip_reader_extract_to_heap(&zip, i, &sz, 0);
+      // decompress directly into wherever the data is going, rather than to a temporary heap
+      // allocation that then gets copied
+      bytebuf *dst = NULL;
 
       // thumbnails are stored separately
       if(strstr(zstat.m_filename, "thumb"))
@@ -982,18 +1073,18 @@ static RDResult ZIP2Buffers(const rdcstr &filename, ThumbTypeAndData &thumb,
         if(strstr(zstat.m_filename, "ext_thumb"))
         {
           extThumb.format = type;
-          extThumb.data.assign(buf, sz);
+          dst = &extThumb.data;
         }
         else
         {
           thumb.format = type;
-          thumb.data.assign(buf, sz);
+          dst = &thumb.data;
         }
       }
       else if(strstr(zstat.m_filename, "diagnostic.log"))
       {
         // same for logfile
-        logfile.assign(buf, sz);
+        dst = &logfile;
       }
       else
       {
@@ -1002,11 +1093,17 @@ static RDResult ZIP2Buffers(const rdcstr &filename, ThumbTypeAndData &thumb,
         if(bufname < (int)buffers.size())
         {
           buffers[bufname] = new bytebuf;
-          buffers[bufname]->assign(buf, sz);
+          dst = buffers[bufname];
         }
       }
 
-      free(buf);
+      if(dst)
+      {
+        dst->resize((size_t)zstat.m_uncomp_size);
+        if(!dst->empty() && !mz_zip_reader_extract_to_mem(&zip, i, dst->data(), dst->size(), 0))
+          RDCERR("Failed to extract %s from zip: %s", zstat.m_filename,
+                 mz_zip_get_error_string(zip.m_last_error));
+      }
 
       if(progress)
         progress(BufferProgress(float(i) / float(numfiles)));
@@ -1034,7 +1131,7 @@ RDResult importXMLZ(const rdcstr &filename, StreamReader &reader, RDCFile *rdc,
   buf.resize((size_t)reader.GetSize());
   reader.Read(buf.data(), buf.size());
 
-  return XML2Structured(buf.c_str(), thumb, extThumb, logfile, structData.buffers, rdc,
+  return XML2Structured(buf, thumb, extThumb, logfile, structData.buffers, rdc,
                         structData.version, structData.chunks, progress);
 }
 
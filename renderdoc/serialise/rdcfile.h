@@ -75,6 +75,7 @@ public:
   void Create(const rdcstr &filename);
 
   const RDResult &Error() const { return m_Error; }
+  const rdcstr &GetFilename() const { return m_Filename; }
   RDCDriver GetDriver() const { return m_Driver; }
   const rdcstr &GetDriverName() const { return m_DriverName; }
   uint64_t GetMachineIdent() const { return m_MachineIdent; }
@@ -27,6 +27,7 @@
 
 #include "serialiser.h"
 #include "api/replay/renderdoc_replay.h"
+#include "common/threading.h"
 #include "core/core.h"
 #include "strings/string_utils.h"
 
@@ -666,10 +667,34 @@ rdcstr DoStringise(const SDChunkFlags &el)
   END_BITFIELD_STRINGISE();
 }
 
+static Threading::CriticalSection internedNamesLock;
+static std::set<rdcstr> internedNames;
+
+rdcinflexiblestr InternStructuredName(const rdcstr &name)
+{
+  SCOPED_LOCK(internedNamesLock);
+
+  // set nodes are never moved and names are never removed, so the string storage - whether inline
+  // or allocated - stays at the same address for the lifetime of the process
+  const rdcstr &interned = *internedNames.insert(name).first;
+
+  // wrap it as a literal so it's referenced rather than copied or freed
+  return operator"" _lit(interned.c_str(), interned.size());
+}
+
+// names are serialised as normal strings, but interned when reading
+#define SERIALISE_NAME_MEMBER(name)         \
+  {                                         \
+    rdcstr name = el.name;                  \
+    SERIALISE_ELEMENT(name);                \
+    if(ser.IsReading())                     \
+      el.name = InternStructuredName(name); \
+  }
+
 template <class SerialiserType>
 void DoSerialise(SerialiserType &ser, SDType &el)
 {
-  SERIALISE_MEMBER(name);
+  SERIALISE_NAME_MEMBER(name);
   SERIALISE_MEMBER(basetype);
   SERIALISE_MEMBER(flags);
   SERIALISE_MEMBER(byteSize);
@@ -735,7 +760,7 @@ void DoSerialise(SerialiserType &ser, SDObject &el, StructuredObjectList &childr
 template <class SerialiserType>
 void DoSerialise(SerialiserType &ser, SDObject &el)
 {
-  SERIALISE_MEMBER(name);
+  SERIALISE_NAME_MEMBER(name);
   SERIALISE_MEMBER(type);
   SERIALISE_MEMBER(data);
 
@@ -745,7 +770,7 @@ void DoSerialise(SerialiserType &ser, SDObject &el)
 template <class SerialiserType>
 void DoSerialise(SerialiserType &ser, SDChunk &el)
 {
-  SERIALISE_MEMBER(name);
+  SERIALISE_NAME_MEMBER(name);
   SERIALISE_MEMBER(type);
   SERIALISE_MEMBER(metadata);
   SERIALISE_MEMBER(data);
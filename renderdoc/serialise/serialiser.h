@@ -53,6 +53,12 @@ void Deserialise(const T &el)
 
 typedef rdcstr (*ChunkLookup)(uint32_t chunkType);
 
+// returns a string for use as an SDObject, SDType or SDChunk name which points into a global table
+// of names that is never freed. Structured data that's built from runtime strings (e.g. read over
+// the network or imported) would otherwise allocate a copy of the same few member and type names
+// for every object. Only use this for names, not arbitrary string data.
+rdcinflexiblestr InternStructuredName(const rdcstr &name);
+
 enum class SerialiserFlags
 {
   NoFlags = 0x0,
@@ -26,6 +26,8 @@
 
 #if ENABLED(ENABLE_UNIT_TESTS)
 
+#include "os/os_specific.h"
+
 #include "catch/catch.hpp"
 
 void WriteAllBasicTypes(WriteSerialiser &ser)
@@ -595,6 +597,159 @@ TEST_CASE("Read/writing large buffers", "[serialiser]")
   FileIO::Delete(filename);
 };
 
+// builds a chunk shaped like typical captured data, with structs of members whose names and types
+// are runtime strings rather than literals - as if it had been imported or read from the network.
+static SDChunk *MakeRuntimeNamedChunk(const rdcarray<rdcstr> &names, uint32_t numStructs,
+                                      uint32_t numMembers)
+{
+  SDChunk *chunk = new SDChunk(rdcstr("vkCmdDraw"));
+
+  for(uint32_t s = 0; s < numStructs; s++)
+  {
+    SDObject *obj =
+        chunk->AddAndOwnChild(new SDObject(names[s % names.size()], rdcstr("VkStructure")));
+    obj->type.basetype = SDBasic::Struct;
+
+    for(uint32_t m = 0; m < numMembers; m++)
+    {
+      SDObject *member = obj->AddAndOwnChild(
+          new SDObject(names[(s + m) % names.size()], rdcstr(m % 2 ? "uint32_t" : "float")));
+      member->type.basetype = SDBasic::UnsignedInteger;
+      member->type.byteSize = 4;
+      member->data.basic.u = s * m;
+    }
+  }
+
+  return chunk;
+}
+
+static void CheckSameNames(const SDObject *a, const SDObject *b)
+{
+  CHECK(a->name == b->name);
+  CHECK(a->type.name == b->type.name);
+  REQUIRE(a->NumChildren() == b->NumChildren());
+  for(size_t i = 0; i < a->NumChildren(); i++)
+    CheckSameNames(a->GetChild(i), b->GetChild(i));
+}
+
+TEST_CASE("Structured data names are interned when read", "[serialiser][structured]")
+{
+  rdcarray<rdcstr> names = {"pCreateInfo", "sType", "offset", "size"};
+
+  SDChunk *chunk = MakeRuntimeNamedChunk(names, 8, 4);
+
+  StreamWriter *buf = new StreamWriter(StreamWriter::DefaultScratchSize);
+
+  {
+    WriteSerialiser ser(buf, Ownership::Nothing);
+    ser.WriteChunk(1);
+    ser.Serialise("chunk"_lit, *chunk);
+    ser.EndChunk();
+  }
+
+  SDChunk *read = new SDChunk(""_lit);
+
+  {
+    ReadSerialiser ser(new StreamReader(buf->GetData(), buf->GetOffset()), Ownership::Stream);
+    ser.ReadChunk<uint32_t>();
+    ser.Serialise("chunk"_lit, *read);
+    ser.EndChunk();
+    REQUIRE_FALSE(ser.IsErrored());
+  }
+
+  CheckSameNames(chunk, read);
+
+  // every object with the same name shares the same storage, including with a separate lookup
+  for(size_t s = 0; s < read->NumChildren(); s++)
+  {
+    const SDObject *obj = read->GetChild(s);
+    CHECK(obj->name.c_str() == InternStructuredName(names[s % names.size()]).c_str());
+    CHECK(obj->type.name.c_str() == read->GetChild(0)->type.name.c_str());
+
+    for(size_t m = 0; m < obj->NumChildren(); m++)
+    {
+      CHECK(obj->GetChild(m)->name.c_str() ==
+            InternStructuredName(names[(s + m) % names.size()]).c_str());
+      CHECK(obj->GetChild(m)->type.name.c_str() ==
+            read->GetChild(0)->GetChild(m % 2)->type.name.c_str());
+    }
+  }
+
+  // interned names can be copied and assigned freely without being freed underneath anyone
+  {
+    SDObject *dup = read->GetChild(0)->Duplicate();
+    CHECK(dup->name.c_str() == read->GetChild(0)->name.c_str());
+    delete dup;
+  }
+
+  delete read;
+  delete chunk;
+  delete buf;
+};
+
+TEST_CASE("Benchmark structured data name memory", "[serialiser][.benchmark]")
+{
+  // roughly the size of the structured data for a large capture: 1M objects, with names drawn from
+  // a vocabulary of a couple of hundred member and type names
+  const uint32_t numChunks = 20000;
+  const uint32_t numStructs = 10;
+  const uint32_t numMembers = 4;
+
+  rdcarray<rdcstr> names;
+  for(uint32_t i = 0; i < 200; i++)
+    names.push_back(StringFormat::Fmt("memberName%u", i));
+
+  StreamWriter *buf = new StreamWriter(StreamWriter::DefaultScratchSize);
+
+  {
+    WriteSerialiser ser(buf, Ownership::Nothing);
+    ser.WriteChunk(1);
+    for(uint32_t c = 0; c < numChunks; c++)
+    {
+      SDChunk *chunk = MakeRuntimeNamedChunk(names, numStructs, numMembers);
+      ser.Serialise("chunk"_lit, *chunk);
+      delete chunk;
+    }
+    ser.EndChunk();
+  }
+
+  SDFile file;
+  file.chunks.resize(numChunks);
+
+  uint64_t before = Process::GetMemoryUsage();
+
+  {
+    ReadSerialiser ser(new StreamReader(buf->GetData(), buf->GetOffset()), Ownership::Stream);
+    ser.ReadChunk<uint32_t>();
+    for(uint32_t c = 0; c < numChunks; c++)
+    {
+      file.chunks[c] = new SDChunk(""_lit);
+      ser.Serialise("chunk"_lit, *file.chunks[c]);
+    }
+    ser.EndChunk();
+  }
+
+  uint64_t interned = Process::GetMemoryUsage();
+
+  // give every object its own copy of its names, as they had before interning
+  std::function<void(SDObject *)> copyNames = [&copyNames](SDObject *obj) {
+    obj->name = rdcstr(obj->name.c_str());
+    obj->type.name = rdcstr(obj->type.name.c_str());
+    for(size_t i = 0; i < obj->NumChildren(); i++)
+      copyNames(obj->GetChild(i));
+  };
+  for(SDChunk *chunk : file.chunks)
+    copyNames(chunk);
+
+  uint64_t copied = Process::GetMemoryUsage();
+
+  RDCLOG("%u structured objects: %.1f MB with interned names, %.1f MB with per-object names",
+         numChunks * (1 + numStructs * (1 + numMembers)), double(interned - before) / 1048576.0,
+         double(copied - before) / 1048576.0);
+
+  delete buf;
+};
+
 TEST_CASE("Read/write chunk metadata", "[serialiser]")
 {
   StreamWriter *buf = new StreamWriter(StreamWriter::DefaultScratchSize);
@@ -527,9 +527,11 @@ private:
 
     if(bufferSize < newSize)
     {
-      // reallocate to a conservative size, don't 'double and allocate'
+      // reallocate to a conservative size, don't 'double and allocate'. Large buffers still grow by
+      // a fraction of their size so that filling a big in-memory stream isn't quadratic.
+      const uint64_t increment = RDCMAX(uint64_t(128 * 1024), bufferSize / 8);
       while(bufferSize < newSize)
-        bufferSize += 128 * 1024;
+        bufferSize += increment;
 
       byte *newBuf = AllocAlignedBuffer(bufferSize);
 
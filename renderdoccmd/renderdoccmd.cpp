@@ -26,7 +26,12 @@
 #include "renderdoccmd.h"
 #include <app/renderdoc_app.h>
 #include <replay/version.h>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <mutex>
 #include <string>
+#include <thread>
 
 rdcstr conv(const std::string &s)
 {
@@ -1258,6 +1263,502 @@ public:
   }
 };
 
+// a single capture processed by the batch command
+struct BatchJob
+{
+  std::string infile;
+  std::string outfile;
+  bool success = false;
+  std::string error;
+  double openMS = 0.0;
+  double processMS = 0.0;
+  double totalMS = 0.0;
+};
+
+static double msSince(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+static bool WriteBatchOutput(const std::string &filename, const bytebuf &data, std::string &error)
+{
+  FILE *f = fopen(filename.c_str(), "wb");
+
+  if(!f)
+  {
+    error = "Couldn't open destination file '" + filename + "'";
+    return false;
+  }
+
+  size_t written = fwrite(data.data(), 1, data.size(), f);
+
+  if(fclose(f) != 0 || written != data.size())
+  {
+    error = "Couldn't write destination file '" + filename + "'";
+    return false;
+  }
+
+  return true;
+}
+
+static void ProcessBatchJob(const std::string &action, const std::string &format,
+                            const std::string &section, BatchJob &job)
+{
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+  ICaptureFile *file = RENDERDOC_OpenCaptureFile();
+
+  ResultDetails st = file->OpenFile(conv(job.infile), "", NULL);
+
+  job.openMS = msSince(start);
+
+  if(st.OK())
+  {
+    start = std::chrono::steady_clock::now();
+
+    if(action == "convert" || action == "structured")
+    {
+      st = file->Convert(conv(job.outfile), conv(format), NULL, NULL);
+
+      job.success = st.OK();
+      if(!job.success)
+        job.error = conv(st.Message());
+    }
+    else if(action == "thumb")
+    {
+      FileType type = FileType::JPG;
+      if(format == "png")
+        type = FileType::PNG;
+      else if(format == "tga")
+        type = FileType::TGA;
+      else if(format == "bmp")
+        type = FileType::BMP;
+
+      bytebuf buf = file->GetThumbnail(type, 0).data;
+
+      if(buf.empty())
+        job.error = "Capture has no thumbnail";
+      else
+        job.success = WriteBatchOutput(job.outfile, buf, job.error);
+    }
+    else if(action == "extract")
+    {
+      int idx = file->FindSectionByName(conv(section));
+
+      if(idx < 0)
+        job.error = "Capture has no section called '" + section + "'";
+      else
+        job.success = WriteBatchOutput(job.outfile, file->GetSectionContents(idx), job.error);
+    }
+
+    job.processMS = msSince(start);
+  }
+  else
+  {
+    job.error = conv(st.Message());
+  }
+
+  file->Shutdown();
+}
+
+// processes one capture for the batch command, which runs this in a child process per capture.
+// Loading and converting captures relies on process-wide state like the progress callbacks, so
+// captures can't safely be processed on several threads of one process.
+struct BatchJobCommand : public Command
+{
+private:
+  std::string action;
+  std::string format;
+  std::string section;
+  std::string result;
+  BatchJob job;
+
+public:
+  BatchJobCommand() : Command() {}
+  virtual void AddOptions(cmdline::parser &parser)
+  {
+    parser.add<std::string>("action", 'a', "", true);
+    parser.add<std::string>("format", 'f', "", false);
+    parser.add<std::string>("section", 's', "", false);
+    parser.add<std::string>("input", 'i', "", true);
+    parser.add<std::string>("output", 'o', "", true);
+    parser.add<std::string>("result", 'r', "", true);
+  }
+  virtual const char *Description() { return "Internal use only!"; }
+  virtual bool IsInternalOnly() { return true; }
+  virtual bool IsCaptureCommand() { return false; }
+  virtual bool Parse(cmdline::parser &parser, GlobalEnvironment &)
+  {
+    action = parser.get<std::string>("action");
+    format = parser.get<std::string>("format");
+    section = parser.get<std::string>("section");
+    job.infile = parser.get<std::string>("input");
+    job.outfile = parser.get<std::string>("output");
+    result = parser.get<std::string>("result");
+    return true;
+  }
+  virtual int Execute(const CaptureOptions &)
+  {
+    ProcessBatchJob(action, format, section, job);
+
+    // the result is read back by the batch command: success, timings, then the error message
+    FILE *f = fopen(result.c_str(), "w");
+    if(f)
+    {
+      fprintf(f, "%d\n%f %f\n%s\n", job.success ? 1 : 0, job.openMS, job.processMS,
+              job.error.c_str());
+      fclose(f);
+    }
+
+    return job.success ? 0 : 1;
+  }
+};
+
+struct BatchCommand : public Command
+{
+private:
+  std::string input;
+  std::string outdir;
+  std::string action;
+  std::string format;
+  std::string section;
+  std::string report;
+  uint32_t numJobs = 0;
+
+  std::vector<BatchJob> m_Jobs;
+  std::mutex m_OutputLock;
+
+  static std::string basename_noext(const std::string &path)
+  {
+    size_t slash = path.find_last_of("/\\");
+    std::string name = slash == std::string::npos ? path : path.substr(slash + 1);
+
+    size_t dot = name.rfind(".rdc");
+    if(dot != std::string::npos && dot + 4 == name.size())
+      name.erase(dot);
+
+    return name;
+  }
+
+  static std::string json_escape(const std::string &str)
+  {
+    std::string ret;
+    for(char c : str)
+    {
+      if(c == '"' || c == '\\')
+      {
+        ret += '\\';
+        ret += c;
+      }
+      else if(c == '\n')
+      {
+        ret += "\\n";
+      }
+      else if((unsigned char)c < 0x20)
+      {
+        ret += ' ';
+      }
+      else
+      {
+        ret += c;
+      }
+    }
+    return ret;
+  }
+
+  bool GatherInputs(std::vector<std::string> &files)
+  {
+    std::vector<std::string> names;
+
+    if(ListDirectory(input, names))
+    {
+      for(const std::string &name : names)
+      {
+        if(name.size() > 4 && name.compare(name.size() - 4, 4, ".rdc") == 0)
+          files.push_back(input + "/" + name);
+      }
+
+      std::sort(files.begin(), files.end());
+      return true;
+    }
+
+    // otherwise treat it as a manifest, with one capture path per line
+    std::ifstream manifest(input);
+
+    if(!manifest)
+    {
+      std::cerr << "Couldn't open '" << input << "' as a directory or a manifest." << std::endl;
+      return false;
+    }
+
+    std::string line;
+    while(std::getline(manifest, line))
+    {
+      while(!line.empty() && isspace((unsigned char)line.back()))
+        line.pop_back();
+
+      if(line.empty() || line[0] == '#')
+        continue;
+
+      files.push_back(line);
+    }
+
+    return true;
+  }
+
+  void Process(BatchJob &job)
+  {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    const std::string result = job.outfile + ".result";
+    remove(result.c_str());
+
+    std::vector<std::string> args = {
+        "batchjob", "-a", action, "-i", job.infile, "-o", job.outfile, "-r", result,
+    };
+
+    if(!format.empty())
+      args.insert(args.end(), {"-f", format});
+    if(!section.empty())
+      args.insert(args.end(), {"-s", section});
+
+    int exitCode = RunSelf(args);
+
+    job.totalMS = msSince(start);
+
+    std::ifstream resultFile(result);
+
+    int success = 0;
+    if(resultFile >> success >> job.openMS >> job.processMS)
+    {
+      job.success = success != 0;
+      resultFile.ignore(1);
+      std::getline(resultFile, job.error);
+    }
+    else if(exitCode < 0)
+    {
+      job.error = "Couldn't run a process to handle the capture";
+    }
+    else
+    {
+      job.error = "Processing the capture failed with exit code " + std::to_string(exitCode);
+    }
+
+    resultFile.close();
+    remove(result.c_str());
+  }
+
+  void WriteReport(uint32_t workers, double totalMS)
+  {
+    FILE *f = fopen(report.c_str(), "w");
+
+    if(!f)
+    {
+      std::cerr << "Couldn't open report file '" << report << "'" << std::endl;
+      return;
+    }
+
+    size_t succeeded = 0;
+    for(const BatchJob &job : m_Jobs)
+      succeeded += job.success ? 1 : 0;
+
+    fprintf(f, "{\n");
+    fprintf(f, "  \"action\": \"%s\",\n", json_escape(action).c_str());
+    fprintf(f, "  \"workers\": %u,\n", workers);
+    fprintf(f, "  \"totalMS\": %.3f,\n", totalMS);
+    fprintf(f, "  \"succeeded\": %zu,\n", succeeded);
+    fprintf(f, "  \"failed\": %zu,\n", m_Jobs.size() - succeeded);
+    fprintf(f, "  \"files\": [\n");
+    for(size_t i = 0; i < m_Jobs.size(); i++)
+    {
+      const BatchJob &job = m_Jobs[i];
+      fprintf(f,
+              "    {\"input\": \"%s\", \"output\": \"%s\", \"success\": %s, \"error\": \"%s\", "
+              "\"openMS\": %.3f, \"processMS\": %.3f, \"totalMS\": %.3f}%s\n",
+              json_escape(job.infile).c_str(), json_escape(job.outfile).c_str(),
+              job.success ? "true" : "false", json_escape(job.error).c_str(), job.openMS,
+              job.processMS, job.totalMS, i + 1 < m_Jobs.size() ? "," : "");
+    }
+    fprintf(f, "  ]\n");
+    fprintf(f, "}\n");
+
+    fclose(f);
+  }
+
+public:
+  BatchCommand() : Command() {}
+  virtual void AddOptions(cmdline::parser &parser)
+  {
+    parser.set_footer("<directory or manifest>");
+    parser.add<std::string>(
+        "action", 'a', "What to do with each capture.", false, "convert",
+        cmdline::oneof<std::string>("convert", "structured", "thumb", "extract"));
+    parser.add<std::string>("output-dir", 'o',
+                            "The directory to write output files to, created if it doesn't exist.",
+                            true);
+    parser.add<std::string>("format", 'f',
+                            "The output format. For convert this is a capture format, for "
+                            "structured it defaults to zip.xml, and for thumb it defaults to jpg.",
+                            false);
+    parser.add<std::string>("section", 's', "The section to extract, for the extract action.",
+                            false);
+    parser.add<uint32_t>("jobs", 'j',
+                         "How many captures to process at once, each in its own process. This "
+                         "bounds memory use. Default is 0, one per core.",
+                         false, 0);
+    parser.add<std::string>("report", 'r', "Write a JSON timing report to this file.", false);
+  }
+  virtual const char *Description()
+  {
+    return "Process a directory or manifest of captures in parallel.";
+  }
+  virtual bool IsInternalOnly() { return false; }
+  virtual bool IsCaptureCommand() { return false; }
+  virtual bool Parse(cmdline::parser &parser, GlobalEnvironment &)
+  {
+    std::vector<std::string> rest = parser.rest();
+    if(rest.empty())
+    {
+      std::cerr << "Error: batch command requires a directory or manifest file." << std::endl
+                << std::endl
+                << parser.usage();
+      return false;
+    }
+
+    input = rest[0];
+
+    rest.erase(rest.begin());
+
+    parser.set_rest(rest);
+
+    action = parser.get<std::string>("action");
+    outdir = parser.get<std::string>("output-dir");
+    format = parser.get<std::string>("format");
+    section = parser.get<std::string>("section");
+    numJobs = parser.get<uint32_t>("jobs");
+    report = parser.get<std::string>("report");
+
+    if(action == "convert" && format.empty())
+    {
+      std::cerr << "Need an output format (-f) to convert to." << std::endl << std::endl;
+      std::cerr << parser.usage() << std::endl;
+      return false;
+    }
+
+    if(action == "extract" && section.empty())
+    {
+      std::cerr << "Need a section name (-s) to extract." << std::endl << std::endl;
+      std::cerr << parser.usage() << std::endl;
+      return false;
+    }
+
+    if(action == "structured" && format.empty())
+      format = "zip.xml";
+    else if(action == "thumb" && format.empty())
+      format = "jpg";
+
+    return true;
+  }
+
+  virtual int Execute(const CaptureOptions &)
+  {
+    std::vector<std::string> files;
+    if(!GatherInputs(files))
+      return 1;
+
+    if(files.empty())
+    {
+      std::cerr << "No captures found in '" << input << "'." << std::endl;
+      return 1;
+    }
+
+    if(!CreateDirectories(outdir))
+    {
+      std::cerr << "Couldn't create output directory '" << outdir << "'." << std::endl;
+      return 1;
+    }
+
+    std::string ext = format;
+    if(action == "extract")
+    {
+      ext = section + ".bin";
+      std::replace(ext.begin(), ext.end(), '/', '_');
+    }
+
+    // captures from a manifest may share names, so make the outputs unique
+    std::map<std::string, int> names;
+
+    m_Jobs.resize(files.size());
+    for(size_t i = 0; i < files.size(); i++)
+    {
+      std::string name = basename_noext(files[i]);
+      int count = names[name]++;
+      if(count > 0)
+        name += "_" + std::to_string(count);
+
+      m_Jobs[i].infile = files[i];
+      m_Jobs[i].outfile = outdir + "/" + name + "." + ext;
+    }
+
+    uint32_t workers = numJobs;
+    if(workers == 0)
+      workers = std::max(1U, std::thread::hardware_concurrency());
+    workers = std::min(workers, (uint32_t)m_Jobs.size());
+
+    std::atomic<size_t> next(0);
+    std::atomic<size_t> failed(0);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    auto worker = [&]() {
+      for(;;)
+      {
+        size_t idx = next++;
+        if(idx >= m_Jobs.size())
+          break;
+
+        Process(m_Jobs[idx]);
+
+        BatchJob &job = m_Jobs[idx];
+
+        std::lock_guard<std::mutex> lock(m_OutputLock);
+
+        if(job.success)
+        {
+          std::cout << "[" << (idx + 1) << "/" << m_Jobs.size() << "] Wrote '" << job.outfile
+                    << "' from '" << job.infile << "'" << std::endl;
+        }
+        else
+        {
+          failed++;
+          std::cerr << "[" << (idx + 1) << "/" << m_Jobs.size() << "] Failed on '" << job.infile
+                    << "': " << job.error << std::endl;
+        }
+      }
+    };
+
+    std::vector<std::thread> threads;
+    for(uint32_t i = 1; i < workers; i++)
+      threads.push_back(std::thread(worker));
+
+    worker();
+
+    for(std::thread &t : threads)
+      t.join();
+
+    double totalMS = msSince(start);
+
+    std::cout << "Processed " << m_Jobs.size() << " captures (" << failed.load() << " failed) in "
+              << totalMS / 1000.0 << "s with " << workers << " workers." << std::endl;
+
+    if(!report.empty())
+      WriteReport(workers, totalMS);
+
+    return failed.load() > 0 ? 1 : 0;
+  }
+};
+
 struct VulkanRegisterCommand : public Command
 {
 private:
@@ -1565,6 +2066,8 @@ int renderdoccmd(GlobalEnvironment &env, std::vector<std::string> &argv)
     add_command("convert", new ConvertCommand());
     add_command("embed", new EmbeddedSectionCommand(false));
     add_command("extract", new EmbeddedSectionCommand(true));
+    add_command("batch", new BatchCommand());
+    add_command("batchjob", new BatchJobCommand());
 
     if(argv.size() <= 1)
     {
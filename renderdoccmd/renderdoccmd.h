@@ -58,3 +58,10 @@ void DisplayRendererPreview(IReplayController *renderer, TextureDisplay &display
                             uint32_t height, uint32_t numLoops);
 WindowingData DisplayRemoteServerPreview(bool active, const rdcarray<WindowingSystem> &systems);
 void Daemonise();
+
+// used by the batch command. ListDirectory returns the names of the regular files in path, and
+// RunSelf runs this executable with the given arguments and returns its exit code, or -1 if it
+// couldn't be run
+bool ListDirectory(const std::string &path, std::vector<std::string> &files);
+bool CreateDirectories(const std::string &path);
+int RunSelf(const std::vector<std::string> &args);
@@ -370,6 +370,22 @@ void DisplayRendererPreview(IReplayController *renderer, TextureDisplay &display
 // Returns the renderdoccmd arguments passed via am start
 // Examples: am start ... -e renderdoccmd "remoteserver"
 // -e renderdoccmd "replay /sdcard/capture.rdc"
+// batch processing isn't supported on android
+bool ListDirectory(const std::string &path, std::vector<std::string> &files)
+{
+  return false;
+}
+
+bool CreateDirectories(const std::string &path)
+{
+  return false;
+}
+
+int RunSelf(const std::vector<std::string> &args)
+{
+  return -1;
+}
+
 std::vector<std::string> getRenderdoccmdArgs()
 {
   JNIEnv *env;
@@ -23,8 +23,14 @@
  ******************************************************************************/
 
 #include "renderdoccmd.h"
+#include <dirent.h>
+#include <errno.h>
+#include <limits.h>
 #include <signal.h>
 #include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
 #include <unistd.h>
 
 #include <ggp_c/ggp.h>
@@ -137,6 +143,75 @@ void DisplayRendererPreview(IReplayController *renderer, TextureDisplay &display
   Finalize();
 }
 
+bool ListDirectory(const std::string &path, std::vector<std::string> &files)
+{
+  DIR *d = opendir(path.c_str());
+
+  if(!d)
+    return false;
+
+  for(dirent *ent = readdir(d); ent; ent = readdir(d))
+  {
+    std::string name = ent->d_name;
+
+    struct stat st = {};
+    if(stat((path + "/" + name).c_str(), &st) == 0 && S_ISREG(st.st_mode))
+      files.push_back(name);
+  }
+
+  closedir(d);
+
+  return true;
+}
+
+bool CreateDirectories(const std::string &path)
+{
+  struct stat st = {};
+
+  for(size_t sep = path.find('/', 1); sep != std::string::npos; sep = path.find('/', sep + 1))
+    mkdir(path.substr(0, sep).c_str(), 0775);
+
+  mkdir(path.c_str(), 0775);
+
+  return stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+int RunSelf(const std::vector<std::string> &args)
+{
+  char exepath[PATH_MAX + 1] = {};
+  if(readlink("/proc/self/exe", exepath, PATH_MAX) <= 0)
+    return -1;
+
+  std::vector<char *> argv;
+  argv.push_back((char *)exepath);
+  for(const std::string &a : args)
+    argv.push_back((char *)a.c_str());
+  argv.push_back(NULL);
+
+  pid_t pid = fork();
+
+  if(pid == 0)
+  {
+    execv(exepath, argv.data());
+    _exit(127);
+  }
+
+  if(pid < 0)
+    return -1;
+
+  int status = 0;
+  while(waitpid(pid, &status, 0) < 0)
+  {
+    if(errno != EINTR)
+      return -1;
+  }
+
+  if(WIFEXITED(status))
+    return WEXITSTATUS(status);
+
+  return -1;
+}
+
 void sig_handler(int signo)
 {
   if(usingKillSignal)
@@ -239,6 +239,99 @@ void DisplayRendererPreview(IReplayController *renderer, TextureDisplay &display
   DestroyWindow(wnd);
 }
 
+bool ListDirectory(const std::string &path, std::vector<std::string> &files)
+{
+  WIN32_FIND_DATAW findData = {};
+  HANDLE find = FindFirstFileW(conv(path + "\\*").c_str(), &findData);
+
+  if(find == INVALID_HANDLE_VALUE)
+    return false;
+
+  do
+  {
+    if((findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0)
+      files.push_back(conv(std::wstring(findData.cFileName)));
+  } while(FindNextFileW(find, &findData) != FALSE);
+
+  FindClose(find);
+
+  return true;
+}
+
+bool CreateDirectories(const std::string &path)
+{
+  std::wstring wpath = conv(path);
+
+  for(size_t sep = wpath.find_first_of(L"/\\", 1); sep != std::wstring::npos;
+      sep = wpath.find_first_of(L"/\\", sep + 1))
+    CreateDirectoryW(wpath.substr(0, sep).c_str(), NULL);
+
+  CreateDirectoryW(wpath.c_str(), NULL);
+
+  DWORD attribs = GetFileAttributesW(wpath.c_str());
+
+  return attribs != INVALID_FILE_ATTRIBUTES && (attribs & FILE_ATTRIBUTE_DIRECTORY);
+}
+
+int RunSelf(const std::vector<std::string> &args)
+{
+  wchar_t exepath[MAX_PATH + 1] = {};
+  GetModuleFileNameW(NULL, exepath, MAX_PATH);
+
+  std::wstring cmdline = L"\"";
+  cmdline += exepath;
+  cmdline += L"\"";
+
+  // quote each argument so that CommandLineToArgvW will give back the original string
+  for(const std::string &a : args)
+  {
+    std::wstring arg = conv(a);
+
+    cmdline += L" \"";
+
+    size_t backslashes = 0;
+    for(wchar_t c : arg)
+    {
+      if(c == L'\\')
+      {
+        backslashes++;
+      }
+      else
+      {
+        // backslashes are only special before a quote
+        if(c == L'"')
+          cmdline.append(backslashes + 1, L'\\');
+        backslashes = 0;
+      }
+
+      cmdline += c;
+    }
+
+    // double any trailing backslashes so they don't escape the closing quote
+    cmdline.append(backslashes, L'\\');
+    cmdline += L"\"";
+  }
+
+  PROCESS_INFORMATION pi;
+  STARTUPINFOW si;
+  ZeroMemory(&pi, sizeof(pi));
+  ZeroMemory(&si, sizeof(si));
+  si.cb = sizeof(si);
+
+  if(!CreateProcessW(NULL, &cmdline[0], NULL, NULL, FALSE, 0, NULL, NULL, &si, &pi))
+    return -1;
+
+  WaitForSingleObject(pi.hProcess, INFINITE);
+
+  DWORD exitCode = ~0U;
+  GetExitCodeProcess(pi.hProcess, &exitCode);
+
+  CloseHandle(pi.hProcess);
+  CloseHandle(pi.hThread);
+
+  return (int)exitCode;
+}
+
 struct UpgradeCommand : public Command
 {
 private:
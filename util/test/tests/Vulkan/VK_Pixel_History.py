@@ -223,6 +223,27 @@ class VK_Pixel_History(rdtest.TestCase):
         self.check_events(events, modifs, False)
         self.check_pixel_value(tex, x, y, value_selector(modifs[-1].postMod.col), sub=sub, cast=rt.typeCast)
 
+        self.region_test(tex, 274, 259, sub, rt.typeCast)
+
+    def region_test(self, tex, x, y, sub, typeCast):
+        rdtest.log.print("Testing region history around pixel {}, {}".format(x + 1, y + 1))
+
+        region: List[rd.PixelHistoryResult] = self.controller.PixelHistoryRegion(tex, x, y, 3, 3, sub, typeCast)
+        self.check(len(region) == 9, "Expected 9 pixels in region, got {}".format(len(region)))
+
+        for i, res in enumerate(region):
+            self.check(res.x == x + i % 3 and res.y == y + i // 3,
+                       "Pixel {} is at {},{} not {},{}".format(i, res.x, res.y, x + i % 3, y + i // 3))
+
+            # querying the region again for single pixels should use cached occlusion results and still
+            # match exactly
+            modifs: List[rd.PixelModification] = self.controller.PixelHistory(tex, res.x, res.y, sub, typeCast)
+            if len(modifs) != len(res.modifications) or any(a != b for a, b in zip(modifs, res.modifications)):
+                raise rdtest.TestFailureException(
+                    "Region history at {},{} doesn't match single pixel history".format(res.x, res.y))
+
+        rdtest.log.success("Region history matches single pixel history")
+
     def multisampled_image_test(self):
         test_marker: rd.ActionDescription = self.find_action("Multisampled: test")
         action_eid = test_marker.next.eventId